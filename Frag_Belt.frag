@@ -8,8 +8,9 @@ in vec2 vs_out_tex;
 // kimen rtk - a fragment szne
 out vec4 fs_out_col;
 
-// textra mintavtelez objektum
-uniform sampler2D texImage;
+// textra mintavtelez objektum: a textratmb s benne a rteg
+uniform sampler2DArray texImages;
+uniform int layer;
 
 /* segtsg:
 	    - normalizls: http://www.opengl.org/sdk/docs/manglsl/xhtml/normalize.xml
@@ -33,5 +34,5 @@ void main()
 	
 	// normal vector debug:
 	// fs_out_col = vec4( normal * 0.5 + 0.5, 1.0 );
-	fs_out_col =  texture(texImage, vs_out_tex);
+	fs_out_col =  texture(texImages, vec3(vs_out_tex, layer));
 }
\ No newline at end of file
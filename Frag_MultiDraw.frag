@@ -0,0 +1,100 @@
+#version 430
+
+// pipeline-ból bejövő per-fragment attribútumok
+in vec3 vs_out_pos;
+in vec3 vs_out_norm;
+in vec2 vs_out_tex;
+flat in int vs_out_layer;
+flat in int vs_out_array;
+flat in int vs_out_flags;
+
+// kimenő érték - a fragment színe
+out vec4 fs_out_col;
+
+// textúra mintavételező objektumok: a CMyApp::m_materialTextures tömbjei a 0-3. egységen
+layout( binding = 0 ) uniform sampler2DArray texArrays[ 4 ];
+
+// a Föld éjszakai textúrájának rétege, ugyanabban a tömbben mint a nappalié
+uniform int nightLayer;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
+
+// fenyforras tulajdonsagok - CMyApp::LightBlock
+layout( std140, binding = 1 ) uniform Light
+{
+	vec4  lightPos;
+	vec3  La;
+	float lightConstantAttenuation;
+	vec3  Ld;
+	float lightLinearAttenuation;
+	vec3  Ls;
+	float lightQuadraticAttenuation;
+};
+
+// anyag tulajdonsagok - CMyApp::MaterialBlock
+layout( std140, binding = 2 ) uniform Material
+{
+	vec3  Ka;
+	float Shininess;
+	vec3  Kd;
+	vec3  Ks;
+};
+
+// anyagjelzők (lásd CMyApp::BODY_FLAG_*)
+const int FLAG_SUN   = 1;
+const int FLAG_EARTH = 2;
+const int FLAG_UNLIT = 8;
+
+// A tömb rajzolásonként más lehet, egy hívásban nem dinamikusan uniform, ezért konstans indexű ágakban
+// mintavételezünk. Az ágakban nincs implicit derivált, a gradienseket előtte, egységes vezérlésben számoljuk.
+// A negyediknél későbbi tömbök rajzolásait a QueueMultiDraw nem küldi ide, azok külön rajzolással mennek.
+vec4 SampleMaterial( int array, int layer, vec2 dx, vec2 dy )
+{
+	vec3 coord = vec3( vs_out_tex, layer );
+	switch ( array )
+	{
+	case 0:  return textureGrad( texArrays[ 0 ], coord, dx, dy );
+	case 1:  return textureGrad( texArrays[ 1 ], coord, dx, dy );
+	case 2:  return textureGrad( texArrays[ 2 ], coord, dx, dy );
+	default: return textureGrad( texArrays[ 3 ], coord, dx, dy );
+	}
+}
+
+void main()
+{
+	vec2 dx = dFdx( vs_out_tex );
+	vec2 dy = dFdy( vs_out_tex );
+
+	vec4 texColor = SampleMaterial( vs_out_array, vs_out_layer, dx, dy );
+
+	if ((vs_out_flags & (FLAG_SUN | FLAG_UNLIT)) != 0){
+	fs_out_col = texColor;
+	return;
+	}
+
+	// A fragment normálvektora
+	// MINDIG normalizáljuk!
+	vec3 normal = normalize( vs_out_norm );
+
+	vec3 ambient = Ka*La;
+
+	vec3 toLight = normalize(lightPos.xyz - vs_out_pos);
+	vec3 diffuse = clamp(dot(toLight,normal),0.f,1.f) * Ld * Kd;
+
+	vec3 toEye = normalize(cameraPos - vs_out_pos);
+	vec3 r = reflect(normalize(-toLight),normal);
+	vec3 specular = pow(clamp(dot(normalize(r),toEye),0,1),Shininess) * Ks * Ls;
+
+	if((vs_out_flags & FLAG_EARTH) != 0){
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor
+			+ vec4(1 - diffuse, 1) * SampleMaterial( vs_out_array, nightLayer, dx, dy );
+	}
+	else{
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor;
+	}
+}
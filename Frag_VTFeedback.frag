@@ -0,0 +1,38 @@
+#version 430
+
+// pipeline-ból bejövő per-fragment attribútumok
+in vec3 vs_out_pos;
+in vec3 vs_out_norm;
+in vec2 vs_out_tex;
+
+// kimenő érték - a csempe, amit a fragment mintavételezne: ( x, y, szint, virtuális textúra + 1 ), 0: nincs
+layout( location = 0 ) out uvec4 fs_out_tile;
+
+// VirtualTextureSet: a virtuális textúra indexe, -1: csak takar
+uniform int vtIndex;
+uniform vec2 vtTileCount;  // csempék száma a 0. szinten
+uniform int vtLevelCount;
+// a feedback kép kisebb a nézetnél, a szintet úgy választjuk, mintha teljes méretű lenne
+uniform float lodBias;
+
+const float VT_TILE_SIZE = 128.0; // VirtualTextureSet::TILE_SIZE
+
+void main()
+{
+	// a deriváltak még az elágazás előtt
+	vec2 texel = vs_out_tex * vtTileCount * VT_TILE_SIZE;
+	float lod = 0.5 * log2( max( max( dot( dFdx( texel ), dFdx( texel ) ), dot( dFdy( texel ), dFdy( texel ) ) ), 1e-8 ) ) + lodBias;
+
+	if ( vtIndex < 0 )
+	{
+		fs_out_tile = uvec4( 0 );
+		return;
+	}
+
+	// a trilineáris szűrés a két szomszédos szintet keveri, a finomabbat kérjük, a durvább az őse
+	int level = int( clamp( floor( lod ), 0.0, float( vtLevelCount - 1 ) ) );
+	ivec2 tiles = max( ivec2( vtTileCount ) >> level, ivec2( 1 ) );
+	ivec2 tile = min( ivec2( clamp( vs_out_tex, 0.0, 1.0 ) * vec2( tiles ) ), tiles - 1 );
+
+	fs_out_tile = uvec4( uvec2( tile ), uint( level ), uint( vtIndex + 1 ) );
+}
@@ -8,31 +8,49 @@ in vec2 vs_out_tex;
 // kimenő érték - a fragment színe
 out vec4 fs_out_col;
 
-// textúra mintavételező objektum
-uniform sampler2D texImage;
-uniform sampler2D texImageNight;
-
-// kamera pozíció
-uniform vec3 cameraPos;
-
-// fenyforras tulajdonsagok
- uniform vec4 lightPos;
-
- uniform vec3 La;
- uniform vec3 Ld;
- uniform vec3 Ls;
-
-uniform float lightConstantAttenuation;
-uniform float lightLinearAttenuation;
-uniform float lightQuadraticAttenuation;
-
-// anyag tulajdonsagok
-
- uniform vec3 Ka;
- uniform vec3 Kd;
- uniform vec3 Ks;
+// textúra mintavételező objektum: a textúratömb és benne az égitest rétege
+uniform sampler2DArray texImages;
+uniform int layer;
+// a Föld éjszakai textúrájának rétege ugyanebben a tömbben
+uniform int nightLayer;
+
+// virtuális textúra (VirtualTextureSet): ha be van kapcsolva, a nappali szín ebből jön a réteg helyett
+uniform int useVirtualTexture;
+uniform usampler2D vtPageTable; // csempénként ( atlasz x, y, a rezidens szint, 255 ), szintenként egy mipmap
+uniform sampler2D vtAtlas;      // a rezidens csempék, minden virtuális textúrának közös
+uniform vec2 vtTileCount;       // csempék száma a 0. szinten
+uniform int vtLevelCount;
+
+const float VT_TILE_SIZE   = 128.0; // VirtualTextureSet::TILE_SIZE
+const float VT_TILE_BORDER = 4.0;   // VirtualTextureSet::TILE_BORDER
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
 
- uniform float Shininess;
+// fenyforras tulajdonsagok - CMyApp::LightBlock
+layout( std140, binding = 1 ) uniform Light
+{
+	vec4  lightPos;
+	vec3  La;
+	float lightConstantAttenuation;
+	vec3  Ld;
+	float lightLinearAttenuation;
+	vec3  Ls;
+	float lightQuadraticAttenuation;
+};
+
+// anyag tulajdonsagok - CMyApp::MaterialBlock
+layout( std140, binding = 2 ) uniform Material
+{
+	vec3  Ka;
+	float Shininess;
+	vec3  Kd;
+	vec3  Ks;
+};
 
 // éjszakai Földhöz
  uniform int isEarth; 
@@ -41,6 +59,21 @@ uniform float lightQuadraticAttenuation;
  uniform int isSun; 
 
 
+// egy szint bilineáris mintája: a laptábla megmondja, melyik atlasz helyen van a csempe,
+// vagy ha az még nincs betöltve, a legközelebbi betöltött őse
+vec4 SampleVirtualLevel( vec2 uv, int level )
+{
+	ivec2 tiles = max( ivec2( vtTileCount ) >> level, ivec2( 1 ) );
+	uvec4 page = texelFetch( vtPageTable, min( ivec2( uv * vec2( tiles ) ), tiles - 1 ), level );
+
+	// a csempén belüli hely a tényleges (esetleg durvább) szinten
+	vec2 residentTiles = vec2( max( ivec2( vtTileCount ) >> int( page.z ), ivec2( 1 ) ) );
+	vec2 inTile = uv * residentTiles - min( floor( uv * residentTiles ), residentTiles - 1.0 );
+
+	vec2 atlasTexel = vec2( page.xy ) * ( VT_TILE_SIZE + 2.0 * VT_TILE_BORDER ) + VT_TILE_BORDER + inTile * VT_TILE_SIZE;
+	return textureLod( vtAtlas, atlasTexel / vec2( textureSize( vtAtlas, 0 ) ), 0.0 );
+}
+
 /* segítség:
 	    - normalizálás: http://www.opengl.org/sdk/docs/manglsl/xhtml/normalize.xml
 	    - skaláris szorzat: http://www.opengl.org/sdk/docs/manglsl/xhtml/dot.xml
@@ -53,6 +86,10 @@ uniform float lightQuadraticAttenuation;
 
 void main()
 {
+	// a virtuális textúra szintje a deriváltakból, még minden elágazás előtt
+	vec2 vtTexel = vs_out_tex * vtTileCount * VT_TILE_SIZE;
+	float vtLod = 0.5 * log2( max( max( dot( dFdx( vtTexel ), dFdx( vtTexel ) ), dot( dFdy( vtTexel ), dFdy( vtTexel ) ) ), 1e-8 ) );
+
 	// A fragment normálvektora
 	// MINDIG normalizáljuk!
 	vec3 normal = normalize( vs_out_norm );
@@ -73,14 +110,26 @@ void main()
 	// normal vector debug:
 	// fs_out_col = vec4( normal * 0.5 + 0.5, 1.0 );
 
+	vec4 texColor;
+	if ( useVirtualTexture == 1 )
+	{
+		// trilineáris: a két szomszédos szint keveréke
+		vtLod = clamp( vtLod, 0.0, float( max( vtLevelCount - 1, 0 ) ) );
+		int vtLevel = int( vtLod );
+		vec2 uv = clamp( vs_out_tex, 0.0, 1.0 );
+		texColor = mix( SampleVirtualLevel( uv, vtLevel ), SampleVirtualLevel( uv, min( vtLevel + 1, vtLevelCount - 1 ) ), fract( vtLod ) );
+	}
+	else
+		texColor = texture(texImages, vec3(vs_out_tex, layer));
+
 	if(isEarth == 1){
-	fs_out_col = vec4((ambient + diffuse + specular),1) * texture(texImage, vs_out_tex)
-			+ (1- diffuse) * texture(texImageNight, vs_out_tex);
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor
+			+ vec4(1 - diffuse, 1) * texture(texImages, vec3(vs_out_tex, nightLayer));
 	}
 	else if (isSun ==1){
-	fs_out_col = texture(texImage, vs_out_tex);
+	fs_out_col = texColor;
 	}
 	else{
-	fs_out_col = vec4((ambient + diffuse + specular),1) * texture(texImage, vs_out_tex);
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#version 430
+
+// pipeline-ból bejövő per-fragment attribútumok
+in vec3 vs_out_pos;
+in vec3 vs_out_norm;
+in vec2 vs_out_tex;
+flat in int vs_out_layer;
+flat in int vs_out_flags;
+
+// kimenő érték - a fragment színe
+out vec4 fs_out_col;
+
+// textúra mintavételező objektumok: az égitestek textúrái egy tömb rétegeiben
+uniform sampler2DArray texImages;
+// a Föld éjszakai textúrájának rétege ugyanebben a tömbben
+uniform int nightLayer;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
+
+// fenyforras tulajdonsagok - CMyApp::LightBlock
+layout( std140, binding = 1 ) uniform Light
+{
+	vec4  lightPos;
+	vec3  La;
+	float lightConstantAttenuation;
+	vec3  Ld;
+	float lightLinearAttenuation;
+	vec3  Ls;
+	float lightQuadraticAttenuation;
+};
+
+// anyag tulajdonsagok - CMyApp::MaterialBlock
+layout( std140, binding = 2 ) uniform Material
+{
+	vec3  Ka;
+	float Shininess;
+	vec3  Kd;
+	vec3  Ks;
+};
+
+// anyagjelzők (lásd CMyApp::BODY_FLAG_*)
+const int FLAG_SUN   = 1;
+const int FLAG_EARTH = 2;
+
+void main()
+{
+	// A fragment normálvektora
+	// MINDIG normalizáljuk!
+	vec3 normal = normalize( vs_out_norm );
+
+	vec3 ambient = Ka*La;
+
+	vec3 toLight = normalize(lightPos.xyz - vs_out_pos);
+	vec3 diffuse = clamp(dot(toLight,normal),0.f,1.f) * Ld * Kd;
+
+	vec3 toEye = normalize(cameraPos - vs_out_pos);
+	vec3 r = reflect(normalize(-toLight),normal);
+	vec3 specular = pow(clamp(dot(normalize(r),toEye),0,1),Shininess) * Ks * Ls;
+
+	vec4 texColor = texture(texImages, vec3(vs_out_tex, vs_out_layer));
+
+	if((vs_out_flags & FLAG_EARTH) != 0){
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor
+			+ vec4(1 - diffuse, 1) * texture(texImages, vec3(vs_out_tex, nightLayer));
+	}
+	else if ((vs_out_flags & FLAG_SUN) != 0){
+	fs_out_col = texColor;
+	}
+	else{
+	fs_out_col = vec4((ambient + diffuse + specular),1) * texColor;
+	}
+}
@@ -1,9 +1,15 @@
 #include "MyApp.h"
 #include "SDL_GLDebugMessageCallback.h"
-#include "ObjParser.h"
 #include "ParametricSurfaceMesh.hpp"
+#include "ImageOpsBenchmark.h"
+#include "ObjParserBenchmark.h"
 
 #include <imgui.h>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 CMyApp::CMyApp()
 {
@@ -26,19 +32,232 @@ void CMyApp::SetupDebugCallback()
 	}
 }
 
+const std::vector<CMyApp::ProgramSource>& CMyApp::GetProgramSources()
+{
+	// melyik tagváltozóba melyik fájlokból linkelt program kerül
+	static const std::vector<ProgramSource> programSources =
+	{
+		{ &CMyApp::m_programID,              { { GL_VERTEX_SHADER, "Vert_PosNormTex.vert" },          { GL_FRAGMENT_SHADER, "Frag_ZH.frag" } } },
+		{ &CMyApp::m_programSkyboxID,        { { GL_VERTEX_SHADER, "Vert_skybox.vert" },              { GL_FRAGMENT_SHADER, "Frag_skybox.frag" } } },
+		{ &CMyApp::m_beltProgramID,          { { GL_VERTEX_SHADER, "Vert_Belt.vert" },                { GL_FRAGMENT_SHADER, "Frag_Belt.frag" } } },
+		{ &CMyApp::m_bodyInstancedProgramID, { { GL_VERTEX_SHADER, "Vert_PosNormTexInstanced.vert" }, { GL_FRAGMENT_SHADER, "Frag_ZHInstanced.frag" } } },
+		{ &CMyApp::m_multiDrawProgramID,     { { GL_VERTEX_SHADER, "Vert_MultiDraw.vert" },           { GL_FRAGMENT_SHADER, "Frag_MultiDraw.frag" } } },
+		{ &CMyApp::m_sphereTessProgramID,    {
+			{ GL_VERTEX_SHADER,          "Vert_SphereTess.vert" },
+			{ GL_TESS_CONTROL_SHADER,    "Tesc_Sphere.tesc" },
+			{ GL_TESS_EVALUATION_SHADER, "Tese_Sphere.tese" },
+			{ GL_FRAGMENT_SHADER,        "Frag_ZH.frag" },
+		} },
+		{ &CMyApp::m_asteroidBeltInitProgramID, { { GL_COMPUTE_SHADER, "Comp_AsteroidBeltInit.comp" } } },
+		{ &CMyApp::m_asteroidBeltCullProgramID, { { GL_COMPUTE_SHADER, "Comp_AsteroidBelt.comp" } } },
+		{ &CMyApp::m_asteroidBeltProgramID,  { { GL_VERTEX_SHADER, "Vert_AsteroidBelt.vert" },        { GL_FRAGMENT_SHADER, "Frag_Belt.frag" } } },
+		{ &CMyApp::m_vtFeedbackProgramID,    { { GL_VERTEX_SHADER, "Vert_PosNormTex.vert" },          { GL_FRAGMENT_SHADER, "Frag_VTFeedback.frag" } } },
+	};
+
+	return programSources;
+}
+
+bool CMyApp::BuildAssetPack( const std::filesystem::path& packPath, const bool decodeImages )
+{
+	// a programok shaderei és az Assets/ könyvtár, ugyanaz, amit a hot reload is figyel
+	std::vector<std::filesystem::path> files;
+	for ( const ProgramSource& source : GetProgramSources() )
+		for ( const ShaderStageFile& stage : source.stages )
+			files.push_back( stage.fileName );
+
+	std::error_code error;
+	for ( const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator( "Assets", error ) )
+		if ( entry.is_regular_file( error ) )
+			files.push_back( entry.path() );
+
+	return AssetPack::Build( packPath, files, decodeImages );
+}
+
 void CMyApp::InitShaders()
 {
-	m_programID = glCreateProgram();
-	AssembleProgram( m_programID, "Vert_PosNormTex.vert", "Frag_ZH.frag" );
-	InitSkyboxShaders();
-	m_beltProgramID = glCreateProgram();
-	AssembleProgram(m_beltProgramID, "Vert_Belt.vert", "Frag_Belt.frag");
+	// induláskor nincs mit közben rajzolni: megvárjuk az összeset
+	std::vector<std::size_t> sources( GetProgramSources().size() );
+	std::iota( sources.begin(), sources.end(), std::size_t( 0 ) );
+
+	SubmitShaders( sources );
+	m_programBatch.Finish();
+	SwapShaders();
+}
+
+void CMyApp::SubmitShaders( const std::vector<std::size_t>& sources )
+{
+	// mindegyik program fordítását elindítjuk, mielőtt bármelyikre várnánk;
+	// a bináris cache-ben lévők azonnal készen vannak
+	m_shaderBuildStart = SDL_GetPerformanceCounter();
+	m_programCache.ResetStats();
+	m_programBatch.ResetFailed();
+
+	m_pendingPrograms.clear();
+	for ( std::size_t source : sources )
+	{
+		const GLuint programID = glCreateProgram();
+		m_programBatch.Submit( programID, GetProgramSources()[ source ].stages, &m_programCache );
+		m_pendingPrograms.push_back( { source, programID } );
+	}
+}
+
+void CMyApp::MarkShadersDirty( const std::filesystem::path& fileName )
+{
+	// minden program, amelyik ezt a fájlt használja
+	const std::vector<ProgramSource>& sources = GetProgramSources();
+	for ( std::size_t i = 0; i < sources.size(); ++i )
+		for ( const ShaderStageFile& stage : sources[ i ].stages )
+			if ( fileName.empty() || stage.fileName.lexically_normal() == fileName.lexically_normal() )
+				m_dirtyPrograms.insert( i );
+}
+
+void CMyApp::PollShaders()
+{
+	if ( !m_pendingPrograms.empty() )
+	{
+		if ( !m_programBatch.Poll() ) return;
+
+		if ( m_programBatch.GetFailedCount() > 0 )
+		{
+			// újratöltéskor hibás shaderrel a régi programok maradnak
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN,
+							"[Shaders] %u programs failed to build, keeping the current ones", m_programBatch.GetFailedCount() );
+			CleanPendingShaders();
+		}
+		else
+		{
+			SwapShaders();
+		}
+	}
+
+	// a fordítás közben megváltozott programok most indulnak
+	if ( m_pendingPrograms.empty() && !m_dirtyPrograms.empty() )
+	{
+		SubmitShaders( std::vector<std::size_t>( m_dirtyPrograms.begin(), m_dirtyPrograms.end() ) );
+		m_dirtyPrograms.clear();
+	}
+}
+
+void CMyApp::SwapShaders()
+{
+	// egyszerre cseréljük mindegyiket, így egy frame sem rajzol régi és új programokkal vegyesen
+	const std::vector<ProgramSource>& sources = GetProgramSources();
+	for ( const PendingProgram& pending : m_pendingPrograms )
+	{
+		GLuint& programID = this->*sources[ pending.source ].program;
+		glDeleteProgram( programID );
+		programID = pending.programID;
+	}
+
+	const double elapsedMs = 1000.0 * ( SDL_GetPerformanceCounter() - m_shaderBuildStart ) / SDL_GetPerformanceFrequency();
+	const ProgramBinaryCache::Stats& cacheStats = m_programCache.GetStats();
+	SDL_Log( "[Shaders] %u of %u programs rebuilt: %u from the binary cache, %u compiled (%u rejected binaries) in %.1f ms",
+			 static_cast<unsigned>( m_pendingPrograms.size() ), static_cast<unsigned>( sources.size() ),
+			 cacheStats.hits, cacheStats.misses, cacheStats.rejected, elapsedMs );
+
+	m_pendingPrograms.clear();
+
+	// a state cache még a régi programok azonosítóit tarthatja
+	m_stateCache.Invalidate();
+
+	ResolveUniforms();
+}
+
+void CMyApp::CleanPendingShaders()
+{
+	m_programBatch.Finish();
+	for ( const PendingProgram& pending : m_pendingPrograms )
+		glDeleteProgram( pending.programID );
+	m_pendingPrograms.clear();
 }
 
-void CMyApp::InitSkyboxShaders()
+void CMyApp::ResolveUniforms()
 {
-	m_programSkyboxID = glCreateProgram();
-	AssembleProgram( m_programSkyboxID, "Vert_skybox.vert", "Frag_skybox.frag" );
+	// a táblákat minden (újra)linkelés után újra kell építeni, a location-ök megváltozhatnak
+
+	m_bodyUniforms.table.Build( m_programID );
+	m_bodyUniforms.world         = m_bodyUniforms.table.Get<glm::mat4>( "world" );
+	m_bodyUniforms.worldIT       = m_bodyUniforms.table.Get<glm::mat4>( "worldIT" );
+	m_bodyUniforms.texImages     = m_bodyUniforms.table.Get<GLint>( "texImages" );
+	m_bodyUniforms.layer         = m_bodyUniforms.table.Get<GLint>( "layer" );
+	m_bodyUniforms.nightLayer    = m_bodyUniforms.table.Get<GLint>( "nightLayer" );
+	m_bodyUniforms.isEarth       = m_bodyUniforms.table.Get<GLint>( "isEarth" );
+	m_bodyUniforms.isSun         = m_bodyUniforms.table.Get<GLint>( "isSun" );
+	m_bodyUniforms.useVirtualTexture = m_bodyUniforms.table.Get<GLint>( "useVirtualTexture" );
+	m_bodyUniforms.vtPageTable   = m_bodyUniforms.table.Get<GLint>( "vtPageTable" );
+	m_bodyUniforms.vtAtlas       = m_bodyUniforms.table.Get<GLint>( "vtAtlas" );
+	m_bodyUniforms.vtTileCount   = m_bodyUniforms.table.Get<glm::vec2>( "vtTileCount" );
+	m_bodyUniforms.vtLevelCount  = m_bodyUniforms.table.Get<GLint>( "vtLevelCount" );
+
+	m_skyboxUniforms.table.Build( m_programSkyboxID );
+	m_skyboxUniforms.skyboxTexture = m_skyboxUniforms.table.Get<GLint>( "skyboxTexture" );
+
+	m_beltUniforms.table.Build( m_beltProgramID );
+	m_beltUniforms.world   = m_beltUniforms.table.Get<glm::mat4>( "world" );
+	m_beltUniforms.worldIT = m_beltUniforms.table.Get<glm::mat4>( "worldIT" );
+	m_beltUniforms.texImages = m_beltUniforms.table.Get<GLint>( "texImages" );
+	m_beltUniforms.layer     = m_beltUniforms.table.Get<GLint>( "layer" );
+
+	m_bodyInstancedUniforms.table.Build( m_bodyInstancedProgramID );
+	m_bodyInstancedUniforms.texImages  = m_bodyInstancedUniforms.table.Get<GLint>( "texImages" );
+	m_bodyInstancedUniforms.nightLayer = m_bodyInstancedUniforms.table.Get<GLint>( "nightLayer" );
+
+	// a texArrays egységeit a shader layout( binding ) adja
+	m_multiDrawUniforms.table.Build( m_multiDrawProgramID );
+	m_multiDrawUniforms.nightLayer = m_multiDrawUniforms.table.Get<GLint>( "nightLayer" );
+
+	m_sphereTessUniforms.table.Build( m_sphereTessProgramID );
+	m_sphereTessUniforms.world            = m_sphereTessUniforms.table.Get<glm::mat4>( "world" );
+	m_sphereTessUniforms.worldIT          = m_sphereTessUniforms.table.Get<glm::mat4>( "worldIT" );
+	m_sphereTessUniforms.texImages        = m_sphereTessUniforms.table.Get<GLint>( "texImages" );
+	m_sphereTessUniforms.layer            = m_sphereTessUniforms.table.Get<GLint>( "layer" );
+	m_sphereTessUniforms.nightLayer       = m_sphereTessUniforms.table.Get<GLint>( "nightLayer" );
+	m_sphereTessUniforms.isEarth          = m_sphereTessUniforms.table.Get<GLint>( "isEarth" );
+	m_sphereTessUniforms.isSun            = m_sphereTessUniforms.table.Get<GLint>( "isSun" );
+	m_sphereTessUniforms.useVirtualTexture = m_sphereTessUniforms.table.Get<GLint>( "useVirtualTexture" );
+	m_sphereTessUniforms.vtPageTable      = m_sphereTessUniforms.table.Get<GLint>( "vtPageTable" );
+	m_sphereTessUniforms.vtAtlas          = m_sphereTessUniforms.table.Get<GLint>( "vtAtlas" );
+	m_sphereTessUniforms.vtTileCount      = m_sphereTessUniforms.table.Get<glm::vec2>( "vtTileCount" );
+	m_sphereTessUniforms.vtLevelCount     = m_sphereTessUniforms.table.Get<GLint>( "vtLevelCount" );
+	m_sphereTessUniforms.screenScale      = m_sphereTessUniforms.table.Get<float>( "screenScale" );
+	m_sphereTessUniforms.targetEdgeLength = m_sphereTessUniforms.table.Get<float>( "targetEdgeLength" );
+	m_sphereTessUniforms.maxTessLevel     = m_sphereTessUniforms.table.Get<float>( "maxTessLevel" );
+
+	m_asteroidBeltInitUniforms.table.Build( m_asteroidBeltInitProgramID );
+	m_asteroidBeltInitUniforms.asteroidCount = m_asteroidBeltInitUniforms.table.Get<GLuint>( "asteroidCount" );
+	m_asteroidBeltInitUniforms.seed          = m_asteroidBeltInitUniforms.table.Get<GLuint>( "seed" );
+
+	m_asteroidBeltCullUniforms.table.Build( m_asteroidBeltCullProgramID );
+	m_asteroidBeltCullUniforms.asteroidCount = m_asteroidBeltCullUniforms.table.Get<GLuint>( "asteroidCount" );
+	m_asteroidBeltCullUniforms.time          = m_asteroidBeltCullUniforms.table.Get<float>( "time" );
+	m_asteroidBeltCullUniforms.meshRadius    = m_asteroidBeltCullUniforms.table.Get<float>( "meshRadius" );
+
+	m_asteroidBeltUniforms.table.Build( m_asteroidBeltProgramID );
+	m_asteroidBeltUniforms.texImages = m_asteroidBeltUniforms.table.Get<GLint>( "texImages" );
+	m_asteroidBeltUniforms.layer     = m_asteroidBeltUniforms.table.Get<GLint>( "layer" );
+
+	m_vtFeedbackUniforms.table.Build( m_vtFeedbackProgramID );
+	m_vtFeedbackUniforms.world        = m_vtFeedbackUniforms.table.Get<glm::mat4>( "world" );
+	m_vtFeedbackUniforms.worldIT      = m_vtFeedbackUniforms.table.Get<glm::mat4>( "worldIT" );
+	m_vtFeedbackUniforms.vtIndex      = m_vtFeedbackUniforms.table.Get<GLint>( "vtIndex" );
+	m_vtFeedbackUniforms.vtTileCount  = m_vtFeedbackUniforms.table.Get<glm::vec2>( "vtTileCount" );
+	m_vtFeedbackUniforms.vtLevelCount = m_vtFeedbackUniforms.table.Get<GLint>( "vtLevelCount" );
+	m_vtFeedbackUniforms.lodBias      = m_vtFeedbackUniforms.table.Get<float>( "lodBias" );
+
+	// textúraegységek: a programok állapotához tartoznak, elég linkelés után egyszer beállítani
+	m_bodyUniforms.texImages.Set( m_programID, 0 );
+	m_skyboxUniforms.skyboxTexture.Set( m_programSkyboxID, 1 );
+	m_beltUniforms.texImages.Set( m_beltProgramID, 0 );
+	m_bodyInstancedUniforms.texImages.Set( m_bodyInstancedProgramID, 0 );
+	m_sphereTessUniforms.texImages.Set( m_sphereTessProgramID, 0 );
+	m_sphereTessUniforms.maxTessLevel.Set( m_sphereTessProgramID, SPHERE_MAX_TESS_LEVEL );
+	m_asteroidBeltUniforms.texImages.Set( m_asteroidBeltProgramID, 0 );
+	// a laptábla egységét rajzolásonként állítjuk, de különböző típusú samplerek nem mutathatnak ugyanarra az egységre
+	m_bodyUniforms.vtAtlas.Set( m_programID, VT_ATLAS_UNIT );
+	m_bodyUniforms.vtPageTable.Set( m_programID, VT_ATLAS_UNIT + 1 );
+	m_sphereTessUniforms.vtAtlas.Set( m_sphereTessProgramID, VT_ATLAS_UNIT );
+	m_sphereTessUniforms.vtPageTable.Set( m_sphereTessProgramID, VT_ATLAS_UNIT + 1 );
+	m_vtFeedbackUniforms.lodBias.Set( m_vtFeedbackProgramID, VirtualTextureSet::GetFeedbackLodBias() );
 }
 
 void CMyApp::CleanShaders()
@@ -46,6 +265,13 @@ void CMyApp::CleanShaders()
 	glDeleteProgram( m_programID );
 	CleanSkyboxShaders();
 	glDeleteProgram(m_beltProgramID);
+	glDeleteProgram(m_bodyInstancedProgramID);
+	glDeleteProgram(m_multiDrawProgramID);
+	glDeleteProgram(m_sphereTessProgramID);
+	glDeleteProgram(m_asteroidBeltInitProgramID);
+	glDeleteProgram(m_asteroidBeltCullProgramID);
+	glDeleteProgram(m_asteroidBeltProgramID);
+	glDeleteProgram(m_vtFeedbackProgramID);
 }
 
 void CMyApp::CleanSkyboxShaders()
@@ -90,6 +316,9 @@ public:
 		return matWorld;
 	}
 
+	// a (gömb vagy gyűrű) modell skálázása, a befoglaló gömbhöz
+	float GetRadius() const noexcept { return radius; }
+
 private:
 	float distance;
 	float radius;
@@ -98,25 +327,27 @@ private:
 	float periodTimeOwn;
 };
 
-void CMyApp::InitGeometry()
+// a Vertex attribútumai, minden modellnek ugyanaz
+static const std::initializer_list<VertexAttributeDescriptor> vertexAttribList =
 {
+	{ 0, offsetof( Vertex, position ), 3, GL_FLOAT },
+	{ 1, offsetof( Vertex, normal   ), 3, GL_FLOAT },
+	{ 2, offsetof( Vertex, texcoord ), 2, GL_FLOAT },
+};
 
-	const std::initializer_list<VertexAttributeDescriptor> vertexAttribList =
-	{
-		{ 0, offsetof( Vertex, position ), 3, GL_FLOAT },
-		{ 1, offsetof( Vertex, normal   ), 3, GL_FLOAT },
-		{ 2, offsetof( Vertex, texcoord ), 2, GL_FLOAT },
-	};
+void CMyApp::InitGeometry()
+{
 
 	// Ez egy sík, a gömb objektum koordinátáit, normál vektorait
-	// és textúra koordinátáit a vertex-shaderben számoljuk 
-	MeshObject<Vertex> surfaceMeshCPU = GetParamSurfMesh(Param());
-	m_surfaceGPU = CreateGLObjectFromMesh(surfaceMeshCPU, vertexAttribList);
+	// és textúra koordinátáit a vertex-shaderben számoljuk.
+	// Részletességi szintenként egy, mind a m_meshPool-ba kerül (lent).
+	std::vector<MeshObject<Vertex>> surfaceMeshLodsCPU;
+	for ( const SphereLod& lod : SPHERE_LODS )
+		surfaceMeshLodsCPU.push_back( GetParamSurfMesh( Param(), lod.N, lod.M ) );
 
 	// aszteroida
 
-	MeshObject<Vertex> asteroidMeshCPU = ObjParser::parse("Assets/asteroid.obj");
-	m_asteroidGPU = CreateGLObjectFromMesh(asteroidMeshCPU, vertexAttribList);
+	UploadAsteroidMesh( m_meshCache.Load( ASTEROID_MESH_FILE, &m_workerPool ) );
 
 	// Skybox
 	InitSkyboxGeometry();
@@ -139,11 +370,111 @@ void CMyApp::InitGeometry()
 
 	beltMeshCPU.vertexArray = vertices;
 	m_beltGPU = CreateGLObjectFromMesh(beltMeshCPU, vertexAttribList);
+
+	// ugyanezek egy közös pufferben, ezt használja mindhárom rajzolási mód;
+	// a 3. attribútum a multi-draw-indirect rajzolás sorszáma
+	for ( std::size_t lod = 0; lod < SPHERE_LOD_COUNT; ++lod )
+		m_sphereLodMeshes[lod] = m_meshPool.Add(surfaceMeshLodsCPU[lod]);
+	m_ringMesh     = m_meshPool.Add(beltMeshCPU);
+	m_spherePatchMesh = m_meshPool.Add(GetParamSurfPatches(Param(), SPHERE_PATCHES_N, SPHERE_PATCHES_M));
+	m_meshPool.Build(vertexAttribList, 3, MULTI_DRAW_CAPACITY);
+
+	InitBodyInstancing();
+	InitMultiDraw();
+
+	// kisbolygóöv
+	InitAsteroidBelt();
+}
+
+void CMyApp::UploadAsteroidMesh( const CachedMesh& mesh )
+{
+	CleanOGLObject( m_asteroidGPU );
+	m_asteroidGPU = CreateGLObjectFromMesh(mesh.GetVertices(), mesh.GetVertexCount(), mesh.GetIndices(), mesh.GetIndexCount(), vertexAttribList);
+
+	// a kisbolygóöv vágásához a modell befoglaló gömbje
+	m_asteroidMeshRadius = 0.0f;
+	for ( std::size_t i = 0; i < mesh.GetVertexCount(); ++i )
+		m_asteroidMeshRadius = std::max( m_asteroidMeshRadius, glm::length( mesh.GetVertices()[ i ].position ) );
+}
+
+void CMyApp::InitBodyInstancing()
+{
+	// A példányosított rajzoláshoz saját VAO kell: a m_meshPool VBO-ját és IBO-ját használja,
+	// de a 3-11. attribútumok égitestenként (példányonként) egy BodyInstance-ből jönnek.
+	glGenVertexArrays(1, &m_bodyInstancedVaoID);
+	glBindVertexArray(m_bodyInstancedVaoID);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_meshPool.GetVboID());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_meshPool.GetIboID());
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, texcoord)));
+
+	glGenBuffers(1, &m_bodyInstanceBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_bodyInstanceBufferID);
+
+	// mat4 attribútum = 4 db egymást követő vec4 location
+	for ( GLuint column = 0; column < 4; ++column )
+	{
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+			reinterpret_cast<const void*>(offsetof(BodyInstance, world) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + column, 1);
+
+		glEnableVertexAttribArray(7 + column);
+		glVertexAttribPointer(7 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+			reinterpret_cast<const void*>(offsetof(BodyInstance, worldIT) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(7 + column, 1);
+	}
+
+	// a réteg és a jelzők egészként maradnak ( glVertexAttribIPointer )
+	glEnableVertexAttribArray(11);
+	glVertexAttribIPointer(11, 2, GL_INT, sizeof(BodyInstance), reinterpret_cast<const void*>(offsetof(BodyInstance, layer)));
+	glVertexAttribDivisor(11, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void CMyApp::InitMultiDraw()
+{
+	glGenBuffers(1, &m_drawDataBufferID);
+	glGenBuffers(1, &m_indirectBufferID);
+
+	// a tartalmat frame-enként töltjük fel, a kötési pont állandó (mint az uniform blokkoké)
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MULTI_DRAW_CAPACITY * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_drawDataBufferID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void CMyApp::CleanMultiDraw()
+{
+	glDeleteBuffers(1, &m_drawDataBufferID);
+	m_drawDataBufferID = 0;
+	glDeleteBuffers(1, &m_indirectBufferID);
+	m_indirectBufferID = 0;
+	m_meshPool.Clean();
+}
+
+void CMyApp::CleanBodyInstancing()
+{
+	glDeleteBuffers(1, &m_bodyInstanceBufferID);
+	m_bodyInstanceBufferID = 0;
+	glDeleteVertexArrays(1, &m_bodyInstancedVaoID);
+	m_bodyInstancedVaoID = 0;
 }
 
 void CMyApp::CleanGeometry()
 {
-	CleanOGLObject( m_surfaceGPU );
+	CleanBodyInstancing();
+	CleanMultiDraw();
+	CleanAsteroidBelt();
 	CleanOGLObject( m_asteroidGPU );
 	CleanOGLObject( m_beltGPU );
 	CleanSkyboxGeometry();
@@ -194,24 +525,6 @@ void CMyApp::InitSkyboxGeometry()
 	m_SkyboxGPU = CreateGLObjectFromMesh( skyboxCPU, { { 0, offsetof( glm::vec3,x ), 3, GL_FLOAT } } );
 }
 
-void CMyApp::RenderPlanet(glm:: mat4 matWorld, GLuint TextureID) {
-
-	glBindTexture(GL_TEXTURE_2D, TextureID);
-
-	glBindVertexArray(m_surfaceGPU.vaoID);
-
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
-
-	glDrawElements(GL_TRIANGLES,
-		m_surfaceGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-}
-
 void CMyApp::CleanSkyboxGeometry()
 {
 	CleanOGLObject( m_SkyboxGPU );
@@ -223,116 +536,80 @@ void CMyApp::InitTextures()
 
 	InitSkyboxTextures();
 
-	// bolygók textúrái
-	//sun.jpg – Nap textúrája
-	glGenTextures(1, &m_sunTextureID);
-	TextureFromFile(m_sunTextureID, "Assets/sun.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_sunTextureID);
-
-	//mercury.jpg – Merkúr textúrája
-	glGenTextures(1, &m_mercuryTextureID);
-	TextureFromFile(m_mercuryTextureID, "Assets/mercury.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_mercuryTextureID);
-
-	//venus.jpg – Vénusz textúrája
-	glGenTextures(1, &m_venusTextureID);
-	TextureFromFile(m_venusTextureID, "Assets/venus.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_venusTextureID);
-
-	//earth.png – A Föld nappali oldalának textúrája
-	glGenTextures(1, &m_earthTextureID);
-	TextureFromFile(m_earthTextureID, "Assets/earth.png");
-	SetupTextureSampling(GL_TEXTURE_2D, m_earthTextureID);
-
-	//earth-night.jpg – A Föld éjszakai oldalának textúrája
-	glGenTextures(2, &m_earthNightTextureID);
-	TextureFromFile(m_earthNightTextureID, "Assets/earth-night.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_earthNightTextureID);
-
-	//moon.jpg – Hold textúrája
-	glGenTextures(1, &m_moonTextureID);
-	TextureFromFile(m_moonTextureID, "Assets/moon.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_moonTextureID);
-
-	//mars.jpg – Mars textúrája
-	glGenTextures(1, &m_marsTextureID);
-	TextureFromFile(m_marsTextureID, "Assets/mars.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_marsTextureID);
-
-	//jupiter.jpg – Jupiter textúrája
-	glGenTextures(1, &m_jupiterTextureID);
-	TextureFromFile(m_jupiterTextureID, "Assets/jupiter.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_jupiterTextureID);
-
-	//saturn.jpg – Szaturnusz textúrája
-	glGenTextures(1, &m_saturnTextureID);
-	TextureFromFile(m_saturnTextureID, "Assets/saturn.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_saturnTextureID);
-
-	//uranus.jpg – Uránusz textúrája
-	glGenTextures(1, &m_uranusTextureID);
-	TextureFromFile(m_uranusTextureID, "Assets/uranus.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_uranusTextureID);
-
-	//neptune.jpg – Neptunusz textúrája
-	glGenTextures(1, &m_neptuneTextureID);
-	TextureFromFile(m_neptuneTextureID, "Assets/neptune.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_neptuneTextureID);
-
-	//pluto.jpg – Pluto textúrája
-	glGenTextures(1, &m_plutoTextureID);
-	TextureFromFile(m_plutoTextureID, "Assets/pluto.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_plutoTextureID);
-
-	//kuiper.png - Kuiper-öv textúrája
-	glGenTextures(1, &m_kuiperTextureID);
-	TextureFromFile(m_kuiperTextureID, "Assets/kuiper.png");
-	SetupTextureSampling(GL_TEXTURE_2D, m_kuiperTextureID);
-
-	//saturn-ring.png - Szaturnusz-öv textúrája
-	glGenTextures(1, &m_saturn_ringTextureID);
-	TextureFromFile(m_saturn_ringTextureID, "Assets/saturn-ring.png");
-	SetupTextureSampling(GL_TEXTURE_2D, m_saturn_ringTextureID);
-
-	//uranus-ring.png - Uránusz-öv textúrája
-	glGenTextures(1, &m_uranus_ringTextureID);
-	TextureFromFile(m_uranus_ringTextureID, "Assets/uranus-ring.png");
-	SetupTextureSampling(GL_TEXTURE_2D, m_uranus_ringTextureID);
-
-	//neptune-ring.pngg - Neptunusz-öv textúrája
-	glGenTextures(1, &m_neptune_ringTextureID);
-	TextureFromFile(m_neptune_ringTextureID, "Assets/neptune-ring.png");
-	SetupTextureSampling(GL_TEXTURE_2D, m_neptune_ringTextureID);
-
-	//rock.jpg - aszteroida textúrája
-	glGenTextures(1, &m_asteroidTextureID);
-	TextureFromFile(m_asteroidTextureID, "Assets/rock.jpg");
-	SetupTextureSampling(GL_TEXTURE_2D, m_asteroidTextureID);
+	// bolygók, gyűrűk és az aszteroida textúrái, a sorrend a MaterialTexture szerinti
+	const std::filesystem::path materialFiles[ MATERIAL_TEXTURE_COUNT ] =
+	{
+		"Assets/sun.jpg",
+		"Assets/mercury.jpg",
+		"Assets/venus.jpg",
+		"Assets/earth.png",
+		"Assets/earth-night.jpg",
+		"Assets/moon.jpg",
+		"Assets/mars.jpg",
+		"Assets/jupiter.jpg",
+		"Assets/saturn.jpg",
+		"Assets/uranus.jpg",
+		"Assets/neptune.jpg",
+		"Assets/pluto.jpg",
+
+		"Assets/kuiper.png",
+		"Assets/saturn-ring.png",
+		"Assets/uranus-ring.png",
+		"Assets/neptune-ring.png",
+
+		"Assets/rock.jpg",
+	};
+
+	for ( TextureArraySet::Handle handle = 0; handle < MATERIAL_TEXTURE_COUNT; ++handle )
+	{
+		// a Föld nappali és éjszakai rétege ugyanabból a tömbből mintavételeződik:
+		// az éjszakai a nappali méretosztályába kerül, ha kell, átméretezve
+		if ( handle == EARTH_NIGHT_TEXTURE )
+			m_materialTextures.Add( materialFiles[ handle ], EARTH_TEXTURE );
+		else
+			m_materialTextures.Add( materialFiles[ handle ] );
+	}
+
+	// méretosztályonként egy-egy GL_TEXTURE_2D_ARRAY, eleinte kicsi és üres:
+	// egy réteg akkor töltődik be, amikor először látszik, a tömb akkor bővül, amikor nagyobb szint kell
+	m_textureResidency.Init( m_materialTextures, m_workerPool, m_textureCache, m_textureStreamer );
+
+	// a nagy felbontású felszínek virtuális textúrák is: a csempék a háttérben sülnek, addig a tömb rétege látszik
+	for ( MaterialTexture material : VIRTUAL_TEXTURE_MATERIALS )
+		m_virtualTextures.Add( materialFiles[ material ] );
+	m_virtualTextures.Init( m_workerPool, m_textureCache.IsCompressing() );
+
+	// a textúrák keretén a skybox és az atlasz is osztozik, ezek mindig a videomemóriában vannak
+	std::size_t skyboxBytes = 0;
+	for ( int level = 0; level < GetMipLevelCount( m_skyboxSize ); ++level )
+		skyboxBytes += 6 * GetLevelByteSize( m_skyboxFormat, GetMipLevelSize( m_skyboxSize, level ) );
+	m_textureResidency.SetExternalBytes( skyboxBytes + m_virtualTextures.GetAtlasByteSize() );
+
+	const CompressedTextureCache::Stats cacheStats = m_textureCache.GetStats();
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[InitTextures] Texture cache: %u hits, %u baked, %u failed",
+					cacheStats.hits, cacheStats.baked, cacheStats.failed );
+
+	// a multi-draw program ennyi tömböt tud egyszerre mintavételezni, a többi tömb rajzolásai külön mennek
+	if ( m_materialTextures.GetArrayCount() > MULTI_DRAW_MAX_ARRAYS )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION,
+						SDL_LOG_PRIORITY_INFO,
+						"[InitTextures] %d texture arrays, the multi-draw path draws the layers past the first %d arrays one by one",
+						static_cast<int>( m_materialTextures.GetArrayCount() ), static_cast<int>( MULTI_DRAW_MAX_ARRAYS ) );
+	}
 }
 
 void CMyApp::CleanTextures()
 {
+	// a még sorban álló feltöltések törölt textúrákba írnának
+	m_textureStreamer.Clean();
+
 	// diffuse textures
 
-	glDeleteTextures(1, &m_sunTextureID);
-	glDeleteTextures(1, &m_mercuryTextureID);
-	glDeleteTextures(1, &m_venusTextureID);
-	glDeleteTextures(1, &m_earthTextureID);
-	glDeleteTextures(1, &m_earthNightTextureID);
-	glDeleteTextures(1, &m_moonTextureID);
-	glDeleteTextures(1, &m_marsTextureID);
-	glDeleteTextures(1, &m_jupiterTextureID);
-	glDeleteTextures(1, &m_saturnTextureID);
-	glDeleteTextures(1, &m_uranusTextureID);
-	glDeleteTextures(1, &m_neptuneTextureID);
-	glDeleteTextures(1, &m_plutoTextureID);
-
-	glDeleteTextures(1, &m_kuiperTextureID);
-	glDeleteTextures(1, &m_saturn_ringTextureID);
-	glDeleteTextures(1, &m_uranus_ringTextureID);
-	glDeleteTextures(1, &m_neptune_ringTextureID);
-
-	glDeleteTextures(1, &m_asteroidTextureID);
+	// a háttérszálak még a tömbök adatait olvashatják
+	m_textureResidency.Clean();
+	m_materialTextures.Clean();
+	m_virtualTextures.Clean();
 
 	// skybox texture
 
@@ -344,17 +621,202 @@ void CMyApp::InitSkyboxTextures()
 	// skybox texture
 
 	glGenTextures( 1, &m_skyboxTextureID );
-	TextureFromFile(m_skyboxTextureID, "Assets/space_xpos.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-	TextureFromFile(m_skyboxTextureID, "Assets/space_xneg.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-	TextureFromFile(m_skyboxTextureID, "Assets/space_ypos.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-	TextureFromFile(m_skyboxTextureID, "Assets/space_yneg.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-	TextureFromFile(m_skyboxTextureID, "Assets/space_zpos.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-	TextureFromFile(m_skyboxTextureID, "Assets/space_zneg.png", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
-	SetupTextureSampling( GL_TEXTURE_CUBE_MAP, m_skyboxTextureID, false );
+
+	// a lapok a m_workerPool szálain töltődnek a cache-ből, itt csak a feltöltés történik
+	BakedTexture faces[ 6 ];
+	TextureLoadBatch batch( m_workerPool, m_textureCache );
+	for ( int i = 0; i < 6; ++i )
+		batch.Add( SKYBOX_FACES[ i ].fileName, false, [ &faces, i ]( BakedTexture& image ) { faces[ i ] = std::move( image ); } );
+	batch.Finish();
+
+	// a kocka lapjainak azonos formátumúnak kell lenniük: ha egy is áttetsző, mind BC3
+	m_skyboxFormat = m_textureCache.IsCompressing() ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+	for ( const BakedTexture& face : faces )
+		if ( face.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT )
+			m_skyboxFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	// a kocka lapjai egyforma méretűek, az első betöltött lap szerint
+	m_skyboxSize = glm::ivec2( 1 );
+	for ( const BakedTexture& face : faces )
+		if ( !face.IsEmpty() )
+		{
+			m_skyboxSize = face.size;
+			break;
+		}
+
+	glBindTexture( GL_TEXTURE_CUBE_MAP, m_skyboxTextureID );
+	glTexStorage2D( GL_TEXTURE_CUBE_MAP, GetMipLevelCount( m_skyboxSize ), m_skyboxFormat, m_skyboxSize.x, m_skyboxSize.y );
+	glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+
+	for ( int i = 0; i < 6; ++i )
+	{
+		if ( faces[ i ].IsEmpty() ) faces[ i ] = MakeClearTexture( m_skyboxFormat, m_skyboxSize );
+		UploadSkyboxFace( SKYBOX_FACES[ i ].target, faces[ i ] );
+	}
+
+	SetupTextureSampling( GL_TEXTURE_CUBE_MAP, m_skyboxTextureID, false, true );
 
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 }
 
+void CMyApp::UploadSkyboxFace( const GLenum target, BakedTexture& image )
+{
+	if ( image.IsEmpty() ) return;
+
+	if ( !PromoteTexture( image, m_skyboxFormat ) || image.size != m_skyboxSize )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[Skybox] A face does not match the others in size or translucency. Restart to apply it." );
+		return;
+	}
+
+	// a többi textúrával együtt, a legkisebb mipmap szintekkel kezdve érkezik
+	m_textureStreamer.EnqueueFace( m_skyboxTextureID, target, std::move( image ) );
+}
+
+void CMyApp::InitHotReload()
+{
+	// a shaderek a munkakönyvtárban, a többi az Assets-ben
+	m_fileWatcher.Watch( "." );
+	m_fileWatcher.Watch( "Assets" );
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[HotReload] Watching shaders and Assets/ (%s)",
+					m_fileWatcher.IsNative() ? "inotify" : "polling" );
+}
+
+void CMyApp::PollHotReload()
+{
+	for ( const std::filesystem::path& fileName : m_fileWatcher.Poll() )
+	{
+		// a szerkesztett fájl a lemezről jön, akkor is, ha a csomagban is benne van
+		PreferAssetFile( fileName );
+
+		// shader: csak az érintett programok fordulnak újra
+		MarkShadersDirty( fileName );
+
+		// a bolygók, gyűrűk textúrái: egy réteg a tömbjükben, ha már betöltődött, a tömb mostani szintjeivel
+		if ( std::optional<TextureArraySet::Handle> handle = m_materialTextures.Find( fileName ) )
+		{
+			m_textureResidency.Reload( *handle );
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[HotReload] %s", fileName.string().c_str() );
+		}
+
+		// virtuális textúra: a csempék újrasülnek, addig a tömb rétege látszik
+		if ( std::optional<VirtualTextureSet::Handle> handle = m_virtualTextures.Find( fileName ) )
+			m_virtualTextures.Reload( *handle );
+
+		// a skybox egy lapja; laponként egy töltés fut, különben egy korábbi mentés később érkezhetne meg.
+		// Ha a lap már töltődik, az elavult, a végén az ApplyHotReloads újraindítja
+		for ( const SkyboxFace& face : SKYBOX_FACES )
+		{
+			if ( std::filesystem::path( face.fileName ).lexically_normal() != fileName ) continue;
+
+			auto pending = std::find_if( m_textureReloads.begin(), m_textureReloads.end(),
+				[ &face ]( const TextureReload& reload ) { return reload.cubeFace == face.target; } );
+			if ( pending != m_textureReloads.end() )
+			{
+				pending->stale = true;
+				continue;
+			}
+
+			TextureReload& reload = m_textureReloads.emplace_back();
+			reload.fileName = fileName;
+			reload.cubeFace = face.target;
+			StartSkyboxFaceReload( reload );
+		}
+
+		// a kisbolygó modellje; ha még az előző töltődik, az elavult, a végén az ApplyHotReloads újraindítja
+		if ( std::filesystem::path( ASTEROID_MESH_FILE ).lexically_normal() == fileName )
+		{
+			if ( m_asteroidMeshReload.valid() )
+				m_asteroidMeshStale = true;
+			else
+				StartAsteroidMeshReload();
+		}
+	}
+}
+
+void CMyApp::StartSkyboxFaceReload( TextureReload& reload )
+{
+	const CompressedTextureCache* cache = &m_textureCache;
+	const std::filesystem::path fileName = reload.fileName;
+	reload.image = m_workerPool.Submit( [ cache, fileName ]() { return cache->Load( fileName, false ); } );
+	reload.stale = false;
+}
+
+void CMyApp::StartAsteroidMeshReload()
+{
+	// a munkaszálon sorosan: ha a ParallelFor a saját segítőire várna, azok mögötte állnának a sorban
+	const MeshCache* cache = &m_meshCache;
+	const std::filesystem::path fileName = std::filesystem::path( ASTEROID_MESH_FILE ).lexically_normal();
+	m_asteroidMeshReload = m_workerPool.Submit( [ cache, fileName ]() { return cache->Load( fileName ); } );
+}
+
+void CMyApp::ApplyHotReloads()
+{
+	auto isReady = []( const auto& future ) { return future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready; };
+
+	// a kész képek feltöltése, a többi marad a következő frame-re
+	for ( auto it = m_textureReloads.begin(); it != m_textureReloads.end(); )
+	{
+		if ( !isReady( it->image ) )
+		{
+			++it;
+			continue;
+		}
+
+		// a régi tartalmú töltés eredménye eldobható, a lap legutóbbi mentése töltődik
+		if ( it->stale )
+		{
+			StartSkyboxFaceReload( *it );
+			++it;
+			continue;
+		}
+
+		// ha nem sikerült, a hibát a betöltés már kiírta, a régi tartalom marad
+		BakedTexture image = it->image.get();
+		if ( !image.IsEmpty() )
+		{
+			UploadSkyboxFace( it->cubeFace, image );
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[HotReload] %s", it->fileName.string().c_str() );
+		}
+
+		it = m_textureReloads.erase( it );
+	}
+
+	// a régi tartalmú töltés eredménye eldobható, a fájl legutóbbi mentése töltődik
+	if ( m_asteroidMeshReload.valid() && isReady( m_asteroidMeshReload ) && m_asteroidMeshStale )
+	{
+		m_asteroidMeshReload = {};
+		m_asteroidMeshStale = false;
+		StartAsteroidMeshReload();
+	}
+	else if ( m_asteroidMeshReload.valid() && isReady( m_asteroidMeshReload ) )
+	{
+		try
+		{
+			UploadAsteroidMesh( m_asteroidMeshReload.get() );
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[HotReload] %s", ASTEROID_MESH_FILE );
+		}
+		catch ( ... )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[HotReload] Cannot load %s, keeping the current mesh", ASTEROID_MESH_FILE );
+		}
+	}
+}
+
+void CMyApp::CleanHotReload()
+{
+	// a háttérszálak még a textúratömbök adatait olvashatják: megvárjuk őket
+	for ( TextureReload& reload : m_textureReloads )
+		reload.image.wait();
+	m_textureReloads.clear();
+
+	if ( m_asteroidMeshReload.valid() )
+		m_asteroidMeshReload.wait();
+	m_asteroidMeshReload = {};
+	m_asteroidMeshStale = false;
+}
+
 void CMyApp::CleanSkyboxTextures()
 {
 	glDeleteTextures( 1, &m_skyboxTextureID );
@@ -367,7 +829,17 @@ bool CMyApp::Init()
 	// törlési szín legyen kékes
 	glClearColor(0.125f, 0.25f, 0.5f, 1.0f);
 
+	// ha van asset csomag, minden fájl abból jön (mmap), különben a shaderek és az Assets/ fájljaiból
+	AssetPack::Mount( AssetPack::DEFAULT_FILE );
+
+	m_programCache.Init();
+	m_programBatch.Init();
+	m_textureCache.Init();
+	m_meshCache.Init();
+	m_textureStreamer.Init();
 	InitShaders();
+	InitHotReload();
+	InitUniformBuffers();
 	InitGeometry();
 	InitTextures();
 
@@ -380,6 +852,13 @@ bool CMyApp::Init()
 
 	glEnable(GL_DEPTH_TEST); // mélységi teszt bekapcsolása (takarás)
 
+	// a keverés módja mindig ugyanaz, csak ki-be kapcsoljuk (GLStateCache::SetBlend)
+	// az áttetsző textúrák előre alfával szorzottak (premultiplied), ezért a forrás színét nem szorozzuk újra
+	glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+
+	// a tessellation shaderes gömb négyszög patch-ekből áll
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+
 	// kamera
 	m_camera.SetView(
 		glm::vec3(0.0, 5.0, 35.0),// honnan nézzük a színteret	   - eye
@@ -392,111 +871,73 @@ bool CMyApp::Init()
 
 void CMyApp::Clean()
 {
+	CleanHotReload();
+	CleanPendingShaders();
 	CleanShaders();
+	CleanUniformBuffers();
 	CleanGeometry();
 	CleanTextures();
+
+	// a háttérszálak már nem olvasnak belőle
+	AssetPack::Unmount();
 }
 
 void CMyApp::Update( const SUpdateInfo& updateInfo )
 {
 	m_ElapsedTimeInSec = updateInfo.ElapsedTimeInSec;
 
-	m_camera.Update( updateInfo.DeltaTimeInSec );
-}
+	// megváltozott fájlok és Ctrl+F5: amint egy köteg elkészült, lecseréljük a régieket
+	PollHotReload();
+	PollShaders();
+	ApplyHotReloads();
 
-void CMyApp::Render()
-{
-	// töröljük a frampuffert (GL_COLOR_BUFFER_BIT)...
-	// ... és a mélységi Z puffert (GL_DEPTH_BUFFER_BIT)
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	//
-	// égitestek
-	//
-	
-	glUseProgram( m_programID );
-
-	glm::mat4 matWorld = glm::identity<glm::mat4>();
+	// az előző frame-ben látott textúrák betöltése, a tömbök szintjei a kereten belül; a streamer sorába tölt
+	m_textureResidency.SetBudget( static_cast<std::size_t>( m_textureBudgetMB ) << 20 );
+	m_textureResidency.Update();
 
-/*	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv( ul( "worldIT" ),  1, GL_FALSE, glm::value_ptr( glm::transpose( glm::inverse( matWorld ) ) ) );*/
+	// a textúrák feltöltése frame-enként legfeljebb ennyi időben
+	m_textureStreamer.Update( m_textureStreamBudgetMs );
 
-	glUniformMatrix4fv( ul( "viewProj" ), 1, GL_FALSE, glm::value_ptr( m_camera.GetViewProj() ) );
+	// a feedback által kért csempék betöltése és feltöltése, frame-enként legfeljebb ennyi
+	m_virtualTextures.Update( m_vtUploadBudget );
 
-	// - Fényforrások beállítása
-	glUniform3fv( ul( "cameraPos" ), 1, glm::value_ptr( m_camera.GetEye() ) );
-	glUniform4fv( ul( "lightPos" ),  1, glm::value_ptr( m_lightPos ) );
-
-	glUniform3fv( ul( "La" ),		 1, glm::value_ptr( m_La ) );
-	glUniform3fv( ul( "Ld" ),		 1, glm::value_ptr( m_Ld ) );
-	glUniform3fv( ul( "Ls" ),		 1, glm::value_ptr( m_Ls ) );
-
-	glUniform1f( ul( "lightConstantAttenuation"	 ), m_lightConstantAttenuation );
-	glUniform1f( ul( "lightLinearAttenuation"	 ), m_lightLinearAttenuation   );
-	glUniform1f( ul( "lightQuadraticAttenuation" ), m_lightQuadraticAttenuation);
-
-	// - Anyagjellemzők beállítása
-	glUniform3fv( ul( "Ka" ),		 1, glm::value_ptr( m_Ka ) );
-	glUniform3fv( ul( "Kd" ),		 1, glm::value_ptr( m_Kd ) );
-	glUniform3fv( ul( "Ks" ),		 1, glm::value_ptr( m_Ks ) );
-
-	glUniform1f( ul( "Shininess" ),	m_Shininess );
+	m_camera.Update( updateInfo.DeltaTimeInSec );
+}
 
-	glUniform1i(ul("isEarth"), m_isEarth);
+void CMyApp::UpdateBodies()
+{
+	m_bodies.clear();
 
-	glUniform1i(ul("isSun"), m_isSun);
+	glm::mat4 matWorld;
 
 	// Nap
 	// középpont: (0.0, 0.0, 0.0); sugár: 1.0;
 	// forgástengely: 7.25 deg
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_earthNightTextureID);
-	
-	glActiveTexture(GL_TEXTURE0);
-
-	glUniform1i(ul("isSun"), 1);
-
 	matWorld = glm::rotate<float>(glm::radians(-7.25f), glm::vec3(0.0f, 0.0f, 1.0f))
 		* glm::rotate<float>(glm::radians(m_ElapsedTimeInSec * (360.f / 27.f)), glm::vec3(0.0, 1.0, 0.0))
 		* glm::identity<glm::mat4>();
-	RenderPlanet(matWorld, m_sunTextureID);
-
-	glUniform1i(ul("isSun"), 0);
-	glUniform1i(ul("isSun"), 0);
+	m_bodies.push_back({ matWorld, GetMaterialTexture( SUN_TEXTURE ), BODY_FLAG_SUN, 1.0f });
 
 	// Merkúr
 	// Felszíne legyen 1 egységre a Nap felszínétől; surgár: 0.15;
 	// középpont: (2.15, 0.0, 0.0)  (1 + 1 + 0.15 = 2.15)
 	// forgástengely: 0.01 deg
 	Orb mercury(2.15f, 0.15f, 0.01f, 89.f, 58.7f);	
-	matWorld = mercury.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_mercuryTextureID);
+	m_bodies.push_back({ mercury.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( MERCURY_TEXTURE ), 0, mercury.GetRadius() });
 
 	// Vénusz
 	// Felszíne legyen 2 egységre a Nap felszínétől; surgár:  0.13;
 	// 2 + 1 + 0.13 = 3.13
 	// forgástengely: 177.4 deg
 	Orb venus(3.13f, 0.13f, 177.4f, 243.f, 255.f);
-	matWorld = venus.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_venusTextureID);
+	m_bodies.push_back({ venus.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( VENUS_TEXTURE ), 0, venus.GetRadius() });
 
 	// Föld
 	// Felszíne legyen 3 egységre a Nap felszínétől; surgár: 0.2;
 	// 3 + 1 + 0.2 = 4.2
 	// forgástengely: 23.44 fok
-
-	glUniform1i(ul("isEarth"), 1);
-
-	//mintavételező beállítása
-	glUniform1i(ul("texImage"), 0); 
-	glUniform1i(ul("texImageNight"), 1);
-
 	Orb earth(4.2f, 0.2f, 203.44f, 365.f, 1.f);
-	matWorld = earth.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_earthTextureID);
-
-	glUniform1i(ul("isEarth"), 0);
+	m_bodies.push_back({ earth.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( EARTH_TEXTURE ), BODY_FLAG_EARTH, earth.GetRadius(), GetVirtualTexture( EARTH_TEXTURE ) });
 
 	// Hold
 	// Felszíne legyen 0.2 egységre a Fökld felszínétől; surgár: Föld méretének 1 / 3 része
@@ -509,253 +950,858 @@ void CMyApp::Render()
 			* glm::translate<float>(glm::vec3(0.46667f, 0.0f, 0.0f))
 			* glm::rotate<float>(glm::radians(-1.54f), glm::vec3(0.0f, 0.0f, 1.0f))
 			* glm::scale<float>(glm::vec3(0.06667f, 0.06667f, 0.06667f));
-	RenderPlanet(matWorld, m_moonTextureID);
+	m_bodies.push_back({ matWorld, GetMaterialTexture( MOON_TEXTURE ), 0, 0.06667f, GetVirtualTexture( MOON_TEXTURE ) });
 
 	// Mars
 	// Felszíne legyen 4 egységre a Nap felszínétől; surgár: 0.19;
 	// 4 + 1 + 0.19 = 5.19
 	// forgástengely: 25.19 fok
 	Orb mars(5.19f, 0.19f, 25.19f, 687.f, 1.04f);
-	matWorld = mars.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_marsTextureID);
+	m_bodies.push_back({ mars.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( MARS_TEXTURE ), 0, mars.GetRadius(), GetVirtualTexture( MARS_TEXTURE ) });
 
 	// Jupiter
 	// Felszíne legyen 5 egységre a Nap felszínétől; surgár: 0.4;
 	//  5 + 1 + 0.4 = 6.4
 	// forgástengely: 3.13 fok	
 	Orb jupiter(6.4f, 0.4f, 3.13f, 4329.f, 0.42f);
-	matWorld = jupiter.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_jupiterTextureID);
+	m_bodies.push_back({ jupiter.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( JUPITER_TEXTURE ), 0, jupiter.GetRadius() });
 
 	// Szaturnusz
 	// Felszíne legyen 6 egységre a Nap felszínétől; surgár: 0.35;
 	// 6 + 1 + 0.35 = 7.35
 	// forgástengely: 26.73 fok
 	Orb saturn(7.35f, 0.35f, 26.73f, 10753.f, 0.46f);
-	matWorld = saturn.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_saturnTextureID);
+	m_bodies.push_back({ saturn.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( SATURN_TEXTURE ), 0, saturn.GetRadius() });
 
 	// Uránusz
 	// Felszíne legyen 7 egységre a Nap felszínétől; surgár: 0.25;
 	// 7 + 1 + 0.25 = 8.25
 	// forgástengely: 97.77 fok
 	Orb uranus(8.25f, 0.25f, 97.77f, 30664.f, 0.71f);
-	matWorld = uranus.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_uranusTextureID);
+	m_bodies.push_back({ uranus.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( URANUS_TEXTURE ), 0, uranus.GetRadius() });
 
 	// Neptunusz
 	// Felszíne legyen 8 egységre a Nap felszínétől; surgár: 0.26;
 	// 8 + 1 + 0.26 = 9.26
 	// forgástengely: 28.32 fok
 	Orb neptune(9.26f, 0.26f, 28.32f, 60148.f, 0.66f);
-	matWorld = neptune.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_neptuneTextureID);
+	m_bodies.push_back({ neptune.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( NEPTUNE_TEXTURE ), 0, neptune.GetRadius() });
 
 	// Pluto
 	// Felszíne legyen 9 egységre a Nap felszínétől; surgár: 0.1;
 	// 9 + 1 + 0.1 = 10.1
 	// forgástengely: 119.61 fok
 	Orb pluto(10.1f, 0.1f, 119.61f, 90520.f, 6.37f);
-	matWorld = pluto.GenTransformMatrix(m_ElapsedTimeInSec);
-	RenderPlanet(matWorld, m_plutoTextureID);
+	m_bodies.push_back({ pluto.GenTransformMatrix(m_ElapsedTimeInSec), GetMaterialTexture( PLUTO_TEXTURE ), 0, pluto.GetRadius() });
+}
 
+void CMyApp::InitUniformBuffers()
+{
+	// std140 elrendezés ellenőrzése (a vec3 után következő float a vec3 16 bájtos slotjába kerül)
+	static_assert( sizeof( CameraBlock )   == 80, "CameraBlock must match the std140 Camera block" );
+	static_assert( sizeof( LightBlock )    == 64, "LightBlock must match the std140 Light block" );
+	static_assert( sizeof( MaterialBlock ) == 48, "MaterialBlock must match the std140 Material block" );
+	static_assert( offsetof( LightBlock, Ld ) == 32 && offsetof( LightBlock, Ls ) == 48, "LightBlock std140 offsets" );
+	static_assert( offsetof( MaterialBlock, Kd ) == 16 && offsetof( MaterialBlock, Ks ) == 32, "MaterialBlock std140 offsets" );
+
+	m_cameraUBO.Create( CAMERA_BLOCK_BINDING );
+	m_lightUBO.Create( LIGHT_BLOCK_BINDING );
+	m_materialUBO.Create( MATERIAL_BLOCK_BINDING );
+}
 
-	// shader kikapcsolasa
-	glUseProgram(0);
+void CMyApp::CleanUniformBuffers()
+{
+	m_cameraUBO.Clean();
+	m_lightUBO.Clean();
+	m_materialUBO.Clean();
+}
 
-	// - Textúra kikapcsolása
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	
-	//
-	// skybox
-	//
+void CMyApp::UpdateUniformBuffers()
+{
+	// a bufferek csak akkor íródnak, ha a tartalmuk változott
 
-	// - VAO
-	glBindVertexArray( m_SkyboxGPU.vaoID );
+	CameraBlock camera = {};
+	camera.viewProj  = m_camera.GetViewProj();
+	camera.cameraPos = m_camera.GetEye();
+	m_cameraUBO.Update( camera );
 
-	// - Textura
-	glActiveTexture( GL_TEXTURE1 );
-	glBindTexture( GL_TEXTURE_CUBE_MAP, m_skyboxTextureID );
+	// - Fényforrások beállítása
+	LightBlock light = {};
+	light.lightPos = m_lightPos;
+	light.La = m_La;
+	light.Ld = m_Ld;
+	light.Ls = m_Ls;
+	light.lightConstantAttenuation  = m_lightConstantAttenuation;
+	light.lightLinearAttenuation    = m_lightLinearAttenuation;
+	light.lightQuadraticAttenuation = m_lightQuadraticAttenuation;
+	m_lightUBO.Update( light );
 
-	// - Program
-	glUseProgram( m_programSkyboxID );
+	// - Anyagjellemzők beállítása
+	MaterialBlock material = {};
+	material.Ka = m_Ka;
+	material.Kd = m_Kd;
+	material.Ks = m_Ks;
+	material.Shininess = m_Shininess;
+	m_materialUBO.Update( material );
+}
 
-	// - uniform parameterek
-	glUniformMatrix4fv( ul("world"),    1, GL_FALSE, glm::value_ptr( glm::translate( m_camera.GetEye() ) ) );
-	glUniformMatrix4fv( ul("viewProj"), 1, GL_FALSE, glm::value_ptr( m_camera.GetViewProj() ) );
+float CMyApp::GetSortDepth( const glm::mat4& matWorld ) const
+{
+	// a modell origójának távolsága a kamerától, a távoli vágósíkhoz normálva
+	return glm::length( glm::vec3( matWorld[ 3 ] ) - m_camera.GetEye() ) / m_camera.GetZFar();
+}
 
-	// - textúraegységek beállítása
-	glUniform1i( ul( "skyboxTexture" ), 1 );
+void CMyApp::CullBodiesAndBelts()
+{
+	m_cullSpheres.Clear();
+	m_cullSpheres.Reserve( m_bodies.size() + m_beltObjects.size() );
 
-	// mentsük el az előző Z-test eredményt, azaz azt a relációt, ami alapján update-eljük a pixelt.
-	GLint prevDepthFnc;
-	glGetIntegerv(GL_DEPTH_FUNC, &prevDepthFnc);
+	// középpont a world mátrix eltolása: az Orb pályapontja
+	for ( const CelestialBody& body : m_bodies )
+		m_cullSpheres.Add( glm::vec3( body.world[ 3 ] ), body.boundingRadius );
+	for ( const BeltObject& belt : m_beltObjects )
+		m_cullSpheres.Add( glm::vec3( belt.world[ 3 ] ), belt.boundingRadius );
 
-	// most kisebb-egyenlőt használjunk, mert mindent kitolunk a távoli vágósíkokra
-	glDepthFunc(GL_LEQUAL);
+	if ( m_frustumCulling )
+	{
+		m_visibleCount = CullSpheres( m_camera.GetFrustumPlanes(), m_cullSpheres, m_cullVisible );
+	}
+	else
+	{
+		m_cullVisible.assign( m_cullSpheres.GetSize(), 1 );
+		m_visibleCount = m_cullSpheres.GetSize();
+	}
+}
 
-	// - Rajzolas
-	glDrawElements( GL_TRIANGLES, m_SkyboxGPU.count, GL_UNSIGNED_INT, nullptr );
+float CMyApp::GetScreenRadius( const glm::vec3& center, const float radius ) const
+{
+	const float distance = glm::length( center - m_camera.GetEye() );
+	// a gömbön belül vagy közvetlenül mellette: a teljes képernyő
+	if ( distance <= radius )
+		return static_cast<float>( m_viewportHeight );
 
-	glDepthFunc(prevDepthFnc);
+	// a GetAngle a függőleges látószög, a képernyő fél magassága tan( angle / 2 ) a d = 1 távolságban
+	return radius / ( distance * std::tan( 0.5f * m_camera.GetAngle() ) ) * ( 0.5f * m_viewportHeight );
+}
 
+void CMyApp::RequestTextureResidency()
+{
+	// A gömb textúrája a teljes kerületet fedi: a kép közepén egy pixel 1 / r radián ( r a képernyőn mért sugár ),
+	// a 0. szinten w / ( 2 pi ) texel esik egy radiánra
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( !IsBodyVisible( i ) ) continue;
 
-	//
-	// gyűrűk
-	//
+		const CelestialBody& body = m_bodies[ i ];
+		const float screenRadius = std::max( GetScreenRadius( glm::vec3( body.world[ 3 ] ), body.boundingRadius ), 1.0f );
+		const float texelsPerPixel = m_materialTextures.GetArraySize( body.texture.array ).x / ( glm::two_pi<float>() * screenRadius );
 
-	glUseProgram(m_beltProgramID);
+		// a virtuális textúrás felszín nem a tömbből mintavételez, az éjszakai réteg viszont igen
+		if ( !UsesVirtualTexture( body ) )
+			m_textureResidency.Request( m_materialTextures.GetArrayHandles( body.texture.array )[ body.texture.layer ], texelsPerPixel );
+		if ( body.flags & BODY_FLAG_EARTH )
+			m_textureResidency.Request( EARTH_NIGHT_TEXTURE, texelsPerPixel );
+	}
 
-	matWorld = glm::identity<glm::mat4>();
+	// a gyűrű textúrája az átmérőjére feszül
+	for ( std::size_t i = 0; i < m_beltObjects.size(); ++i )
+	{
+		if ( !IsBeltVisible( i ) ) continue;
+
+		const BeltObject& belt = m_beltObjects[ i ];
+		const float screenRadius = std::max( GetScreenRadius( glm::vec3( belt.world[ 3 ] ), belt.boundingRadius ), 1.0f );
+		m_textureResidency.Request( m_materialTextures.GetArrayHandles( belt.texture.array )[ belt.texture.layer ],
+									m_materialTextures.GetArraySize( belt.texture.array ).x / ( 2.0f * screenRadius ) );
+	}
 
-	/*	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-		glUniformMatrix4fv( ul( "worldIT" ),  1, GL_FALSE, glm::value_ptr( glm::transpose( glm::inverse( matWorld ) ) ) );*/
+	// a kisbolygóöv a GPU-n vágódik, mindig kérjük
+	m_textureResidency.Request( ASTEROID_TEXTURE, m_materialTextures.GetArraySize( GetMaterialTexture( ASTEROID_TEXTURE ).array ).x / ASTEROID_SCREEN_SIZE );
+}
 
-	glUniformMatrix4fv(ul("viewProj"), 1, GL_FALSE, glm::value_ptr(m_camera.GetViewProj()));
+void CMyApp::SelectBodyLods()
+{
+	m_bodyLods.resize( m_bodies.size(), 0 );
+	m_sphereTriangleCount = 0;
 
-	// - Fényforrások beállítása
-	glUniform3fv(ul("cameraPos"), 1, glm::value_ptr(m_camera.GetEye()));
-	glUniform4fv(ul("lightPos"), 1, glm::value_ptr(m_lightPos));
+	// N szakaszos sokszög sziluett hibája egy r sugarú körhöz képest: r * ( 1 - cos( pi / N ) ),
+	// a paraméteres gömb M-je a fél kört osztja, így a két irányban ugyanaz a lépésköz
+	auto getError = []( const std::size_t lod, const float screenRadius )
+	{
+		return screenRadius * ( 1.0f - std::cos( glm::pi<float>() / SPHERE_LODS[ lod ].N ) );
+	};
 
-	glUniform3fv(ul("La"), 1, glm::value_ptr(m_La));
-	glUniform3fv(ul("Ld"), 1, glm::value_ptr(m_Ld));
-	glUniform3fv(ul("Ls"), 1, glm::value_ptr(m_Ls));
+	const float refineAbove  = m_sphereLodMaxError * ( 1.0f + SPHERE_LOD_HYSTERESIS );
+	const float coarsenBelow = m_sphereLodMaxError * ( 1.0f - SPHERE_LOD_HYSTERESIS );
 
-	glUniform1f(ul("lightConstantAttenuation"), m_lightConstantAttenuation);
-	glUniform1f(ul("lightLinearAttenuation"), m_lightLinearAttenuation);
-	glUniform1f(ul("lightQuadraticAttenuation"), m_lightQuadraticAttenuation);
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		std::size_t lod = m_bodyLods[ i ];
 
-	// - Anyagjellemzők beállítása
-	glUniform3fv(ul("Ka"), 1, glm::value_ptr(m_Ka));
-	glUniform3fv(ul("Kd"), 1, glm::value_ptr(m_Kd));
-	glUniform3fv(ul("Ks"), 1, glm::value_ptr(m_Ks));
+		if ( !m_sphereLod )
+		{
+			lod = 0;
+		}
+		else if ( IsBodyVisible( i ) )
+		{
+			const CelestialBody& body = m_bodies[ i ];
+			const float screenRadius = GetScreenRadius( glm::vec3( body.world[ 3 ] ), body.boundingRadius );
+
+			// finomítás, amíg a hiba a (kitolt) küszöb fölött van,
+			// durvítás, amíg a durvább szint hibája is a (csökkentett) küszöb alatt marad
+			while ( lod > 0 && getError( lod, screenRadius ) > refineAbove )
+				--lod;
+			while ( lod + 1 < SPHERE_LOD_COUNT && getError( lod + 1, screenRadius ) < coarsenBelow )
+				++lod;
+		}
+		// a nem látható égitest megtartja a szintjét, nem kell kiértékelni
 
-	glUniform1f(ul("Shininess"), m_Shininess);
-	glUniform1f(ul("Shininess"), m_Shininess);
+		m_bodyLods[ i ] = static_cast<std::uint8_t>( lod );
 
-	// aszteroida
-	glBindVertexArray(m_asteroidGPU.vaoID);
+		if ( IsBodyVisible( i ) )
+			m_sphereTriangleCount += 2 * SPHERE_LODS[ lod ].N * SPHERE_LODS[ lod ].M;
+	}
+}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_asteroidTextureID);
+void CMyApp::QueueBodiesPerDraw()
+{
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( !IsBodyVisible( i ) ) continue;
 
-	Orb asteroid(4.5f, 0.05f, 0.f, 110.f, 0.0f);
-	matWorld = asteroid.GenTransformMatrix(m_ElapsedTimeInSec)
-		* glm::rotate<float>(glm::radians(m_ElapsedTimeInSec* (30.f)), glm::vec3(1.0, 0.0, 0.0))
-		* glm::rotate<float>(glm::radians(m_ElapsedTimeInSec* (30.f)), glm::vec3(0.0, 1.0, 0.0))
-		* glm::rotate<float>(glm::radians(m_ElapsedTimeInSec* (30.f)), glm::vec3(0.0, 0.0, 1.0));
+		QueueBodyPerDraw( i );
+	}
+}
 
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
+void CMyApp::QueueBodyPerDraw( const std::size_t i )
+{
+	const CelestialBody& body = m_bodies[ i ];
+	const MeshRange& mesh = GetBodyMesh( i );
+
+	DrawItem item;
+	item.state.program       = m_programID;
+	item.state.vao           = m_meshPool.GetVaoID();
+	item.state.textureUnit   = 0;
+	item.state.textureTarget = GL_TEXTURE_2D_ARRAY;
+	item.state.textures[ 0 ] = body.texture.textureID;
+	item.count      = mesh.indexCount;
+	item.firstIndex = mesh.firstIndex;
+	item.baseVertex = mesh.baseVertex;
+	item.setUniforms = [ this, i ]()
+	{
+		const CelestialBody& body = m_bodies[ i ];
 
-	glDrawElements(GL_TRIANGLES,
-		m_asteroidGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
+		m_bodyUniforms.isSun.Set( ( body.flags & BODY_FLAG_SUN ) ? 1 : 0 );
+		m_bodyUniforms.isEarth.Set( ( body.flags & BODY_FLAG_EARTH ) ? 1 : 0 );
+		m_bodyUniforms.layer.Set( body.texture.layer );
+		m_bodyUniforms.useVirtualTexture.Set( UsesVirtualTexture( body ) ? 1 : 0 );
+		if ( UsesVirtualTexture( body ) )
+		{
+			m_bodyUniforms.vtPageTable.Set( m_virtualTextures.GetPageTableUnit( body.virtualTexture ) );
+			m_bodyUniforms.vtTileCount.Set( glm::vec2( m_virtualTextures.GetTileCount( body.virtualTexture ) ) );
+			m_bodyUniforms.vtLevelCount.Set( m_virtualTextures.GetLevelCount( body.virtualTexture ) );
+		}
+		m_bodyUniforms.world.Set( body.world );
+		m_bodyUniforms.worldIT.Set( glm::transpose( glm::inverse( body.world ) ) );
+	};
 
-	glBindVertexArray(m_beltGPU.vaoID);
+	m_renderQueue.Push( RenderPass::Opaque, GetSortDepth( body.world ), std::move( item ) );
+}
 
-	glEnable(GL_BLEND);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+void CMyApp::QueueBodiesInstanced()
+{
+	// példányonkénti adatok összeállítása és feltöltése, textúratömbönként és azon belül
+	// részletességi szintenként egymás után, hogy (tömb, szint) páronként egyetlen rajzolás elég legyen
+	m_bodyInstances.clear();
+	std::vector<GLsizei> instanceCounts( m_materialTextures.GetArrayCount() * SPHERE_LOD_COUNT, 0 );
 
-	glDisable(GL_CULL_FACE);
-	
-	// Szaturnusz-öv
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_saturn_ringTextureID);
+	for ( std::size_t group = 0; group < instanceCounts.size(); ++group )
+	{
+		const std::size_t arrayIndex = group / SPHERE_LOD_COUNT;
+		const std::size_t lod        = group % SPHERE_LOD_COUNT;
 
-	Orb saturnRing(7.35f, 1.5f, 26.73f, 10753.f, 0.f);
-	matWorld = saturnRing.GenTransformMatrix(m_ElapsedTimeInSec);
+		for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+		{
+			const CelestialBody& body = m_bodies[ i ];
+			if ( !IsBodyVisible( i ) || m_bodyLods[ i ] != lod || body.texture.textureID != m_materialTextures.GetArrayID( arrayIndex ) ) continue;
 
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
+			BodyInstance instance;
+			instance.world   = body.world;
+			instance.worldIT = glm::transpose( glm::inverse( body.world ) );
+			instance.layer   = body.texture.layer;
+			instance.flags   = body.flags;
+			m_bodyInstances.push_back( instance );
 
-	glDrawElements(GL_TRIANGLES,
-		m_beltGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
+			++instanceCounts[ group ];
+		}
+	}
 
-	// Uránusz-öv
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_uranus_ringTextureID);
+	glBindBuffer( GL_ARRAY_BUFFER, m_bodyInstanceBufferID );
+	// a régi tartalmat eldobjuk (orphaning), így nem kell megvárni az előző frame rajzolását
+	glBufferData( GL_ARRAY_BUFFER, m_bodyInstances.size() * sizeof( BodyInstance ), nullptr, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, m_bodyInstances.size() * sizeof( BodyInstance ), m_bodyInstances.data() );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
 
-	Orb uranusRing(8.25f, 0.85f, 97.77f, 30664.f, 0.f);
-	matWorld = uranusRing.GenTransformMatrix(m_ElapsedTimeInSec);
+	// (tömb, szint) páronként egy rajzolás, a baseInstance a csoport első példányára mutat
+	GLuint baseInstance = 0;
+	for ( std::size_t group = 0; group < instanceCounts.size(); ++group )
+	{
+		if ( instanceCounts[ group ] == 0 ) continue;
+
+		const std::size_t arrayIndex = group / SPHERE_LOD_COUNT;
+		const MeshRange& mesh = m_meshPool.Get( m_sphereLodMeshes[ group % SPHERE_LOD_COUNT ] );
+
+		DrawItem item;
+		item.state.program       = m_bodyInstancedProgramID;
+		item.state.vao           = m_bodyInstancedVaoID;
+		item.state.textureUnit   = 0;
+		item.state.textureTarget = GL_TEXTURE_2D_ARRAY;
+		item.state.textures[ 0 ]  = m_materialTextures.GetArrayID( arrayIndex );
+		item.count         = mesh.indexCount;
+		item.firstIndex    = mesh.firstIndex;
+		item.baseVertex    = mesh.baseVertex;
+		item.instanceCount = instanceCounts[ group ];
+		item.baseInstance  = baseInstance;
+
+		// több égitest egy rajzolásban, a mélység itt nem számít
+		m_renderQueue.Push( RenderPass::Opaque, 0.0f, std::move( item ) );
+
+		baseInstance += instanceCounts[ group ];
+	}
+}
 
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
+void CMyApp::QueueBodiesTessellated()
+{
+	const MeshRange& patches = m_meshPool.Get( m_spherePatchMesh );
 
-	glDrawElements(GL_TRIANGLES,
-		m_beltGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
+	DrawState state;
+	state.program       = m_sphereTessProgramID;
+	state.vao           = m_meshPool.GetVaoID();
+	state.textureUnit   = 0;
+	state.textureTarget = GL_TEXTURE_2D_ARRAY;
 
-	// Neptunusz-öv
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_neptune_ringTextureID);
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( !IsBodyVisible( i ) ) continue;
+
+		const CelestialBody& body = m_bodies[ i ];
+
+		DrawItem item;
+		item.state = state;
+		item.state.textures[ 0 ] = body.texture.textureID;
+		item.mode       = GL_PATCHES;
+		item.count      = patches.indexCount;
+		item.firstIndex = patches.firstIndex;
+		item.baseVertex = patches.baseVertex;
+		item.setUniforms = [ this, i ]()
+		{
+			const CelestialBody& body = m_bodies[ i ];
+
+			m_sphereTessUniforms.isSun.Set( ( body.flags & BODY_FLAG_SUN ) ? 1 : 0 );
+			m_sphereTessUniforms.isEarth.Set( ( body.flags & BODY_FLAG_EARTH ) ? 1 : 0 );
+			m_sphereTessUniforms.layer.Set( body.texture.layer );
+			m_sphereTessUniforms.useVirtualTexture.Set( UsesVirtualTexture( body ) ? 1 : 0 );
+			if ( UsesVirtualTexture( body ) )
+			{
+				m_sphereTessUniforms.vtPageTable.Set( m_virtualTextures.GetPageTableUnit( body.virtualTexture ) );
+				m_sphereTessUniforms.vtTileCount.Set( glm::vec2( m_virtualTextures.GetTileCount( body.virtualTexture ) ) );
+				m_sphereTessUniforms.vtLevelCount.Set( m_virtualTextures.GetLevelCount( body.virtualTexture ) );
+			}
+			m_sphereTessUniforms.world.Set( body.world );
+			m_sphereTessUniforms.worldIT.Set( glm::transpose( glm::inverse( body.world ) ) );
+		};
+
+		m_renderQueue.Push( RenderPass::Opaque, GetSortDepth( body.world ), std::move( item ) );
+	}
+}
 
-	Orb neptuneRing(9.26f, 1.0f, 28.32f, 60148.f, 0.66f);
-	matWorld = neptuneRing.GenTransformMatrix(m_ElapsedTimeInSec);
+int CMyApp::GetVirtualTexture( MaterialTexture texture ) const
+{
+	const auto it = std::find( std::begin( VIRTUAL_TEXTURE_MATERIALS ), std::end( VIRTUAL_TEXTURE_MATERIALS ), texture );
+	return it != std::end( VIRTUAL_TEXTURE_MATERIALS ) ? static_cast<int>( it - std::begin( VIRTUAL_TEXTURE_MATERIALS ) ) : -1;
+}
 
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
+bool CMyApp::UsesVirtualTexture( const CelestialBody& body ) const
+{
+	return m_virtualTexturing && body.virtualTexture >= 0 && m_virtualTextures.IsReady( body.virtualTexture );
+}
+
+void CMyApp::RenderVirtualTextureFeedback()
+{
+	// kis felbontásban újra az égitestek, a színük helyett a csempe, amit mintavételeznének;
+	// a többi égitest is rajzolódik, hogy takarjon. A visszaolvasás aszinkron, egy-két frame múlva érkezik.
+	const glm::ivec2 viewportSize( m_viewportWidth, m_viewportHeight );
+	if ( !m_virtualTextures.BeginFeedback( viewportSize ) ) return;
+
+	m_stateCache.UseProgram( m_vtFeedbackProgramID );
+	m_stateCache.BindVertexArray( m_meshPool.GetVaoID() );
+	m_stateCache.SetBlend( false );
+	m_stateCache.SetCullFace( true );
+	m_stateCache.SetDepthFunc( GL_LESS );
+
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( !IsBodyVisible( i ) ) continue;
 
-	glDrawElements(GL_TRIANGLES,
-		m_beltGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
+		const CelestialBody& body = m_bodies[ i ];
+		const MeshRange& mesh = GetBodyMesh( i );
 
-	// Kuiper-öv
+		m_vtFeedbackUniforms.world.Set( body.world );
+		m_vtFeedbackUniforms.worldIT.Set( glm::transpose( glm::inverse( body.world ) ) );
+		m_vtFeedbackUniforms.vtIndex.Set( UsesVirtualTexture( body ) ? body.virtualTexture : -1 );
+		if ( UsesVirtualTexture( body ) )
+		{
+			m_vtFeedbackUniforms.vtTileCount.Set( glm::vec2( m_virtualTextures.GetTileCount( body.virtualTexture ) ) );
+			m_vtFeedbackUniforms.vtLevelCount.Set( m_virtualTextures.GetLevelCount( body.virtualTexture ) );
+		}
+
+		const void* indices = reinterpret_cast<const void*>( static_cast<std::uintptr_t>( mesh.firstIndex ) * sizeof( GLuint ) );
+		glDrawElementsBaseVertex( GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, indices, mesh.baseVertex );
+	}
+
+	m_virtualTextures.EndFeedback( viewportSize );
+}
+
+void CMyApp::QueueSkybox()
+{
+	DrawItem item;
+	item.state.program       = m_programSkyboxID;
+	item.state.vao           = m_SkyboxGPU.vaoID;
+	item.state.textureUnit   = 1;
+	item.state.textureTarget = GL_TEXTURE_CUBE_MAP;
+	item.state.textures[ 0 ]  = m_skyboxTextureID;
+	// most kisebb-egyenlőt használjunk, mert mindent kitolunk a távoli vágósíkokra
+	item.state.depthFunc     = GL_LEQUAL;
+	item.count = m_SkyboxGPU.count;
+
+	m_renderQueue.Push( RenderPass::Skybox, 1.0f, std::move( item ) );
+}
+
+// az egységnyi gyűrű-négyzet befoglaló gömbjének sugara (fél átló)
+static constexpr float RING_QUAD_RADIUS = 0.70711f;
+
+void CMyApp::UpdateBelts()
+{
+	m_beltObjects.clear();
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_kuiperTextureID);
+	glm::mat4 matWorld;
 
+	// Szaturnusz-öv
+	Orb saturnRing(7.35f, 1.5f, 26.73f, 10753.f, 0.f);
+	matWorld = saturnRing.GenTransformMatrix(m_ElapsedTimeInSec);
+	m_beltObjects.push_back({ matWorld, GetMaterialTexture( SATURN_RING_TEXTURE ), &m_beltGPU, m_ringMesh, true, saturnRing.GetRadius() * RING_QUAD_RADIUS });
+
+	// Uránusz-öv
+	Orb uranusRing(8.25f, 0.85f, 97.77f, 30664.f, 0.f);
+	matWorld = uranusRing.GenTransformMatrix(m_ElapsedTimeInSec);
+	m_beltObjects.push_back({ matWorld, GetMaterialTexture( URANUS_RING_TEXTURE ), &m_beltGPU, m_ringMesh, true, uranusRing.GetRadius() * RING_QUAD_RADIUS });
+
+	// Neptunusz-öv
+	Orb neptuneRing(9.26f, 1.0f, 28.32f, 60148.f, 0.66f);
+	matWorld = neptuneRing.GenTransformMatrix(m_ElapsedTimeInSec);
+	m_beltObjects.push_back({ matWorld, GetMaterialTexture( NEPTUNE_RING_TEXTURE ), &m_beltGPU, m_ringMesh, true, neptuneRing.GetRadius() * RING_QUAD_RADIUS });
+
+	// Kuiper-öv
 	matWorld = glm::translate<float>(glm::vec3(0.0f, -0.05f, 0.0f))
 		* glm::scale<float>(glm::vec3(25.0f, 1.0f, 25.0f))
 		* glm::identity<glm::mat4>();
+	m_beltObjects.push_back({ matWorld, GetMaterialTexture( KUIPER_TEXTURE ), &m_beltGPU, m_ringMesh, true, 25.0f * RING_QUAD_RADIUS });
+}
 
-	glUniformMatrix4fv(ul("world"), 1, GL_FALSE, glm::value_ptr(matWorld));
-	glUniformMatrix4fv(ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(matWorld))));
+void CMyApp::QueueBelts()
+{
+	for ( std::size_t i = 0; i < m_beltObjects.size(); ++i )
+	{
+		if ( !IsBeltVisible( i ) ) continue;
 
-	glDrawElements(GL_TRIANGLES,
-		m_beltGPU.count,
-		GL_UNSIGNED_INT,
-		nullptr);
+		QueueBelt( i );
+	}
+}
 
-	glEnable(GL_CULL_FACE);
-	glDisable(GL_BLEND);
+void CMyApp::QueueBelt( const std::size_t i )
+{
+	const BeltObject& belt = m_beltObjects[ i ];
+
+	DrawItem item;
+	item.state.program       = m_beltProgramID;
+	item.state.vao           = belt.mesh->vaoID;
+	item.state.textureUnit   = 0;
+	item.state.textureTarget = GL_TEXTURE_2D_ARRAY;
+	item.state.textures[ 0 ]  = belt.texture.textureID;
+	// a gyűrűk átlátszóak és mindkét oldalukról látszanak
+	item.state.blend         = belt.blended;
+	item.state.cullFace      = !belt.blended;
+	item.count = belt.mesh->count;
+	item.setUniforms = [ this, i ]()
+	{
+		const BeltObject& belt = m_beltObjects[ i ];
 
-	// shader kikapcsolasa
-	glUseProgram( 0 );
+		m_beltUniforms.layer.Set( belt.texture.layer );
+		m_beltUniforms.world.Set( belt.world );
+		m_beltUniforms.worldIT.Set( glm::transpose( glm::inverse( belt.world ) ) );
+	};
 
-	// - Textúrák kikapcsolása, minden egységre külön
-	glActiveTexture( GL_TEXTURE0 );
-	glBindTexture( GL_TEXTURE_2D, 0 );
-	glActiveTexture( GL_TEXTURE1 );
-	glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+	m_renderQueue.Push( belt.blended ? RenderPass::Transparent : RenderPass::Opaque, GetSortDepth( belt.world ), std::move( item ) );
+}
+
+void CMyApp::QueueMultiDraw()
+{
+	m_multiDrawOpaque.clear();
+	m_multiDrawBlended.clear();
+
+	auto makeEntry = [ this ]( MeshPool::Handle mesh, const glm::mat4& world, const TextureLayer& texture, GLint flags )
+	{
+		MultiDrawEntry entry;
+		entry.mesh          = mesh;
+		entry.data.world    = world;
+		entry.data.worldIT  = glm::transpose( glm::inverse( world ) );
+		entry.data.layer    = texture.layer;
+		entry.data.array    = texture.array;
+		entry.data.flags    = flags;
+		entry.data._pad0    = 0;
+		entry.depth         = GetSortDepth( world );
+		return entry;
+	};
+
+	for ( std::size_t i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( !IsBodyVisible( i ) ) continue;
+
+		const CelestialBody& body = m_bodies[ i ];
+		// a shader ennyi tömböt ér el, a többiek rétegeit külön rajzolással
+		if ( body.texture.array >= static_cast<GLint>( MULTI_DRAW_MAX_ARRAYS ) )
+		{
+			QueueBodyPerDraw( i );
+			continue;
+		}
+		m_multiDrawOpaque.push_back( makeEntry( m_sphereLodMeshes[ m_bodyLods[ i ] ], body.world, body.texture, body.flags | BODY_FLAG_SPHERE ) );
+	}
+
+	for ( std::size_t i = 0; i < m_beltObjects.size(); ++i )
+	{
+		if ( !IsBeltVisible( i ) ) continue;
+
+		const BeltObject& belt = m_beltObjects[ i ];
+		if ( belt.texture.array >= static_cast<GLint>( MULTI_DRAW_MAX_ARRAYS ) )
+		{
+			QueueBelt( i );
+			continue;
+		}
+		MultiDrawEntry entry = makeEntry( belt.pooledMesh, belt.world, belt.texture, BODY_FLAG_UNLIT );
+		( belt.blended ? m_multiDrawBlended : m_multiDrawOpaque ).push_back( entry );
+	}
+
+	// egy parancslistán belül nincs további rendezés: az átlátszatlanokat elölről hátra,
+	// az átlátszókat hátulról előre soroljuk
+	std::sort( m_multiDrawOpaque.begin(), m_multiDrawOpaque.end(),
+		[]( const MultiDrawEntry& a, const MultiDrawEntry& b ) { return a.depth < b.depth; } );
+	std::sort( m_multiDrawBlended.begin(), m_multiDrawBlended.end(),
+		[]( const MultiDrawEntry& a, const MultiDrawEntry& b ) { return a.depth > b.depth; } );
+
+	// parancsok és rajzolásonkénti adatok: előbb az átlátszatlan, utána az átlátszó menet,
+	// a baseInstance a DrawData indexe (ezt olvassa a rajzolás sorszám attribútum)
+	// ha nem fér el minden rajzolás, a rajzolás sorszám attribútum és a DrawData puffer kétszer akkora lesz
+	const std::size_t drawCount = m_multiDrawOpaque.size() + m_multiDrawBlended.size();
+	GLuint drawCapacity = m_meshPool.GetDrawIndexCapacity();
+	if ( drawCount > drawCapacity )
+	{
+		while ( drawCapacity < drawCount ) drawCapacity *= 2;
+		m_meshPool.ReserveDrawIndices( drawCapacity );
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[MultiDraw] %d draws, capacity grown to %u", static_cast<int>( drawCount ), drawCapacity );
+	}
+
+	m_multiDrawCommands.clear();
+	m_multiDrawData.clear();
+	for ( const auto* entries : { &m_multiDrawOpaque, &m_multiDrawBlended } )
+	{
+		for ( const MultiDrawEntry& entry : *entries )
+		{
+			m_multiDrawCommands.push_back( m_meshPool.MakeCommand( entry.mesh, static_cast<GLuint>( m_multiDrawData.size() ) ) );
+			m_multiDrawData.push_back( entry.data );
+		}
+	}
+
+	// feltöltés a GL_COPY_WRITE_BUFFER-en keresztül, hogy a state cache által követett kötések ne változzanak;
+	// a régi tartalmat eldobjuk (orphaning), így nem kell megvárni az előző frame rajzolását
+	glBindBuffer( GL_COPY_WRITE_BUFFER, m_drawDataBufferID );
+	glBufferData( GL_COPY_WRITE_BUFFER, drawCapacity * sizeof( DrawData ), nullptr, GL_STREAM_DRAW );
+	glBufferSubData( GL_COPY_WRITE_BUFFER, 0, m_multiDrawData.size() * sizeof( DrawData ), m_multiDrawData.data() );
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, m_indirectBufferID );
+	glBufferData( GL_COPY_WRITE_BUFFER, m_multiDrawCommands.size() * sizeof( DrawElementsIndirectCommand ), m_multiDrawCommands.data(), GL_STREAM_DRAW );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	// a textúratömbök a 0. egységtől kezdve, ahogy a texArrays várja
+	DrawState state;
+	state.program        = m_multiDrawProgramID;
+	state.vao            = m_meshPool.GetVaoID();
+	state.textureUnit    = 0;
+	state.textureTarget  = GL_TEXTURE_2D_ARRAY;
+	state.indirectBuffer = m_indirectBufferID;
+	for ( std::size_t i = 0; i < m_materialTextures.GetArrayCount() && i < MULTI_DRAW_MAX_ARRAYS; ++i )
+		state.textures[ i ] = m_materialTextures.GetArrayID( i );
+
+	const GLsizei opaqueCount  = static_cast<GLsizei>( m_multiDrawOpaque.size() );
+	const GLsizei blendedCount = static_cast<GLsizei>( m_multiDrawCommands.size() ) - opaqueCount;
+
+	if ( opaqueCount > 0 )
+	{
+		DrawItem item;
+		item.state     = state;
+		item.drawCount = opaqueCount;
+		m_renderQueue.Push( RenderPass::Opaque, 0.0f, std::move( item ) );
+	}
+
+	if ( blendedCount > 0 )
+	{
+		DrawItem item;
+		item.state          = state;
+		item.state.blend    = true;
+		item.state.cullFace = false;
+		item.drawCount      = blendedCount;
+		item.indirectOffset = opaqueCount * sizeof( DrawElementsIndirectCommand );
+		m_renderQueue.Push( RenderPass::Transparent, 0.0f, std::move( item ) );
+	}
+}
 
+void CMyApp::InitAsteroidBelt()
+{
+	glGenBuffers(1, &m_asteroidParamsBufferID);
+	glGenBuffers(1, &m_visibleAsteroidBufferID);
+	glGenBuffers(1, &m_asteroidCommandBufferID);
 
-	// VAO kikapcsolása
-	glBindVertexArray( 0 );
+	// a parancsot a compute shader SSBO-ként tölti, a rajzolás GL_DRAW_INDIRECT_BUFFER-ként olvassa
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_asteroidCommandBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ASTEROID_COMMAND_BINDING, m_asteroidCommandBufferID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	ResizeAsteroidBelt();
 }
 
-void CMyApp::RenderGUI()
+void CMyApp::CleanAsteroidBelt()
 {
-	// ImGui::ShowDemoWindow();
-	
+	glDeleteBuffers(1, &m_asteroidParamsBufferID);
+	m_asteroidParamsBufferID = 0;
+	glDeleteBuffers(1, &m_visibleAsteroidBufferID);
+	m_visibleAsteroidBufferID = 0;
+	glDeleteBuffers(1, &m_asteroidCommandBufferID);
+	m_asteroidCommandBufferID = 0;
+	m_allocatedAsteroidCount = 0;
 }
 
-GLint CMyApp::ul( const char* uniformName ) noexcept
+void CMyApp::ResizeAsteroidBelt()
 {
-	GLuint programID = 0;
+	// csak a darabszám változásakor: új pufferek és új pályaadatok, a CPU nem tölt fel semmit
+	const GLuint asteroidCount = static_cast<GLuint>( m_asteroidCount );
 
-	// Kérdezzük le az aktuális programot!
-	// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glGet.xhtml
-	glGetIntegerv( GL_CURRENT_PROGRAM, reinterpret_cast<GLint*>( &programID ) );
-	// A program és a uniform név ismeretében kérdezzük le a location-t!
-	// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glGetUniformLocation.xhtml
-	return glGetUniformLocation( programID, uniformName );
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_asteroidParamsBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, asteroidCount * sizeof(AsteroidParams), nullptr, GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ASTEROID_PARAMS_BINDING, m_asteroidParamsBufferID);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleAsteroidBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, asteroidCount * sizeof(VisibleAsteroid), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_ASTEROID_BINDING, m_visibleAsteroidBufferID);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_stateCache.UseProgram( m_asteroidBeltInitProgramID );
+	m_asteroidBeltInitUniforms.asteroidCount.Set( asteroidCount );
+	m_asteroidBeltInitUniforms.seed.Set( 0x9E3779B9u );
+	glDispatchCompute( ( asteroidCount + ASTEROID_GROUP_SIZE - 1 ) / ASTEROID_GROUP_SIZE, 1, 1 );
+
+	// a vágás SSBO-ként olvassa
+	glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+
+	m_allocatedAsteroidCount = asteroidCount;
+}
+
+void CMyApp::DispatchAsteroidBelt()
+{
+	if ( static_cast<GLuint>( m_asteroidCount ) != m_allocatedAsteroidCount )
+		ResizeAsteroidBelt();
+
+	// a parancs alaphelyzetbe: teljes modell, 0 példány - ezt növeli a compute shader
+	DrawElementsIndirectCommand command = {};
+	command.count = static_cast<GLuint>( m_asteroidGPU.count );
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, m_asteroidCommandBufferID );
+	glBufferSubData( GL_COPY_WRITE_BUFFER, 0, sizeof( command ), &command );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	m_stateCache.UseProgram( m_asteroidBeltCullProgramID );
+	m_asteroidBeltCullUniforms.asteroidCount.Set( m_allocatedAsteroidCount );
+	m_asteroidBeltCullUniforms.time.Set( m_ElapsedTimeInSec );
+	m_asteroidBeltCullUniforms.meshRadius.Set( m_asteroidMeshRadius );
+	glDispatchCompute( ( m_allocatedAsteroidCount + ASTEROID_GROUP_SIZE - 1 ) / ASTEROID_GROUP_SIZE, 1, 1 );
+
+	// a vertex shader SSBO-ként, a rajzolás indirekt parancsként olvassa az eredményt
+	glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT );
+}
+
+void CMyApp::QueueAsteroidBelt()
+{
+	// egyetlen indirekt példányosított rajzolás, a példányszámot a GPU írta
+	DrawItem item;
+	item.state.program        = m_asteroidBeltProgramID;
+	item.state.vao            = m_asteroidGPU.vaoID;
+	item.state.textureUnit    = 0;
+	item.state.textureTarget  = GL_TEXTURE_2D_ARRAY;
+	item.state.textures[ 0 ]  = GetMaterialTexture( ASTEROID_TEXTURE ).textureID;
+	item.state.indirectBuffer = m_asteroidCommandBufferID;
+	item.drawCount = 1;
+	item.setUniforms = [ this ]()
+	{
+		m_asteroidBeltUniforms.layer.Set( GetMaterialTexture( ASTEROID_TEXTURE ).layer );
+	};
+
+	m_renderQueue.Push( RenderPass::Opaque, 0.0f, std::move( item ) );
+}
+
+void CMyApp::Render()
+{
+	// töröljük a frampuffert (GL_COLOR_BUFFER_BIT)...
+	// ... és a mélységi Z puffert (GL_DEPTH_BUFFER_BIT)
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// két frame között az ImGui és a shader újratöltés is állít GL állapotot a cache tudta nélkül
+	m_stateCache.Invalidate();
+
+	// kamera, fény és anyag - egyszer, minden programnak
+	UpdateUniformBuffers();
+
+	// a Föld éjszakai rétege minden égitestre közös
+	m_bodyUniforms.nightLayer.Set( m_programID, GetMaterialTexture( EARTH_NIGHT_TEXTURE ).layer );
+	m_bodyInstancedUniforms.nightLayer.Set( m_bodyInstancedProgramID, GetMaterialTexture( EARTH_NIGHT_TEXTURE ).layer );
+	m_multiDrawUniforms.nightLayer.Set( m_multiDrawProgramID, GetMaterialTexture( EARTH_NIGHT_TEXTURE ).layer );
+
+	// a virtuális textúrák atlasza és laptáblái, a rajzolási lista a 0. egységet használja
+	if ( m_virtualTexturing )
+		m_virtualTextures.Bind( m_stateCache );
+	m_sphereTessUniforms.nightLayer.Set( m_sphereTessProgramID, GetMaterialTexture( EARTH_NIGHT_TEXTURE ).layer );
+	m_sphereTessUniforms.screenScale.Set( m_sphereTessProgramID, 0.5f * m_viewportHeight / std::tan( 0.5f * m_camera.GetAngle() ) );
+	m_sphereTessUniforms.targetEdgeLength.Set( m_sphereTessProgramID, m_tessEdgeLength );
+
+	//
+	// rajzolási lista összeállítása
+	//
+
+	m_renderQueue.Clear();
+
+	// égitestek és gyűrűk
+	UpdateBodies();
+	UpdateBelts();
+	CullBodiesAndBelts();
+	SelectBodyLods();
+	RequestTextureResidency();
+
+	switch ( m_renderPath )
+	{
+	case RenderPath::PerDraw:
+		QueueBodiesPerDraw();
+		QueueBelts();
+		break;
+	case RenderPath::Instanced:
+		QueueBodiesInstanced();
+		QueueBelts();
+		break;
+	case RenderPath::MultiDrawIndirect:
+		// egy rajzolás az átlátszatlan, egy az átlátszó menetre, a színtér méretétől függetlenül;
+		// csak a MULTI_DRAW_MAX_ARRAYS feletti tömbök rétegei mennek külön
+		QueueMultiDraw();
+		break;
+	case RenderPath::Tessellated:
+		QueueBodiesTessellated();
+		QueueBelts();
+		break;
+	}
+
+	// kisbolygóöv: a léptetés és a vágás most fut, a rajzolás a listával együtt
+	DispatchAsteroidBelt();
+	QueueAsteroidBelt();
+
+	// skybox
+	QueueSkybox();
+
+	//
+	// rendezés és kirajzolás
+	//
+
+	m_renderQueue.Sort();
+	m_renderStats = m_renderQueue.Submit( m_stateCache );
+
+	// csak ez a két út mintavételez virtuális textúrát
+	if ( m_virtualTexturing && ( m_renderPath == RenderPath::PerDraw || m_renderPath == RenderPath::Tessellated ) )
+		RenderVirtualTextureFeedback();
+}
+
+void CMyApp::RenderGUI()
+{
+	// ImGui::ShowDemoWindow();
+
+	if ( ImGui::Begin( "Render" ) )
+	{
+		int renderPath = static_cast<int>( m_renderPath );
+		ImGui::RadioButton( "Per draw", &renderPath, static_cast<int>( RenderPath::PerDraw ) );
+		ImGui::SameLine();
+		ImGui::RadioButton( "Instanced", &renderPath, static_cast<int>( RenderPath::Instanced ) );
+		ImGui::SameLine();
+		ImGui::RadioButton( "Multi-draw indirect", &renderPath, static_cast<int>( RenderPath::MultiDrawIndirect ) );
+		ImGui::SameLine();
+		ImGui::RadioButton( "Tessellated", &renderPath, static_cast<int>( RenderPath::Tessellated ) );
+		m_renderPath = static_cast<RenderPath>( renderPath );
+
+		ImGui::Text( "Bodies: %d, texture arrays: %d", static_cast<int>( m_bodies.size() ), static_cast<int>( m_materialTextures.GetArrayCount() ) );
+		ImGui::Checkbox( "Frustum culling", &m_frustumCulling );
+		ImGui::Text( "Visible bodies and rings: %d / %d", static_cast<int>( m_visibleCount ), static_cast<int>( m_cullSpheres.GetSize() ) );
+		ImGui::Checkbox( "Sphere LOD", &m_sphereLod );
+		ImGui::SliderFloat( "LOD max error (px)", &m_sphereLodMaxError, 0.1f, 4.0f );
+		if ( m_renderPath == RenderPath::Tessellated )
+			ImGui::SliderFloat( "Tess edge length (px)", &m_tessEdgeLength, 2.0f, 32.0f );
+		else
+			ImGui::Text( "Sphere triangles: %d", static_cast<int>( m_sphereTriangleCount ) );
+		ImGui::SliderInt( "Asteroids", &m_asteroidCount, MIN_ASTEROID_COUNT, MAX_ASTEROID_COUNT );
+		ImGui::Text( "Draw calls: %u", m_renderStats.drawCalls );
+		ImGui::Text( "State changes: %u issued, %u skipped", m_renderStats.state.issued, m_renderStats.state.skipped );
+		const TextureStreamer::Stats& streamStats = m_textureStreamer.GetStats();
+		ImGui::SliderFloat( "Texture stream budget (ms)", &m_textureStreamBudgetMs, 0.25f, 16.0f );
+		ImGui::Text( "Texture streaming: %.1f MB pending, %.2f ms (max %.2f)", streamStats.pendingBytes / ( 1024.0 * 1024.0 ), streamStats.updateMs, streamStats.maxUpdateMs );
+		const TextureResidency::Stats& residencyStats = m_textureResidency.GetStats();
+		ImGui::SliderInt( "Texture budget (MB)", &m_textureBudgetMB, 16, 2048 );
+		ImGui::Text( "Texture memory: %.1f MB arrays + %.1f MB skybox and atlas / %.0f MB", residencyStats.residentBytes / ( 1024.0 * 1024.0 ),
+					 residencyStats.externalBytes / ( 1024.0 * 1024.0 ), residencyStats.budgetBytes / ( 1024.0 * 1024.0 ) );
+		ImGui::Text( "Texture layers: %d loaded, %d loading, levels %u added, %u dropped", static_cast<int>( residencyStats.loadedImages ),
+					 static_cast<int>( residencyStats.loadingImages ), residencyStats.levelsAdded, residencyStats.levelsDropped );
+		ImGui::Checkbox( "Virtual texturing (per draw, tessellated)", &m_virtualTexturing );
+		if ( m_virtualTexturing )
+		{
+			const VirtualTextureSet::Stats& vtStats = m_virtualTextures.GetStats();
+			ImGui::SliderInt( "VT tile uploads / frame", &m_vtUploadBudget, 1, 64 );
+			ImGui::Text( "VT tiles: %d / %d resident, %d requested, %d pending", static_cast<int>( vtStats.residentTiles ), static_cast<int>( vtStats.slotCount ),
+						 static_cast<int>( vtStats.requestedTiles ), static_cast<int>( vtStats.pendingTiles ) );
+			ImGui::Text( "VT uploads: %u, evictions: %u", vtStats.uploads, vtStats.evictions );
+		}
+		if ( m_imageOpsBenchmark.valid() && m_imageOpsBenchmark.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+			ImGui::Text( "Benchmarking image ops..." );
+		else if ( ImGui::Button( "Benchmark image ops" ) )
+		{
+			// a saját textúráink méretein mérünk, mindegyiken egyszer
+			std::vector<glm::ivec2> sizes{ m_skyboxSize };
+			for ( std::size_t i = 0; i < m_materialTextures.GetArrayCount(); ++i )
+			{
+				const glm::ivec3 arraySize = m_materialTextures.GetArraySize( i );
+				sizes.push_back( glm::ivec2( arraySize.x, arraySize.y ) );
+			}
+			std::sort( sizes.begin(), sizes.end(), []( const glm::ivec2& a, const glm::ivec2& b ) { return a.x != b.x ? a.x < b.x : a.y < b.y; } );
+			sizes.erase( std::unique( sizes.begin(), sizes.end() ), sizes.end() );
+
+			m_imageOpsBenchmark = m_workerPool.Submit( [ sizes ]() { RunImageOpsBenchmark( sizes ); } );
+		}
+		if ( m_objParserBenchmark.valid() && m_objParserBenchmark.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+			ImGui::Text( "Benchmarking OBJ parsing..." );
+		else if ( ImGui::Button( "Benchmark OBJ parsing" ) )
+			m_objParserBenchmark = m_workerPool.Submit( []() { RunObjParserBenchmark( ASTEROID_MESH_FILE ); } );
+	}
+	ImGui::End();
 }
 
 // https://wiki.libsdl.org/SDL2/SDL_KeyboardEvent
@@ -769,8 +1815,8 @@ void CMyApp::KeyboardDown(const SDL_KeyboardEvent& key)
 	{
 		if ( key.keysym.sym == SDLK_F5 && key.keysym.mod & KMOD_CTRL )
 		{
-			CleanShaders();
-			InitShaders();
+			// a fordítás közben a régi programokkal rajzolunk tovább, a csere a PollShaders-ben
+			MarkShadersDirty( {} );
 		}
 		if ( key.keysym.sym == SDLK_F1 )
 		{
@@ -820,5 +1866,7 @@ void CMyApp::Resize(int _w, int _h)
 {
 	glViewport(0, 0, _w, _h);
 	m_camera.Resize( _w, _h );
+	m_viewportWidth  = _w;
+	m_viewportHeight = _h;
 }
 
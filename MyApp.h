@@ -16,6 +16,29 @@
 // Utils
 #include "GLUtils.hpp"
 #include "Camera.h"
+#include "UniformTable.h"
+#include "UniformBuffer.h"
+#include "TextureArraySet.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "MeshPool.h"
+#include "FrustumCulling.h"
+#include "ProgramBinaryCache.h"
+#include "ProgramBatch.h"
+#include "FileWatcher.h"
+#include "WorkerPool.h"
+#include "TextureLoadBatch.h"
+#include "CompressedTextureCache.h"
+#include "MeshCache.h"
+#include "TextureStreamer.h"
+#include "AssetPack.h"
+#include "VirtualTextureSet.h"
+#include "TextureResidency.h"
+
+// standard
+#include <future>
+#include <set>
+#include <vector>
 
 struct SUpdateInfo
 {
@@ -44,6 +67,12 @@ public:
 	void MouseWheel(const SDL_MouseWheelEvent&);
 	void Resize(int, int);
 
+	// a shaderek és az Assets/ összes fájlja egyetlen AssetPack-ba; GL context nem kell hozzá
+	static bool BuildAssetPack( const std::filesystem::path& packPath, const bool decodeImages );
+
+	// a textúrák videomemória-kerete, az Init előtt ( --texture-budget )
+	inline void SetTextureBudget( const int megabytes ) { m_textureBudgetMB = megabytes; }
+
 protected:
 	void SetupDebugCallback();
 
@@ -60,13 +89,94 @@ protected:
 	// OpenGL-es dolgok
 	//
 	
-	// uniform location lekérdezése
-	GLint ul( const char* uniformName ) noexcept;
-
 	// shaderekhez szükséges változók
 	GLuint m_programID = 0;		  // shaderek programja
 	GLuint m_programSkyboxID = 0; // skybox programja
 	GLuint m_beltProgramID = 0;	  // övek programja
+	GLuint m_bodyInstancedProgramID = 0; // égitestek példányosított programja
+	GLuint m_multiDrawProgramID = 0;     // égitestek és gyűrűk multi-draw-indirect programja
+	GLuint m_sphereTessProgramID = 0;    // égitestek tessellation shaderes programja
+	GLuint m_asteroidBeltInitProgramID = 0; // kisbolygóöv pályaadatainak sorsolása (compute)
+	GLuint m_asteroidBeltCullProgramID = 0; // kisbolygóöv léptetése és vágása (compute)
+	GLuint m_asteroidBeltProgramID = 0;     // kisbolygóöv rajzolása
+	GLuint m_vtFeedbackProgramID = 0;       // a virtuális textúrák feedback menete
+
+	// linkelt programok binárisai a lemezen, a következő indításhoz és Ctrl+F5-höz
+	ProgramBinaryCache m_programCache{ "ShaderCache" };
+
+	// A programok uniformjai: a link után egyszer felépített tábla és belőle feloldott handle-k
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<glm::mat4> world, worldIT;
+		Uniform<GLint>     texImages, layer, nightLayer, isEarth, isSun;
+		Uniform<GLint>     useVirtualTexture, vtPageTable, vtAtlas, vtLevelCount;
+		Uniform<glm::vec2> vtTileCount;
+	} m_bodyUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLint>     skyboxTexture;
+	} m_skyboxUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<glm::mat4> world, worldIT;
+		Uniform<GLint>     texImages, layer;
+	} m_beltUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLint>     texImages, nightLayer;
+	} m_bodyInstancedUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLint>     nightLayer;
+	} m_multiDrawUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<glm::mat4> world, worldIT;
+		Uniform<GLint>     texImages, layer, nightLayer, isEarth, isSun;
+		Uniform<GLint>     useVirtualTexture, vtPageTable, vtAtlas, vtLevelCount;
+		Uniform<glm::vec2> vtTileCount;
+		Uniform<float>     screenScale, targetEdgeLength, maxTessLevel;
+	} m_sphereTessUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLuint>    asteroidCount, seed;
+	} m_asteroidBeltInitUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLuint>    asteroidCount;
+		Uniform<float>     time, meshRadius;
+	} m_asteroidBeltCullUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<GLint>     texImages, layer;
+	} m_asteroidBeltUniforms;
+
+	struct
+	{
+		UniformTable       table;
+		Uniform<glm::mat4> world, worldIT;
+		Uniform<GLint>     vtIndex, vtLevelCount;
+		Uniform<glm::vec2> vtTileCount;
+		Uniform<float>     lodBias;
+	} m_vtFeedbackUniforms;
 
 
 	// Fényforrás- ...
@@ -87,15 +197,89 @@ protected:
 
 	float m_Shininess = 80.0;
 
+	// Kamera, fény és anyag std140 uniform blokkokban, minden program ugyanazokat a buffereket látja.
+	// A struktúrák bájtra pontosan a shaderekben deklarált blokkokat követik.
+
+	enum UniformBlockBinding : GLuint
+	{
+		CAMERA_BLOCK_BINDING   = 0,
+		LIGHT_BLOCK_BINDING    = 1,
+		MATERIAL_BLOCK_BINDING = 2,
+	};
+
+	struct CameraBlock
+	{
+		glm::mat4 viewProj;
+		glm::vec3 cameraPos;
+		float     _pad0;
+	};
+
+	struct LightBlock
+	{
+		glm::vec4 lightPos;
+		glm::vec3 La;
+		float     lightConstantAttenuation;
+		glm::vec3 Ld;
+		float     lightLinearAttenuation;
+		glm::vec3 Ls;
+		float     lightQuadraticAttenuation;
+	};
+
+	struct MaterialBlock
+	{
+		glm::vec3 Ka;
+		float     Shininess;
+		glm::vec3 Kd;
+		float     _pad0;
+		glm::vec3 Ks;
+		float     _pad1;
+	};
+
+	UniformBuffer<CameraBlock>   m_cameraUBO;
+	UniformBuffer<LightBlock>    m_lightUBO;
+	UniformBuffer<MaterialBlock> m_materialUBO;
+
+	void InitUniformBuffers();
+	void CleanUniformBuffers();
+	void UpdateUniformBuffers();
+
 	// Shaderek inicializálása, és törtlése
 	void InitShaders();
 	void CleanShaders();
-	void InitSkyboxShaders();
+	void ResolveUniforms();
 	void CleanSkyboxShaders();
 
+	// A programok egyszerre, a driver szálain fordulnak (ProgramBatch). Induláskor megvárjuk őket,
+	// Ctrl+F5-nél a régiekkel rajzolunk tovább, amíg mind el nem készül, és csak akkor cseréljük le őket.
+
+	struct ProgramSource
+	{
+		GLuint CMyApp::*             program; // ide kerül a linkelt program
+		std::vector<ShaderStageFile> stages;
+	};
+
+	static const std::vector<ProgramSource>& GetProgramSources();
+
+	struct PendingProgram
+	{
+		std::size_t source;    // GetProgramSources indexe
+		GLuint      programID; // az új program, a csere után a source tagváltozójában
+	};
+
+	ProgramBatch                m_programBatch;
+	std::vector<PendingProgram> m_pendingPrograms;
+	std::set<std::size_t>       m_dirtyPrograms; // újra kell fordítani, amint az előző köteg elkészült
+	Uint64                      m_shaderBuildStart = 0;
+
+	void SubmitShaders( const std::vector<std::size_t>& sources );
+	// üres fájlnév: mindegyik program
+	void MarkShadersDirty( const std::filesystem::path& fileName );
+	void PollShaders();
+	void SwapShaders();
+	void CleanPendingShaders();
+
 	// Geometriával kapcsolatos változók
 
-	OGLObject m_surfaceGPU = {};
 	OGLObject m_asteroidGPU = {};
 	OGLObject m_beltGPU = {};
 	OGLObject m_SkyboxGPU = {};
@@ -106,33 +290,310 @@ protected:
 	void InitSkyboxGeometry();
 	void CleanSkyboxGeometry();
 
-	void RenderPlanet(glm::mat4 matWorld, GLuint TextureID);
+	// Rajzolási lista: a Render a rajzolásokat gyűjti, rendezi, és a state cache-en keresztül adja ki
+
+	RenderQueue  m_renderQueue;
+	GLStateCache m_stateCache;
+	RenderQueue::Stats m_renderStats; // az utolsó frame-é, a GUI-nak
+
+	// a modell origójának kamerától vett távolsága [0, 1]-be normálva, a rendezési kulcshoz
+	float GetSortDepth( const glm::mat4& matWorld ) const;
+
+	// Égitestek
+
+	// anyagjelzők, a shaderben is ugyanezekkel az értékekkel
+	enum BodyFlags : GLint
+	{
+		BODY_FLAG_SUN    = 1,
+		BODY_FLAG_EARTH  = 2,
+		BODY_FLAG_SPHERE = 4, // a síkot a vertex shader gömbbé alakítja (csak a multi-draw programban)
+		BODY_FLAG_UNLIT  = 8, // csak a textúra színe, megvilágítás nélkül (gyűrűk)
+	};
+
+	struct CelestialBody
+	{
+		glm::mat4 world;
+		TextureLayer texture;
+		GLint        flags;          // BodyFlags
+		float        boundingRadius; // a world mátrix eltolása körül
+		int          virtualTexture = -1; // m_virtualTextures handle, -1: csak a tömb rétege
+	};
+
+	// égitestenkénti (példányonkénti) adat a példányosított rajzoláshoz
+	struct BodyInstance
+	{
+		glm::mat4 world;
+		glm::mat4 worldIT;
+		GLint     layer;
+		GLint     flags;
+	};
+
+	std::vector<CelestialBody> m_bodies;
+	std::vector<BodyInstance>  m_bodyInstances;
+
+	// Hogyan rajzoljuk az égitesteket (és a multi-draw esetén a gyűrűket is)
+	enum class RenderPath : int
+	{
+		PerDraw,           // égitestenként egy rajzolás
+		Instanced,         // textúratömbönként egy példányosított rajzolás
+		MultiDrawIndirect, // az átlátszatlan és az átlátszó menet is egy-egy glMultiDrawElementsIndirect
+		Tessellated,       // égitestenként egy rajzolás, a durva patch rácsot a tessellation shader bontja fel
+	};
+
+	RenderPath m_renderPath = RenderPath::MultiDrawIndirect;
+
+	GLuint m_bodyInstancedVaoID = 0;   // a m_meshPool geometriája + a példányonkénti attribútumok
+	GLuint m_bodyInstanceBufferID = 0; // BodyInstance tömb
+
+	void InitBodyInstancing();
+	void CleanBodyInstancing();
+
+	void UpdateBodies();
+	void QueueBodiesPerDraw();
+	void QueueBodyPerDraw( const std::size_t i );
+	void QueueBodiesInstanced();
+	void QueueBodiesTessellated();
+
+	void QueueSkybox();
+
+	// Gyűrűk és övek
+
+	struct BeltObject
+	{
+		glm::mat4        world;
+		TextureLayer     texture;
+		const OGLObject* mesh;
+		MeshPool::Handle pooledMesh; // ugyanez a m_meshPool-ban
+		bool             blended; // átlátszó, mindkét oldala látszik
+		float            boundingRadius; // a world mátrix eltolása körül
+	};
+
+	std::vector<BeltObject> m_beltObjects;
+
+	void UpdateBelts();
+	void QueueBelts();
+	void QueueBelt( const std::size_t i );
+
+	// Nézetgúla vágás a CPU-n: az égitestek és gyűrűk befoglaló gömbjei egy kötegben (SIMD),
+	// a Queue* függvények csak a láthatókat rajzolják
+
+	bool m_frustumCulling = true;
+
+	SphereBatch               m_cullSpheres;
+	std::vector<std::uint8_t> m_cullVisible;  // m_cullSpheres sorrendjében: előbb az égitestek, utána a gyűrűk
+	std::size_t               m_visibleCount = 0;
+
+	void CullBodiesAndBelts();
+	inline bool IsBodyVisible( std::size_t i ) const { return m_cullVisible[ i ] != 0; }
+	inline bool IsBeltVisible( std::size_t i ) const { return m_cullVisible[ m_bodies.size() + i ] != 0; }
+
+	// Gömb részletességi szintek (LOD): a paraméteres sík több felbontásban a m_meshPool-ban.
+	// Égitestenként azt a legdurvább szintet választjuk, aminek a sziluett hibája a képernyőn
+	// (pixelben) a küszöb alatt marad, a váltás hiszterézissel történik, hogy ne villogjon.
+
+	struct SphereLod
+	{
+		std::size_t N, M; // a GetParamSurfMesh felbontása
+	};
+
+	static constexpr std::size_t SPHERE_LOD_COUNT = 4;
+	static constexpr SphereLod SPHERE_LODS[ SPHERE_LOD_COUNT ] = { { 80, 40 }, { 48, 24 }, { 24, 12 }, { 12, 6 } };
+	// a küszöb ennyiszeresével tér el a váltási pont a finomítás és a durvítás irányába
+	static constexpr float SPHERE_LOD_HYSTERESIS = 0.2f;
+
+	bool  m_sphereLod = true;
+	float m_sphereLodMaxError = 0.5f; // pixel
+
+	MeshPool::Handle m_sphereLodMeshes[ SPHERE_LOD_COUNT ] = {};
+	std::vector<std::uint8_t> m_bodyLods;  // m_bodies sorrendjében, frame-ek között megmarad a hiszterézishez
+	std::size_t m_sphereTriangleCount = 0; // a látható égitestekéi, a GUI-nak
+
+	int m_viewportWidth  = 800;
+	int m_viewportHeight = 600;
+
+	// a befoglaló gömb sugara pixelben
+	float GetScreenRadius( const glm::vec3& center, const float radius ) const;
+	void SelectBodyLods();
+	inline const MeshRange& GetBodyMesh( std::size_t i ) const { return m_meshPool.Get( m_sphereLodMeshes[ m_bodyLods[ i ] ] ); }
+
+	// Tessellation shaderes gömb: a durva patch rács éleit a képernyőn mért hosszuk szerint bontjuk fel
+
+	static constexpr std::size_t SPHERE_PATCHES_N = 4, SPHERE_PATCHES_M = 2;
+	static constexpr float SPHERE_MAX_TESS_LEVEL = 64.0f; // a GL_MAX_TESS_GEN_LEVEL legkisebb megengedett értéke
+
+	float m_tessEdgeLength = 8.0f; // pixel
+
+	MeshPool::Handle m_spherePatchMesh = 0;
+
+	// Multi-draw-indirect: a gömb és a gyűrű síkja egy közös pufferben,
+	// a rajzolásonkénti adatok egy SSBO-ban, amit a vertex shader a rajzolás sorszámával indexel
+
+	enum ShaderStorageBinding : GLuint
+	{
+		DRAW_DATA_BINDING        = 0,
+		ASTEROID_PARAMS_BINDING  = 1,
+		VISIBLE_ASTEROID_BINDING = 2,
+		ASTEROID_COMMAND_BINDING = 3,
+	};
+
+	// a textúratömbök egységei a Frag_MultiDraw texArrays tömbjében
+	static constexpr std::size_t MULTI_DRAW_MAX_ARRAYS = 4;
+	// ennyi rajzolásnak van kezdetben hely (a rajzolás sorszám attribútum és a DrawData puffer mérete),
+	// ha egy frame-be több kell, a QueueMultiDraw kétszerezi
+	static constexpr GLuint MULTI_DRAW_CAPACITY = 1024;
+
+	// std430, a Vert_MultiDraw DrawData struktúrája
+	struct DrawData
+	{
+		glm::mat4 world;
+		glm::mat4 worldIT;
+		GLint     layer;
+		GLint     array;
+		GLint     flags;
+		GLint     _pad0;
+	};
+
+	MeshPool         m_meshPool;
+	MeshPool::Handle m_ringMesh     = 0;
+
+	GLuint m_drawDataBufferID = 0; // SSBO, DrawData tömb
+	GLuint m_indirectBufferID = 0; // DrawElementsIndirectCommand tömb
+
+	// egy frame rajzolásai a rendezéshez és a feltöltéshez
+	struct MultiDrawEntry
+	{
+		MeshPool::Handle mesh;
+		DrawData         data;
+		float            depth;
+	};
+
+	std::vector<MultiDrawEntry>              m_multiDrawOpaque;
+	std::vector<MultiDrawEntry>              m_multiDrawBlended;
+	std::vector<DrawElementsIndirectCommand> m_multiDrawCommands;
+	std::vector<DrawData>                    m_multiDrawData;
+
+	void InitMultiDraw();
+	void CleanMultiDraw();
+	void QueueMultiDraw();
+
+	// Kisbolygóöv: a pályaadatok SSBO-ban, a léptetést, a vágást és a rajzolási parancs kitöltését
+	// compute shader végzi, a CPU költsége független a darabszámtól
+
+	// std430, a Comp_AsteroidBelt AsteroidParams struktúrája
+	struct AsteroidParams
+	{
+		glm::vec4 orbit;  // sugár, kezdőszög, szögsebesség (rad/s), magasság
+		glm::vec4 tumble; // forgástengely, forgási szögsebesség (rad/s)
+		glm::vec4 shape;  // méret, kezdő elfordulás
+	};
+
+	// std430, a Vert_AsteroidBelt VisibleAsteroid struktúrája
+	struct VisibleAsteroid
+	{
+		glm::vec4 posScale;
+		glm::vec4 rotation;
+	};
+
+	static constexpr int MIN_ASTEROID_COUNT = 100000;
+	static constexpr int MAX_ASTEROID_COUNT = 1000000;
+	static constexpr GLuint ASTEROID_GROUP_SIZE = 256; // a compute shaderek local_size_x-e
+
+	int    m_asteroidCount = 200000;
+	GLuint m_allocatedAsteroidCount = 0;  // a pufferek ennyi példányra készültek
+	float  m_asteroidMeshRadius = 1.0f;   // az aszteroida modell befoglaló gömbje
+
+	GLuint m_asteroidParamsBufferID  = 0; // AsteroidParams tömb
+	GLuint m_visibleAsteroidBufferID = 0; // VisibleAsteroid tömb
+	GLuint m_asteroidCommandBufferID = 0; // egyetlen DrawElementsIndirectCommand
+
+	void InitAsteroidBelt();
+	void CleanAsteroidBelt();
+	void ResizeAsteroidBelt();
+	void DispatchAsteroidBelt();
+	void QueueAsteroidBelt();
 
 	// Textúrázás, és változói
 
 	GLuint m_SuzanneTextureID = 0;
 	GLuint m_surfaceTextureID = 0;
 	GLuint m_skyboxTextureID = 0;
-
-	GLuint m_sunTextureID = 0;
-	GLuint m_mercuryTextureID = 0;
-	GLuint m_venusTextureID = 0;
-	GLuint m_earthTextureID = 0;
-	GLuint m_earthNightTextureID = 0;
-	GLuint m_moonTextureID = 0;
-	GLuint m_marsTextureID = 0;
-	GLuint m_jupiterTextureID = 0;
-	GLuint m_saturnTextureID = 0;
-	GLuint m_uranusTextureID = 0;
-	GLuint m_neptuneTextureID = 0;
-	GLuint m_plutoTextureID = 0;
-
-	GLuint m_kuiperTextureID = 0;
-	GLuint m_saturn_ringTextureID = 0;
-	GLuint m_uranus_ringTextureID = 0;
-	GLuint m_neptune_ringTextureID = 0;
-
-	GLuint m_asteroidTextureID = 0;
+	GLenum m_skyboxFormat = 0; // minden lapé ugyanez
+	glm::ivec2 m_skyboxSize = glm::ivec2( 1 );
+
+	// A bolygók, gyűrűk és az aszteroida textúrái méretosztályonként egy-egy GL_TEXTURE_2D_ARRAY-ben.
+	// A sorrend egyben a m_materialTextures-beli handle is (lásd InitTextures).
+	enum MaterialTexture : TextureArraySet::Handle
+	{
+		SUN_TEXTURE = 0,
+		MERCURY_TEXTURE,
+		VENUS_TEXTURE,
+		EARTH_TEXTURE,
+		EARTH_NIGHT_TEXTURE,
+		MOON_TEXTURE,
+		MARS_TEXTURE,
+		JUPITER_TEXTURE,
+		SATURN_TEXTURE,
+		URANUS_TEXTURE,
+		NEPTUNE_TEXTURE,
+		PLUTO_TEXTURE,
+
+		KUIPER_TEXTURE,
+		SATURN_RING_TEXTURE,
+		URANUS_RING_TEXTURE,
+		NEPTUNE_RING_TEXTURE,
+
+		ASTEROID_TEXTURE,
+
+		MATERIAL_TEXTURE_COUNT
+	};
+
+	// képek dekódolása és a hot reload háttérmunkái; a feltöltés mindig a GL szálon marad
+	WorkerPool m_workerPool;
+
+	// a textúrák előre sütve: BC1/BC3 tömörítés és mipmap-ek, KTX2 fájlokban a lemezen
+	CompressedTextureCache m_textureCache{ "TextureCache" };
+
+	// a feltöltés PBO gyűrűn át, több frame alatt: előbb a kis mipmap szintek, így a textúra azonnal látszik, majd élesedik
+	TextureStreamer m_textureStreamer;
+	float m_textureStreamBudgetMs = 2.0f;
+
+	// az ImageOps mérése a m_workerPool egyik szálán, az eredmény a logba kerül
+	std::future<void> m_imageOpsBenchmark;
+	// az OBJ tokenizer és a számok beolvasásának mérése az aszteroida modelljén és egy generált modellen, szintén a logba
+	std::future<void> m_objParserBenchmark;
+
+	TextureArraySet m_materialTextures;
+
+	inline const TextureLayer& GetMaterialTexture( MaterialTexture texture ) const { return m_materialTextures.Get( texture ); }
+
+	// A rétegek csak akkor töltődnek be, amikor először látszanak, és csak a képernyőn mért méretükhöz kellő
+	// mipmap szintekkel. A keretbe a skybox és a virtuális textúrák atlasza is beleszámít.
+	TextureResidency m_textureResidency;
+	int m_textureBudgetMB = 256;
+
+	// a látható égitestek és gyűrűk textúrái, frame-enként a kivágás után
+	void RequestTextureResidency();
+
+	// Virtuális textúrák: a nagy felbontású felszínek csempékre bontva, a videomemóriában csak a látszó
+	// csempék vannak, egy közös atlaszban. Hogy mi látszik, azt egy kis felbontású feedback menet dönti el.
+	// Amíg egy virtuális textúra nincs kész, a tömbbeli rétege látszik. Csak a PerDraw és a Tessellated út használja.
+
+	// a virtuális textúrák forrásai, a sorrend egyben a m_virtualTextures-beli handle
+	static constexpr MaterialTexture VIRTUAL_TEXTURE_MATERIALS[] = { EARTH_TEXTURE, MOON_TEXTURE, MARS_TEXTURE };
+	// az atlasz egysége, a laptábláké utána: 5, 6, 7
+	static constexpr GLuint VT_ATLAS_UNIT = 4;
+
+	VirtualTextureSet m_virtualTextures{ "TextureCache", VT_ATLAS_UNIT };
+	bool m_virtualTexturing = true;
+	int  m_vtUploadBudget = 16; // csempe / frame
+
+	// -1, ha nem virtuális textúra
+	int GetVirtualTexture( MaterialTexture texture ) const;
+	bool UsesVirtualTexture( const CelestialBody& body ) const;
+	void RenderVirtualTextureFeedback();
+
+	// a kisbolygók legfeljebb ekkorák a képernyőn (pixel), a textúrájuk ehhez kell
+	static constexpr float ASTEROID_SCREEN_SIZE = 128.0f;
 
 	// éjszakai Földhöz
 	int m_isEarth = 0;
@@ -144,5 +605,54 @@ protected:
 	void CleanTextures();
 	void InitSkyboxTextures();
 	void CleanSkyboxTextures();
+	void UploadSkyboxFace( GLenum target, BakedTexture& image );
+
+	// skybox lapjai: fájl és a kocka melyik oldala
+	struct SkyboxFace
+	{
+		const char* fileName;
+		GLenum      target;
+	};
+
+	static constexpr SkyboxFace SKYBOX_FACES[ 6 ] =
+	{
+		{ "Assets/space_xpos.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X },
+		{ "Assets/space_xneg.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X },
+		{ "Assets/space_ypos.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y },
+		{ "Assets/space_yneg.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y },
+		{ "Assets/space_zpos.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z },
+		{ "Assets/space_zneg.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z },
+	};
+
+	static constexpr const char* ASTEROID_MESH_FILE = "Assets/asteroid.obj";
+
+	// a beolvasott modellek végső vertex- és indextömbjei binárisan a lemezen, a következő indításkor csak map-eljük és feltöltjük
+	MeshCache m_meshCache{ "MeshCache" };
+
+	// Hot reload: a shaderek könyvtárában és az Assets-ben megváltozott fájlok újratöltése újraindítás nélkül.
+	// A shaderek a ProgramBatch-csel fordulnak, a képek és a modell a m_workerPool szálain töltődnek be;
+	// a feltöltés és a csere mindig az Update-ben, két frame között történik.
+
+	FileWatcher m_fileWatcher;
+
+	struct TextureReload
+	{
+		std::filesystem::path     fileName;
+		std::future<BakedTexture> image;
+		GLenum                    cubeFace;
+		bool                      stale = false; // a töltés közben újra mentették, újra kell tölteni
+	};
+
+	std::vector<TextureReload> m_textureReloads;
+	std::future<CachedMesh>    m_asteroidMeshReload;
+	bool                       m_asteroidMeshStale = false; // a töltés közben újra mentették, újra kell tölteni
+
+	void InitHotReload();
+	void PollHotReload();
+	void ApplyHotReloads();
+	void CleanHotReload();
+	void StartSkyboxFaceReload( TextureReload& reload );
+	void StartAsteroidMeshReload();
+	void UploadAsteroidMesh( const CachedMesh& mesh );
 };
 
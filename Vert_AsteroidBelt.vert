@@ -0,0 +1,48 @@
+#version 430
+
+// VBO-ból érkező változók (az aszteroida modell)
+layout( location = 0 ) in vec3 vs_in_pos;
+layout( location = 1 ) in vec3 vs_in_norm;
+layout( location = 2 ) in vec2 vs_in_tex;
+
+// a pipeline-ban tovább adandó értékek
+out vec3 vs_out_pos;
+out vec3 vs_out_norm;
+out vec2 vs_out_tex;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
+
+// a Comp_AsteroidBelt által kiírt látható példányok, gl_InstanceID-vel indexelve
+struct VisibleAsteroid
+{
+	vec4 posScale; // világbeli pozíció, méret
+	vec4 rotation; // kvaternió
+};
+
+layout( std430, binding = 2 ) readonly buffer VisibleAsteroidBuffer
+{
+	VisibleAsteroid visible[];
+};
+
+vec3 Rotate( vec4 q, vec3 v )
+{
+	return v + 2.0 * cross( q.xyz, cross( q.xyz, v ) + q.w * v );
+}
+
+void main()
+{
+	VisibleAsteroid asteroid = visible[ gl_InstanceID ];
+
+	vec3 pos = Rotate( asteroid.rotation, vs_in_pos ) * asteroid.posScale.w + asteroid.posScale.xyz;
+
+	gl_Position = viewProj * vec4( pos, 1 );
+	vs_out_pos  = pos;
+	// egyenletes skálázás: a normálist elég elforgatni
+	vs_out_norm = Rotate( asteroid.rotation, vs_in_norm );
+	vs_out_tex  = vs_in_tex;
+}
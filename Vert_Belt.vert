@@ -13,7 +13,13 @@ out vec2 vs_out_tex;
 // shader kls paramterei - most a hrom transzformcis mtrixot kln-kln vesszk t
 uniform mat4 world;
 uniform mat4 worldIT;
-uniform mat4 viewProj;
+
+// kamera - CMyApp::CameraBlock
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
 
 void main()
 {
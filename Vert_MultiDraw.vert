@@ -0,0 +1,85 @@
+#version 430
+
+float M_PI = 3.14;
+
+// VBO-ból érkező változók (a CMyApp::m_meshPool közös pufferéből)
+layout( location = 0 ) in vec3 vs_in_pos;
+layout( location = 1 ) in vec3 vs_in_norm;
+layout( location = 2 ) in vec2 vs_in_tex;
+
+// a rajzolás sorszáma: a parancs baseInstance-e (lásd MeshPool), ezzel indexeljük a DrawData tömböt
+layout( location = 3 ) in uint vs_in_drawIndex;
+
+// a pipeline-ban tovább adandó értékek
+out vec3 vs_out_pos;
+out vec3 vs_out_norm;
+out vec2 vs_out_tex;
+flat out int vs_out_layer;
+flat out int vs_out_array;
+flat out int vs_out_flags;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
+
+// rajzolásonkénti adatok - CMyApp::DrawData
+struct DrawData
+{
+	mat4 world;
+	mat4 worldIT;
+	int  layer;
+	int  array;
+	int  flags;
+};
+
+layout( std430, binding = 0 ) readonly buffer DrawDataBuffer
+{
+	DrawData draws[];
+};
+
+// anyagjelzők (lásd CMyApp::BODY_FLAG_*)
+const int FLAG_SPHERE = 4;
+
+vec3 GetPos(float u, float v){
+		float a = u * 2 * (M_PI + 0.005);
+		float b = v * M_PI;
+
+		float r = 1;
+
+		float x = r * cos(a) * sin(b);
+		float y = r * sin(a) * sin(b);
+		float z = r * cos(b);
+
+		return vec3(x, z, y);
+	}
+
+vec3 GetNorm(float u, float v){
+		vec3 p = GetPos(u, v);
+		return normalize(p);
+	}
+
+void main()
+{
+	DrawData draw = draws[ vs_in_drawIndex ];
+
+	// a gömbök síkként érkeznek, a felületet itt számoljuk (mint a Vert_PosNormTex-ben)
+	vec3 pos  = vs_in_pos;
+	vec3 norm = vs_in_norm;
+	if ( ( draw.flags & FLAG_SPHERE ) != 0 )
+	{
+		pos  = GetPos( vs_in_pos.x, vs_in_pos.y );
+		norm = GetNorm( vs_in_pos.x, vs_in_pos.y );
+	}
+
+	gl_Position = viewProj * draw.world * vec4( pos, 1 );
+	vs_out_pos  = (draw.world   * vec4(pos,  1)).xyz;
+	vs_out_norm = (draw.worldIT * vec4(norm, 0)).xyz;
+	vs_out_tex  = vs_in_tex;
+
+	vs_out_layer = draw.layer;
+	vs_out_array = draw.array;
+	vs_out_flags = draw.flags;
+}
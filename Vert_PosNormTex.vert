@@ -15,7 +15,13 @@ out vec2 vs_out_tex;
 // shader külső paraméterei - most a három transzformációs mátrixot külön-külön vesszük át
 uniform mat4 world;
 uniform mat4 worldIT;
-uniform mat4 viewProj;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
 
 vec3 GetPos(float u, float v){
 		float a = u * 2 * (M_PI + 0.005);
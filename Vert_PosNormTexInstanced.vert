@@ -0,0 +1,60 @@
+#version 430
+
+float M_PI = 3.14;
+
+// VBO-ból érkező változók
+layout( location = 0 ) in vec3 vs_in_pos;
+layout( location = 1 ) in vec3 vs_in_norm;
+layout( location = 2 ) in vec2 vs_in_tex;
+
+// példányonként (égitestenként) érkező változók
+layout( location = 3 ) in mat4 vs_in_world;		// 3, 4, 5, 6
+layout( location = 7 ) in mat4 vs_in_worldIT;	// 7, 8, 9, 10
+layout( location = 11 ) in ivec2 vs_in_layerFlags; // textúraréteg, anyagjelzők
+
+// a pipeline-ban tovább adandó értékek
+out vec3 vs_out_pos;
+out vec3 vs_out_norm;
+out vec2 vs_out_tex;
+flat out int vs_out_layer;
+flat out int vs_out_flags;
+
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
+
+vec3 GetPos(float u, float v){
+		float a = u * 2 * (M_PI + 0.005);
+		float b = v * M_PI;
+
+		float r = 1;
+
+		float x = r * cos(a) * sin(b);
+		float y = r * sin(a) * sin(b);
+		float z = r * cos(b);
+
+		return vec3(x, z, y);
+	}
+
+vec3 GetNorm(float u, float v){
+		vec3 p = GetPos(u, v);
+		return normalize(p);
+	}
+
+vec2 GetTex(float u, float v){
+		return vec2(u, v);
+	}
+
+void main()
+{
+	gl_Position = viewProj * vs_in_world * vec4( GetNorm(vs_in_pos.x, vs_in_pos.y), 1 );
+	vs_out_pos  = (vs_in_world   * vec4(GetPos(vs_in_pos.x, vs_in_pos.y),  1)).xyz;
+	vs_out_norm = (vs_in_worldIT * vec4(GetNorm(vs_in_pos.x, vs_in_pos.y), 0)).xyz;
+	vs_out_tex = GetTex(vs_in_tex.x, vs_in_tex.y);
+
+	vs_out_layer = vs_in_layerFlags.x;
+	vs_out_flags = vs_in_layerFlags.y;
+}
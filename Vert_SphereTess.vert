@@ -0,0 +1,13 @@
+#version 430
+
+// VBO-ból érkező változók: a durva patch rács pontjainak (u,v) paraméterei
+layout( location = 0 ) in vec3 vs_in_pos;
+
+// a tessellation control shadernek
+out vec2 vs_out_uv;
+
+void main()
+{
+	// a felületet csak a tessellation evaluation shader értékeli ki
+	vs_out_uv = vs_in_pos.xy;
+}
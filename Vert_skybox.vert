@@ -6,13 +6,17 @@ layout (location = 0 ) in vec3 vs_in_pos;
 // a pipeline-ban tovább adandó értékek
 out vec3 vs_out_pos;
 
-// shader külső paraméterei - most a három transzformációs mátrixot külön-külön vesszük át
-uniform mat4 world;
-uniform mat4 viewProj;
+// kamera - CMyApp::CameraBlock, minden programnak közös
+layout( std140, binding = 0 ) uniform Camera
+{
+	mat4 viewProj;
+	vec3 cameraPos;
+};
 
 void main()
 {
-	gl_Position = (viewProj * world * vec4( vs_in_pos, 1 )).xyww;	// [x,y,w,w] => homogén osztás után [x/w, y/w, 1]
+	// a skybox a kamerával együtt mozog: a world transzformáció a kamera pozíciójába tolás
+	gl_Position = (viewProj * vec4( vs_in_pos + cameraPos, 1 )).xyww;	// [x,y,w,w] => homogén osztás után [x/w, y/w, 1]
 
 	vs_out_pos = vs_in_pos;
 }
\ No newline at end of file
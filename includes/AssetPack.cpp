@@ -0,0 +1,328 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <system_error>
+
+#include <SDL2/SDL.h>
+
+#include "GLUtils.hpp"
+
+// Bump when the layout changes, older packs are then refused and the plain files are used.
+static constexpr std::uint32_t PACK_FORMAT_VERSION = 1;
+static constexpr char PACK_MAGIC[ 8 ] = { 'Z', 'H', 'P', 'A', 'C', 'K', '\r', '\n' };
+
+struct PackHeader
+{
+	char          magic[ 8 ];
+	std::uint32_t version;
+	std::uint32_t entryCount;
+	std::uint64_t fileSize;
+};
+
+struct AssetPack::Entry
+{
+	std::uint64_t offset; // from the start of the file
+	std::uint64_t size;
+	std::uint32_t nameOffset;
+	std::uint32_t nameLength;
+	std::uint32_t encoding;
+	std::int32_t  width, height; // ImageRGBA only
+	std::uint32_t reserved;
+};
+
+static_assert( sizeof( PackHeader ) == 24, "the pack header is written as is" );
+
+AssetData::AssetData( std::vector<std::uint8_t> bytes ) : m_owned( std::move( bytes ) )
+{
+	m_size = m_owned.size();
+	m_owned.push_back( 0 );
+	m_data = m_owned.data();
+}
+
+std::string AssetPack::GetName( const std::filesystem::path& fileName )
+{
+	return fileName.lexically_normal().generic_string();
+}
+
+bool AssetPack::Open( const std::filesystem::path& path )
+{
+	static_assert( sizeof( Entry ) == 40, "pack entries are written as is" );
+
+	Close();
+
+	if ( !m_file.Open( path ) ) return false;
+	m_data = m_file.GetData();
+	m_size = m_file.GetSize();
+
+	// start reading the whole pack ahead in the background, one long read instead of many page faults
+	m_file.Prefetch( 0, m_size );
+
+	// everything the lookups rely on is checked once here
+	PackHeader header{};
+	bool valid = m_size >= sizeof( header );
+	if ( valid )
+	{
+		std::memcpy( &header, m_data, sizeof( header ) );
+		valid = std::memcmp( header.magic, PACK_MAGIC, sizeof( PACK_MAGIC ) ) == 0 && header.version == PACK_FORMAT_VERSION && header.fileSize == m_size
+			 && header.entryCount <= ( m_size - sizeof( header ) ) / sizeof( Entry );
+	}
+
+	if ( valid )
+	{
+		m_entries = reinterpret_cast<const Entry*>( m_data + sizeof( header ) );
+		m_entryCount = header.entryCount;
+
+		for ( std::size_t i = 0; valid && i < m_entryCount; ++i )
+		{
+			const Entry& entry = m_entries[ i ];
+			valid = entry.nameOffset <= m_size && entry.nameLength <= m_size - entry.nameOffset
+				 && entry.offset % BLOB_ALIGNMENT == 0 && entry.offset < m_size && entry.size < m_size - entry.offset // room for the zero after it
+				 && ( entry.encoding == static_cast<std::uint32_t>( AssetEncoding::Raw )
+					  || ( entry.encoding == static_cast<std::uint32_t>( AssetEncoding::ImageRGBA ) && entry.width > 0 && entry.height > 0
+						   && entry.size == static_cast<std::uint64_t>( entry.width ) * entry.height * 4 ) );
+
+			// sorted, for the binary search in Find
+			if ( valid && i > 0 )
+			{
+				const Entry& previous = m_entries[ i - 1 ];
+				valid = std::string_view( reinterpret_cast<const char*>( m_data + previous.nameOffset ), previous.nameLength )
+					  < std::string_view( reinterpret_cast<const char*>( m_data + entry.nameOffset ), entry.nameLength );
+			}
+		}
+	}
+
+	if ( !valid )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[AssetPack] %s is not a valid version %u asset pack, ignoring it", path.string().c_str(), PACK_FORMAT_VERSION );
+		Close();
+	}
+
+	return valid;
+}
+
+void AssetPack::Close() noexcept
+{
+	m_file.Close();
+	m_data = nullptr;
+	m_size = 0;
+	m_entries = nullptr;
+	m_entryCount = 0;
+}
+
+AssetData AssetPack::Find( const std::filesystem::path& fileName ) const
+{
+	const std::string name = GetName( fileName );
+	auto getName = [ this ]( const Entry& entry ) { return std::string_view( reinterpret_cast<const char*>( m_data + entry.nameOffset ), entry.nameLength ); };
+
+	const Entry* end = m_entries + m_entryCount;
+	const Entry* entry = std::lower_bound( m_entries, end, name, [ &getName ]( const Entry& e, const std::string& value ) { return getName( e ) < value; } );
+	if ( entry == end || getName( *entry ) != name ) return {};
+
+	return AssetData( m_data + entry->offset, static_cast<std::size_t>( entry->size ), static_cast<AssetEncoding>( entry->encoding ), glm::ivec2( entry->width, entry->height ) );
+}
+
+static bool IsImageFile( const std::filesystem::path& fileName )
+{
+	std::string extension = fileName.extension().string();
+	std::transform( extension.begin(), extension.end(), extension.begin(), []( unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga";
+}
+
+bool AssetPack::Build( const std::filesystem::path& path, const std::vector<std::filesystem::path>& files, const bool decodeImages )
+{
+	struct Blob
+	{
+		std::string               name;
+		std::vector<std::uint8_t> bytes;
+		AssetEncoding             encoding = AssetEncoding::Raw;
+		glm::ivec2                imageSize = glm::ivec2( 0 );
+	};
+
+	std::vector<Blob> blobs;
+	for ( const std::filesystem::path& fileName : files )
+	{
+		Blob blob;
+		blob.name = GetName( fileName );
+		if ( std::any_of( blobs.begin(), blobs.end(), [ &blob ]( const Blob& other ) { return other.name == blob.name; } ) ) continue;
+
+		if ( decodeImages && IsImageFile( fileName ) )
+		{
+			// top row first, flipping stays a load option
+			SDL_Surface* image = LoadImageRGBA( fileName, false );
+			if ( image == nullptr ) return false;
+
+			blob.encoding = AssetEncoding::ImageRGBA;
+			blob.imageSize = glm::ivec2( image->w, image->h );
+			blob.bytes.resize( static_cast<std::size_t>( image->w ) * image->h * 4 );
+			for ( int y = 0; y < image->h; ++y )
+				std::memcpy( blob.bytes.data() + static_cast<std::size_t>( y ) * image->w * 4, static_cast<const std::uint8_t*>( image->pixels ) + y * image->pitch, image->w * 4 );
+			SDL_FreeSurface( image );
+		}
+		else
+		{
+			AssetData data = ReadAsset( fileName );
+			if ( !data.IsValid() )
+			{
+				SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[AssetPack] Cannot read %s", fileName.string().c_str() );
+				return false;
+			}
+			blob.bytes.assign( data.GetData(), data.GetData() + data.GetSize() );
+		}
+
+		blobs.push_back( std::move( blob ) );
+	}
+
+	std::sort( blobs.begin(), blobs.end(), []( const Blob& a, const Blob& b ) { return a.name < b.name; } );
+
+	// the layout: header, entries, names, then the aligned blobs, each followed by at least one zero byte
+	auto align = []( const std::uint64_t offset ) { return ( offset + BLOB_ALIGNMENT - 1 ) / BLOB_ALIGNMENT * BLOB_ALIGNMENT; };
+
+	std::vector<Entry> entries( blobs.size() );
+	std::string names;
+	std::uint64_t offset = sizeof( PackHeader ) + entries.size() * sizeof( Entry );
+	for ( const Blob& blob : blobs )
+		offset += blob.name.size();
+
+	for ( std::size_t i = 0; i < blobs.size(); ++i )
+	{
+		Entry& entry = entries[ i ];
+		entry = {};
+		entry.nameOffset = static_cast<std::uint32_t>( sizeof( PackHeader ) + entries.size() * sizeof( Entry ) + names.size() );
+		entry.nameLength = static_cast<std::uint32_t>( blobs[ i ].name.size() );
+		entry.encoding = static_cast<std::uint32_t>( blobs[ i ].encoding );
+		entry.width = blobs[ i ].imageSize.x;
+		entry.height = blobs[ i ].imageSize.y;
+		names += blobs[ i ].name;
+
+		entry.offset = align( offset );
+		entry.size = blobs[ i ].bytes.size();
+		offset = entry.offset + entry.size + 1;
+	}
+
+	PackHeader header{};
+	std::memcpy( header.magic, PACK_MAGIC, sizeof( PACK_MAGIC ) );
+	header.version = PACK_FORMAT_VERSION;
+	header.entryCount = static_cast<std::uint32_t>( entries.size() );
+	header.fileSize = align( offset );
+
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+	{
+		std::ofstream stream( tempPath, std::ios::binary | std::ios::trunc );
+		stream.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		stream.write( reinterpret_cast<const char*>( entries.data() ), entries.size() * sizeof( Entry ) );
+		stream.write( names.data(), names.size() );
+
+		std::uint64_t written = sizeof( header ) + entries.size() * sizeof( Entry ) + names.size();
+		const std::vector<char> padding( BLOB_ALIGNMENT, 0 );
+		auto padTo = [ & ]( const std::uint64_t target )
+		{
+			stream.write( padding.data(), static_cast<std::streamsize>( target - written ) );
+			written = target;
+		};
+
+		for ( std::size_t i = 0; i < blobs.size(); ++i )
+		{
+			padTo( entries[ i ].offset );
+			stream.write( reinterpret_cast<const char*>( blobs[ i ].bytes.data() ), blobs[ i ].bytes.size() );
+			written += blobs[ i ].bytes.size();
+		}
+		padTo( header.fileSize );
+
+		if ( !stream )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[AssetPack] Cannot write %s", tempPath.string().c_str() );
+			stream.close();
+			std::error_code error;
+			std::filesystem::remove( tempPath, error );
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename( tempPath, path, error );
+	if ( error )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[AssetPack] Cannot write %s: %s", path.string().c_str(), error.message().c_str() );
+		std::filesystem::remove( tempPath, error );
+		return false;
+	}
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[AssetPack] %s: %d files, %.1f MB%s", path.string().c_str(), static_cast<int>( blobs.size() ),
+					header.fileSize / ( 1024.0 * 1024.0 ), decodeImages ? ", images decoded" : "" );
+	return true;
+}
+
+namespace
+{
+	// written only by Mount and Unmount, before and after every reader
+	std::unique_ptr<AssetPack> g_mountedPack;
+
+	std::mutex g_preferredFilesMutex;
+	std::set<std::string, std::less<>> g_preferredFiles;
+}
+
+bool AssetPack::Mount( const std::filesystem::path& path )
+{
+	auto pack = std::make_unique<AssetPack>();
+	if ( !pack->Open( path ) ) return false;
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[AssetPack] Mounted %s: %d files, %.1f MB", path.string().c_str(),
+					static_cast<int>( pack->GetEntryCount() ), pack->GetByteSize() / ( 1024.0 * 1024.0 ) );
+	g_mountedPack = std::move( pack );
+	return true;
+}
+
+void AssetPack::Unmount() noexcept
+{
+	g_mountedPack.reset();
+}
+
+const AssetPack* AssetPack::GetMounted() noexcept
+{
+	return g_mountedPack.get();
+}
+
+AssetData FindPackedAsset( const std::filesystem::path& fileName )
+{
+	const AssetPack* pack = AssetPack::GetMounted();
+	if ( !pack ) return {};
+
+	{
+		std::lock_guard<std::mutex> lock( g_preferredFilesMutex );
+		if ( !g_preferredFiles.empty() && g_preferredFiles.count( fileName.lexically_normal().generic_string() ) != 0 ) return {};
+	}
+
+	return pack->Find( fileName );
+}
+
+AssetData ReadAsset( const std::filesystem::path& fileName )
+{
+	AssetData packed = FindPackedAsset( fileName );
+	if ( packed.IsValid() ) return packed;
+
+	std::error_code error;
+	const std::uintmax_t fileSize = std::filesystem::file_size( fileName, error );
+	if ( error ) return {};
+
+	std::ifstream file( fileName, std::ios::binary );
+	if ( !file ) return {};
+
+	std::vector<std::uint8_t> bytes( static_cast<std::size_t>( fileSize ) );
+	file.read( reinterpret_cast<char*>( bytes.data() ), static_cast<std::streamsize>( bytes.size() ) );
+	bytes.resize( static_cast<std::size_t>( file.gcount() ) );
+
+	return AssetData( std::move( bytes ) );
+}
+
+void PreferAssetFile( const std::filesystem::path& fileName )
+{
+	std::lock_guard<std::mutex> lock( g_preferredFilesMutex );
+	g_preferredFiles.insert( fileName.lexically_normal().generic_string() );
+}
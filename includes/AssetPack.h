@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+enum class AssetEncoding : std::uint32_t
+{
+	Raw       = 0, // the file's bytes
+	ImageRGBA = 1, // an image decoded to tightly packed 8 bit RGBA, top row first
+};
+
+// The bytes of one asset: a view into the mounted AssetPack, or the contents of a plain file.
+// GetData()[ GetSize() ] is always a readable zero byte, so text assets can be parsed as C strings.
+class AssetData
+{
+public:
+	AssetData() = default;
+	// A view of memory that outlives the AssetData.
+	AssetData( const std::uint8_t* data, const std::size_t size, const AssetEncoding encoding, const glm::ivec2 imageSize ) noexcept
+		: m_data( data ), m_size( size ), m_encoding( encoding ), m_imageSize( imageSize ) {}
+	// Owns the bytes, adds the terminating zero.
+	explicit AssetData( std::vector<std::uint8_t> bytes );
+
+	AssetData( const AssetData& ) = delete;
+	AssetData& operator=( const AssetData& ) = delete;
+	AssetData( AssetData&& ) = default;
+	AssetData& operator=( AssetData&& ) = default;
+
+	// false if the asset was not found, an empty file is valid
+	inline bool IsValid() const noexcept { return m_data != nullptr; }
+	inline bool IsMapped() const noexcept { return m_data != nullptr && m_owned.empty(); }
+
+	inline const std::uint8_t* GetData() const noexcept { return m_data; }
+	inline std::size_t GetSize() const noexcept { return m_size; }
+	inline std::string_view GetText() const noexcept { return std::string_view( reinterpret_cast<const char*>( m_data ), m_size ); }
+
+	inline AssetEncoding GetEncoding() const noexcept { return m_encoding; }
+	// ImageRGBA only
+	inline glm::ivec2 GetImageSize() const noexcept { return m_imageSize; }
+
+private:
+	std::vector<std::uint8_t> m_owned;
+	const std::uint8_t* m_data = nullptr;
+	std::size_t         m_size = 0;
+	AssetEncoding       m_encoding = AssetEncoding::Raw;
+	glm::ivec2          m_imageSize = glm::ivec2( 0 );
+};
+
+// A single read-only file of named blobs, memory mapped, so reading an asset is an index lookup and the
+// data is paged in straight from the file cache, without opening or copying anything.
+//
+// Layout: a header, the index entries sorted by name, the names, then the blobs. Every blob starts on a
+// BLOB_ALIGNMENT boundary and is followed by at least one zero byte. Names are the lexically normal,
+// generic ( '/' separated ) paths the app opens, relative to the working directory.
+class AssetPack
+{
+public:
+	static constexpr const char* DEFAULT_FILE = "Assets.pack";
+	static constexpr std::size_t BLOB_ALIGNMENT = 4096;
+
+	AssetPack() = default;
+	~AssetPack() { Close(); }
+
+	AssetPack( const AssetPack& ) = delete;
+	AssetPack& operator=( const AssetPack& ) = delete;
+
+	// Maps the file and checks the index. Logs and returns false if it is missing or malformed.
+	bool Open( const std::filesystem::path& path );
+	void Close() noexcept;
+
+	// An invalid AssetData if the pack has no such file. Thread-safe.
+	AssetData Find( const std::filesystem::path& fileName ) const;
+
+	inline std::size_t GetEntryCount() const noexcept { return m_entryCount; }
+	inline std::size_t GetByteSize() const noexcept { return m_size; }
+
+	// Packs the files, decoding images to ImageRGBA if decodeImages is set, the rest stays Raw.
+	// Writes a temporary file and renames it, so a mounted pack is never seen half written.
+	static bool Build( const std::filesystem::path& path, const std::vector<std::filesystem::path>& files, const bool decodeImages );
+
+	// The pack ReadAsset reads from. Mount before anything loads assets, Unmount once nothing does.
+	static bool Mount( const std::filesystem::path& path );
+	static void Unmount() noexcept;
+	static const AssetPack* GetMounted() noexcept;
+
+private:
+	struct Entry;
+
+	static std::string GetName( const std::filesystem::path& fileName );
+
+	MappedFile          m_file;
+	const std::uint8_t* m_data = nullptr;
+	std::size_t         m_size = 0;
+	const Entry*        m_entries = nullptr;
+	std::size_t         m_entryCount = 0;
+};
+
+// The asset from the mounted pack if it has it, from the plain file otherwise. Thread-safe.
+AssetData ReadAsset( const std::filesystem::path& fileName );
+
+// The view of the asset in the mounted pack, invalid if ReadAsset would read the plain file. For readers
+// that stream a plain file instead of holding all of it. Thread-safe.
+AssetData FindPackedAsset( const std::filesystem::path& fileName );
+
+// ReadAsset reads this file from disk from now on, even if the pack has it: hot reloaded files were edited.
+void PreferAssetFile( const std::filesystem::path& fileName );
@@ -0,0 +1,215 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+	using Block = std::uint8_t[ 16 ][ 4 ]; // 4x4 RGBA pixels, row by row
+
+	int GetBlockCount( const int size ) noexcept { return ( size + 3 ) / 4; }
+
+	void GatherBlock( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch, const int blockX, const int blockY, Block& block ) noexcept
+	{
+		for ( int y = 0; y < 4; ++y )
+		{
+			const int sourceY = std::min( blockY * 4 + y, height - 1 );
+			for ( int x = 0; x < 4; ++x )
+			{
+				const int sourceX = std::min( blockX * 4 + x, width - 1 );
+				std::memcpy( block[ y * 4 + x ], rgba + sourceY * pitch + sourceX * 4, 4 );
+			}
+		}
+	}
+
+	std::uint16_t ToRGB565( const int r, const int g, const int b ) noexcept
+	{
+		return static_cast<std::uint16_t>( ( ( r * 31 + 127 ) / 255 ) << 11 | ( ( g * 63 + 127 ) / 255 ) << 5 | ( b * 31 + 127 ) / 255 );
+	}
+
+	void FromRGB565( const std::uint16_t color, int rgb[ 3 ] ) noexcept
+	{
+		const int r = ( color >> 11 ) & 31, g = ( color >> 5 ) & 63, b = color & 31;
+		rgb[ 0 ] = ( r << 3 ) | ( r >> 2 );
+		rgb[ 1 ] = ( g << 2 ) | ( g >> 4 );
+		rgb[ 2 ] = ( b << 3 ) | ( b >> 2 );
+	}
+
+	void PutLittleEndian( std::uint8_t* out, std::uint64_t value, const int byteCount ) noexcept
+	{
+		for ( int i = 0; i < byteCount; ++i, value >>= 8 )
+			out[ i ] = static_cast<std::uint8_t>( value & 0xFF );
+	}
+
+	// 8 bytes: two RGB565 endpoints, then 2 bit palette indices
+	void EncodeColorBlock( const Block& block, std::uint8_t* out ) noexcept
+	{
+		int minColor[ 3 ] = { 255, 255, 255 }, maxColor[ 3 ] = { 0, 0, 0 };
+		int mean[ 3 ] = { 0, 0, 0 };
+		for ( const auto& pixel : block )
+			for ( int c = 0; c < 3; ++c )
+			{
+				minColor[ c ] = std::min<int>( minColor[ c ], pixel[ c ] );
+				maxColor[ c ] = std::max<int>( maxColor[ c ], pixel[ c ] );
+				mean[ c ] += pixel[ c ];
+			}
+
+		// the box has four diagonals, take the one red and blue correlate with green on
+		int covarianceRG = 0, covarianceBG = 0;
+		for ( const auto& pixel : block )
+		{
+			const int g = pixel[ 1 ] * 16 - mean[ 1 ];
+			covarianceRG += ( pixel[ 0 ] * 16 - mean[ 0 ] ) * g;
+			covarianceBG += ( pixel[ 2 ] * 16 - mean[ 2 ] ) * g;
+		}
+		if ( covarianceRG < 0 ) std::swap( minColor[ 0 ], maxColor[ 0 ] );
+		if ( covarianceBG < 0 ) std::swap( minColor[ 2 ], maxColor[ 2 ] );
+
+		// pull the endpoints in by 1/16 of the range, outliers should not waste them
+		for ( int c = 0; c < 3; ++c )
+		{
+			const int inset = ( maxColor[ c ] - minColor[ c ] ) / 16;
+			minColor[ c ] += inset;
+			maxColor[ c ] -= inset;
+		}
+
+		std::uint16_t color0 = ToRGB565( maxColor[ 0 ], maxColor[ 1 ], maxColor[ 2 ] );
+		std::uint16_t color1 = ToRGB565( minColor[ 0 ], minColor[ 1 ], minColor[ 2 ] );
+
+		// color0 > color1 selects the four colour mode, the only one BC3 knows.
+		// With equal endpoints every index stays 0, which decodes the same in both modes.
+		if ( color0 < color1 ) std::swap( color0, color1 );
+
+		std::uint32_t indices = 0;
+		if ( color0 != color1 )
+		{
+			int palette[ 4 ][ 3 ];
+			FromRGB565( color0, palette[ 0 ] );
+			FromRGB565( color1, palette[ 1 ] );
+			for ( int c = 0; c < 3; ++c )
+			{
+				palette[ 2 ][ c ] = ( 2 * palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 3;
+				palette[ 3 ][ c ] = ( palette[ 0 ][ c ] + 2 * palette[ 1 ][ c ] ) / 3;
+			}
+
+			for ( int i = 0; i < 16; ++i )
+			{
+				int bestIndex = 0, bestDistance = std::numeric_limits<int>::max();
+				for ( int p = 0; p < 4; ++p )
+				{
+					const int dr = block[ i ][ 0 ] - palette[ p ][ 0 ];
+					const int dg = block[ i ][ 1 ] - palette[ p ][ 1 ];
+					const int db = block[ i ][ 2 ] - palette[ p ][ 2 ];
+					const int distance = dr * dr + dg * dg + db * db;
+					if ( distance < bestDistance )
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= static_cast<std::uint32_t>( bestIndex ) << ( 2 * i );
+			}
+		}
+
+		PutLittleEndian( out, color0, 2 );
+		PutLittleEndian( out + 2, color1, 2 );
+		PutLittleEndian( out + 4, indices, 4 );
+	}
+
+	// 8 bytes: two alpha endpoints, then 3 bit indices into the eight value ramp between them
+	void EncodeAlphaBlock( const Block& block, std::uint8_t* out ) noexcept
+	{
+		int minAlpha = 255, maxAlpha = 0;
+		for ( const auto& pixel : block )
+		{
+			minAlpha = std::min<int>( minAlpha, pixel[ 3 ] );
+			maxAlpha = std::max<int>( maxAlpha, pixel[ 3 ] );
+		}
+
+		std::uint64_t indices = 0;
+		if ( maxAlpha != minAlpha )
+		{
+			// alpha0 > alpha1: index 0 and 1 are the endpoints, 2..7 the six values between them
+			int ramp[ 8 ] = { maxAlpha, minAlpha };
+			for ( int k = 1; k <= 6; ++k )
+				ramp[ k + 1 ] = ( ( 7 - k ) * maxAlpha + k * minAlpha ) / 7;
+
+			for ( int i = 0; i < 16; ++i )
+			{
+				int bestIndex = 0, bestDistance = 256;
+				for ( int p = 0; p < 8; ++p )
+				{
+					const int distance = std::abs( block[ i ][ 3 ] - ramp[ p ] );
+					if ( distance < bestDistance )
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= static_cast<std::uint64_t>( bestIndex ) << ( 3 * i );
+			}
+		}
+
+		out[ 0 ] = static_cast<std::uint8_t>( maxAlpha );
+		out[ 1 ] = static_cast<std::uint8_t>( minAlpha );
+		PutLittleEndian( out + 2, indices, 6 );
+	}
+}
+
+std::size_t GetCompressedByteSize( const BlockFormat format, const int width, const int height ) noexcept
+{
+	return static_cast<std::size_t>( GetBlockCount( width ) ) * GetBlockCount( height ) * GetBlockBytes( format );
+}
+
+bool HasTranslucentPixels( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch ) noexcept
+{
+	for ( int y = 0; y < height; ++y )
+	{
+		const std::uint8_t* row = rgba + y * pitch;
+		for ( int x = 0; x < width; ++x )
+			if ( row[ x * 4 + 3 ] != 255 )
+				return true;
+	}
+	return false;
+}
+
+std::vector<std::uint8_t> CompressImage( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch, const BlockFormat format )
+{
+	std::vector<std::uint8_t> compressed( GetCompressedByteSize( format, width, height ) );
+	std::uint8_t* out = compressed.data();
+
+	Block block;
+	for ( int blockY = 0; blockY < GetBlockCount( height ); ++blockY )
+		for ( int blockX = 0; blockX < GetBlockCount( width ); ++blockX )
+		{
+			GatherBlock( rgba, width, height, pitch, blockX, blockY, block );
+
+			if ( format == BlockFormat::BC3 )
+			{
+				EncodeAlphaBlock( block, out );
+				out += 8;
+			}
+			EncodeColorBlock( block, out );
+			out += 8;
+		}
+
+	return compressed;
+}
+
+std::vector<std::uint8_t> PromoteBC1ToBC3( const std::vector<std::uint8_t>& bc1 )
+{
+	// alpha0 = alpha1 = 255 with all indices 0
+	static constexpr std::uint8_t OPAQUE_ALPHA_BLOCK[ 8 ] = { 255, 255, 0, 0, 0, 0, 0, 0 };
+
+	std::vector<std::uint8_t> bc3;
+	bc3.reserve( bc1.size() * 2 );
+	for ( std::size_t offset = 0; offset + 8 <= bc1.size(); offset += 8 )
+	{
+		bc3.insert( bc3.end(), std::begin( OPAQUE_ALPHA_BLOCK ), std::end( OPAQUE_ALPHA_BLOCK ) );
+		bc3.insert( bc3.end(), bc1.begin() + offset, bc1.begin() + offset + 8 );
+	}
+	return bc3;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BC1 ( DXT1 ) and BC3 ( DXT5 ) encoding of 8 bit RGBA images, 4x4 pixel blocks.
+//
+// The colour endpoints are the bounding box of the block's colours, inset a little and oriented along
+// the diagonal the colours correlate on. That is far from the best possible quality, but fast enough
+// to bake every texture of the scene at startup and good enough for planet surfaces.
+
+enum class BlockFormat : std::uint8_t
+{
+	BC1, // RGB, 8 bytes per block
+	BC3, // RGBA, 16 bytes per block: an alpha block followed by a BC1 style colour block
+};
+
+constexpr std::size_t GetBlockBytes( const BlockFormat format ) noexcept { return format == BlockFormat::BC1 ? 8 : 16; }
+
+// Bytes of a width x height image in the given format, partial blocks at the edges included.
+std::size_t GetCompressedByteSize( const BlockFormat format, const int width, const int height ) noexcept;
+
+// True if any pixel has an alpha below 255, i.e. the image needs BC3 instead of BC1.
+bool HasTranslucentPixels( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch ) noexcept;
+
+// Encodes an image whose rows are pitch bytes apart. Blocks reaching over the edge repeat the last row and column.
+std::vector<std::uint8_t> CompressImage( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch, const BlockFormat format );
+
+// Every BC1 block written by CompressImage uses the four colour mode, which is also a valid BC3
+// colour block, so a BC1 image becomes BC3 by putting an opaque alpha block in front of each block.
+std::vector<std::uint8_t> PromoteBC1ToBC3( const std::vector<std::uint8_t>& bc1 );
@@ -46,6 +46,31 @@ void Camera::SetProj(float _angle, float _aspect, float _zn, float _zf)
 	m_projectionDirty = true;
 }
 
+std::array<glm::vec4, 6> Camera::GetFrustumPlanes() const
+{
+	// Gribb-Hartmann: the planes are sums and differences of the rows of the matrix (glm is column-major)
+	const glm::mat4& m = m_matViewProj;
+	const glm::vec4 row0( m[0][0], m[1][0], m[2][0], m[3][0] );
+	const glm::vec4 row1( m[0][1], m[1][1], m[2][1], m[3][1] );
+	const glm::vec4 row2( m[0][2], m[1][2], m[2][2], m[3][2] );
+	const glm::vec4 row3( m[0][3], m[1][3], m[2][3], m[3][3] );
+
+	std::array<glm::vec4, 6> planes =
+	{
+		row3 + row0,
+		row3 - row0,
+		row3 + row1,
+		row3 - row1,
+		row3 + row2,
+		row3 - row2,
+	};
+
+	for ( glm::vec4& plane : planes )
+		plane /= glm::length( glm::vec3( plane ) );
+
+	return planes;
+}
+
 void Camera::LookAt(glm::vec3 _at)
 {
 	SetView( m_eye, _at, m_up );
@@ -3,6 +3,8 @@
 #include <SDL2/SDL.h>
 #include <glm/glm.hpp>
 
+#include <array>
+
 class Camera
 {
 public:
@@ -19,6 +21,10 @@ public:
 	inline glm::mat4 GetProj() const { return m_matProj; }
 	inline glm::mat4 GetViewProj() const { return m_matViewProj; }
 
+	// The six planes of the view frustum ( left, right, bottom, top, near, far ) extracted from the
+	// view-projection matrix, normalized, normals pointing inwards.
+	std::array<glm::vec4, 6> GetFrustumPlanes() const;
+
 	void Update(float _deltaTime);
 
 	void SetView(glm::vec3 _eye, glm::vec3 _at, glm::vec3 _up);
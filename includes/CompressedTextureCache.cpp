@@ -0,0 +1,541 @@
+#include "CompressedTextureCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include <SDL2/SDL.h>
+
+#include "AssetPack.h"
+#include "BlockCompression.h"
+#include "FileUtils.h"
+#include "GLUtils.hpp"
+#include "ImageOps.h"
+
+// Bump when the baking ( filtering, encoder, ... ) changes, old entries then simply miss.
+static constexpr std::uint32_t CACHE_FORMAT_VERSION = 2;
+
+static int NearestPowerOfTwo( const int value )
+{
+	if ( value <= 1 ) return 1;
+	return 1 << static_cast<int>( std::lround( std::log2( static_cast<double>( value ) ) ) );
+}
+
+static glm::ivec2 GetBakedSize( const glm::ivec2 size, const CompressedTextureCache::Resize resize, const glm::ivec2 exactSize )
+{
+	switch ( resize )
+	{
+	case CompressedTextureCache::Resize::NearestPowerOfTwo: return glm::ivec2( NearestPowerOfTwo( size.x ), NearestPowerOfTwo( size.y ) );
+	case CompressedTextureCache::Resize::Exact:             return exactSize;
+	default:                                                return size;
+	}
+}
+
+static std::uint32_t ReadBigEndian32( const std::uint8_t* data ) noexcept
+{
+	return static_cast<std::uint32_t>( data[ 0 ] ) << 24 | static_cast<std::uint32_t>( data[ 1 ] ) << 16 | static_cast<std::uint32_t>( data[ 2 ] ) << 8 | data[ 3 ];
+}
+
+// Size and alpha channel from the header of a PNG or JPEG file, false for anything else.
+static bool ReadImageHeader( const std::uint8_t* data, const std::size_t size, glm::ivec2& imageSize, bool& hasAlpha )
+{
+	static constexpr std::uint8_t PNG_SIGNATURE[ 8 ] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	if ( size >= 33 && std::equal( std::begin( PNG_SIGNATURE ), std::end( PNG_SIGNATURE ), data ) && std::memcmp( data + 12, "IHDR", 4 ) == 0 )
+	{
+		imageSize = glm::ivec2( static_cast<int>( ReadBigEndian32( data + 16 ) ), static_cast<int>( ReadBigEndian32( data + 20 ) ) );
+
+		// grey or RGB with alpha, or a transparency chunk ( palette alpha, colour key ) before the image data
+		const std::uint8_t colorType = data[ 25 ];
+		hasAlpha = colorType == 4 || colorType == 6;
+		for ( std::size_t offset = 8; !hasAlpha && offset + 8 <= size; )
+		{
+			const std::uint8_t* type = data + offset + 4;
+			if ( std::memcmp( type, "IDAT", 4 ) == 0 || std::memcmp( type, "IEND", 4 ) == 0 ) break;
+			hasAlpha = std::memcmp( type, "tRNS", 4 ) == 0;
+			offset += 12 + static_cast<std::size_t>( ReadBigEndian32( data + offset ) );
+		}
+		return imageSize.x > 0 && imageSize.y > 0;
+	}
+
+	if ( size >= 4 && data[ 0 ] == 0xFF && data[ 1 ] == 0xD8 )
+	{
+		// the marker segments up to the frame header: SOF0..SOF15, except DHT ( C4 ), JPG ( C8 ) and DAC ( CC )
+		for ( std::size_t offset = 2; offset + 4 <= size; )
+		{
+			if ( data[ offset ] != 0xFF ) return false;
+
+			const std::uint8_t marker = data[ offset + 1 ];
+			if ( marker == 0xFF )
+			{
+				++offset; // fill byte
+				continue;
+			}
+
+			if ( marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC )
+			{
+				if ( offset + 9 > size ) return false;
+				imageSize = glm::ivec2( data[ offset + 7 ] << 8 | data[ offset + 8 ], data[ offset + 5 ] << 8 | data[ offset + 6 ] );
+				hasAlpha = false;
+				return imageSize.x > 0 && imageSize.y > 0;
+			}
+
+			offset += 2 + static_cast<std::size_t>( data[ offset + 2 ] << 8 | data[ offset + 3 ] );
+		}
+	}
+
+	return false;
+}
+
+std::size_t BakedTexture::GetByteSize() const noexcept
+{
+	std::size_t byteSize = 0;
+	for ( const std::vector<std::uint8_t>& level : levels )
+		byteSize += level.size();
+	return byteSize;
+}
+
+glm::ivec2 GetMipLevelSize( const glm::ivec2 size, const int level ) noexcept
+{
+	return glm::max( glm::ivec2( size.x >> level, size.y >> level ), glm::ivec2( 1 ) );
+}
+
+int GetMipLevelCount( const glm::ivec2 size ) noexcept
+{
+	int levelCount = 1;
+	for ( int largest = std::max( size.x, size.y ); largest > 1; largest >>= 1 )
+		++levelCount;
+	return levelCount;
+}
+
+std::size_t GetLevelByteSize( const GLenum format, const glm::ivec2 size ) noexcept
+{
+	switch ( format )
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  return GetCompressedByteSize( BlockFormat::BC1, size.x, size.y );
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GetCompressedByteSize( BlockFormat::BC3, size.x, size.y );
+	default:                               return static_cast<std::size_t>( size.x ) * size.y * 4;
+	}
+}
+
+BakedTexture MakeClearTexture( const GLenum format, const glm::ivec2 size )
+{
+	BakedTexture texture{ format, size, {} };
+	for ( int level = 0; level < GetMipLevelCount( size ); ++level )
+		texture.levels.emplace_back( GetLevelByteSize( format, GetMipLevelSize( size, level ) ), std::uint8_t( 0 ) );
+	return texture;
+}
+
+bool PromoteTexture( BakedTexture& texture, const GLenum format )
+{
+	if ( texture.format == format ) return true;
+	if ( texture.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ) return false;
+
+	for ( std::vector<std::uint8_t>& level : texture.levels )
+		level = PromoteBC1ToBC3( level );
+	texture.format = format;
+	return true;
+}
+
+void UploadTexture( const GLenum role, const BakedTexture& texture )
+{
+	for ( int level = 0; level < static_cast<int>( texture.levels.size() ); ++level )
+	{
+		const glm::ivec2 size = GetMipLevelSize( texture.size, level );
+		const std::vector<std::uint8_t>& data = texture.levels[ level ];
+
+		if ( texture.format == GL_RGBA8 )
+			glTexImage2D( role, level, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data() );
+		else
+			glCompressedTexImage2D( role, level, texture.format, size.x, size.y, 0, static_cast<GLsizei>( data.size() ), data.data() );
+	}
+}
+
+void UploadTextureLayer( const GLint layer, const BakedTexture& texture )
+{
+	for ( int level = 0; level < static_cast<int>( texture.levels.size() ); ++level )
+	{
+		const glm::ivec2 size = GetMipLevelSize( texture.size, level );
+		const std::vector<std::uint8_t>& data = texture.levels[ level ];
+
+		if ( texture.format == GL_RGBA8 )
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size.x, size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, data.data() );
+		else
+			glCompressedTexSubImage3D( GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size.x, size.y, 1, texture.format, static_cast<GLsizei>( data.size() ), data.data() );
+	}
+}
+
+// KTX2, as much of it as the baked textures need: one 2D image, no supercompression, no key/value data.
+// Level data is stored smallest first, as the format requires.
+namespace Ktx2
+{
+	static constexpr std::uint8_t IDENTIFIER[ 12 ] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	static constexpr std::size_t HEADER_SIZE = 80;
+	static constexpr std::size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+	// VkFormat values
+	static constexpr std::uint32_t VK_FORMAT_R8G8B8A8_UNORM     = 37;
+	static constexpr std::uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+	static constexpr std::uint32_t VK_FORMAT_BC3_UNORM_BLOCK     = 137;
+
+	static std::uint32_t ToVkFormat( const GLenum format ) noexcept
+	{
+		switch ( format )
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return VK_FORMAT_BC3_UNORM_BLOCK;
+		default:                               return VK_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	static GLenum FromVkFormat( const std::uint32_t vkFormat ) noexcept
+	{
+		switch ( vkFormat )
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case VK_FORMAT_BC3_UNORM_BLOCK:     return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case VK_FORMAT_R8G8B8A8_UNORM:      return GL_RGBA8;
+		default:                            return 0;
+		}
+	}
+
+	static void Put32( std::vector<std::uint8_t>& out, const std::uint32_t value )
+	{
+		for ( int i = 0; i < 4; ++i ) out.push_back( static_cast<std::uint8_t>( value >> ( 8 * i ) ) );
+	}
+
+	static void Put64( std::vector<std::uint8_t>& out, const std::uint64_t value )
+	{
+		for ( int i = 0; i < 8; ++i ) out.push_back( static_cast<std::uint8_t>( value >> ( 8 * i ) ) );
+	}
+
+	static std::uint64_t Get( const std::vector<std::uint8_t>& in, const std::size_t offset, const int byteCount ) noexcept
+	{
+		std::uint64_t value = 0;
+		for ( int i = byteCount - 1; i >= 0; --i ) value = ( value << 8 ) | in[ offset + i ];
+		return value;
+	}
+
+	// Data format descriptor with a single basic block: colour model, block size and the channels.
+	// Formats with alpha are flagged premultiplied: translucent images are baked premultiplied,
+	// and an opaque image is the same either way.
+	static std::vector<std::uint8_t> MakeDescriptor( const GLenum format )
+	{
+		struct Sample { std::uint32_t bitOffset, bitLength, channel, upper; };
+
+		std::uint32_t colorModel, blockDimensions, bytesPlane0;
+		std::uint32_t flags = 0;
+		std::vector<Sample> samples;
+
+		switch ( format )
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			colorModel = 128; blockDimensions = 3 | 3 << 8; bytesPlane0 = 8;   // KHR_DF_MODEL_BC1A, 4x4
+			samples = { { 0, 64, 0, ~0u } };                                      // colour
+			break;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			colorModel = 130; blockDimensions = 3 | 3 << 8; bytesPlane0 = 16;  // KHR_DF_MODEL_BC3, 4x4
+			samples = { { 0, 64, 15, ~0u }, { 64, 64, 0, ~0u } };                 // alpha, colour
+			flags = 1;                                                            // KHR_DF_FLAG_ALPHA_PREMULTIPLIED
+			break;
+		default:
+			colorModel = 1; blockDimensions = 0; bytesPlane0 = 4;               // KHR_DF_MODEL_RGBSDA, 1x1
+			samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, 15, 255 } };
+			flags = 1;                                                            // KHR_DF_FLAG_ALPHA_PREMULTIPLIED
+			break;
+		}
+
+		const std::uint32_t blockSize = 24 + 16 * static_cast<std::uint32_t>( samples.size() );
+
+		std::vector<std::uint8_t> descriptor;
+		Put32( descriptor, 4 + blockSize );                 // dfdTotalSize
+		Put32( descriptor, 0 );                             // vendor: Khronos, type: basic
+		Put32( descriptor, 2 | blockSize << 16 );           // version 1.3, block size
+		Put32( descriptor, colorModel | 1 << 8 | 1 << 16 | flags << 24 ); // BT.709 primaries, linear transfer, alpha flags
+		Put32( descriptor, blockDimensions );
+		Put32( descriptor, bytesPlane0 );
+		Put32( descriptor, 0 );
+		for ( const Sample& sample : samples )
+		{
+			Put32( descriptor, sample.bitOffset | ( sample.bitLength - 1 ) << 16 | sample.channel << 24 );
+			Put32( descriptor, 0 );                         // sample position
+			Put32( descriptor, 0 );                         // lower
+			Put32( descriptor, sample.upper );
+		}
+		return descriptor;
+	}
+
+	static bool Write( std::ostream& stream, const BakedTexture& texture )
+	{
+		const std::uint32_t levelCount = static_cast<std::uint32_t>( texture.levels.size() );
+		const std::vector<std::uint8_t> descriptor = MakeDescriptor( texture.format );
+		const std::size_t alignment = texture.format == GL_RGBA8 ? 4 : ( texture.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16 );
+
+		// smallest level first, each aligned to the block size
+		const std::size_t descriptorOffset = HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * levelCount;
+		std::vector<std::uint64_t> levelOffsets( levelCount );
+		std::size_t offset = descriptorOffset + descriptor.size();
+		for ( std::uint32_t level = levelCount; level-- > 0; )
+		{
+			offset = ( offset + alignment - 1 ) / alignment * alignment;
+			levelOffsets[ level ] = offset;
+			offset += texture.levels[ level ].size();
+		}
+
+		std::vector<std::uint8_t> file( std::begin( IDENTIFIER ), std::end( IDENTIFIER ) );
+		Put32( file, ToVkFormat( texture.format ) );
+		Put32( file, 1 );                                   // typeSize
+		Put32( file, static_cast<std::uint32_t>( texture.size.x ) );
+		Put32( file, static_cast<std::uint32_t>( texture.size.y ) );
+		Put32( file, 0 );                                   // pixelDepth
+		Put32( file, 0 );                                   // layerCount
+		Put32( file, 1 );                                   // faceCount
+		Put32( file, levelCount );
+		Put32( file, 0 );                                   // supercompressionScheme
+		Put32( file, static_cast<std::uint32_t>( descriptorOffset ) );
+		Put32( file, static_cast<std::uint32_t>( descriptor.size() ) );
+		Put32( file, 0 );                                   // kvdByteOffset
+		Put32( file, 0 );                                   // kvdByteLength
+		Put64( file, 0 );                                   // sgdByteOffset
+		Put64( file, 0 );                                   // sgdByteLength
+
+		for ( std::uint32_t level = 0; level < levelCount; ++level )
+		{
+			Put64( file, levelOffsets[ level ] );
+			Put64( file, texture.levels[ level ].size() );
+			Put64( file, texture.levels[ level ].size() );  // uncompressedByteLength
+		}
+
+		file.insert( file.end(), descriptor.begin(), descriptor.end() );
+
+		file.resize( offset, 0 );
+		for ( std::uint32_t level = 0; level < levelCount; ++level )
+			std::copy( texture.levels[ level ].begin(), texture.levels[ level ].end(), file.begin() + levelOffsets[ level ] );
+
+		stream.write( reinterpret_cast<const char*>( file.data() ), file.size() );
+		return static_cast<bool>( stream );
+	}
+
+	// Format and size only, the levels are not read.
+	static bool ReadHeader( const std::filesystem::path& path, GLenum& format, glm::ivec2& size )
+	{
+		std::ifstream stream( path, std::ios::binary );
+		std::vector<std::uint8_t> header( HEADER_SIZE );
+		if ( !stream.read( reinterpret_cast<char*>( header.data() ), HEADER_SIZE ) || !std::equal( std::begin( IDENTIFIER ), std::end( IDENTIFIER ), header.begin() ) ) return false;
+
+		format = FromVkFormat( static_cast<std::uint32_t>( Get( header, 12, 4 ) ) );
+		size = glm::ivec2( static_cast<int>( Get( header, 20, 4 ) ), static_cast<int>( Get( header, 24, 4 ) ) );
+		return format != 0 && size.x > 0 && size.y > 0;
+	}
+
+	// Accepts only what Write produces, anything else is a miss.
+	static bool Read( const std::filesystem::path& path, BakedTexture& texture )
+	{
+		std::ifstream stream( path, std::ios::binary );
+		if ( !stream ) return false;
+
+		const std::vector<std::uint8_t> file( ( std::istreambuf_iterator<char>( stream ) ), std::istreambuf_iterator<char>() );
+		if ( file.size() < HEADER_SIZE || !std::equal( std::begin( IDENTIFIER ), std::end( IDENTIFIER ), file.begin() ) ) return false;
+
+		const GLenum format = FromVkFormat( static_cast<std::uint32_t>( Get( file, 12, 4 ) ) );
+		const glm::ivec2 size( static_cast<int>( Get( file, 20, 4 ) ), static_cast<int>( Get( file, 24, 4 ) ) );
+		const std::uint32_t levelCount = static_cast<std::uint32_t>( Get( file, 40, 4 ) );
+
+		if ( format == 0 || size.x <= 0 || size.y <= 0 || Get( file, 28, 4 ) != 0 || Get( file, 32, 4 ) != 0 || Get( file, 36, 4 ) != 1
+			 || static_cast<int>( levelCount ) != GetMipLevelCount( size ) || Get( file, 44, 4 ) != 0
+			 || file.size() < HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * levelCount )
+			return false;
+
+		texture = BakedTexture{ format, size, {} };
+		texture.levels.resize( levelCount );
+		for ( std::uint32_t level = 0; level < levelCount; ++level )
+		{
+			const std::size_t entry = HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * level;
+			const std::uint64_t offset = Get( file, entry, 8 );
+			const std::uint64_t length = Get( file, entry + 8, 8 );
+
+			if ( length != GetLevelByteSize( format, GetMipLevelSize( size, static_cast<int>( level ) ) ) || offset > file.size() || length > file.size() - offset )
+				return false;
+
+			texture.levels[ level ].assign( file.begin() + offset, file.begin() + offset + length );
+		}
+
+		return true;
+	}
+}
+
+void CompressedTextureCache::Init()
+{
+	m_compress = GLEW_EXT_texture_compression_s3tc;
+	if ( !m_compress )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[CompressedTextureCache] No S3TC support, textures are baked as uncompressed RGBA8." );
+
+	std::error_code error;
+	std::filesystem::create_directories( m_directory, error );
+	m_writable = !error;
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[CompressedTextureCache] Cannot create %s: %s, textures are baked on every start.",
+						m_directory.string().c_str(), error.message().c_str() );
+}
+
+BakedTexture CompressedTextureCache::Load( const std::filesystem::path& fileName, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const
+{
+	// straight from the mounted AssetPack when it has the file, no copy
+	const AssetData source = ReadAsset( fileName );
+
+	// a missing file is not hashed, Bake fails on it and LoadImageRGBA reports it
+	std::optional<std::filesystem::path> path;
+	if ( source.GetSize() != 0 )
+	{
+		path = GetPath( MakeKey( source, flipVertically, resize, exactSize ) );
+
+		BakedTexture texture;
+		if ( Ktx2::Read( *path, texture ) )
+		{
+			++m_hits;
+			return texture;
+		}
+	}
+
+	BakedTexture texture = Bake( fileName, flipVertically, resize, exactSize );
+	if ( texture.IsEmpty() )
+	{
+		++m_failed;
+		return texture;
+	}
+
+	++m_baked;
+	if ( path && m_writable )
+		Store( *path, texture );
+
+	return texture;
+}
+
+CompressedTextureCache::ImageInfo CompressedTextureCache::Probe( const std::filesystem::path& fileName, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const
+{
+	const AssetData source = ReadAsset( fileName );
+	if ( source.GetSize() == 0 ) return {};
+
+	ImageInfo info;
+	if ( Ktx2::ReadHeader( GetPath( MakeKey( source, flipVertically, resize, exactSize ) ), info.format, info.size ) )
+		return info;
+
+	glm::ivec2 size( 0 );
+	bool translucent = false;
+	if ( source.GetEncoding() == AssetEncoding::ImageRGBA )
+	{
+		size = source.GetImageSize();
+		translucent = HasTranslucentPixels( source.GetData(), size.x, size.y, static_cast<std::size_t>( size.x ) * 4 );
+	}
+	else if ( !ReadImageHeader( source.GetData(), source.GetSize(), size, translucent ) )
+	{
+		// no header we know, decoded as Bake would do it
+		SDL_Surface* image = LoadImageRGBA( fileName, flipVertically );
+		if ( image == nullptr ) return {};
+
+		size = glm::ivec2( image->w, image->h );
+		translucent = HasTranslucentPixels( static_cast<const std::uint8_t*>( image->pixels ), image->w, image->h, image->pitch );
+		SDL_FreeSurface( image );
+	}
+
+	info.size = GetBakedSize( size, resize, exactSize );
+	info.format = !m_compress ? GL_RGBA8 : ( translucent ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT );
+	return info;
+}
+
+std::uint64_t CompressedTextureCache::MakeKey( const AssetData& source, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const noexcept
+{
+	const std::uint8_t options[] = { static_cast<std::uint8_t>( m_compress ), static_cast<std::uint8_t>( flipVertically ), static_cast<std::uint8_t>( resize ) };
+	const glm::ivec2 keySize = resize == Resize::Exact ? exactSize : glm::ivec2( 0 );
+	const std::uint64_t sourceSize = source.GetSize();
+
+	std::uint64_t key = FNV_OFFSET_BASIS;
+	key = HashBytes( key, &CACHE_FORMAT_VERSION, sizeof( CACHE_FORMAT_VERSION ) );
+	key = HashBytes( key, options, sizeof( options ) );
+	key = HashBytes( key, &keySize, sizeof( keySize ) );
+	key = HashBytes( key, &sourceSize, sizeof( sourceSize ) );
+	key = HashBytes( key, source.GetData(), source.GetSize() );
+	return key;
+}
+
+void CompressedTextureCache::Store( const std::filesystem::path& path, const BakedTexture& texture ) const
+{
+	const std::error_code error = WriteFileAtomically( path, [ &texture ]( std::ostream& stream ) { return Ktx2::Write( stream, texture ); } );
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[CompressedTextureCache] Cannot write %s: %s", path.string().c_str(), error.message().c_str() );
+}
+
+BakedTexture CompressedTextureCache::Bake( const std::filesystem::path& fileName, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const
+{
+	SDL_Surface* image = LoadImageRGBA( fileName, flipVertically );
+	if ( image == nullptr ) return {};
+
+	const glm::ivec2 size = GetBakedSize( glm::ivec2( image->w, image->h ), resize, exactSize );
+
+	image = ResampleImageRGBA( image, size.x, size.y );
+	if ( image == nullptr ) return {};
+
+	// tightly packed from here on
+	std::vector<std::uint8_t> pixels( static_cast<std::size_t>( size.x ) * size.y * 4 );
+	for ( int y = 0; y < size.y; ++y )
+		std::memcpy( pixels.data() + static_cast<std::size_t>( y ) * size.x * 4, static_cast<const std::uint8_t*>( image->pixels ) + y * image->pitch, size.x * 4 );
+	SDL_FreeSurface( image );
+
+	// translucent images are stored premultiplied, so filtering and blending never mix in the colour of invisible texels
+	const bool translucent = HasTranslucentPixels( pixels.data(), size.x, size.y, size.x * 4 );
+	if ( translucent )
+		PremultiplyAlpha( pixels.data(), pixels.size() / 4 );
+
+	BakedTexture texture{ GL_RGBA8, size, {} };
+	if ( m_compress )
+		texture.format = translucent ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	const int levelCount = GetMipLevelCount( size );
+	texture.levels.reserve( levelCount );
+
+	for ( int level = 0; level < levelCount; ++level )
+	{
+		const glm::ivec2 levelSize = GetMipLevelSize( size, level );
+
+		if ( texture.format == GL_RGBA8 )
+			texture.levels.push_back( pixels );
+		else
+			texture.levels.push_back( CompressImage( pixels.data(), levelSize.x, levelSize.y, levelSize.x * 4,
+													 texture.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? BlockFormat::BC1 : BlockFormat::BC3 ) );
+
+		if ( level + 1 < levelCount )
+		{
+			const glm::ivec2 halfSize = GetMipLevelSize( levelSize, 1 );
+			std::vector<std::uint8_t> half( static_cast<std::size_t>( halfSize.x ) * halfSize.y * 4 );
+			DownsampleRGBA( pixels.data(), levelSize.x, levelSize.y, static_cast<std::size_t>( levelSize.x ) * 4, half.data() );
+			pixels = std::move( half );
+		}
+	}
+
+	return texture;
+}
+
+std::filesystem::path CompressedTextureCache::GetPath( const std::uint64_t key ) const
+{
+	char fileName[ 32 ];
+	std::snprintf( fileName, sizeof( fileName ), "%016llx.ktx2", static_cast<unsigned long long>( key ) );
+	return m_directory / fileName;
+}
+
+CompressedTextureCache::Stats CompressedTextureCache::GetStats() const noexcept
+{
+	return Stats{ m_hits.load(), m_baked.load(), m_failed.load() };
+}
+
+void CompressedTextureCache::ResetStats() noexcept
+{
+	m_hits = 0;
+	m_baked = 0;
+	m_failed = 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class AssetData;
+
+// An image ready for upload: every mip level down to 1x1 in its GPU format, level 0 first.
+struct BakedTexture
+{
+	GLenum     format = 0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT or GL_RGBA8
+	glm::ivec2 size   = glm::ivec2( 0 );
+	std::vector<std::vector<std::uint8_t>> levels;
+
+	inline bool IsEmpty() const noexcept { return levels.empty(); }
+	std::size_t GetByteSize() const noexcept;
+};
+
+// Size of a mip level, at least 1x1.
+glm::ivec2 GetMipLevelSize( const glm::ivec2 size, const int level ) noexcept;
+// Number of levels of a full mip chain.
+int GetMipLevelCount( const glm::ivec2 size ) noexcept;
+// Bytes of one level of the given size in the format, see BakedTexture::format.
+std::size_t GetLevelByteSize( const GLenum format, const glm::ivec2 size ) noexcept;
+
+// A texture of the given format and size with every level zero: black, and transparent if the format has alpha.
+BakedTexture MakeClearTexture( const GLenum format, const glm::ivec2 size );
+
+// Converts a BC1 texture to BC3 so it can share an array or a cube map with translucent images.
+// Returns false if the texture cannot be brought to the format.
+bool PromoteTexture( BakedTexture& texture, const GLenum format );
+
+// Uploads every level to role ( GL_TEXTURE_2D or a cube map face ) of the texture bound to its target.
+void UploadTexture( const GLenum role, const BakedTexture& texture );
+// Uploads every level to one layer of the bound GL_TEXTURE_2D_ARRAY, whose storage has the texture's format and size.
+void UploadTextureLayer( const GLint layer, const BakedTexture& texture );
+
+// Images baked to block compressed textures with a full mip chain, cached on disk as KTX2 files.
+//
+// The first load of an image decodes it, builds the mip chain with a box filter and compresses every
+// level: BC1 if the image is opaque, BC3 with premultiplied alpha otherwise. Later loads read the KTX2 file and skip all of that.
+// The key is a 64-bit hash of the source file's bytes and the load options, so an edited image simply
+// misses. Without S3TC support the levels stay uncompressed RGBA8, the mip chain is still baked.
+class CompressedTextureCache
+{
+public:
+	enum class Resize : std::uint8_t
+	{
+		None,
+		NearestPowerOfTwo, // both dimensions to the nearest power of two, see TextureArraySet
+		Exact,
+	};
+
+	struct Stats
+	{
+		std::uint32_t hits   = 0;
+		std::uint32_t baked  = 0; // decoded and compressed, written to disk if the cache is writable
+		std::uint32_t failed = 0; // the image could not be loaded
+	};
+
+	// What Load would return, without the levels.
+	struct ImageInfo
+	{
+		GLenum     format = 0; // 0 if the image cannot be loaded
+		glm::ivec2 size   = glm::ivec2( 0 );
+	};
+
+	explicit CompressedTextureCache( std::filesystem::path directory ) : m_directory( std::move( directory ) ) {}
+
+	// Needs a current GL context to check for S3TC support.
+	void Init();
+
+	// Loads the image baked, empty if it cannot be loaded. Touches no GL state and may run on any thread.
+	// flipVertically: as in LoadImageRGBA, exactSize: the size to resample to with Resize::Exact.
+	BakedTexture Load( const std::filesystem::path& fileName, const bool flipVertically,
+					   const Resize resize = Resize::None, const glm::ivec2 exactSize = glm::ivec2( 0 ) ) const;
+
+	// The format and size Load would return, without decoding: from the header of the cached file on a hit,
+	// from the image header otherwise ( PNG and JPEG, other types are decoded ). On a miss an image with an
+	// alpha channel counts as translucent even if every pixel is opaque. May run on any thread.
+	ImageInfo Probe( const std::filesystem::path& fileName, const bool flipVertically,
+					 const Resize resize = Resize::None, const glm::ivec2 exactSize = glm::ivec2( 0 ) ) const;
+
+	inline bool IsCompressing() const noexcept { return m_compress; }
+	Stats GetStats() const noexcept;
+	void ResetStats() noexcept;
+
+private:
+	BakedTexture Bake( const std::filesystem::path& fileName, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const;
+	void Store( const std::filesystem::path& path, const BakedTexture& texture ) const;
+	std::uint64_t MakeKey( const AssetData& source, const bool flipVertically, const Resize resize, const glm::ivec2 exactSize ) const noexcept;
+	std::filesystem::path GetPath( const std::uint64_t key ) const;
+
+	std::filesystem::path m_directory;
+	bool m_compress = false;
+	bool m_writable = false;
+
+	mutable std::atomic<std::uint32_t> m_hits{ 0 }, m_baked{ 0 }, m_failed{ 0 };
+};
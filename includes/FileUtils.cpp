@@ -0,0 +1,39 @@
+#include "FileUtils.h"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+
+std::uint64_t HashBytes( std::uint64_t hash, const void* data, const std::size_t size ) noexcept
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>( data );
+	for ( std::size_t i = 0; i < size; ++i )
+	{
+		hash ^= bytes[ i ];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::error_code WriteFileAtomically( const std::filesystem::path& path, const std::function<bool( std::ostream& stream )>& write )
+{
+	static std::atomic<std::uint32_t> tempFileCounter{ 0 };
+
+	std::filesystem::path tempPath = path;
+	tempPath += "." + std::to_string( tempFileCounter++ ) + ".tmp";
+
+	std::error_code error;
+	{
+		std::ofstream stream( tempPath, std::ios::binary | std::ios::trunc );
+		if ( !stream || !write( stream ) || !stream.flush() ) error = std::make_error_code( std::errc::io_error );
+	}
+
+	if ( !error ) std::filesystem::rename( tempPath, path, error );
+
+	if ( error )
+	{
+		std::error_code removeError;
+		std::filesystem::remove( tempPath, removeError );
+	}
+	return error;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <system_error>
+
+// 64-bit FNV-1a. Start with FNV_OFFSET_BASIS, pass the result on to hash more bytes after.
+constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+std::uint64_t HashBytes( std::uint64_t hash, const void* data, const std::size_t size ) noexcept;
+
+// Writes the file through write into a temporary file next to path and renames it to path, so a crash or a
+// parallel reader never sees a truncated file. Every call has its own temporary name: if several threads write
+// the same path, one of the whole files wins. Fails if write returns false or the stream does; the temporary
+// file is removed then.
+std::error_code WriteFileAtomically( const std::filesystem::path& path, const std::function<bool( std::ostream& stream )>& write );
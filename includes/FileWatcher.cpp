@@ -0,0 +1,149 @@
+#include "FileWatcher.h"
+
+#include <SDL2/SDL_log.h>
+
+#if defined( __linux__ )
+	#include <cerrno>
+	#include <climits>
+	#include <cstring>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+#if defined( __linux__ )
+
+FileWatcher::FileWatcher()
+{
+	m_inotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( m_inotifyFD < 0 )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[FileWatcher] inotify_init1 failed: %s", std::strerror( errno ) );
+}
+
+FileWatcher::~FileWatcher()
+{
+	if ( m_inotifyFD >= 0 )
+		close( m_inotifyFD );
+}
+
+bool FileWatcher::Watch( const std::filesystem::path& directory )
+{
+	if ( m_inotifyFD < 0 ) return false;
+
+	const int watchDescriptor = inotify_add_watch( m_inotifyFD, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO );
+	if ( watchDescriptor < 0 )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[FileWatcher] Cannot watch %s: %s", directory.string().c_str(), std::strerror( errno ) );
+		return false;
+	}
+
+	m_watchedDirectories[ watchDescriptor ] = directory;
+	return true;
+}
+
+std::vector<std::filesystem::path> FileWatcher::Poll()
+{
+	std::set<std::filesystem::path> changed;
+
+	if ( m_inotifyFD >= 0 )
+	{
+		// the buffer must be aligned for inotify_event and hold at least one event with the longest name
+		alignas( inotify_event ) char buffer[ 16 * ( sizeof( inotify_event ) + NAME_MAX + 1 ) ];
+
+		for ( ;; )
+		{
+			const ssize_t length = read( m_inotifyFD, buffer, sizeof( buffer ) );
+			if ( length <= 0 ) break; // EAGAIN: nothing more to read
+
+			for ( ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>( buffer + offset );
+				offset += sizeof( inotify_event ) + event->len;
+
+				auto directory = m_watchedDirectories.find( event->wd );
+				if ( event->len == 0 || directory == m_watchedDirectories.end() || ( event->mask & IN_ISDIR ) ) continue;
+
+				changed.insert( ( directory->second / event->name ).lexically_normal() );
+			}
+		}
+	}
+
+	return std::vector<std::filesystem::path>( changed.begin(), changed.end() );
+}
+
+bool FileWatcher::IsNative() const noexcept
+{
+	return m_inotifyFD >= 0;
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+FileWatcher::Timestamps FileWatcher::Scan( const std::filesystem::path& directory )
+{
+	Timestamps timestamps;
+
+	std::error_code error;
+	for ( const auto& entry : std::filesystem::directory_iterator( directory, error ) )
+	{
+		if ( !entry.is_regular_file( error ) ) continue;
+
+		const auto writeTime = entry.last_write_time( error );
+		if ( !error )
+			timestamps[ entry.path().lexically_normal() ] = writeTime;
+	}
+
+	return timestamps;
+}
+
+bool FileWatcher::Watch( const std::filesystem::path& directory )
+{
+	std::error_code error;
+	if ( !std::filesystem::is_directory( directory, error ) )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[FileWatcher] Cannot watch %s: not a directory", directory.string().c_str() );
+		return false;
+	}
+
+	m_watchedDirectories[ directory ] = Scan( directory );
+	return true;
+}
+
+std::vector<std::filesystem::path> FileWatcher::Poll()
+{
+	std::vector<std::filesystem::path> changed;
+
+	const auto now = std::chrono::steady_clock::now();
+	if ( now - m_lastPoll < POLL_INTERVAL ) return changed;
+	m_lastPoll = now;
+
+	for ( auto& [ directory, timestamps ] : m_watchedDirectories )
+	{
+		Timestamps current = Scan( directory );
+
+		// new files and files with a different modification time
+		for ( const auto& [ path, writeTime ] : current )
+		{
+			auto previous = timestamps.find( path );
+			if ( previous == timestamps.end() || previous->second != writeTime )
+				changed.push_back( path );
+		}
+
+		timestamps = std::move( current );
+	}
+
+	return changed;
+}
+
+bool FileWatcher::IsNative() const noexcept
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+// Reports files that were written in a set of watched directories.
+//
+// On Linux it reads inotify events ( IN_CLOSE_WRITE, IN_MOVED_TO ), so a file is reported once the
+// writer has closed it, and editors that save through a temporary file and a rename work too.
+// Elsewhere it compares modification times, at most every POLL_INTERVAL.
+class FileWatcher
+{
+public:
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 500 };
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher( const FileWatcher& ) = delete;
+	FileWatcher& operator=( const FileWatcher& ) = delete;
+
+	// Watches the files directly inside the directory (not recursively). Returns false if it cannot.
+	bool Watch( const std::filesystem::path& directory );
+
+	// The files written since the last call, each once, as lexically normal directory / name paths.
+	// Never blocks.
+	std::vector<std::filesystem::path> Poll();
+
+	// inotify, not the modification time fallback
+	bool IsNative() const noexcept;
+
+private:
+#if defined( __linux__ )
+	int m_inotifyFD = -1;
+	std::map<int, std::filesystem::path> m_watchedDirectories; // by watch descriptor
+#else
+	using Timestamps = std::map<std::filesystem::path, std::filesystem::file_time_type>;
+
+	static Timestamps Scan( const std::filesystem::path& directory );
+
+	std::map<std::filesystem::path, Timestamps> m_watchedDirectories;
+	std::chrono::steady_clock::time_point m_lastPoll;
+#endif
+};
@@ -0,0 +1,113 @@
+#include "FrustumCulling.h"
+
+#if defined( __AVX__ )
+	#include <immintrin.h>
+	#define FRUSTUM_CULLING_AVX
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#include <emmintrin.h>
+	#define FRUSTUM_CULLING_SSE2
+#endif
+
+void SphereBatch::Clear() noexcept
+{
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+	m_radius.clear();
+}
+
+void SphereBatch::Reserve( const std::size_t count )
+{
+	m_x.reserve( count );
+	m_y.reserve( count );
+	m_z.reserve( count );
+	m_radius.reserve( count );
+}
+
+std::size_t SphereBatch::Add( const glm::vec3& center, const float radius )
+{
+	m_x.push_back( center.x );
+	m_y.push_back( center.y );
+	m_z.push_back( center.z );
+	m_radius.push_back( radius );
+	return m_x.size() - 1;
+}
+
+std::size_t CullSpheres( const FrustumPlanes& planes, const SphereBatch& spheres, std::vector<std::uint8_t>& visible )
+{
+	const std::size_t count = spheres.GetSize();
+	visible.assign( count, 0 );
+
+	const float* x = spheres.GetX();
+	const float* y = spheres.GetY();
+	const float* z = spheres.GetZ();
+	const float* r = spheres.GetRadius();
+
+	std::size_t visibleCount = 0;
+	std::size_t i = 0;
+
+#if defined( FRUSTUM_CULLING_AVX )
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		const __m256 cx = _mm256_loadu_ps( x + i );
+		const __m256 cy = _mm256_loadu_ps( y + i );
+		const __m256 cz = _mm256_loadu_ps( z + i );
+		const __m256 negRadius = _mm256_sub_ps( _mm256_setzero_ps(), _mm256_loadu_ps( r + i ) );
+
+		// inside as long as the signed distance is >= -radius for every plane
+		__m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+		for ( const glm::vec4& plane : planes )
+		{
+			__m256 distance = _mm256_add_ps( _mm256_mul_ps( cx, _mm256_set1_ps( plane.x ) ), _mm256_set1_ps( plane.w ) );
+			distance = _mm256_add_ps( distance, _mm256_mul_ps( cy, _mm256_set1_ps( plane.y ) ) );
+			distance = _mm256_add_ps( distance, _mm256_mul_ps( cz, _mm256_set1_ps( plane.z ) ) );
+			inside = _mm256_and_ps( inside, _mm256_cmp_ps( distance, negRadius, _CMP_GE_OQ ) );
+		}
+
+		const int mask = _mm256_movemask_ps( inside );
+		for ( std::size_t lane = 0; lane < 8; ++lane )
+		{
+			visible[ i + lane ] = static_cast<std::uint8_t>( ( mask >> lane ) & 1 );
+			visibleCount += visible[ i + lane ];
+		}
+	}
+#elif defined( FRUSTUM_CULLING_SSE2 )
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		const __m128 cx = _mm_loadu_ps( x + i );
+		const __m128 cy = _mm_loadu_ps( y + i );
+		const __m128 cz = _mm_loadu_ps( z + i );
+		const __m128 negRadius = _mm_sub_ps( _mm_setzero_ps(), _mm_loadu_ps( r + i ) );
+
+		// inside as long as the signed distance is >= -radius for every plane
+		__m128 inside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+		for ( const glm::vec4& plane : planes )
+		{
+			__m128 distance = _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( plane.x ) ), _mm_set1_ps( plane.w ) );
+			distance = _mm_add_ps( distance, _mm_mul_ps( cy, _mm_set1_ps( plane.y ) ) );
+			distance = _mm_add_ps( distance, _mm_mul_ps( cz, _mm_set1_ps( plane.z ) ) );
+			inside = _mm_and_ps( inside, _mm_cmpge_ps( distance, negRadius ) );
+		}
+
+		const int mask = _mm_movemask_ps( inside );
+		for ( std::size_t lane = 0; lane < 4; ++lane )
+		{
+			visible[ i + lane ] = static_cast<std::uint8_t>( ( mask >> lane ) & 1 );
+			visibleCount += visible[ i + lane ];
+		}
+	}
+#endif
+
+	// the remainder that does not fill a register, or everything without SIMD
+	for ( ; i < count; ++i )
+	{
+		bool inside = true;
+		for ( const glm::vec4& plane : planes )
+			inside = inside && ( plane.x * x[ i ] + plane.y * y[ i ] + plane.z * z[ i ] + plane.w >= -r[ i ] );
+
+		visible[ i ] = inside ? 1 : 0;
+		visibleCount += visible[ i ];
+	}
+
+	return visibleCount;
+}
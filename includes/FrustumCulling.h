@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Frustum planes as ( normal, distance ), normalized, pointing inwards: a point p is inside when
+// dot( normal, p ) + distance >= 0 for all six. See Camera::GetFrustumPlanes.
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+// Bounding spheres in structure-of-arrays layout, so a batch test can load 4 or 8 of them per register.
+class SphereBatch
+{
+public:
+	void Clear() noexcept;
+	void Reserve( const std::size_t count );
+
+	// Returns the index of the sphere, which is also its index in the visibility mask.
+	std::size_t Add( const glm::vec3& center, const float radius );
+
+	inline std::size_t GetSize() const noexcept { return m_x.size(); }
+
+	inline const float* GetX() const noexcept { return m_x.data(); }
+	inline const float* GetY() const noexcept { return m_y.data(); }
+	inline const float* GetZ() const noexcept { return m_z.data(); }
+	inline const float* GetRadius() const noexcept { return m_radius.data(); }
+
+private:
+	std::vector<float> m_x, m_y, m_z, m_radius;
+};
+
+// Tests every sphere of the batch against the planes. visible[ i ] becomes 1 if sphere i intersects
+// the frustum, 0 otherwise. Uses AVX when the build enables it, SSE2 otherwise, scalar code on
+// other architectures. Returns the number of visible spheres.
+std::size_t CullSpheres( const FrustumPlanes& planes, const SphereBatch& spheres, std::vector<std::uint8_t>& visible );
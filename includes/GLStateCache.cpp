@@ -0,0 +1,133 @@
+#include "GLStateCache.h"
+
+void GLStateCache::Invalidate() noexcept
+{
+	m_programID  = UNKNOWN;
+	m_vaoID      = UNKNOWN;
+	m_indirectBufferID = UNKNOWN;
+	m_activeUnit = UNKNOWN;
+	for ( auto& unit : m_textures )
+		unit.fill( UNKNOWN );
+
+	m_blend     = Toggle::Unknown;
+	m_cullFace  = Toggle::Unknown;
+	m_depthFunc = GL_NONE;
+}
+
+void GLStateCache::UseProgram( const GLuint programID ) noexcept
+{
+	if ( m_programID == programID )
+	{
+		++m_stats.skipped;
+		return;
+	}
+	m_programID = programID;
+	glUseProgram( programID );
+	++m_stats.issued;
+}
+
+void GLStateCache::BindVertexArray( const GLuint vaoID ) noexcept
+{
+	if ( m_vaoID == vaoID )
+	{
+		++m_stats.skipped;
+		return;
+	}
+	m_vaoID = vaoID;
+	glBindVertexArray( vaoID );
+	++m_stats.issued;
+}
+
+void GLStateCache::BindDrawIndirectBuffer( const GLuint bufferID ) noexcept
+{
+	if ( m_indirectBufferID == bufferID )
+	{
+		++m_stats.skipped;
+		return;
+	}
+	m_indirectBufferID = bufferID;
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, bufferID );
+	++m_stats.issued;
+}
+
+int GLStateCache::GetTargetIndex( const GLenum target ) noexcept
+{
+	switch ( target )
+	{
+	case GL_TEXTURE_2D:       return TARGET_2D;
+	case GL_TEXTURE_2D_ARRAY: return TARGET_2D_ARRAY;
+	case GL_TEXTURE_CUBE_MAP: return TARGET_CUBE_MAP;
+	default:                  return -1;
+	}
+}
+
+void GLStateCache::BindTexture( const GLuint unit, const GLenum target, const GLuint textureID ) noexcept
+{
+	const int targetIndex = GetTargetIndex( target );
+
+	// untracked unit or target: bind it and forget what the active unit was
+	if ( unit >= MAX_TEXTURE_UNITS || targetIndex < 0 )
+	{
+		glActiveTexture( GL_TEXTURE0 + unit );
+		glBindTexture( target, textureID );
+		m_activeUnit = UNKNOWN;
+		m_stats.issued += 2;
+		return;
+	}
+
+	GLuint& shadow = m_textures[ unit ][ targetIndex ];
+	if ( shadow == textureID )
+	{
+		++m_stats.skipped;
+		return;
+	}
+
+	if ( m_activeUnit != unit )
+	{
+		m_activeUnit = unit;
+		glActiveTexture( GL_TEXTURE0 + unit );
+		++m_stats.issued;
+	}
+
+	shadow = textureID;
+	glBindTexture( target, textureID );
+	++m_stats.issued;
+}
+
+void GLStateCache::SetToggle( Toggle& shadow, const GLenum cap, const bool enabled ) noexcept
+{
+	const Toggle wanted = enabled ? Toggle::On : Toggle::Off;
+	if ( shadow == wanted )
+	{
+		++m_stats.skipped;
+		return;
+	}
+	shadow = wanted;
+	if ( enabled )
+		glEnable( cap );
+	else
+		glDisable( cap );
+	++m_stats.issued;
+}
+
+void GLStateCache::SetBlend( const bool enabled ) noexcept
+{
+	SetToggle( m_blend, GL_BLEND, enabled );
+}
+
+void GLStateCache::SetCullFace( const bool enabled ) noexcept
+{
+	SetToggle( m_cullFace, GL_CULL_FACE, enabled );
+}
+
+void GLStateCache::SetDepthFunc( const GLenum func ) noexcept
+{
+	if ( m_depthFunc == func )
+	{
+		++m_stats.skipped;
+		return;
+	}
+	m_depthFunc = func;
+	glDepthFunc( func );
+	++m_stats.issued;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// Shadow copy of the GL state the renderer touches. Every setter compares against the shadow and
+// only calls GL when the value differs, the real state is never queried.
+// Anything that changes GL state behind the cache's back (ImGui, shader reload, ...) must be
+// followed by Invalidate(), after which the next set of every state is issued unconditionally.
+class GLStateCache
+{
+public:
+	static constexpr GLuint MAX_TEXTURE_UNITS = 8;
+
+	struct Stats
+	{
+		std::uint32_t issued  = 0; // state changes that reached GL
+		std::uint32_t skipped = 0; // redundant changes filtered out
+	};
+
+	GLStateCache() { Invalidate(); }
+
+	void Invalidate() noexcept;
+
+	void UseProgram( const GLuint programID ) noexcept;
+	void BindVertexArray( const GLuint vaoID ) noexcept;
+	void BindTexture( const GLuint unit, const GLenum target, const GLuint textureID ) noexcept;
+	void BindDrawIndirectBuffer( const GLuint bufferID ) noexcept;
+
+	void SetBlend( const bool enabled ) noexcept;
+	void SetCullFace( const bool enabled ) noexcept;
+	void SetDepthFunc( const GLenum func ) noexcept;
+
+	inline const Stats& GetStats() const noexcept { return m_stats; }
+	inline void ResetStats() noexcept { m_stats = Stats{}; }
+
+private:
+	// Tri-state flag so the first set after Invalidate() always goes through.
+	enum class Toggle : std::uint8_t { Unknown, Off, On };
+
+	enum TextureTargetIndex { TARGET_2D, TARGET_2D_ARRAY, TARGET_CUBE_MAP, TARGET_COUNT };
+	static int GetTargetIndex( const GLenum target ) noexcept;
+
+	void SetToggle( Toggle& shadow, const GLenum cap, const bool enabled ) noexcept;
+
+	static constexpr GLuint UNKNOWN = ~0u;
+
+	GLuint m_programID;
+	GLuint m_vaoID;
+	GLuint m_indirectBufferID;
+	GLuint m_activeUnit;
+	std::array<std::array<GLuint, TARGET_COUNT>, MAX_TEXTURE_UNITS> m_textures;
+
+	Toggle m_blend;
+	Toggle m_cullFace;
+	GLenum m_depthFunc;
+
+	Stats m_stats;
+};
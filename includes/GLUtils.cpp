@@ -1,6 +1,10 @@
 #include "GLUtils.hpp"
+#include "AssetPack.h"
+#include "CompressedTextureCache.h"
+#include "ImageOps.h"
 
 #include <stdio.h>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -23,32 +27,42 @@ void loadShader( const GLuint loadedShader, const std::filesystem::path& _fileNa
 		return;
 	}
 
-	// shaderkod betoltese _fileName fajlbol
-	std::string shaderCode = "";
-
-	// _fileName megnyitasa
-	std::ifstream shaderStream( _fileName );
-	if ( !shaderStream.is_open() )
+	// a csomagból másolás nélkül, a szöveg mögött mindig van lezáró nulla
+	const AssetData shaderCode = ReadAsset( _fileName );
+	if ( !shaderCode.IsValid() )
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
 						SDL_LOG_PRIORITY_ERROR,
-						"Error while loading shader %s!", _fileName );
+						"Error while loading shader %s!", _fileName.string().c_str() );
 		return;
 	}
 
-	// file tartalmanak betoltese a shaderCode string-be
-	std::string line = "";
-	while ( std::getline( shaderStream, line ) )
+	compileShaderFromSource( loadedShader, shaderCode.GetText() );
+}
+
+std::string loadShaderSource( const std::filesystem::path& _fileName )
+{
+	// shaderkod betoltese _fileName fajlbol, vagy az AssetPack-bol, ha benne van
+	const AssetData shaderCode = ReadAsset( _fileName );
+	if ( !shaderCode.IsValid() )
 	{
-		shaderCode += line + "\n";
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+						SDL_LOG_PRIORITY_ERROR,
+						"Error while loading shader %s!", _fileName.string().c_str() );
 	}
 
-	shaderStream.close();
-
-	compileShaderFromSource( loadedShader, shaderCode );
+	return std::string( shaderCode.GetText() );
 }
 
 void compileShaderFromSource( const GLuint loadedShader, std::string_view shaderCode )
+{
+	submitShaderSource( loadedShader, shaderCode );
+
+	// ellenorizzuk, h minden rendben van-e
+	checkShaderCompileStatus( loadedShader );
+}
+
+void submitShaderSource( const GLuint loadedShader, std::string_view shaderCode )
 {
 	// kod hozzarendelese a shader-hez
 	const char* sourcePointer = shaderCode.data();
@@ -58,8 +72,10 @@ void compileShaderFromSource( const GLuint loadedShader, std::string_view shader
 
 	// shader leforditasa
 	glCompileShader( loadedShader );
+}
 
-	// ellenorizzuk, h minden rendben van-e
+bool checkShaderCompileStatus( const GLuint loadedShader )
+{
 	GLint result = GL_FALSE;
 	int infoLogLength;
 
@@ -77,10 +93,30 @@ void compileShaderFromSource( const GLuint loadedShader, std::string_view shader
 						( result ) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR,
 						"[glLinkProgram] Shader compile error: %s" , ErrorMessage.data() );
 	}
+
+	return GL_FALSE != result;
 }
 
+bool checkProgramLinkStatus( const GLuint programID )
+{
+	// linkeles ellenorzese
+	GLint infoLogLength = 0, result = 0;
 
-void AssembleProgram( const GLuint programID, const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename )
+	glGetProgramiv(programID, GL_LINK_STATUS, &result);
+	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if (GL_FALSE == result || infoLogLength != 0 )
+	{
+		std::string ErrorMessage(infoLogLength, '\0');
+		glGetProgramInfoLog(programID, infoLogLength, nullptr, ErrorMessage.data() );
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+						( result ) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR,
+						"[glLinkProgram] Shader linking error: %s" , ErrorMessage.data() );
+	}
+
+	return GL_FALSE != result;
+}
+
+void AssembleProgram( const GLuint programID, const std::vector<ShaderStageFile>& stages )
 {
 	//
 	// shaderek betöltése
@@ -88,105 +124,171 @@ void AssembleProgram( const GLuint programID, const std::filesystem::path& vs_fi
 
 	if ( programID == 0 ) return;
 
-	GLuint vs_ID = glCreateShader( GL_VERTEX_SHADER   );
-	GLuint fs_ID = glCreateShader( GL_FRAGMENT_SHADER );
+	std::vector<GLuint> shaderIDs;
+	shaderIDs.reserve( stages.size() );
 
-	if ( vs_ID == 0 || fs_ID == 0 )
+	for ( const ShaderStageFile& stage : stages )
 	{
-		SDL_SetError("Error while initing shaders (glCreateShader)!");
-	}
+		GLuint shaderID = glCreateShader( stage.type );
 
-	loadShader(vs_ID, vs_filename );
-	loadShader(fs_ID, fs_filename );
+		if ( shaderID == 0 )
+		{
+			SDL_SetError("Error while initing shaders (glCreateShader)!");
+		}
 
-	// adjuk hozzá a programhoz a shadereket
-	glAttachShader(programID, vs_ID);
-	glAttachShader(programID, fs_ID);
+		loadShader( shaderID, stage.fileName );
+
+		// adjuk hozzá a programhoz a shadert
+		glAttachShader( programID, shaderID );
+		shaderIDs.push_back( shaderID );
+	}
 
 	// illesszük össze a shadereket (kimenő-bemenő változók összerendelése stb.)
 	glLinkProgram(programID);
 
-	// linkeles ellenorzese
-	GLint infoLogLength = 0, result = 0;
-
-	glGetProgramiv(programID, GL_LINK_STATUS, &result);
-	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
-	if (GL_FALSE == result || infoLogLength != 0 )
-	{
-		std::string ErrorMessage(infoLogLength, '\0');
-		glGetProgramInfoLog(programID, infoLogLength, nullptr, ErrorMessage.data() );
-		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
-						( result ) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR,
-						"[glLinkProgram] Shader linking error: %s" , ErrorMessage.data() );
-	}
+	checkProgramLinkStatus( programID );
 
 	// mar nincs ezekre szukseg
-	glDeleteShader( vs_ID );
-	glDeleteShader( fs_ID );
+	for ( GLuint shaderID : shaderIDs )
+		glDeleteShader( shaderID );
+}
+
+void AssembleProgram( const GLuint programID, const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename )
+{
+	AssembleProgram( programID, { { GL_VERTEX_SHADER, vs_filename }, { GL_FRAGMENT_SHADER, fs_filename } } );
+}
+
+void AssembleComputeProgram( const GLuint programID, const std::filesystem::path& cs_filename )
+{
+	AssembleProgram( programID, { { GL_COMPUTE_SHADER, cs_filename } } );
 }
 
-static void invert_image_RGBA(int pitchInPixels, int height, Uint32* image_pixels)
+// A leggyakoribb bájtsorrendeket a vektorizált ImageOps rutinokkal alakítjuk RGBA-ra, a többit az SDL-re bízzuk
+static SDL_Surface* ConvertToRGBA32( SDL_Surface* image )
 {
-	int height_div_2 = height / 2;
-	Uint32* lower_data  =image_pixels;
-	Uint32* higher_data =image_pixels + ( height - 1 ) * pitchInPixels;
+	const Uint32 sourceFormat = image->format->format;
+	const bool plain = !SDL_HasColorKey( image ) && !SDL_MUSTLOCK( image );
 
-	for ( int index = 0; index < height_div_2; index++ )
+	if ( plain && sourceFormat == SDL_PIXELFORMAT_RGBA32 )
+		return image;
+
+	if ( !plain || ( sourceFormat != SDL_PIXELFORMAT_RGB24 && sourceFormat != SDL_PIXELFORMAT_BGRA32 && sourceFormat != SDL_PIXELFORMAT_ABGR32 ) )
 	{
-		for ( int rowIndex = 0; rowIndex < pitchInPixels; rowIndex++ )
-		{
-			*lower_data ^= higher_data[ rowIndex ];
-			higher_data[ rowIndex ] ^= *lower_data;
-			*lower_data ^= higher_data[ rowIndex ];
+		SDL_Surface* converted = SDL_ConvertSurfaceFormat( image, SDL_PIXELFORMAT_RGBA32, 0 );
+		SDL_FreeSurface( image );
+		return converted;
+	}
 
-			lower_data++;
+	SDL_Surface* converted = SDL_CreateRGBSurfaceWithFormat( 0, image->w, image->h, 32, SDL_PIXELFORMAT_RGBA32 );
+	if ( converted != nullptr )
+	{
+		for ( int row = 0; row < image->h; ++row )
+		{
+			const std::uint8_t* source = static_cast<const std::uint8_t*>( image->pixels ) + row * image->pitch;
+			std::uint8_t* target = static_cast<std::uint8_t*>( converted->pixels ) + row * converted->pitch;
+			switch ( sourceFormat )
+			{
+			case SDL_PIXELFORMAT_RGB24:  ExpandRGBToRGBA( source, target, image->w ); break;
+			case SDL_PIXELFORMAT_BGRA32: SwizzleBGRAToRGBA( source, target, image->w ); break;
+			case SDL_PIXELFORMAT_ABGR32: SwizzleABGRToRGBA( source, target, image->w ); break;
+			}
 		}
-		higher_data -= pitchInPixels;
 	}
+	SDL_FreeSurface( image );
+	return converted;
 }
 
-void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, GLenum Type, GLenum Role )
+SDL_Surface* LoadImageRGBA( const std::filesystem::path& fileName, bool flipVertically )
 {
-	if ( tex == 0 )
+	// A fájl bájtjai: az AssetPack-ból másolás nélkül, ha benne van, különben a lemezről
+	const AssetData asset = ReadAsset( fileName );
+
+	if ( !asset.IsValid() )
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
 						SDL_LOG_PRIORITY_ERROR,
-						"Texture object needs to be inited before loading %s !", fileName.string().c_str());
-		return;
+						"[TextureFromFile] Error while loading texture: %s", fileName.string().c_str());
+		return nullptr;
 	}
 
-	// Kép betöltése
-	SDL_Surface* loaded_img = IMG_Load(fileName.string().c_str());
+	// Előre dekódolt kép a csomagban: csak egy másolás, közben tükrözünk
+	if ( asset.GetEncoding() == AssetEncoding::ImageRGBA )
+	{
+		const glm::ivec2 size = asset.GetImageSize();
+		SDL_Surface* decodedSurf = SDL_CreateRGBSurfaceWithFormat( 0, size.x, size.y, 32, SDL_PIXELFORMAT_RGBA32 );
+		if ( decodedSurf == nullptr )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+							SDL_LOG_PRIORITY_ERROR,
+							"[TextureFromFile] Error while processing texture");
+			return nullptr;
+		}
+
+		for ( int row = 0; row < size.y; ++row )
+		{
+			const int sourceRow = flipVertically ? size.y - 1 - row : row;
+			std::memcpy( static_cast<std::uint8_t*>( decodedSurf->pixels ) + row * decodedSurf->pitch,
+						 asset.GetData() + static_cast<std::size_t>( sourceRow ) * size.x * 4, static_cast<std::size_t>( size.x ) * 4 );
+		}
+		return decodedSurf;
+	}
+
+	// Kép dekódolása a memóriából, a típust a kiterjesztés is jelzi
+	const std::string extension = fileName.extension().string();
+	SDL_Surface* loaded_img = IMG_LoadTyped_RW( SDL_RWFromConstMem( asset.GetData(), static_cast<int>( asset.GetSize() ) ), 1, extension.empty() ? nullptr : extension.c_str() + 1 );
 
 	if (loaded_img == nullptr)
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
 						SDL_LOG_PRIORITY_ERROR,
 						"[TextureFromFile] Error while loading texture: %s", fileName.string().c_str());
-		return;
+		return nullptr;
 	}
 
-	// Uint32-ben tárolja az SDL a színeket, ezért számít a bájtsorrend
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-	Uint32 format = SDL_PIXELFORMAT_ABGR8888;
-#else
-	Uint32 format = SDL_PIXELFORMAT_RGBA8888;
-#endif
-
-	// Átalakítás 32bit RGBA formátumra, ha nem abban volt
-	SDL_Surface* formattedSurf = SDL_ConvertSurfaceFormat(loaded_img, format, 0);
-	SDL_FreeSurface(loaded_img);
+	// Átalakítás 32bit RGBA formátumra ( bájtsorrendben R, G, B, A ), ha nem abban volt
+	SDL_Surface* formattedSurf = ConvertToRGBA32( loaded_img );
 	if (formattedSurf == nullptr)
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
 						SDL_LOG_PRIORITY_ERROR,
 						"[TextureFromFile] Error while processing texture");
-		return;
+		return nullptr;
 	}
 
 	// Áttérés SDL koordinátarendszerről ( (0,0) balfent ) OpenGL textúra-koordinátarendszerre ( (0,0) ballent )
-	if ( Type != GL_TEXTURE_CUBE_MAP && Type != GL_TEXTURE_CUBE_MAP_ARRAY )
-		invert_image_RGBA( formattedSurf->pitch / sizeof( Uint32 ), formattedSurf->h, reinterpret_cast<Uint32*>( formattedSurf->pixels ) );
+	if ( flipVertically )
+		FlipImageRows( static_cast<std::uint8_t*>( formattedSurf->pixels ), formattedSurf->pitch, formattedSurf->h );
+
+	return formattedSurf;
+}
+
+void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, GLenum Type, GLenum Role, const CompressedTextureCache* cache )
+{
+	if ( tex == 0 )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+						SDL_LOG_PRIORITY_ERROR,
+						"Texture object needs to be inited before loading %s !", fileName.string().c_str());
+		return;
+	}
+
+	const bool flipVertically = Type != GL_TEXTURE_CUBE_MAP && Type != GL_TEXTURE_CUBE_MAP_ARRAY;
+
+	// előre sütött, tömörített változat a mipmap-ekkel együtt
+	if ( cache != nullptr )
+	{
+		const BakedTexture baked = cache->Load( fileName, flipVertically );
+		if ( !baked.IsEmpty() )
+		{
+			glBindTexture( Type, tex );
+			UploadTexture( Role, baked );
+			glBindTexture( Type, 0 );
+		}
+		return;
+	}
+
+	SDL_Surface* formattedSurf = LoadImageRGBA( fileName, flipVertically );
+	if ( formattedSurf == nullptr ) return;
 
 	glBindTexture(Type, tex);
 	glTexImage2D(
@@ -206,13 +308,35 @@ void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, G
 	SDL_FreeSurface(formattedSurf);
 }
 
-void SetupTextureSampling( GLenum Target, GLuint textureID, bool generateMipMap )
+SDL_Surface* ResampleImageRGBA( SDL_Surface* image, int width, int height )
+{
+	if ( image == nullptr || ( image->w == width && image->h == height ) ) return image;
+
+	SDL_Surface* scaledSurf = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, image->format->format );
+	if ( scaledSurf == nullptr )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+						SDL_LOG_PRIORITY_ERROR,
+						"[ResampleImageRGBA] Error while resampling image: %s", SDL_GetError());
+		SDL_FreeSurface( image );
+		return nullptr;
+	}
+
+	// átlátszóságot is másoljuk, ne keverjük
+	SDL_SetSurfaceBlendMode( image, SDL_BLENDMODE_NONE );
+	SDL_BlitScaled( image, nullptr, scaledSurf, nullptr );
+	SDL_FreeSurface( image );
+
+	return scaledSurf;
+}
+
+void SetupTextureSampling( GLenum Target, GLuint textureID, bool generateMipMap, bool hasMipMaps )
 {
 	// mintavételezés beállításai
 	glBindTexture( Target, textureID );
 	if ( generateMipMap ) glGenerateMipmap( Target ); // Mipmap generálása
 	glTexParameteri( Target, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); // bilineáris szürés nagyításkor (ez az alapértelmezett)
-	glTexParameteri( Target, GL_TEXTURE_MIN_FILTER, generateMipMap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR ); // trilineáris szűrés a mipmap-ekböl kicsinyítéskor
+	glTexParameteri( Target, GL_TEXTURE_MIN_FILTER, hasMipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR ); // trilineáris szűrés a mipmap-ekböl kicsinyítéskor
 	// mi legyen az eredmény, ha a textúrán kívülröl próbálunk mintát venni?
 	glTexParameteri( Target, GL_TEXTURE_WRAP_S, GL_REPEAT ); // vízszintesen
 	glTexParameteri( Target, GL_TEXTURE_WRAP_T, GL_REPEAT ); // függölegesen
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+struct SDL_Surface;
+
 /* 
 
 Az http://www.opengl-tutorial.org/ oldal alapján.
@@ -36,15 +40,42 @@ struct Vertex
 // Segéd függvények
 
 void loadShader( const GLuint loadedShader, const std::filesystem::path& _fileName );
+std::string loadShaderSource( const std::filesystem::path& _fileName );
 void compileShaderFromSource( const GLuint loadedShader, std::string_view shaderCode );
 
+// A fordítás (linkelés) elindítása és az eredmény lekérdezése külön, hogy a driver
+// a kettő között dolgozhasson (GL_KHR_parallel_shader_compile). A lekérdezés a végéig vár.
+void submitShaderSource( const GLuint loadedShader, std::string_view shaderCode );
+bool checkShaderCompileStatus( const GLuint loadedShader );
+bool checkProgramLinkStatus( const GLuint programID );
+
+// egy shader fokozat: típusa (GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, ...) és a forrásfájl
+struct ShaderStageFile
+{
+	GLenum                type;
+	std::filesystem::path fileName;
+};
+
+// Tetszőleges fokozatokból álló program (pl. vertex + tessellation control + evaluation + fragment)
+void AssembleProgram( const GLuint programID, const std::vector<ShaderStageFile>& stages );
 void AssembleProgram( const GLuint programID, const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename );
+void AssembleComputeProgram( const GLuint programID, const std::filesystem::path& cs_filename );
+
+class CompressedTextureCache;
 
-void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, GLenum Type, GLenum Role );
+// Ha van cache, onnan tölt (tömörítve, az összes mipmap szinttel), akkor a SetupTextureSampling-nek generateMipMap = false, hasMipMaps = true kell.
+void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, GLenum Type, GLenum Role, const CompressedTextureCache* cache = nullptr );
 
 inline void TextureFromFile( const GLuint tex, const std::filesystem::path& fileName, GLenum Type = GL_TEXTURE_2D ) { TextureFromFile( tex, fileName, Type, Type ); }
 
-void SetupTextureSampling( GLenum Target, GLuint textureID, bool generateMipMap = true );
+// Kép betöltése 32 bites RGBA SDL_Surface-be, NULL hiba esetén. A hívó szabadítja fel (SDL_FreeSurface).
+SDL_Surface* LoadImageRGBA( const std::filesystem::path& fileName, bool flipVertically );
+// A képet width x height méretűre skálázza. Az eredeti surface-t felszabadítja, az újat adja vissza.
+SDL_Surface* ResampleImageRGBA( SDL_Surface* image, int width, int height );
+
+void SetupTextureSampling( GLenum Target, GLuint textureID, bool generateMipMap, bool hasMipMaps );
+// hasMipMaps = generateMipMap
+inline void SetupTextureSampling( GLenum Target, GLuint textureID, bool generateMipMap = true ) { SetupTextureSampling( Target, textureID, generateMipMap, generateMipMap ); }
 
 template<typename VertexT>
 struct MeshObject
@@ -70,8 +101,10 @@ struct VertexAttributeDescriptor
 	GLenum         glType = GL_NONE;
 };
 
+// A tömbök bárhonnan jöhetnek, pl. egy memóriába map-elt fájlból (MeshCache).
 template <typename VertexT>
-[[nodiscard]] OGLObject CreateGLObjectFromMesh( const MeshObject<VertexT>& mesh, std::initializer_list<VertexAttributeDescriptor> vertexAttrDescList )
+[[nodiscard]] OGLObject CreateGLObjectFromMesh( const VertexT* vertices, const std::size_t vertexCount, const GLuint* indices, const std::size_t indexCount,
+												std::initializer_list<VertexAttributeDescriptor> vertexAttrDescList )
 {
 	OGLObject meshGPU = { 0 };
 
@@ -86,16 +119,16 @@ template <typename VertexT>
 
 	// töltsük fel adatokkal az aktív VBO-t
 	glBufferData(GL_ARRAY_BUFFER,	// az aktív VBO-ba töltsünk adatokat
-				  mesh.vertexArray.size() * sizeof(VertexT),		// ennyi bájt nagyságban
-				  mesh.vertexArray.data(),	// erről a rendszermemóriabeli címről olvasva
+				  vertexCount * sizeof(VertexT),		// ennyi bájt nagyságban
+				  vertices,	// erről a rendszermemóriabeli címről olvasva
 				  GL_STATIC_DRAW);	// úgy, hogy a VBO-nkba nem tervezünk ezután írni és minden kirajzoláskor felhasnzáljuk a benne lévő adatokat
 
 	// index puffer létrehozása
 	glGenBuffers(1, &meshGPU.iboID);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshGPU.iboID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexArray.size() * sizeof(GLuint), mesh.indexArray.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices, GL_STATIC_DRAW);
 
-	meshGPU.count = static_cast<GLsizei>(mesh.indexArray.size());
+	meshGPU.count = static_cast<GLsizei>(indexCount);
 
 	for ( const auto& vertexAttrDesc: vertexAttrDescList )
 	{
@@ -117,5 +150,11 @@ template <typename VertexT>
 	return meshGPU;
 }
 
+template <typename VertexT>
+[[nodiscard]] OGLObject CreateGLObjectFromMesh( const MeshObject<VertexT>& mesh, std::initializer_list<VertexAttributeDescriptor> vertexAttrDescList )
+{
+	return CreateGLObjectFromMesh( mesh.vertexArray.data(), mesh.vertexArray.size(), mesh.indexArray.data(), mesh.indexArray.size(), vertexAttrDescList );
+}
+
 void CleanOGLObject( OGLObject& ObjectGPU );
 
@@ -0,0 +1,311 @@
+#include "ImageOps.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined( __AVX2__ )
+	#include <immintrin.h>
+	#define IMAGE_OPS_AVX2
+	#define IMAGE_OPS_SSSE3
+	#define IMAGE_OPS_SSE2
+#elif defined( __SSSE3__ )
+	#include <tmmintrin.h>
+	#define IMAGE_OPS_SSSE3
+	#define IMAGE_OPS_SSE2
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#include <emmintrin.h>
+	#define IMAGE_OPS_SSE2
+#endif
+
+namespace
+{
+	std::uint8_t DivideBy255( const unsigned value ) noexcept
+	{
+		// exact round( value / 255 ) for value <= 255 * 255, the same as the SIMD paths
+		const unsigned rounded = value + 128;
+		return static_cast<std::uint8_t>( ( rounded + ( rounded >> 8 ) ) >> 8 );
+	}
+
+#if defined( IMAGE_OPS_SSE2 )
+	__m128i DivideBy255( const __m128i value ) noexcept
+	{
+		const __m128i rounded = _mm_add_epi16( value, _mm_set1_epi16( 128 ) );
+		return _mm_srli_epi16( _mm_add_epi16( rounded, _mm_srli_epi16( rounded, 8 ) ), 8 );
+	}
+
+	// two pixels widened to 16 bits: alpha in every channel but the alpha itself, which gets 255
+	__m128i GetPremultiplier( const __m128i pixels ) noexcept
+	{
+		const __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( pixels, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		const __m128i alphaLanes = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+		return _mm_or_si128( _mm_andnot_si128( alphaLanes, alpha ), _mm_and_si128( alphaLanes, _mm_set1_epi16( 255 ) ) );
+	}
+#endif
+
+#if defined( IMAGE_OPS_AVX2 )
+	__m256i DivideBy255( const __m256i value ) noexcept
+	{
+		const __m256i rounded = _mm256_add_epi16( value, _mm256_set1_epi16( 128 ) );
+		return _mm256_srli_epi16( _mm256_add_epi16( rounded, _mm256_srli_epi16( rounded, 8 ) ), 8 );
+	}
+
+	__m256i GetPremultiplier( const __m256i pixels ) noexcept
+	{
+		const __m256i alpha = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( pixels, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		const __m256i alphaLanes = _mm256_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0 );
+		return _mm256_or_si256( _mm256_andnot_si256( alphaLanes, alpha ), _mm256_and_si256( alphaLanes, _mm256_set1_epi16( 255 ) ) );
+	}
+#endif
+
+	// the byte order of one RGBA pixel after the swizzle, as source byte indices
+	template <int B0, int B1, int B2, int B3>
+	void SwizzleScalar( const std::uint8_t* source, std::uint8_t* target, const std::size_t begin, const std::size_t pixelCount ) noexcept
+	{
+		for ( std::size_t i = begin; i < pixelCount; ++i )
+		{
+			const std::uint8_t pixel[ 4 ] = { source[ i * 4 ], source[ i * 4 + 1 ], source[ i * 4 + 2 ], source[ i * 4 + 3 ] };
+			target[ i * 4 ]     = pixel[ B0 ];
+			target[ i * 4 + 1 ] = pixel[ B1 ];
+			target[ i * 4 + 2 ] = pixel[ B2 ];
+			target[ i * 4 + 3 ] = pixel[ B3 ];
+		}
+	}
+
+#if defined( IMAGE_OPS_SSSE3 )
+	template <int B0, int B1, int B2, int B3>
+	std::size_t SwizzleShuffle( const std::uint8_t* source, std::uint8_t* target, const std::size_t pixelCount ) noexcept
+	{
+		std::size_t i = 0;
+	#if defined( IMAGE_OPS_AVX2 )
+		const __m256i mask256 = _mm256_setr_epi8( B0, B1, B2, B3, 4 + B0, 4 + B1, 4 + B2, 4 + B3, 8 + B0, 8 + B1, 8 + B2, 8 + B3, 12 + B0, 12 + B1, 12 + B2, 12 + B3,
+												  B0, B1, B2, B3, 4 + B0, 4 + B1, 4 + B2, 4 + B3, 8 + B0, 8 + B1, 8 + B2, 8 + B3, 12 + B0, 12 + B1, 12 + B2, 12 + B3 );
+		for ( ; i + 8 <= pixelCount; i += 8 )
+		{
+			const __m256i pixels = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( source + i * 4 ) );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( target + i * 4 ), _mm256_shuffle_epi8( pixels, mask256 ) );
+		}
+	#endif
+		const __m128i mask = _mm_setr_epi8( B0, B1, B2, B3, 4 + B0, 4 + B1, 4 + B2, 4 + B3, 8 + B0, 8 + B1, 8 + B2, 8 + B3, 12 + B0, 12 + B1, 12 + B2, 12 + B3 );
+		for ( ; i + 4 <= pixelCount; i += 4 )
+		{
+			const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + i * 4 ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( target + i * 4 ), _mm_shuffle_epi8( pixels, mask ) );
+		}
+		return i;
+	}
+#endif
+}
+
+const char* GetImageOpsInstructionSet() noexcept
+{
+#if defined( IMAGE_OPS_AVX2 )
+	return "AVX2";
+#elif defined( IMAGE_OPS_SSSE3 )
+	return "SSSE3";
+#elif defined( IMAGE_OPS_SSE2 )
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+void FlipImageRows( std::uint8_t* pixels, const std::size_t pitch, const int height ) noexcept
+{
+	for ( int row = 0; row < height / 2; ++row )
+	{
+		std::uint8_t* upper = pixels + row * pitch;
+		std::uint8_t* lower = pixels + ( height - 1 - row ) * pitch;
+		std::size_t i = 0;
+
+#if defined( IMAGE_OPS_AVX2 )
+		for ( ; i + 32 <= pitch; i += 32 )
+		{
+			const __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( upper + i ) );
+			const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( lower + i ) );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( upper + i ), b );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( lower + i ), a );
+		}
+#endif
+#if defined( IMAGE_OPS_SSE2 )
+		for ( ; i + 16 <= pitch; i += 16 )
+		{
+			const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( upper + i ) );
+			const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( lower + i ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( upper + i ), b );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( lower + i ), a );
+		}
+#endif
+		for ( ; i < pitch; ++i )
+			std::swap( upper[ i ], lower[ i ] );
+	}
+}
+
+void ExpandRGBToRGBA( const std::uint8_t* rgb, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept
+{
+	std::size_t i = 0;
+
+#if defined( IMAGE_OPS_SSSE3 )
+	// a load reads 16 bytes for 4 pixels, so the last few pixels are left to the scalar loop
+	const __m128i mask = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m128i opaque = _mm_set1_epi32( static_cast<int>( 0xFF000000u ) );
+	#if defined( IMAGE_OPS_AVX2 )
+	const __m256i mask256 = _mm256_broadcastsi128_si256( mask );
+	const __m256i opaque256 = _mm256_set1_epi32( static_cast<int>( 0xFF000000u ) );
+	for ( ; i + 10 <= pixelCount; i += 8 )
+	{
+		const __m128i low  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( rgb + i * 3 ) );
+		const __m128i high = _mm_loadu_si128( reinterpret_cast<const __m128i*>( rgb + i * 3 + 12 ) );
+		const __m256i pixels = _mm256_inserti128_si256( _mm256_castsi128_si256( low ), high, 1 );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( rgba + i * 4 ), _mm256_or_si256( _mm256_shuffle_epi8( pixels, mask256 ), opaque256 ) );
+	}
+	#endif
+	for ( ; i + 6 <= pixelCount; i += 4 )
+	{
+		const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( rgb + i * 3 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( rgba + i * 4 ), _mm_or_si128( _mm_shuffle_epi8( pixels, mask ), opaque ) );
+	}
+#endif
+
+	for ( ; i < pixelCount; ++i )
+	{
+		rgba[ i * 4 ]     = rgb[ i * 3 ];
+		rgba[ i * 4 + 1 ] = rgb[ i * 3 + 1 ];
+		rgba[ i * 4 + 2 ] = rgb[ i * 3 + 2 ];
+		rgba[ i * 4 + 3 ] = 255;
+	}
+}
+
+void SwizzleBGRAToRGBA( const std::uint8_t* bgra, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept
+{
+	std::size_t i = 0;
+
+#if defined( IMAGE_OPS_SSSE3 )
+	i = SwizzleShuffle<2, 1, 0, 3>( bgra, rgba, pixelCount );
+#elif defined( IMAGE_OPS_SSE2 )
+	// as 32 bit words: swap the lowest and the third byte
+	const __m128i greenAlpha = _mm_set1_epi32( static_cast<int>( 0xFF00FF00u ) );
+	const __m128i lowByte = _mm_set1_epi32( 0xFF );
+	for ( ; i + 4 <= pixelCount; i += 4 )
+	{
+		const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bgra + i * 4 ) );
+		const __m128i swapped = _mm_or_si128( _mm_and_si128( pixels, greenAlpha ),
+											  _mm_or_si128( _mm_and_si128( _mm_srli_epi32( pixels, 16 ), lowByte ), _mm_slli_epi32( _mm_and_si128( pixels, lowByte ), 16 ) ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( rgba + i * 4 ), swapped );
+	}
+#endif
+
+	SwizzleScalar<2, 1, 0, 3>( bgra, rgba, i, pixelCount );
+}
+
+void SwizzleABGRToRGBA( const std::uint8_t* abgr, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept
+{
+	std::size_t i = 0;
+
+#if defined( IMAGE_OPS_SSSE3 )
+	i = SwizzleShuffle<3, 2, 1, 0>( abgr, rgba, pixelCount );
+#elif defined( IMAGE_OPS_SSE2 )
+	// as 32 bit words: a byte swap
+	const __m128i byte1 = _mm_set1_epi32( 0xFF00 );
+	const __m128i byte2 = _mm_set1_epi32( 0xFF0000 );
+	for ( ; i + 4 <= pixelCount; i += 4 )
+	{
+		const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( abgr + i * 4 ) );
+		const __m128i outer = _mm_or_si128( _mm_srli_epi32( pixels, 24 ), _mm_slli_epi32( pixels, 24 ) );
+		const __m128i inner = _mm_or_si128( _mm_and_si128( _mm_srli_epi32( pixels, 8 ), byte1 ), _mm_and_si128( _mm_slli_epi32( pixels, 8 ), byte2 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( rgba + i * 4 ), _mm_or_si128( outer, inner ) );
+	}
+#endif
+
+	SwizzleScalar<3, 2, 1, 0>( abgr, rgba, i, pixelCount );
+}
+
+void PremultiplyAlpha( std::uint8_t* rgba, const std::size_t pixelCount ) noexcept
+{
+	std::size_t i = 0;
+
+#if defined( IMAGE_OPS_AVX2 )
+	for ( ; i + 8 <= pixelCount; i += 8 )
+	{
+		__m256i* address = reinterpret_cast<__m256i*>( rgba + i * 4 );
+		const __m256i pixels = _mm256_loadu_si256( address );
+		const __m256i low  = _mm256_unpacklo_epi8( pixels, _mm256_setzero_si256() );
+		const __m256i high = _mm256_unpackhi_epi8( pixels, _mm256_setzero_si256() );
+		const __m256i lowResult  = DivideBy255( _mm256_mullo_epi16( low, GetPremultiplier( low ) ) );
+		const __m256i highResult = DivideBy255( _mm256_mullo_epi16( high, GetPremultiplier( high ) ) );
+		_mm256_storeu_si256( address, _mm256_packus_epi16( lowResult, highResult ) );
+	}
+#endif
+#if defined( IMAGE_OPS_SSE2 )
+	for ( ; i + 4 <= pixelCount; i += 4 )
+	{
+		__m128i* address = reinterpret_cast<__m128i*>( rgba + i * 4 );
+		const __m128i pixels = _mm_loadu_si128( address );
+		const __m128i low  = _mm_unpacklo_epi8( pixels, _mm_setzero_si128() );
+		const __m128i high = _mm_unpackhi_epi8( pixels, _mm_setzero_si128() );
+		const __m128i lowResult  = DivideBy255( _mm_mullo_epi16( low, GetPremultiplier( low ) ) );
+		const __m128i highResult = DivideBy255( _mm_mullo_epi16( high, GetPremultiplier( high ) ) );
+		_mm_storeu_si128( address, _mm_packus_epi16( lowResult, highResult ) );
+	}
+#endif
+
+	for ( ; i < pixelCount; ++i )
+	{
+		std::uint8_t* pixel = rgba + i * 4;
+		for ( int c = 0; c < 3; ++c )
+			pixel[ c ] = DivideBy255( pixel[ c ] * pixel[ 3 ] );
+	}
+}
+
+void DownsampleRGBA( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch, std::uint8_t* half ) noexcept
+{
+	const int halfWidth = std::max( width / 2, 1 );
+	const int halfHeight = std::max( height / 2, 1 );
+
+	for ( int y = 0; y < halfHeight; ++y )
+	{
+		const std::uint8_t* row0 = rgba + std::min( 2 * y, height - 1 ) * pitch;
+		const std::uint8_t* row1 = rgba + std::min( 2 * y + 1, height - 1 ) * pitch;
+		std::uint8_t* out = half + static_cast<std::size_t>( y ) * halfWidth * 4;
+		int x = 0;
+
+		// output pixel x averages input pixels 2x and 2x + 1, both inside the row while x < width / 2
+#if defined( IMAGE_OPS_AVX2 )
+		for ( ; x + 4 <= width / 2; x += 4 )
+		{
+			const __m256i top    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( row0 + x * 8 ) );
+			const __m256i bottom = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( row1 + x * 8 ) );
+
+			// per 128 bit lane, low: pixels 0, 1 and high: pixels 2, 3 of the lane, both rows summed
+			const __m256i low  = _mm256_add_epi16( _mm256_unpacklo_epi8( top, _mm256_setzero_si256() ), _mm256_unpacklo_epi8( bottom, _mm256_setzero_si256() ) );
+			const __m256i high = _mm256_add_epi16( _mm256_unpackhi_epi8( top, _mm256_setzero_si256() ), _mm256_unpackhi_epi8( bottom, _mm256_setzero_si256() ) );
+			const __m256i sums = _mm256_unpacklo_epi64( _mm256_add_epi16( low, _mm256_srli_si256( low, 8 ) ), _mm256_add_epi16( high, _mm256_srli_si256( high, 8 ) ) );
+			const __m256i averages = _mm256_srli_epi16( _mm256_add_epi16( sums, _mm256_set1_epi16( 2 ) ), 2 );
+
+			// two output pixels in the low half of each lane
+			const __m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi16( averages, averages ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( out + x * 4 ), _mm256_castsi256_si128( packed ) );
+		}
+#endif
+#if defined( IMAGE_OPS_SSE2 )
+		for ( ; x + 2 <= width / 2; x += 2 )
+		{
+			const __m128i top    = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row0 + x * 8 ) );
+			const __m128i bottom = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row1 + x * 8 ) );
+
+			const __m128i low  = _mm_add_epi16( _mm_unpacklo_epi8( top, _mm_setzero_si128() ), _mm_unpacklo_epi8( bottom, _mm_setzero_si128() ) );
+			const __m128i high = _mm_add_epi16( _mm_unpackhi_epi8( top, _mm_setzero_si128() ), _mm_unpackhi_epi8( bottom, _mm_setzero_si128() ) );
+			const __m128i sums = _mm_unpacklo_epi64( _mm_add_epi16( low, _mm_srli_si128( low, 8 ) ), _mm_add_epi16( high, _mm_srli_si128( high, 8 ) ) );
+			const __m128i averages = _mm_srli_epi16( _mm_add_epi16( sums, _mm_set1_epi16( 2 ) ), 2 );
+
+			_mm_storel_epi64( reinterpret_cast<__m128i*>( out + x * 4 ), _mm_packus_epi16( averages, averages ) );
+		}
+#endif
+		for ( ; x < halfWidth; ++x )
+		{
+			const int x0 = std::min( 2 * x, width - 1 ) * 4;
+			const int x1 = std::min( 2 * x + 1, width - 1 ) * 4;
+			for ( int c = 0; c < 4; ++c )
+				out[ x * 4 + c ] = static_cast<std::uint8_t>( ( row0[ x0 + c ] + row0[ x1 + c ] + row1[ x0 + c ] + row1[ x1 + c ] + 2 ) / 4 );
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel loops of the texture path over 8 bit RGBA images. Use AVX2 when the build enables it, SSSE3
+// or SSE2 otherwise, scalar code on other architectures; every path gives bit identical results.
+// The swizzles may work in place, other source and destination buffers must not overlap.
+
+// "AVX2", "SSSE3", "SSE2" or "scalar": what the kernels were built for.
+const char* GetImageOpsInstructionSet() noexcept;
+
+// Swaps row i with row height - 1 - i, rows are pitch bytes apart.
+void FlipImageRows( std::uint8_t* pixels, const std::size_t pitch, const int height ) noexcept;
+
+// 3 bytes per pixel to 4, alpha becomes 255.
+void ExpandRGBToRGBA( const std::uint8_t* rgb, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept;
+
+// Byte order B, G, R, A to R, G, B, A. The same swap converts RGBA to BGRA.
+void SwizzleBGRAToRGBA( const std::uint8_t* bgra, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept;
+// Byte order A, B, G, R to R, G, B, A. The same reversal converts RGBA to ABGR.
+void SwizzleABGRToRGBA( const std::uint8_t* abgr, std::uint8_t* rgba, const std::size_t pixelCount ) noexcept;
+
+// rgb = rgb * a / 255, rounded to nearest. Translucent images filter and blend correctly only this way,
+// see the blend function in CMyApp::Init.
+void PremultiplyAlpha( std::uint8_t* rgba, const std::size_t pixelCount ) noexcept;
+
+// Half size with a 2x2 box filter, ( a + b + c + d + 2 ) / 4 per channel. An odd last row or column is
+// dropped, a dimension of 1 stays 1. half is tightly packed.
+void DownsampleRGBA( const std::uint8_t* rgba, const int width, const int height, const std::size_t pitch, std::uint8_t* half ) noexcept;
@@ -0,0 +1,161 @@
+#include "ImageOpsBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include <SDL2/SDL.h>
+
+#include "ImageOps.h"
+
+namespace
+{
+	constexpr int RUNS = 5;
+
+	// the best of RUNS, the first run also warms up the caches
+	template <typename Function>
+	double BestMilliseconds( Function&& function )
+	{
+		double best = std::numeric_limits<double>::max();
+		for ( int run = 0; run < RUNS; ++run )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			best = std::min( best, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+		}
+		return best;
+	}
+
+	void Report( const char* name, const glm::ivec2 size, const std::size_t bytes, const double oldMs, const double newMs, const bool same )
+	{
+		const double megabytes = static_cast<double>( bytes ) / ( 1 << 20 );
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ImageOps] %4dx%-4d %-12s %8.0f -> %8.0f MB/s ( %5.2fx )%s",
+					 size.x, size.y, name, megabytes / oldMs * 1000.0, megabytes / newMs * 1000.0, oldMs / newMs, same ? "" : "  OUTPUT DIFFERS" );
+	}
+
+	// the previous GLUtils.cpp flip
+	void InvertImageRGBA( int pitchInPixels, int height, Uint32* image_pixels )
+	{
+		Uint32* lower_data  = image_pixels;
+		Uint32* higher_data = image_pixels + ( height - 1 ) * pitchInPixels;
+
+		for ( int index = 0; index < height / 2; index++ )
+		{
+			for ( int rowIndex = 0; rowIndex < pitchInPixels; rowIndex++ )
+			{
+				*lower_data ^= higher_data[ rowIndex ];
+				higher_data[ rowIndex ] ^= *lower_data;
+				*lower_data ^= higher_data[ rowIndex ];
+
+				lower_data++;
+			}
+			higher_data -= pitchInPixels;
+		}
+	}
+
+	// the previous CompressedTextureCache.cpp mip filter
+	void DownsampleScalar( const std::uint8_t* pixels, const glm::ivec2 size, std::uint8_t* half )
+	{
+		const glm::ivec2 halfSize( std::max( size.x / 2, 1 ), std::max( size.y / 2, 1 ) );
+		for ( int y = 0; y < halfSize.y; ++y )
+		{
+			const std::uint8_t* row0 = pixels + static_cast<std::size_t>( std::min( 2 * y, size.y - 1 ) ) * size.x * 4;
+			const std::uint8_t* row1 = pixels + static_cast<std::size_t>( std::min( 2 * y + 1, size.y - 1 ) ) * size.x * 4;
+			std::uint8_t* out = half + static_cast<std::size_t>( y ) * halfSize.x * 4;
+
+			for ( int x = 0; x < halfSize.x; ++x )
+			{
+				const int x0 = std::min( 2 * x, size.x - 1 ) * 4;
+				const int x1 = std::min( 2 * x + 1, size.x - 1 ) * 4;
+				for ( int c = 0; c < 4; ++c )
+					out[ x * 4 + c ] = static_cast<std::uint8_t>( ( row0[ x0 + c ] + row0[ x1 + c ] + row1[ x0 + c ] + row1[ x1 + c ] + 2 ) / 4 );
+			}
+		}
+	}
+
+	// a straightforward premultiply, rounded the same way
+	void PremultiplyScalar( std::uint8_t* rgba, const std::size_t pixelCount )
+	{
+		for ( std::size_t i = 0; i < pixelCount; ++i )
+			for ( int c = 0; c < 3; ++c )
+				rgba[ i * 4 + c ] = static_cast<std::uint8_t>( ( rgba[ i * 4 + c ] * rgba[ i * 4 + 3 ] * 2 + 255 ) / 510 );
+	}
+
+	// SDL_ConvertSurfaceFormat to RGBA32 against a kernel called per row
+	template <typename Kernel>
+	void BenchmarkConversion( const char* name, const glm::ivec2 size, const Uint32 sourceFormat, const std::vector<std::uint8_t>& source, Kernel&& kernel )
+	{
+		const int bytesPerPixel = SDL_BYTESPERPIXEL( sourceFormat );
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom( const_cast<std::uint8_t*>( source.data() ), size.x, size.y, bytesPerPixel * 8, size.x * bytesPerPixel, sourceFormat );
+		if ( surface == nullptr ) return;
+
+		SDL_Surface* converted = nullptr;
+		const double oldMs = BestMilliseconds( [&]()
+		{
+			SDL_FreeSurface( converted );
+			converted = SDL_ConvertSurfaceFormat( surface, SDL_PIXELFORMAT_RGBA32, 0 );
+		} );
+
+		std::vector<std::uint8_t> rgba( static_cast<std::size_t>( size.x ) * size.y * 4 );
+		const double newMs = BestMilliseconds( [&]()
+		{
+			for ( int row = 0; row < size.y; ++row )
+				kernel( source.data() + static_cast<std::size_t>( row ) * size.x * bytesPerPixel, rgba.data() + static_cast<std::size_t>( row ) * size.x * 4, static_cast<std::size_t>( size.x ) );
+		} );
+
+		bool same = converted != nullptr;
+		for ( int row = 0; same && row < size.y; ++row )
+			same = std::memcmp( static_cast<const std::uint8_t*>( converted->pixels ) + row * converted->pitch, rgba.data() + static_cast<std::size_t>( row ) * size.x * 4, size.x * 4 ) == 0;
+
+		Report( name, size, source.size(), oldMs, newMs, same );
+		SDL_FreeSurface( converted );
+		SDL_FreeSurface( surface );
+	}
+}
+
+void RunImageOpsBenchmark( const std::vector<glm::ivec2>& sizes )
+{
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ImageOps] %s kernels, best of %d runs, old -> new", GetImageOpsInstructionSet(), RUNS );
+
+	std::mt19937 random( 2023 );
+	for ( const glm::ivec2 size : sizes )
+	{
+		const std::size_t pixelCount = static_cast<std::size_t>( size.x ) * size.y;
+
+		std::vector<std::uint8_t> rgba( pixelCount * 4 );
+		for ( std::uint8_t& byte : rgba ) byte = static_cast<std::uint8_t>( random() );
+		std::vector<std::uint8_t> rgb( pixelCount * 3 );
+		for ( std::uint8_t& byte : rgb ) byte = static_cast<std::uint8_t>( random() );
+
+		// both copies are flipped RUNS times, so they must end up the same
+		{
+			std::vector<std::uint8_t> oldPixels = rgba, newPixels = rgba;
+			const double oldMs = BestMilliseconds( [&]() { InvertImageRGBA( size.x, size.y, reinterpret_cast<Uint32*>( oldPixels.data() ) ); } );
+			const double newMs = BestMilliseconds( [&]() { FlipImageRows( newPixels.data(), static_cast<std::size_t>( size.x ) * 4, size.y ); } );
+			Report( "flip", size, rgba.size(), oldMs, newMs, oldPixels == newPixels );
+		}
+
+		BenchmarkConversion( "RGB->RGBA", size, SDL_PIXELFORMAT_RGB24, rgb, ExpandRGBToRGBA );
+		BenchmarkConversion( "BGRA->RGBA", size, SDL_PIXELFORMAT_BGRA32, rgba, SwizzleBGRAToRGBA );
+		BenchmarkConversion( "ABGR->RGBA", size, SDL_PIXELFORMAT_ABGR32, rgba, SwizzleABGRToRGBA );
+
+		// premultiplying in place changes the input, so every run starts from a fresh copy, timed for both
+		{
+			std::vector<std::uint8_t> oldPixels, newPixels;
+			const double oldMs = BestMilliseconds( [&]() { oldPixels = rgba; PremultiplyScalar( oldPixels.data(), pixelCount ); } );
+			const double newMs = BestMilliseconds( [&]() { newPixels = rgba; PremultiplyAlpha( newPixels.data(), pixelCount ); } );
+			Report( "premultiply", size, rgba.size(), oldMs, newMs, oldPixels == newPixels );
+		}
+
+		{
+			const std::size_t halfBytes = static_cast<std::size_t>( std::max( size.x / 2, 1 ) ) * std::max( size.y / 2, 1 ) * 4;
+			std::vector<std::uint8_t> oldHalf( halfBytes ), newHalf( halfBytes );
+			const double oldMs = BestMilliseconds( [&]() { DownsampleScalar( rgba.data(), size, oldHalf.data() ); } );
+			const double newMs = BestMilliseconds( [&]() { DownsampleRGBA( rgba.data(), size.x, size.y, static_cast<std::size_t>( size.x ) * 4, newHalf.data() ); } );
+			Report( "downsample", size, rgba.size(), oldMs, newMs, oldHalf == newHalf );
+		}
+	}
+}
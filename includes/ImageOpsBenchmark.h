@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Times the ImageOps kernels against the code they replaced ( the Uint32 XOR swap flip,
+// SDL_ConvertSurfaceFormat, scalar loops ) on synthetic images of the given sizes, checks that both
+// give the same pixels and logs throughput in MB/s of source data. Takes a few seconds for
+// 2048 sized images, run it on a worker thread.
+void RunImageOpsBenchmark( const std::vector<glm::ivec2>& sizes );
@@ -0,0 +1,117 @@
+#include "InMemoryTokenizer.h"
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+const char* GetTokenizerInstructionSet() noexcept
+{
+#if defined( TOKENIZER_AVX2 )
+	return "AVX2";
+#elif defined( TOKENIZER_SSE2 )
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+namespace
+{
+	// every power of ten a double holds exactly
+	constexpr double POWERS_OF_TEN[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	constexpr int MAX_EXACT_POWER = 22;
+	constexpr int MAX_DIGITS = 19; // still fits in 64 bits
+
+	bool FromChars( const std::string_view text, float& value ) noexcept
+	{
+		return std::from_chars( text.data(), text.data() + text.size(), value ).ec == std::errc();
+	}
+
+	inline bool IsDigit( const char ch ) noexcept
+	{
+		return static_cast<unsigned char>( ch - '0' ) <= 9;
+	}
+}
+
+bool ParseFloat( const std::string_view text, float& value ) noexcept
+{
+	const char* ptr = text.data();
+	const char* end = ptr + text.size();
+
+	const bool negative = ptr < end && *ptr == '-';
+	if ( negative ) ++ptr;
+
+	// [digits][.digits], leading zeros are not significant
+	std::uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigit = false;
+	for ( ; ptr < end && IsDigit( *ptr ); ++ptr )
+	{
+		anyDigit = true;
+		if ( mantissa == 0 && *ptr == '0' ) continue;
+		if ( ++digits > MAX_DIGITS ) return FromChars( text, value );
+		mantissa = mantissa * 10 + static_cast<std::uint64_t>( *ptr - '0' );
+	}
+	if ( ptr < end && *ptr == '.' )
+	{
+		for ( ++ptr; ptr < end && IsDigit( *ptr ); ++ptr )
+		{
+			anyDigit = true;
+			--exponent;
+			if ( mantissa == 0 && *ptr == '0' ) continue;
+			if ( ++digits > MAX_DIGITS ) return FromChars( text, value );
+			mantissa = mantissa * 10 + static_cast<std::uint64_t>( *ptr - '0' );
+		}
+	}
+	// inf, nan or not a number at all
+	if ( !anyDigit ) return FromChars( text, value );
+
+	if ( ptr < end && ( *ptr == 'e' || *ptr == 'E' ) )
+	{
+		++ptr;
+		const bool negativeExponent = ptr < end && *ptr == '-';
+		if ( ptr < end && ( *ptr == '-' || *ptr == '+' ) ) ++ptr;
+
+		int writtenExponent = 0;
+		const char* exponentStart = ptr;
+		for ( ; ptr < end && IsDigit( *ptr ) && writtenExponent < 10000; ++ptr )
+			writtenExponent = writtenExponent * 10 + ( *ptr - '0' );
+		if ( ptr == exponentStart ) return FromChars( text, value );
+		exponent += negativeExponent ? -writtenExponent : writtenExponent;
+	}
+
+	// anything else after the number: from_chars decides where it ends
+	if ( ptr != end ) return FromChars( text, value );
+
+	if ( mantissa == 0 )
+	{
+		value = negative ? -0.0f : 0.0f;
+		return true;
+	}
+
+	// m * 10^e in one correctly rounded operation, both operands are exact doubles
+	if ( mantissa > ( std::uint64_t( 1 ) << 53 ) || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER )
+		return FromChars( text, value );
+
+	const double exact = exponent < 0 ? static_cast<double>( mantissa ) / POWERS_OF_TEN[ -exponent ]
+									  : static_cast<double>( mantissa ) * POWERS_OF_TEN[ exponent ];
+
+	// Rounding the double to float rounds twice, which differs from rounding the decimal once only if the
+	// double fell exactly halfway between two floats. Values outside the normal float range go to from_chars too.
+	std::uint64_t bits;
+	std::memcpy( &bits, &exact, sizeof( bits ) );
+	constexpr std::uint64_t DROPPED_BITS = ( std::uint64_t( 1 ) << ( 52 - 23 ) ) - 1;
+	constexpr std::uint64_t HALFWAY      = std::uint64_t( 1 ) << ( 52 - 24 );
+	if ( ( bits & DROPPED_BITS ) == HALFWAY
+		 || exact < static_cast<double>( std::numeric_limits<float>::min() ) || exact > static_cast<double>( std::numeric_limits<float>::max() ) )
+		return FromChars( text, value );
+
+	const float rounded = static_cast<float>( exact );
+	value = negative ? -rounded : rounded;
+	return true;
+}
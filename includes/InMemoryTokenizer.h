@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined( __AVX2__ )
+	#include <immintrin.h>
+	#define TOKENIZER_AVX2
+	#define TOKENIZER_SSE2
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#include <emmintrin.h>
+	#define TOKENIZER_SSE2
+#endif
+
+#if defined( TOKENIZER_SSE2 ) && defined( _MSC_VER )
+	#include <intrin.h>
+#endif
+
+// Splits text in memory into tokens separated by whitespace ( what std::isspace means in the "C" locale ).
+// Whitespace and line ends are found 32 ( AVX2 ) or 16 ( SSE2 ) bytes at a time with a compare and a
+// movemask, scalar code handles the last few bytes and other architectures.
+class InMemoryTokenizer
+{
+public:
+	InMemoryTokenizer() = default;
+	inline void SetData( const char* ptr, size_t Length ) noexcept;
+	// The next token. onlySameLine: empty at the end of the line, the tokenizer then stays on the '\n'.
+	inline std::string_view NextToken( bool onlySameLine = false ) noexcept;
+	// Skips past the next '\n'.
+	inline void ToNextLine() noexcept;
+	inline operator bool() const noexcept;
+
+	// the first byte not read yet
+	inline const char* GetPosition() const noexcept { return currentPtr; }
+
+	static inline bool IsSpace( const char ch ) noexcept;
+	// the first byte from ptr on that is whitespace ( FindSpace ), is not ( SkipSpace ) or is '\n' ( FindNewLine ), end if none is
+	static inline const char* FindSpace( const char* ptr, const char* end ) noexcept;
+	static inline const char* SkipSpace( const char* ptr, const char* end ) noexcept;
+	static inline const char* FindNewLine( const char* ptr, const char* end ) noexcept;
+
+private:
+	const char* currentPtr = nullptr;
+	const char* endPtr = nullptr;
+};
+
+// "AVX2", "SSE2" or "scalar": what the tokenizer was built for.
+const char* GetTokenizerInstructionSet() noexcept;
+
+// The float text starts with, bit for bit what std::from_chars gives: decimal numbers of at most 19
+// significant digits and an exponent the double can absorb exactly are computed with one multiplication
+// or division, the rest ( more digits, inf, nan, huge or tiny values ) goes to std::from_chars.
+// value is left unchanged if text does not start with a number.
+bool ParseFloat( const std::string_view text, float& value ) noexcept;
+
+namespace TokenizerDetail
+{
+	inline unsigned CountTrailingZeros( const unsigned mask ) noexcept
+	{
+#if defined( _MSC_VER )
+		unsigned long index;
+		_BitScanForward( &index, mask );
+		return static_cast<unsigned>( index );
+#else
+		return static_cast<unsigned>( __builtin_ctz( mask ) );
+#endif
+	}
+
+#if defined( TOKENIZER_SSE2 )
+	// 0xFF in the bytes that are ' ' or '\t' .. '\r'
+	inline __m128i SpaceMask( const __m128i bytes ) noexcept
+	{
+		const __m128i control = _mm_sub_epi8( bytes, _mm_set1_epi8( '\t' ) );
+		return _mm_or_si128( _mm_cmpeq_epi8( _mm_min_epu8( control, _mm_set1_epi8( '\r' - '\t' ) ), control ),
+							 _mm_cmpeq_epi8( bytes, _mm_set1_epi8( ' ' ) ) );
+	}
+#endif
+
+#if defined( TOKENIZER_AVX2 )
+	inline __m256i SpaceMask( const __m256i bytes ) noexcept
+	{
+		const __m256i control = _mm256_sub_epi8( bytes, _mm256_set1_epi8( '\t' ) );
+		return _mm256_or_si256( _mm256_cmpeq_epi8( _mm256_min_epu8( control, _mm256_set1_epi8( '\r' - '\t' ) ), control ),
+								_mm256_cmpeq_epi8( bytes, _mm256_set1_epi8( ' ' ) ) );
+	}
+#endif
+
+	// The first byte whose mask bit is set, mask( bytes ) gives 0xFF for the bytes searched for.
+	template <typename Mask, typename Scalar>
+	inline const char* Find( const char* ptr, const char* end, Mask&& mask, Scalar&& scalar ) noexcept
+	{
+#if defined( TOKENIZER_AVX2 )
+		for ( ; end - ptr >= 32; ptr += 32 )
+		{
+			const unsigned bits = static_cast<unsigned>( _mm256_movemask_epi8( mask( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( ptr ) ) ) ) );
+			if ( bits != 0 ) return ptr + CountTrailingZeros( bits );
+		}
+#endif
+#if defined( TOKENIZER_SSE2 )
+		for ( ; end - ptr >= 16; ptr += 16 )
+		{
+			const unsigned bits = static_cast<unsigned>( _mm_movemask_epi8( mask( _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr ) ) ) ) );
+			if ( bits != 0 ) return ptr + CountTrailingZeros( bits );
+		}
+#endif
+		while ( ptr < end && !scalar( *ptr ) )
+			++ptr;
+		return ptr;
+	}
+}
+
+inline void InMemoryTokenizer::SetData( const char* ptr, size_t Length ) noexcept
+{
+	this->currentPtr = ptr;
+	this->endPtr = ptr + Length;
+}
+
+inline std::string_view InMemoryTokenizer::NextToken( bool onlySameLine ) noexcept
+{
+	const char* tPtr = SkipSpace( currentPtr, endPtr );
+
+	if ( onlySameLine )
+	{
+		const char* newLine = FindNewLine( currentPtr, tPtr );
+		if ( newLine != tPtr )
+		{
+			currentPtr = newLine;
+			return std::string_view();
+		}
+	}
+
+	currentPtr = FindSpace( tPtr, endPtr );
+
+	return std::string_view( tPtr, static_cast<std::size_t>( currentPtr - tPtr ) );
+}
+
+inline void InMemoryTokenizer::ToNextLine() noexcept
+{
+	currentPtr = FindNewLine( currentPtr, endPtr ) + 1;
+}
+
+inline InMemoryTokenizer::operator bool() const noexcept
+{
+	return currentPtr < endPtr;
+}
+
+inline bool InMemoryTokenizer::IsSpace( const char ch ) noexcept
+{
+	return ch == ' ' || static_cast<unsigned char>( ch - '\t' ) <= '\r' - '\t';
+}
+
+inline const char* InMemoryTokenizer::FindSpace( const char* ptr, const char* end ) noexcept
+{
+#if defined( TOKENIZER_SSE2 )
+	return TokenizerDetail::Find( ptr, end, []( const auto bytes ) { return TokenizerDetail::SpaceMask( bytes ); }, IsSpace );
+#else
+	return TokenizerDetail::Find( ptr, end, nullptr, IsSpace );
+#endif
+}
+
+inline const char* InMemoryTokenizer::SkipSpace( const char* ptr, const char* end ) noexcept
+{
+	auto isToken = []( const char ch ) { return !IsSpace( ch ); };
+#if defined( TOKENIZER_AVX2 )
+	auto tokenMask = []( const auto bytes )
+	{
+		if constexpr ( sizeof( bytes ) == 32 ) return _mm256_xor_si256( TokenizerDetail::SpaceMask( bytes ), _mm256_set1_epi8( -1 ) );
+		else return _mm_xor_si128( TokenizerDetail::SpaceMask( bytes ), _mm_set1_epi8( -1 ) );
+	};
+	return TokenizerDetail::Find( ptr, end, tokenMask, isToken );
+#elif defined( TOKENIZER_SSE2 )
+	return TokenizerDetail::Find( ptr, end, []( const __m128i bytes ) { return _mm_xor_si128( TokenizerDetail::SpaceMask( bytes ), _mm_set1_epi8( -1 ) ); }, isToken );
+#else
+	return TokenizerDetail::Find( ptr, end, nullptr, isToken );
+#endif
+}
+
+inline const char* InMemoryTokenizer::FindNewLine( const char* ptr, const char* end ) noexcept
+{
+	auto isNewLine = []( const char ch ) { return ch == '\n'; };
+#if defined( TOKENIZER_AVX2 )
+	auto newLineMask = []( const auto bytes )
+	{
+		if constexpr ( sizeof( bytes ) == 32 ) return _mm256_cmpeq_epi8( bytes, _mm256_set1_epi8( '\n' ) );
+		else return _mm_cmpeq_epi8( bytes, _mm_set1_epi8( '\n' ) );
+	};
+	return TokenizerDetail::Find( ptr, end, newLineMask, isNewLine );
+#elif defined( TOKENIZER_SSE2 )
+	return TokenizerDetail::Find( ptr, end, []( const __m128i bytes ) { return _mm_cmpeq_epi8( bytes, _mm_set1_epi8( '\n' ) ); }, isNewLine );
+#else
+	return TokenizerDetail::Find( ptr, end, nullptr, isNewLine );
+#endif
+}
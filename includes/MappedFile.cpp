@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined( _WIN32 )
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+	: m_data( std::exchange( other.m_data, nullptr ) ), m_size( std::exchange( other.m_size, 0 ) )
+{
+}
+
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept
+{
+	if ( this != &other )
+	{
+		Close();
+		m_data = std::exchange( other.m_data, nullptr );
+		m_size = std::exchange( other.m_size, 0 );
+	}
+	return *this;
+}
+
+bool MappedFile::Open( const std::filesystem::path& path )
+{
+	Close();
+
+#if defined( _WIN32 )
+	HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE ) return false;
+
+	LARGE_INTEGER fileSize{};
+	HANDLE mapping = nullptr;
+	if ( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart > 0 )
+		mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	CloseHandle( file );
+	if ( mapping == nullptr ) return false;
+
+	// the view keeps the mapping alive
+	const void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( view == nullptr ) return false;
+
+	m_data = static_cast<const std::uint8_t*>( view );
+	m_size = static_cast<std::size_t>( fileSize.QuadPart );
+#else
+	const int file = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( file < 0 ) return false;
+
+	struct stat status{};
+	void* view = MAP_FAILED;
+	if ( fstat( file, &status ) == 0 && status.st_size > 0 )
+		view = mmap( nullptr, static_cast<std::size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+	close( file );
+	if ( view == MAP_FAILED ) return false;
+
+	m_data = static_cast<const std::uint8_t*>( view );
+	m_size = static_cast<std::size_t>( status.st_size );
+#endif
+
+	return true;
+}
+
+void MappedFile::Close() noexcept
+{
+	if ( m_data != nullptr )
+	{
+#if defined( _WIN32 )
+		UnmapViewOfFile( m_data );
+#else
+		munmap( const_cast<std::uint8_t*>( m_data ), m_size );
+#endif
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+void MappedFile::Prefetch( const std::size_t offset, const std::size_t size ) const noexcept
+{
+	if ( m_data == nullptr || offset >= m_size ) return;
+	const std::size_t length = std::min( size, m_size - offset );
+
+#if defined( _WIN32 )
+	WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::uint8_t*>( m_data + offset ), length };
+	PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+#else
+	// madvise wants a page aligned start
+	const std::size_t pageSize = static_cast<std::size_t>( sysconf( _SC_PAGESIZE ) );
+	const std::size_t start = offset / pageSize * pageSize;
+	madvise( const_cast<std::uint8_t*>( m_data + start ), length + ( offset - start ), MADV_WILLNEED );
+#endif
+}
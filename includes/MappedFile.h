@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// A whole file mapped read-only into the address space: reads are served from the OS file cache and
+// pages are loaded on first touch, nothing is copied up front. Safe to read from any thread.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+	MappedFile( MappedFile&& other ) noexcept;
+	MappedFile& operator=( MappedFile&& other ) noexcept;
+
+	// false if the file is missing, empty or cannot be mapped
+	bool Open( const std::filesystem::path& path );
+	void Close() noexcept;
+
+	// Asks the OS to start reading the range in the background, one long read instead of many page faults.
+	void Prefetch( const std::size_t offset, const std::size_t size ) const noexcept;
+
+	inline bool IsOpen() const noexcept { return m_data != nullptr; }
+	inline const std::uint8_t* GetData() const noexcept { return m_data; }
+	inline std::size_t GetSize() const noexcept { return m_size; }
+
+private:
+	const std::uint8_t* m_data = nullptr;
+	std::size_t         m_size = 0;
+};
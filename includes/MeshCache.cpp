@@ -0,0 +1,217 @@
+#include "MeshCache.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "AssetPack.h"
+#include "FileUtils.h"
+#include "ObjParser.h"
+
+// Bump when the layout, the Vertex struct or the parser's output changes, old entries then simply miss.
+static constexpr std::uint32_t CACHE_FORMAT_VERSION = 1;
+static constexpr char ENTRY_MAGIC[ 8 ] = { 'Z', 'H', 'M', 'E', 'S', 'H', '\r', '\n' };
+
+struct EntryHeader
+{
+	char          magic[ 8 ];
+	std::uint32_t version;
+	std::uint32_t vertexSize;
+	std::uint64_t sourceSize;
+	std::int64_t  sourceTime;
+	std::uint64_t sourceHash;
+	std::uint64_t vertexCount;
+	std::uint64_t indexCount;
+	std::uint64_t vertexOffset; // from the start of the file
+	std::uint64_t indexOffset;
+	std::uint64_t fileSize;
+};
+
+static_assert( sizeof( EntryHeader ) == 80, "the entry header is written as is" );
+
+static std::uint64_t AlignEntry( const std::uint64_t offset ) noexcept
+{
+	return ( offset + MeshCache::ENTRY_ALIGNMENT - 1 ) / MeshCache::ENTRY_ALIGNMENT * MeshCache::ENTRY_ALIGNMENT;
+}
+
+void MeshCache::Init()
+{
+	std::error_code error;
+	std::filesystem::create_directories( m_directory, error );
+	m_writable = !error;
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[MeshCache] Cannot create %s: %s, meshes are parsed on every start.",
+						m_directory.string().c_str(), error.message().c_str() );
+}
+
+CachedMesh MeshCache::Load( const std::filesystem::path& fileName, WorkerPool* workers ) const
+{
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const std::filesystem::path path = GetPath( fileName );
+
+	auto log = [ & ]( const CachedMesh& mesh, const char* how )
+	{
+		const double elapsedMs = 1000.0 * ( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[MeshCache] %s: %zu vertices, %zu indices %s in %.1f ms",
+						fileName.string().c_str(), mesh.GetVertexCount(), mesh.GetIndexCount(), how, elapsedMs );
+	};
+
+	// size and time of the plain file, without reading it
+	SourceInfo source;
+	std::error_code error;
+	const std::uintmax_t fileSize = std::filesystem::file_size( fileName, error );
+	if ( !error )
+	{
+		const std::filesystem::file_time_type fileTime = std::filesystem::last_write_time( fileName, error );
+		if ( !error )
+		{
+			source.size = fileSize;
+			source.time = static_cast<std::int64_t>( fileTime.time_since_epoch().count() );
+		}
+	}
+
+	CachedMesh mesh;
+	if ( source.time != 0 && Open( path, source, false, mesh ) )
+	{
+		++m_hits;
+		log( mesh, "from the cache" );
+		return mesh;
+	}
+
+	// mapped from the AssetPack if it has the file, read from disk otherwise
+	const AssetData sourceData = ReadAsset( fileName );
+	if ( !sourceData.IsValid() ) throw ObjParser::EXC_FILENOTFOUND;
+
+	source.size = sourceData.GetSize();
+	source.hash = HashBytes( FNV_OFFSET_BASIS, sourceData.GetData(), sourceData.GetSize() );
+
+	if ( Open( path, source, true, mesh ) )
+	{
+		// the same bytes with a new time: the entry gets the time, so the next load does not hash again
+		if ( source.time != 0 && m_writable )
+		{
+			mesh = CachedMesh();
+			std::fstream stream( path, std::ios::binary | std::ios::in | std::ios::out );
+			stream.seekp( offsetof( EntryHeader, sourceTime ) );
+			stream.write( reinterpret_cast<const char*>( &source.time ), sizeof( source.time ) );
+			stream.close();
+			Open( path, source, true, mesh );
+		}
+
+		if ( mesh.IsMapped() )
+		{
+			++m_hits;
+			log( mesh, "from the cache" );
+			return mesh;
+		}
+	}
+
+	mesh.m_parsed = workers ? ObjParser::parseString( sourceData.GetText(), *workers ) : ObjParser::parseString( sourceData.GetText() );
+	mesh.m_vertices    = mesh.m_parsed.vertexArray.data();
+	mesh.m_vertexCount = mesh.m_parsed.vertexArray.size();
+	mesh.m_indices     = mesh.m_parsed.indexArray.data();
+	mesh.m_indexCount  = mesh.m_parsed.indexArray.size();
+	++m_parsed;
+
+	if ( m_writable )
+		Store( path, source, mesh.m_vertices, mesh.m_vertexCount, mesh.m_indices, mesh.m_indexCount );
+
+	log( mesh, "parsed" );
+	return mesh;
+}
+
+MeshCache::Stats MeshCache::GetStats() const noexcept
+{
+	Stats stats;
+	stats.hits   = m_hits.load();
+	stats.parsed = m_parsed.load();
+	return stats;
+}
+
+std::filesystem::path MeshCache::GetPath( const std::filesystem::path& fileName ) const
+{
+	const std::string name = fileName.lexically_normal().generic_string();
+
+	char entryName[ 32 ];
+	std::snprintf( entryName, sizeof( entryName ), "%016llx.mesh", static_cast<unsigned long long>( HashBytes( FNV_OFFSET_BASIS, name.data(), name.size() ) ) );
+	return m_directory / entryName;
+}
+
+bool MeshCache::Open( const std::filesystem::path& path, const SourceInfo& source, const bool compareHash, CachedMesh& mesh ) const
+{
+	MappedFile file;
+	if ( !file.Open( path ) ) return false;
+
+	EntryHeader header{};
+	if ( file.GetSize() < sizeof( header ) ) return false;
+	std::memcpy( &header, file.GetData(), sizeof( header ) );
+
+	// everything the upload relies on is checked here, a damaged entry is parsed again and overwritten
+	const bool valid = std::memcmp( header.magic, ENTRY_MAGIC, sizeof( ENTRY_MAGIC ) ) == 0 && header.version == CACHE_FORMAT_VERSION
+					&& header.vertexSize == sizeof( Vertex ) && header.fileSize == file.GetSize()
+					&& header.vertexOffset % ENTRY_ALIGNMENT == 0 && header.indexOffset % ENTRY_ALIGNMENT == 0
+					&& header.vertexOffset >= sizeof( header ) && header.vertexOffset <= header.fileSize
+					&& header.indexOffset >= sizeof( header ) && header.indexOffset <= header.fileSize
+					&& header.vertexCount <= ( header.fileSize - header.vertexOffset ) / sizeof( Vertex )
+					&& header.indexCount <= ( header.fileSize - header.indexOffset ) / sizeof( GLuint );
+	if ( !valid ) return false;
+
+	if ( header.sourceSize != source.size ) return false;
+	if ( compareHash ? header.sourceHash != source.hash : header.sourceTime != source.time ) return false;
+
+	// the whole entry goes to the GPU right away, one long read instead of many page faults
+	file.Prefetch( 0, file.GetSize() );
+
+	mesh = CachedMesh();
+	mesh.m_vertices    = reinterpret_cast<const Vertex*>( file.GetData() + header.vertexOffset );
+	mesh.m_vertexCount = static_cast<std::size_t>( header.vertexCount );
+	mesh.m_indices     = reinterpret_cast<const GLuint*>( file.GetData() + header.indexOffset );
+	mesh.m_indexCount  = static_cast<std::size_t>( header.indexCount );
+	mesh.m_file = std::move( file );
+	return true;
+}
+
+void MeshCache::Store( const std::filesystem::path& path, const SourceInfo& source, const Vertex* vertices, const std::size_t vertexCount,
+					   const GLuint* indices, const std::size_t indexCount ) const
+{
+	EntryHeader header{};
+	std::memcpy( header.magic, ENTRY_MAGIC, sizeof( ENTRY_MAGIC ) );
+	header.version      = CACHE_FORMAT_VERSION;
+	header.vertexSize   = sizeof( Vertex );
+	header.sourceSize   = source.size;
+	header.sourceTime   = source.time;
+	header.sourceHash   = source.hash;
+	header.vertexCount  = vertexCount;
+	header.indexCount   = indexCount;
+	header.vertexOffset = AlignEntry( sizeof( header ) );
+	header.indexOffset  = AlignEntry( header.vertexOffset + vertexCount * sizeof( Vertex ) );
+	header.fileSize     = AlignEntry( header.indexOffset + indexCount * sizeof( GLuint ) );
+
+	const std::error_code error = WriteFileAtomically( path, [ & ]( std::ostream& stream )
+	{
+		std::uint64_t position = 0;
+		const std::vector<char> padding( ENTRY_ALIGNMENT, 0 );
+		auto write = [ & ]( const void* data, const std::uint64_t size )
+		{
+			stream.write( static_cast<const char*>( data ), static_cast<std::streamsize>( size ) );
+			position += size;
+		};
+		auto padTo = [ & ]( const std::uint64_t target ) { write( padding.data(), target - position ); };
+
+		write( &header, sizeof( header ) );
+		padTo( header.vertexOffset );
+		write( vertices, vertexCount * sizeof( Vertex ) );
+		padTo( header.indexOffset );
+		write( indices, indexCount * sizeof( GLuint ) );
+		padTo( header.fileSize );
+		return true;
+	} );
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[MeshCache] Cannot write %s: %s", path.string().c_str(), error.message().c_str() );
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#include "GLUtils.hpp"
+#include "MappedFile.h"
+
+class WorkerPool;
+
+// A mesh loaded through the MeshCache: a view of the mapped cache entry, or the arrays just parsed.
+// Movable, the pointers stay valid.
+class CachedMesh
+{
+public:
+	inline const Vertex* GetVertices() const noexcept { return m_vertices; }
+	inline std::size_t GetVertexCount() const noexcept { return m_vertexCount; }
+	inline const GLuint* GetIndices() const noexcept { return m_indices; }
+	inline std::size_t GetIndexCount() const noexcept { return m_indexCount; }
+	inline bool IsMapped() const noexcept { return m_file.IsOpen(); }
+
+private:
+	friend class MeshCache;
+
+	MappedFile         m_file;
+	MeshObject<Vertex> m_parsed;
+	const Vertex* m_vertices = nullptr;
+	std::size_t   m_vertexCount = 0;
+	const GLuint* m_indices = nullptr;
+	std::size_t   m_indexCount = 0;
+};
+
+// The final vertex and index arrays of parsed .obj files ( ObjParser ), cached on disk in a binary form
+// that is uploaded as it is: loading a cached mesh is a memory map and a glBufferData per array.
+//
+// There is one entry per source path, holding the source's size, modification time and 64-bit hash.
+// If size and time match the entry is used without reading the source. If only the time differs ( a
+// checkout, a copy ) the source is hashed, and if its bytes are the same the entry is kept and stored
+// with the new time. Otherwise the source is parsed and the entry rewritten. A source read from the
+// AssetPack has no time of its own and is always hashed, which is still far cheaper than parsing.
+//
+// Entry layout: a header, then the vertices and the indices, each starting on an ENTRY_ALIGNMENT boundary.
+class MeshCache
+{
+public:
+	static constexpr std::size_t ENTRY_ALIGNMENT = 4096;
+
+	struct Stats
+	{
+		std::uint32_t hits   = 0;
+		std::uint32_t parsed = 0; // written to disk if the cache is writable
+	};
+
+	explicit MeshCache( std::filesystem::path directory ) : m_directory( std::move( directory ) ) {}
+
+	void Init();
+
+	// Loads the mesh through the cache. Throws as ObjParser::parse if the file is missing. A stale entry is
+	// parsed on the workers if given ( ObjParser::parseString( objText, workers ) ), on the calling thread otherwise.
+	// Touches no GL state and may run on any thread.
+	CachedMesh Load( const std::filesystem::path& fileName, WorkerPool* workers = nullptr ) const;
+
+	Stats GetStats() const noexcept;
+
+private:
+	struct SourceInfo
+	{
+		std::uint64_t size = 0;
+		std::int64_t  time = 0; // 0: not a plain file
+		std::uint64_t hash = 0;
+	};
+
+	std::filesystem::path GetPath( const std::filesystem::path& fileName ) const;
+	// Maps the entry and checks its header. On a match mesh views the entry.
+	bool Open( const std::filesystem::path& path, const SourceInfo& source, const bool compareHash, CachedMesh& mesh ) const;
+	void Store( const std::filesystem::path& path, const SourceInfo& source, const Vertex* vertices, const std::size_t vertexCount,
+				const GLuint* indices, const std::size_t indexCount ) const;
+
+	std::filesystem::path m_directory;
+	bool m_writable = false;
+
+	mutable std::atomic<std::uint32_t> m_hits{ 0 }, m_parsed{ 0 };
+};
@@ -0,0 +1,106 @@
+#include "MeshPool.h"
+
+#include <numeric>
+
+MeshPool::Handle MeshPool::Add( const MeshObject<Vertex>& mesh )
+{
+	MeshRange range;
+	range.firstIndex = static_cast<GLuint>( m_indices.size() );
+	range.indexCount = static_cast<GLuint>( mesh.indexArray.size() );
+	range.baseVertex = static_cast<GLint>( m_vertices.size() );
+
+	// indices stay relative to the mesh, baseVertex offsets them at draw time
+	m_vertices.insert( m_vertices.end(), mesh.vertexArray.begin(), mesh.vertexArray.end() );
+	m_indices.insert( m_indices.end(), mesh.indexArray.begin(), mesh.indexArray.end() );
+
+	m_ranges.push_back( range );
+	return m_ranges.size() - 1;
+}
+
+void MeshPool::Build( std::initializer_list<VertexAttributeDescriptor> vertexAttribList, GLuint drawIndexLocation, GLuint drawIndexCapacity )
+{
+	glGenVertexArrays( 1, &m_vaoID );
+	glBindVertexArray( m_vaoID );
+
+	glGenBuffers( 1, &m_vboID );
+	glBindBuffer( GL_ARRAY_BUFFER, m_vboID );
+	glBufferData( GL_ARRAY_BUFFER, m_vertices.size() * sizeof( Vertex ), m_vertices.data(), GL_STATIC_DRAW );
+
+	glGenBuffers( 1, &m_iboID );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_iboID );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof( GLuint ), m_indices.data(), GL_STATIC_DRAW );
+
+	for ( const auto& vertexAttrDesc : vertexAttribList )
+	{
+		glEnableVertexAttribArray( vertexAttrDesc.index );
+		glVertexAttribPointer( vertexAttrDesc.index, vertexAttrDesc.numberOfComponents, vertexAttrDesc.glType, GL_FALSE,
+							   sizeof( Vertex ), reinterpret_cast<const void*>( vertexAttrDesc.strideInBytes ) );
+	}
+
+	m_drawIndexCapacity = drawIndexCapacity;
+	if ( drawIndexCapacity > 0 )
+	{
+		std::vector<GLuint> drawIndices( drawIndexCapacity );
+		std::iota( drawIndices.begin(), drawIndices.end(), 0u );
+
+		glGenBuffers( 1, &m_drawIndexBufferID );
+		glBindBuffer( GL_ARRAY_BUFFER, m_drawIndexBufferID );
+		glBufferData( GL_ARRAY_BUFFER, drawIndices.size() * sizeof( GLuint ), drawIndices.data(), GL_STATIC_DRAW );
+
+		glEnableVertexAttribArray( drawIndexLocation );
+		glVertexAttribIPointer( drawIndexLocation, 1, GL_UNSIGNED_INT, sizeof( GLuint ), nullptr );
+		glVertexAttribDivisor( drawIndexLocation, 1 );
+	}
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	// the GPU has its copy
+	m_vertices = {};
+	m_indices  = {};
+}
+
+void MeshPool::Clean()
+{
+	glDeleteBuffers( 1, &m_drawIndexBufferID );
+	glDeleteBuffers( 1, &m_iboID );
+	glDeleteBuffers( 1, &m_vboID );
+	glDeleteVertexArrays( 1, &m_vaoID );
+
+	m_drawIndexBufferID = m_iboID = m_vboID = m_vaoID = 0;
+	m_drawIndexCapacity = 0;
+
+	m_vertices.clear();
+	m_indices.clear();
+	m_ranges.clear();
+}
+
+void MeshPool::ReserveDrawIndices( const GLuint drawIndexCapacity )
+{
+	if ( m_drawIndexBufferID == 0 || drawIndexCapacity <= m_drawIndexCapacity ) return;
+
+	std::vector<GLuint> drawIndices( drawIndexCapacity );
+	std::iota( drawIndices.begin(), drawIndices.end(), 0u );
+
+	// the VAO refers to the buffer object, new storage keeps the attribute as it is;
+	// GL_COPY_WRITE_BUFFER leaves the GL_ARRAY_BUFFER binding alone
+	glBindBuffer( GL_COPY_WRITE_BUFFER, m_drawIndexBufferID );
+	glBufferData( GL_COPY_WRITE_BUFFER, drawIndices.size() * sizeof( GLuint ), drawIndices.data(), GL_STATIC_DRAW );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	m_drawIndexCapacity = drawIndexCapacity;
+}
+
+DrawElementsIndirectCommand MeshPool::MakeCommand( const Handle handle, const GLuint baseInstance ) const
+{
+	const MeshRange& range = m_ranges[ handle ];
+
+	DrawElementsIndirectCommand command;
+	command.count         = range.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex    = range.firstIndex;
+	command.baseVertex    = range.baseVertex;
+	command.baseInstance  = baseInstance;
+	return command;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLUtils.hpp"
+
+// Layout of one command in a GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint  baseVertex;
+	GLuint baseInstance;
+};
+
+// Where a mesh lives inside the pool's shared buffers.
+struct MeshRange
+{
+	GLuint firstIndex = 0;
+	GLuint indexCount = 0;
+	GLint  baseVertex = 0;
+};
+
+// Several meshes in one shared VBO/IBO pair behind one VAO, so draws of different meshes can be
+// merged into a single glMultiDrawElementsIndirect.
+//
+// The VAO can also carry a per-draw index attribute: a static buffer holding 0, 1, 2, ... read with
+// divisor 1. A command with instanceCount 1 and baseInstance N then sees N in that attribute, which
+// gives the shader the index of its draw without gl_DrawID (GL 4.6 / ARB_shader_draw_parameters).
+class MeshPool
+{
+public:
+	using Handle = std::size_t;
+
+	// Registers a mesh to be uploaded by Build(). The handle stays valid until Clean().
+	Handle Add( const MeshObject<Vertex>& mesh );
+
+	// Uploads every registered mesh and sets up the VAO. drawIndexCapacity > 0 also creates the
+	// per-draw index attribute at drawIndexLocation for that many draws.
+	void Build( std::initializer_list<VertexAttributeDescriptor> vertexAttribList, GLuint drawIndexLocation = 0, GLuint drawIndexCapacity = 0 );
+	void Clean();
+
+	inline const MeshRange& Get( const Handle handle ) const { return m_ranges[ handle ]; }
+	inline GLuint GetVaoID() const noexcept { return m_vaoID; }
+	// the shared buffers, for VAOs that add attributes of their own
+	inline GLuint GetVboID() const noexcept { return m_vboID; }
+	inline GLuint GetIboID() const noexcept { return m_iboID; }
+	inline GLuint GetDrawIndexCapacity() const noexcept { return m_drawIndexCapacity; }
+	// Grows the per-draw index attribute to at least drawIndexCapacity draws. Only after a Build() that created it.
+	void ReserveDrawIndices( const GLuint drawIndexCapacity );
+
+	// A single-instance command for the mesh. baseInstance is what the per-draw index attribute will read.
+	DrawElementsIndirectCommand MakeCommand( const Handle handle, const GLuint baseInstance ) const;
+
+private:
+	std::vector<Vertex>    m_vertices;
+	std::vector<GLuint>    m_indices;
+	std::vector<MeshRange> m_ranges;
+
+	GLuint m_vaoID = 0;
+	GLuint m_vboID = 0;
+	GLuint m_iboID = 0;
+	GLuint m_drawIndexBufferID = 0;
+	GLuint m_drawIndexCapacity = 0;
+};
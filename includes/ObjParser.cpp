@@ -1,79 +1,295 @@
 #include "ObjParser.h"
+#include "AssetPack.h"
+#include "InMemoryTokenizer.h"
+#include "WorkerPool.h"
 #include <array>
 #include <list>
 #include <string>
 #include <charconv>
 #include <algorithm>
+#include <cstring>
 
 #include <glm/gtx/norm.hpp>
 #include <glm/gtc/constants.hpp>
 
 using namespace std;
 
-class InMemoryTokenizer
+constexpr unsigned short From2Char( const char ch1, const char ch2)
 {
-public:
-	InMemoryTokenizer() = default;
-	void SetData( const char* ptr, size_t Length ) noexcept;
-	std::string_view NextToken( bool onlySameLine = false ) noexcept;
-	void ToNextLine() noexcept;
-	operator bool() const noexcept;
-private:
-	const char* currentPtr = nullptr;
-	const char* endPtr = nullptr;
-};
+	unsigned short sh = static_cast<unsigned short>(ch2) << 8 | static_cast<unsigned short>(ch1);
 
-void InMemoryTokenizer::SetData( const char* ptr, size_t Length ) noexcept
-{
-	this->currentPtr = ptr;
-	this->endPtr = ptr + Length;
+	return sh;
 }
 
-std::string_view InMemoryTokenizer::NextToken( bool onlySameLine ) noexcept
-{
-	for ( ;currentPtr < endPtr 
-			&& std::isspace(static_cast<unsigned char>(*currentPtr) ); ++currentPtr )
-	{
-		if ( onlySameLine && *currentPtr == '\n' )
-		{
-			return std::string_view();
-		}
-	}
-	const char* tPtr = currentPtr;
-	std::size_t tLength = 0;
+static std::vector<unsigned int> triangulatePolygon( const std::vector<glm::vec2>& );
 
-	while ( currentPtr < endPtr 
-			&& !std::isspace(static_cast<unsigned char>(*currentPtr) ) )
+static void parsePosition( InMemoryTokenizer& tokenizer, glm::vec3& position )
+{
+	float& x = position.x;
+	float& y = position.y;
+	float& z = position.z;
+
+	std::string_view coordT = tokenizer.NextToken();
+	ParseFloat( coordT, x );
+	coordT = tokenizer.NextToken();
+	ParseFloat( coordT, y );
+	coordT = tokenizer.NextToken();
+	ParseFloat( coordT, z );
+	coordT = tokenizer.NextToken(true);
+
+	if ( !coordT.empty() )
 	{
-		currentPtr++;
-		tLength++;
+		float w;
+		ParseFloat( coordT, w );
+		x /= w;
+		y /= w;
+		z /= w;
 	}
+}
 
-	return std::string_view( tPtr, tLength );
+static void parseNormal( InMemoryTokenizer& tokenizer, glm::vec3& normal )
+{
+	std::string_view coordT = tokenizer.NextToken();
+	ParseFloat( coordT, normal.x );
+	coordT = tokenizer.NextToken();
+	ParseFloat( coordT, normal.y );
+	coordT = tokenizer.NextToken();
+	ParseFloat( coordT, normal.z );
 }
 
-void InMemoryTokenizer::ToNextLine() noexcept
+static void parseTexcoord( InMemoryTokenizer& tokenizer, glm::vec2& texcoord )
 {
-	while ( currentPtr < endPtr && *currentPtr != '\n' )
-		currentPtr++;
-	currentPtr++;
+	std::string_view coordT = tokenizer.NextToken();
+	ParseFloat( coordT, texcoord.x );
+	coordT = tokenizer.NextToken();
+	ParseFloat( coordT, texcoord.y );
 }
 
-InMemoryTokenizer::operator bool() const noexcept
+bool ObjParser::parseFaceVertex( const std::string_view faceVertT, IndexedVert& idxVert )
 {
-	return currentPtr < endPtr;
+	size_t posEndOffs = faceVertT.find_first_of( '/', 0 );
+	if ( posEndOffs == std::string_view::npos ) posEndOffs = faceVertT.size();
+
+	std::from_chars( faceVertT.data(), faceVertT.data() + posEndOffs, idxVert.v );
+	idxVert.v--;
+
+	size_t texStartOffs = posEndOffs + 1;
+	size_t texEndOffs = faceVertT.find_first_of( '/', texStartOffs );
+	if ( texEndOffs == std::string_view::npos ) texEndOffs = faceVertT.size();
+	if ( texEndOffs > texStartOffs ) std::from_chars( faceVertT.data() + texStartOffs, faceVertT.data() + texEndOffs, idxVert.vt);
+	if ( idxVert.vt ) idxVert.vt--; 
+	size_t normStartOffs = texEndOffs + 1;
+
+	if ( faceVertT.size() > normStartOffs )
+	{
+		std::from_chars( faceVertT.data() + normStartOffs, faceVertT.data() + faceVertT.size(), idxVert.vn );
+		idxVert.vn--;
+		return true;
+	}
+	return false;
 }
 
-constexpr unsigned short From2Char( const char ch1, const char ch2)
+void ObjParser::triangulateFace( std::vector<IndexedVert>& face_vertIds, const std::vector<glm::vec3>& positions )
 {
-	unsigned short sh = static_cast<unsigned short>(ch2) << 8 | static_cast<unsigned short>(ch1);
+	std::vector<IndexedVert> face_vertIdsFace2Tris;
+	if ( 4 == face_vertIds.size() )
+	{
+		glm::vec3 v10 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 1 ].v ];
+		glm::vec3 v12 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 1 ].v ];
 
-	return sh;
+		glm::vec3 v32 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 3 ].v ];
+		glm::vec3 v30 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 3 ].v ];
+
+		float angle_012 = ::acosf( glm::dot(v10,v12) / sqrtf( glm::dot(v10,v10) * glm::dot(v12,v12) ) );
+		float angle_230 = ::acosf( glm::dot(v32,v30) / sqrtf( glm::dot(v32,v32) * glm::dot(v30,v30) ) );
+		
+		if ( ( angle_012 + angle_230 ) <= glm::pi<float>() )
+		{
+			face_vertIdsFace2Tris =
+			{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 2 ],
+			  face_vertIds[ 0 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
+		}
+		else
+		{
+			face_vertIdsFace2Tris =
+			{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 3 ],
+			  face_vertIds[ 1 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
+		}
+	}
+	else 
+	{
+		// Calculate the best fitting plane
+		glm::vec3 MidPoint( 0.0 );
+		for ( const auto& vertex : face_vertIds )
+		{
+			MidPoint += positions[ vertex.v ];
+		}
+		MidPoint /= float( face_vertIds.size() );
+
+		std::vector<glm::vec3> centeredPoints( face_vertIds.size() );
+
+		std::transform( face_vertIds.cbegin(), face_vertIds.cend(), centeredPoints.begin(),
+						[&positions,MidPoint]( const IndexedVert& faceV )->glm::vec3
+						{ return positions[ faceV.v ] - MidPoint;}
+						);
+
+		float cov_xx = 0.0f, cov_xy = 0.0f;
+		float cov_yy = 0.0f, cov_yz = 0.0f;
+		float cov_xz = 0.0f, cov_zz = 0.0f;
+
+		for ( const glm::vec3& centeredP : centeredPoints )
+		{
+			cov_xx += centeredP.x * centeredP.x;
+			cov_xy += centeredP.x * centeredP.y;
+			
+			cov_yy += centeredP.y * centeredP.y;
+			cov_yz += centeredP.y * centeredP.z;
+
+			cov_xz += centeredP.x * centeredP.z;
+			cov_zz += centeredP.z * centeredP.z;
+		}
+
+		// viktor-vad: Very strange, but the pca.hpp and pca.inc disappeared from glm/gtx.
+		// Did not find any explanation for this.
+		// Instead of some header file copy-hacking, I implemented a 3x3 verion of eigen decomposition.
+		// It was not intended, but most likely it is faster than the original glm pca, since that is a general method with Housholder and QR.
+		// https://dl.acm.org/doi/epdf/10.1145/355578.366316
+		// https://en.wikipedia.org/wiki/Eigenvalue_algorithm#2%C3%972_matrices
+		glm::vec3 eigenVectors[2];
+		{
+			glm::vec3 eigenVectors_[3];
+			float p1 = cov_xy * cov_xy + cov_xz * cov_xz + cov_yz * cov_yz;
+			float trC = cov_xx + cov_yy + cov_zz;
+			float eig1 = 0.0f, eig2 = 0.0f, eig3 = 0.0f;
+
+			// normal case
+			if ( p1 > 1e-15f )
+			{
+				float q = trC / 3.0f;
+				float p2 = ( cov_xx - q ) * ( cov_xx - q ) + ( cov_yy - q ) * ( cov_yy - q ) + ( cov_zz - q ) * ( cov_zz - q ) + 2.0f * p1;
+				float p = std::sqrt( p2 / 6.0f );
+
+				float cov_xx_q = cov_xx - q;
+				float cov_yy_q = cov_yy - q;
+				float cov_zz_q = cov_zz - q;
+
+				float r = glm::clamp( ( cov_xx_q * cov_yy_q * cov_zz_q + 2.0f * cov_xy * cov_yz * cov_xz - cov_xx_q * cov_yz * cov_yz - cov_yy_q * cov_xz * cov_xz - cov_zz_q * cov_xy * cov_xy ) / ( 2.0f * p * p * p ),
+									  -1.0f, 1.0f );
+
+				float phi = ::acosf( r ) / 3.0f;
+
+				eig1 = q + 2.0f * p * std::cos( phi );
+				eig2 = q + 2.0f * p * std::cos( phi + ( 2.0f * glm::pi<float>() / 3.0f ) );
+				eig3 = trC - eig1 - eig2;
+			}
+			else // covariance matrix is numericaly diagonal. We assume eigen values are the diagonal values.
+			{
+				eig1 = std::max( { cov_xx, cov_yy, cov_zz } );
+				eig3 = std::min( { cov_xx, cov_yy, cov_zz } );
+				eig2 = trC - eig1 - eig2;
+			}
+
+			eigenVectors_[ 0 ] = glm::vec3( cov_xy * cov_xy + cov_xz * cov_xz + ( cov_xx - eig2 ) * ( cov_xx - eig3 ),
+										   cov_xy * ( ( cov_xx - eig3 ) + ( cov_yy - eig2 ) ) + cov_xz * cov_yz,
+										   cov_xz * ( ( cov_xx - eig3 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz );
+
+			eigenVectors_[ 1 ] = glm::vec3( cov_xy * ( ( cov_xx - eig1 ) + ( cov_yy - eig3 ) ) + cov_xz * cov_yz,
+										   cov_yz * cov_yz + cov_xy * cov_xy + ( cov_yy - eig1 ) * ( cov_yy - eig3 ),
+										   cov_yz * ( ( cov_yy - eig3 ) + ( cov_zz - eig1 ) ) + cov_xy * cov_xz );
+
+			eigenVectors_[ 2 ] = glm::vec3( cov_xz * ( ( cov_xx - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz,
+										   cov_yz * ( ( cov_yy - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_xz,
+										   cov_yz * cov_yz + cov_xz * cov_xz + ( cov_zz - eig1 ) * ( cov_zz - eig2 ) );
+			
+			// Simplification of original method.
+			// We only need the first 2 eigen vectors for 2D projection.
+			// Therefor we are not intereted, which is bigger, but in leaving the smallest out.
+			float minEig = std::min( { eig1, eig2, eig3 } );
+
+			if ( eig3 == minEig )
+			{
+				eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
+				eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 1 ] );
+			}
+			else if ( eig2 == minEig )
+			{
+                                eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
+                                eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
+                            }
+			else //if ( eig1 == minEig ) most unlikly case
+			{
+                                eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 1 ] );
+                                eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
+                            }
+		}
+
+		std::vector<glm::vec2> facePointsProjected( face_vertIds.size() );
+		
+
+		std::transform(centeredPoints.cbegin(),centeredPoints.cend(),facePointsProjected.begin(),
+						[ &eigenVectors ]( const glm::vec3& cp )->glm::vec2
+						{
+							return glm::vec2(
+								glm::dot( cp, eigenVectors[0] ),
+								glm::dot( cp, eigenVectors[1] )
+							);
+						} );
+
+		// checking the orientation. CCW should be kept
+		float sum = 0.0;
+		for ( int i = 0; i < facePointsProjected.size() - 1; ++i )
+		{
+			sum += ( facePointsProjected[ i + 1 ].x - facePointsProjected[ i ].x ) *
+				( facePointsProjected[ i + 1 ].y + facePointsProjected[ i ].y );
+		}
+		sum += ( facePointsProjected.front().x - facePointsProjected.back().x ) *
+			( facePointsProjected.front().y + facePointsProjected.back().y );
+
+		if ( sum > 0.0f )
+		{
+			for ( int i = 0; i < facePointsProjected.size(); ++i )
+				facePointsProjected[ i ].y *= -1.0f;
+		}
+
+		std::vector<unsigned int> triIndices = triangulatePolygon( facePointsProjected );
+		
+		face_vertIdsFace2Tris.resize( triIndices.size() );
+		std::transform( triIndices.cbegin(), triIndices.cend(), face_vertIdsFace2Tris.begin(),
+						[ &face_vertIds ]( const unsigned int fTriId )->IndexedVert
+						{
+							return face_vertIds[ fTriId ];
+						} );
+
+	}
+	face_vertIds = std::move( face_vertIdsFace2Tris );
 }
 
-static std::vector<unsigned int> triangulatePolygon( const std::vector<glm::vec2>& );
+void ObjParser::computeFaceNormals( std::vector<IndexedVert>& face_vertIds, const std::vector<glm::vec3>& positions, glm::vec3* normals, const unsigned int firstNormal )
+{
+	for ( size_t i = 0; i + 2 < face_vertIds.size(); i += 3 )
+	{
+		glm::vec3 n = glm::normalize( glm::cross(
+			positions[face_vertIds[i + 1].v] - positions[face_vertIds[i].v],
+			positions[face_vertIds[i + 2].v] - positions[face_vertIds[i].v]
+		) );
+
+		unsigned int n_idx = firstNormal + static_cast<unsigned int>( i / 3 );
+		normals[ i / 3 ] = n;
+		face_vertIds[ i ].vn = face_vertIds[ i + 1 ].vn = face_vertIds[ i + 2 ].vn = n_idx;
+	}
+}
 
 ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
+{
+	// mapped from the AssetPack if it has the file, read from disk otherwise
+	const AssetData objRawData = ReadAsset( fileName );
+
+	if ( !objRawData.IsValid() ) throw(EXC_FILENOTFOUND);
+
+	return parseString( objRawData.GetText() );
+}
+
+ObjParser::Mesh ObjParser::parseString(const std::string_view objText)
 {
 	Mesh resultMesh;
 
@@ -84,24 +300,11 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 	std::vector<IndexedVert> face_vertIds;
 	face_vertIds.reserve( 4 );
 	bool needsNormalComputation = false;
-	std::unordered_map<IndexedVert, unsigned int, IndexedVertHash> vertexIndices;
-
-	std::error_code ec;
-	std::size_t fileSize = std::filesystem::file_size( fileName, ec );
-
-	if ( ec ) throw(EXC_FILENOTFOUND);
-
-	std::vector<char> objRawData( fileSize );
-
-	std::ifstream objFileStrm( fileName, std::ios::binary );
-
-	if ( !objFileStrm ) throw(EXC_FILENOTFOUND);
-
-	objFileStrm.read( objRawData.data(), fileSize );
+	IndexedVertTable vertexIndices;
 
 	InMemoryTokenizer tokenizer;
 
-	tokenizer.SetData( objRawData.data(), fileSize );
+	tokenizer.SetData( objText.data(), objText.size() );
 
 	unsigned int nIndexedVerts = 0;
 
@@ -142,56 +345,17 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 			case From2Char('v','\t'): // v <x> <y> <z> [<w>]
 			{
 				positions.emplace_back(glm::vec3());
-
-				float& x = positions.back().x;
-				float& y = positions.back().y;
-				float& z = positions.back().z;
-
-				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), x );
-				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), y );
-				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), z );
-				coordT = tokenizer.NextToken(true);
-
-				if ( !coordT.empty() )
-				{
-					float w;
-					std::from_chars( coordT.data(), coordT.data() + coordT.size(), w );
-					x /= w;
-					y /= w;
-					z /= w;
-				}
+				parsePosition( tokenizer, positions.back() );
 			}break;
 			case From2Char('v','n'): // vn <nx> <ny> <nz>
 			{
 				normals.emplace_back(glm::vec3());
-
-				float& x = normals.back().x;
-				float& y = normals.back().y;
-				float& z = normals.back().z;
-
-				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), x );
-				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), y );
-				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), z );
-				
+				parseNormal( tokenizer, normals.back() );
 			}break;
 			case From2Char('v','t'): // vt <s> <t>
 			{
 				texcoords.emplace_back(glm::vec2());
-
-				float& s = texcoords.back().x;
-				float& t = texcoords.back().y;
-
-				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), s );
-				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), t );
-	
+				parseTexcoord( tokenizer, texcoords.back() );
 			}break;
 			case From2Char('f',' '):
 			case From2Char('f','\t'): // f (<pi>[/<ti>][/<ni>])3+
@@ -203,228 +367,37 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 				while ( !faceVertT.empty() )
 				{
 					face_vertIds.emplace_back( IndexedVert{} );
-					IndexedVert& idxVert = face_vertIds.back();
-
-					size_t posEndOffs = faceVertT.find_first_of( '/', 0 );
-					if ( posEndOffs == std::string_view::npos ) posEndOffs = faceVertT.size();
-
-					std::from_chars( faceVertT.data(), faceVertT.data() + posEndOffs, idxVert.v );
-					idxVert.v--;
-
-					size_t texStartOffs = posEndOffs + 1;
-					size_t texEndOffs = faceVertT.find_first_of( '/', texStartOffs );
-					if ( texEndOffs == std::string_view::npos ) texEndOffs = faceVertT.size();
-					if ( texEndOffs > texStartOffs ) std::from_chars( faceVertT.data() + texStartOffs, faceVertT.data() + texEndOffs, idxVert.vt);
-					if ( idxVert.vt ) idxVert.vt--; 
-					size_t normStartOffs = texEndOffs + 1;
-
-					if ( faceVertT.size() > normStartOffs )
-					{
-						std::from_chars( faceVertT.data() + normStartOffs, faceVertT.data() + faceVertT.size(), idxVert.vn );
-						idxVert.vn--;
-					}
-					else needsNormalComputation = true;
+					if ( !parseFaceVertex( faceVertT, face_vertIds.back() ) ) needsNormalComputation = true;
 					
 					faceVertT = tokenizer.NextToken( true );
 				}
 
-				if ( 3 < face_vertIds.size() )
-				{
-					std::vector<IndexedVert> face_vertIdsFace2Tris;
-					if ( 4 == face_vertIds.size() )
-					{
-						glm::vec3 v10 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 1 ].v ];
-						glm::vec3 v12 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 1 ].v ];
-
-						glm::vec3 v32 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 3 ].v ];
-						glm::vec3 v30 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 3 ].v ];
+				if ( 3 < face_vertIds.size() ) triangulateFace( face_vertIds, positions );
 
-						float angle_012 = ::acosf( glm::dot(v10,v12) / sqrtf( glm::dot(v10,v10) * glm::dot(v12,v12) ) );
-						float angle_230 = ::acosf( glm::dot(v32,v30) / sqrtf( glm::dot(v32,v32) * glm::dot(v30,v30) ) );
-						
-						if ( ( angle_012 + angle_230 ) <= glm::pi<float>() )
-						{
-							face_vertIdsFace2Tris =
-							{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 2 ],
-							  face_vertIds[ 0 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
-						}
-						else
-						{
-							face_vertIdsFace2Tris =
-							{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 3 ],
-							  face_vertIds[ 1 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
-						}
-					}
-					else 
-					{
-						// Calculate the best fitting plane
-						glm::vec3 MidPoint( 0.0 );
-						for ( const auto& vertex : face_vertIds )
-						{
-							MidPoint += positions[ vertex.v ];
-						}
-						MidPoint /= float( face_vertIds.size() );
-
-						std::vector<glm::vec3> centeredPoints( face_vertIds.size() );
-
-						std::transform( face_vertIds.cbegin(), face_vertIds.cend(), centeredPoints.begin(),
-										[&positions,MidPoint]( const IndexedVert& faceV )->glm::vec3
-										{ return positions[ faceV.v ] - MidPoint;}
-										);
-
-						float cov_xx = 0.0f, cov_xy = 0.0f;
-						float cov_yy = 0.0f, cov_yz = 0.0f;
-						float cov_xz = 0.0f, cov_zz = 0.0f;
-
-						for ( const glm::vec3& centeredP : centeredPoints )
-						{
-							cov_xx += centeredP.x * centeredP.x;
-							cov_xy += centeredP.x * centeredP.y;
-							
-							cov_yy += centeredP.y * centeredP.y;
-							cov_yz += centeredP.y * centeredP.z;
-
-							cov_xz += centeredP.x * centeredP.z;
-							cov_zz += centeredP.z * centeredP.z;
-						}
-
-						// viktor-vad: Very strange, but the pca.hpp and pca.inc disappeared from glm/gtx.
-						// Did not find any explanation for this.
-						// Instead of some header file copy-hacking, I implemented a 3x3 verion of eigen decomposition.
-						// It was not intended, but most likely it is faster than the original glm pca, since that is a general method with Housholder and QR.
-						// https://dl.acm.org/doi/epdf/10.1145/355578.366316
-						// https://en.wikipedia.org/wiki/Eigenvalue_algorithm#2%C3%972_matrices
-						glm::vec3 eigenVectors[2];
-						{
-							glm::vec3 eigenVectors_[3];
-							float p1 = cov_xy * cov_xy + cov_xz * cov_xz + cov_yz * cov_yz;
-							float trC = cov_xx + cov_yy + cov_zz;
-							float eig1 = 0.0f, eig2 = 0.0f, eig3 = 0.0f;
-
-							// normal case
-							if ( p1 > 1e-15f )
-							{
-								float q = trC / 3.0f;
-								float p2 = ( cov_xx - q ) * ( cov_xx - q ) + ( cov_yy - q ) * ( cov_yy - q ) + ( cov_zz - q ) * ( cov_zz - q ) + 2.0f * p1;
-								float p = std::sqrt( p2 / 6.0f );
-
-								float cov_xx_q = cov_xx - q;
-								float cov_yy_q = cov_yy - q;
-								float cov_zz_q = cov_zz - q;
-
-								float r = glm::clamp( ( cov_xx_q * cov_yy_q * cov_zz_q + 2.0f * cov_xy * cov_yz * cov_xz - cov_xx_q * cov_yz * cov_yz - cov_yy_q * cov_xz * cov_xz - cov_zz_q * cov_xy * cov_xy ) / ( 2.0f * p * p * p ),
-													  -1.0f, 1.0f );
-
-								float phi = ::acosf( r ) / 3.0f;
-
-								eig1 = q + 2.0f * p * std::cos( phi );
-								eig2 = q + 2.0f * p * std::cos( phi + ( 2.0f * glm::pi<float>() / 3.0f ) );
-								eig3 = trC - eig1 - eig2;
-							}
-							else // covariance matrix is numericaly diagonal. We assume eigen values are the diagonal values.
-							{
-								eig1 = std::max( { cov_xx, cov_yy, cov_zz } );
-								eig3 = std::min( { cov_xx, cov_yy, cov_zz } );
-								eig2 = trC - eig1 - eig2;
-							}
-
-							eigenVectors_[ 0 ] = glm::vec3( cov_xy * cov_xy + cov_xz * cov_xz + ( cov_xx - eig2 ) * ( cov_xx - eig3 ),
-														   cov_xy * ( ( cov_xx - eig3 ) + ( cov_yy - eig2 ) ) + cov_xz * cov_yz,
-														   cov_xz * ( ( cov_xx - eig3 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz );
-
-							eigenVectors_[ 1 ] = glm::vec3( cov_xy * ( ( cov_xx - eig1 ) + ( cov_yy - eig3 ) ) + cov_xz * cov_yz,
-														   cov_yz * cov_yz + cov_xy * cov_xy + ( cov_yy - eig1 ) * ( cov_yy - eig3 ),
-														   cov_yz * ( ( cov_yy - eig3 ) + ( cov_zz - eig1 ) ) + cov_xy * cov_xz );
-
-							eigenVectors_[ 2 ] = glm::vec3( cov_xz * ( ( cov_xx - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz,
-														   cov_yz * ( ( cov_yy - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_xz,
-														   cov_yz * cov_yz + cov_xz * cov_xz + ( cov_zz - eig1 ) * ( cov_zz - eig2 ) );
-							
-							// Simplification of original method.
-							// We only need the first 2 eigen vectors for 2D projection.
-							// Therefor we are not intereted, which is bigger, but in leaving the smallest out.
-							float minEig = std::min( { eig1, eig2, eig3 } );
-
-							if ( eig3 == minEig )
-							{
-								eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
-								eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 1 ] );
-							}
-							else if ( eig2 == minEig )
-							{
-                                eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
-                                eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
-                            }
-							else //if ( eig1 == minEig ) most unlikly case
-							{
-                                eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 1 ] );
-                                eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
-                            }
-						}
-
-						std::vector<glm::vec2> facePointsProjected( face_vertIds.size() );
-						
-
-						std::transform(centeredPoints.cbegin(),centeredPoints.cend(),facePointsProjected.begin(),
-										[ &eigenVectors ]( const glm::vec3& cp )->glm::vec2
-										{
-											return glm::vec2(
-												glm::dot( cp, eigenVectors[0] ),
-												glm::dot( cp, eigenVectors[1] )
-											);
-										} );
-
-						// checking the orientation. CCW should be kept
-						float sum = 0.0;
-						for ( int i = 0; i < facePointsProjected.size() - 1; ++i )
-						{
-							sum += ( facePointsProjected[ i + 1 ].x - facePointsProjected[ i ].x ) *
-								( facePointsProjected[ i + 1 ].y + facePointsProjected[ i ].y );
-						}
-						sum += ( facePointsProjected.front().x - facePointsProjected.back().x ) *
-							( facePointsProjected.front().y + facePointsProjected.back().y );
-
-						if ( sum > 0.0f )
-						{
-							for ( int i = 0; i < facePointsProjected.size(); ++i )
-								facePointsProjected[ i ].y *= -1.0f;
-						}
-
-						std::vector<unsigned int> triIndices = triangulatePolygon( facePointsProjected );
-						
-						face_vertIdsFace2Tris.resize( triIndices.size() );
-						std::transform( triIndices.cbegin(), triIndices.cend(), face_vertIdsFace2Tris.begin(),
-										[ &face_vertIds ]( const unsigned int fTriId )->IndexedVert
-										{
-											return face_vertIds[ fTriId ];
-										} );
-
-					}
-					face_vertIds = std::move( face_vertIdsFace2Tris );
+				// The faces usually come last, as many more lines of this length as the text has left. A smooth mesh
+				// has about as many distinct vertices as its largest attribute array, that is the estimate if smaller.
+				if ( nIndexedVerts == 0 )
+				{
+					const std::size_t lineLength = static_cast<std::size_t>( tokenizer.GetPosition() - token.data() ) + 1;
+					const std::size_t textLeft = objText.size() - static_cast<std::size_t>( token.data() - objText.data() );
+					const std::size_t faceVertexCount = textLeft / lineLength * face_vertIds.size();
+					vertexIndices.Reserve( std::min( faceVertexCount, std::max( { positions.size(), normals.size(), texcoords.size() } ) ) );
 				}
 				
 				if ( texcoords.empty() ) texcoords.emplace_back( glm::vec2( 0.0 ) );
 				
 				if ( needsNormalComputation )
 				{
-					for ( int i = 0; i < face_vertIds.size(); i += 3 )
-					{
-						glm::vec3 n = glm::normalize( glm::cross(
-							positions[face_vertIds[i + 1].v] - positions[face_vertIds[i].v],
-							positions[face_vertIds[i + 2].v] - positions[face_vertIds[i].v]
-						) );
-
-						unsigned int n_idx = static_cast<unsigned int>( normals.size() );
-						normals.push_back( n );
-						face_vertIds[ i ].vn = face_vertIds[ i + 1 ].vn = face_vertIds[ i + 2 ].vn = n_idx;
-					}
+					unsigned int firstNormal = static_cast<unsigned int>( normals.size() );
+					normals.resize( firstNormal + face_vertIds.size() / 3 );
+					computeFaceNormals( face_vertIds, positions, normals.data() + firstNormal, firstNormal );
 				}
 
 
 				for ( const auto& vertex : face_vertIds )
 				{
-					unsigned int& vIndex = vertexIndices[ vertex ];
-					if (vIndex == 0) // new vertex
+					const auto [ vIndex, inserted ] = vertexIndices.TryEmplace( vertex, nIndexedVerts );
+					if ( inserted ) // new vertex
 					{
 						Vertex v;
 						v.position = positions[vertex.v];
@@ -432,11 +405,9 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 						v.normal = normals[vertex.vn];
 
 						resultMesh.vertexArray.push_back(v);
-						resultMesh.indexArray.push_back(nIndexedVerts++);
-						vIndex = nIndexedVerts;	
-					} else {
-						resultMesh.indexArray.push_back(vIndex-1);
+						++nIndexedVerts;
 					}
+					resultMesh.indexArray.push_back(vIndex);
 				}
 			}break;
 		}
@@ -472,9 +443,567 @@ static inline constexpr uint64_t fasthash64( uint64_t v, uint64_t seed )
 	return fasthash64_mix(h);
 }
 
-std::size_t ObjParser::IndexedVertHash::operator()( const IndexedVert& iv ) const noexcept
+// Face vertex deduplication
+
+ObjParser::IndexedVertTable::IndexedVertTable( const std::size_t expectedCount )
+{
+	Reserve( expectedCount );
+}
+
+void ObjParser::IndexedVertTable::Reserve( const std::size_t expectedCount )
+{
+	// at most 3/4 full, 16 slots at least
+	std::size_t slotCount = 16;
+	while ( slotCount / 4 * 3 < expectedCount ) slotCount *= 2;
+
+	if ( slotCount > m_slots.size() ) Rehash( slotCount );
+}
+
+std::pair<std::uint32_t, bool> ObjParser::IndexedVertTable::TryEmplace( const IndexedVert& vertex, const std::uint32_t index )
+{
+	if ( m_count + 1 > m_slots.size() / 4 * 3 ) Rehash( std::max<std::size_t>( 16, m_slots.size() * 2 ) );
+
+	for ( std::size_t i = fasthash64( vertex.v_vt, vertex.vn_64 ) & m_mask; ; i = ( i + 1 ) & m_mask )
+	{
+		Slot& slot = m_slots[ i ];
+		if ( slot.index == EMPTY_SLOT )
+		{
+			slot = Slot{ vertex.v, vertex.vt, vertex.vn, index };
+			++m_count;
+			return { index, true };
+		}
+		if ( slot.v == vertex.v && slot.vt == vertex.vt && slot.vn == vertex.vn ) return { slot.index, false };
+	}
+}
+
+void ObjParser::IndexedVertTable::Clear() noexcept
+{
+	std::fill( m_slots.begin(), m_slots.end(), Slot{ 0, 0, 0, EMPTY_SLOT } );
+	m_count = 0;
+}
+
+void ObjParser::IndexedVertTable::Rehash( const std::size_t slotCount )
+{
+	std::vector<Slot> oldSlots( slotCount, Slot{ 0, 0, 0, EMPTY_SLOT } );
+	oldSlots.swap( m_slots );
+	m_mask = slotCount - 1;
+
+	for ( const Slot& slot : oldSlots )
+	{
+		if ( slot.index == EMPTY_SLOT ) continue;
+
+		IndexedVert vertex;
+		vertex.v  = slot.v;
+		vertex.vt = slot.vt;
+		vertex.vn = slot.vn;
+		std::size_t i = fasthash64( vertex.v_vt, vertex.vn_64 ) & m_mask;
+		while ( m_slots[ i ].index != EMPTY_SLOT ) i = ( i + 1 ) & m_mask;
+		m_slots[ i ] = slot;
+	}
+}
+
+// Parallel parsing
+
+// smaller files are parsed serially, the chunks would not pay off
+static constexpr std::size_t PARALLEL_MIN_BYTES = 4u << 20;
+static constexpr std::size_t CHUNK_MIN_BYTES    = 1u << 20;
+// the distinct vertices of the chunks are merged in this many independent parts
+static constexpr std::size_t MERGE_SHARD_COUNT  = 64;
+static constexpr std::uint32_t NO_COMPUTED_NORMALS = ~0u;
+
+struct ObjParser::Chunk
+{
+	std::string_view text;
+
+	// the records in file order, the indices in the faces refer to the whole file already
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals; // the vn records and a slot for every computed normal, where the serial parser appends it
+	std::vector<glm::vec2> texcoords;
+	bool faceBeforeTexcoord = false; // a face comes before the first vt of the chunk
+
+	struct Face
+	{
+		std::uint32_t firstVert;
+		std::uint32_t vertCount;
+		std::uint32_t firstNormal; // slot of its first computed normal, NO_COMPUTED_NORMALS if the file has them
+	};
+	std::vector<IndexedVert> faceVerts;
+	std::vector<Face>        faces;
+
+	// where the records go in the whole file's arrays
+	std::size_t positionOffset = 0;
+	std::size_t normalOffset   = 0;
+	std::size_t texcoordOffset = 0;
+
+	// the distinct face vertices in order of first use, and the triangles as indices into them
+	std::vector<IndexedVert>   keys;
+	std::vector<std::uint32_t> localIndices;
+	std::array<std::vector<std::uint32_t>, MERGE_SHARD_COUNT> shardKeys;
+
+	// per key: chunk << 32 | key of its first use in the whole file, and its index in the mesh
+	std::vector<std::uint64_t> firstUses;
+	std::vector<std::uint32_t> vertexIndices;
+	std::size_t firstVertex = 0;
+	std::size_t firstIndex  = 0;
+};
+
+void ObjParser::parseChunk( Chunk& chunk )
+{
+	InMemoryTokenizer tokenizer;
+
+	tokenizer.SetData( chunk.text.data(), chunk.text.size() );
+
+	while ( tokenizer )
+	{
+		std::string_view token = tokenizer.NextToken();
+
+		// only whitespace is left, its first byte would already be the next chunk's
+		if ( token.empty() ) break;
+
+		if ( token[ 0 ] == '#' )
+		{
+			tokenizer.ToNextLine();
+			continue;
+		}
+
+		// the same records as in the serial parser, the names are read only to skip them the same way
+		switch ( *reinterpret_cast<const unsigned short*>( token.data() ) )
+		{
+			case From2Char('m','t'):
+			case From2Char('u','s'):
+			case From2Char('o',' '):
+			case From2Char('o','\t'):
+			case From2Char('g',' '):
+			case From2Char('g','\t'):
+			{
+				tokenizer.NextToken();
+			}break;
+			case From2Char('v',' '):
+			case From2Char('v','\t'):
+			{
+				chunk.positions.emplace_back(glm::vec3());
+				parsePosition( tokenizer, chunk.positions.back() );
+			}break;
+			case From2Char('v','n'):
+			{
+				chunk.normals.emplace_back(glm::vec3());
+				parseNormal( tokenizer, chunk.normals.back() );
+			}break;
+			case From2Char('v','t'):
+			{
+				chunk.texcoords.emplace_back(glm::vec2());
+				parseTexcoord( tokenizer, chunk.texcoords.back() );
+			}break;
+			case From2Char('f',' '):
+			case From2Char('f','\t'):
+			{
+				Chunk::Face face{ static_cast<std::uint32_t>( chunk.faceVerts.size() ), 0, NO_COMPUTED_NORMALS };
+				bool needsNormalComputation = false;
+
+				for ( std::string_view faceVertT = tokenizer.NextToken( true ); !faceVertT.empty(); faceVertT = tokenizer.NextToken( true ) )
+				{
+					chunk.faceVerts.emplace_back( IndexedVert{} );
+					if ( !parseFaceVertex( faceVertT, chunk.faceVerts.back() ) ) needsNormalComputation = true;
+				}
+				face.vertCount = static_cast<std::uint32_t>( chunk.faceVerts.size() ) - face.firstVert;
+
+				if ( chunk.texcoords.empty() ) chunk.faceBeforeTexcoord = true;
+
+				// a polygon of n vertices becomes n - 2 triangles, a normal each
+				if ( needsNormalComputation )
+				{
+					face.firstNormal = static_cast<std::uint32_t>( chunk.normals.size() );
+					chunk.normals.resize( chunk.normals.size() + ( face.vertCount >= 3 ? face.vertCount - 2 : 0 ) );
+				}
+
+				chunk.faces.push_back( face );
+			}break;
+		}
+
+		tokenizer.ToNextLine();
+	}
+}
+
+void ObjParser::triangulateChunk( Chunk& chunk, const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals )
+{
+	// at most one distinct vertex per face vertex, unless faces were split or got computed normals
+	IndexedVertTable vertexIndices( chunk.faceVerts.size() );
+	std::vector<IndexedVert> face_vertIds;
+
+	for ( const Chunk::Face& face : chunk.faces )
+	{
+		face_vertIds.assign( chunk.faceVerts.cbegin() + face.firstVert, chunk.faceVerts.cbegin() + face.firstVert + face.vertCount );
+
+		if ( 3 < face_vertIds.size() ) triangulateFace( face_vertIds, positions );
+
+		if ( face.firstNormal != NO_COMPUTED_NORMALS )
+		{
+			const std::size_t firstNormal = chunk.normalOffset + face.firstNormal;
+			computeFaceNormals( face_vertIds, positions, normals.data() + firstNormal, static_cast<unsigned int>( firstNormal ) );
+		}
+
+		for ( const IndexedVert& vertex : face_vertIds )
+		{
+			const auto [ key, inserted ] = vertexIndices.TryEmplace( vertex, static_cast<std::uint32_t>( chunk.keys.size() ) );
+			if ( inserted ) chunk.keys.push_back( vertex );
+			chunk.localIndices.push_back( key );
+		}
+	}
+
+	// the records are not needed any more, they are in the whole file's arrays
+	chunk.faceVerts = {};
+	chunk.faces = {};
+
+	for ( std::uint32_t key = 0; key < chunk.keys.size(); ++key )
+		chunk.shardKeys[ fasthash64_mix( chunk.keys[ key ].v ) % MERGE_SHARD_COUNT ].push_back( key );
+}
+
+ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName, WorkerPool& workers)
+{
+	// mapped from the AssetPack if it has the file, read from disk otherwise
+	const AssetData objRawData = ReadAsset( fileName );
+
+	if ( !objRawData.IsValid() ) throw(EXC_FILENOTFOUND);
+
+	return parseString( objRawData.GetText(), workers );
+}
+
+ObjParser::Mesh ObjParser::parseString(const std::string_view objText, WorkerPool& workers)
+{
+	if ( objText.size() < PARALLEL_MIN_BYTES || workers.GetThreadCount() == 0 ) return parseString( objText );
+
+	// split at line starts, where the serial parser is always between two records
+	const std::size_t chunkCount = std::max<std::size_t>( 1, std::min<std::size_t>( objText.size() / CHUNK_MIN_BYTES, ( workers.GetThreadCount() + 1 ) * 4 ) );
+	std::vector<Chunk> chunks( chunkCount );
+	for ( std::size_t i = 0, start = 0; i < chunkCount; ++i )
+	{
+		std::size_t end = objText.size();
+		if ( i + 1 < chunkCount )
+		{
+			end = objText.find( '\n', std::max( start, objText.size() / chunkCount * ( i + 1 ) ) );
+			end = end == std::string_view::npos ? objText.size() : end + 1;
+		}
+		chunks[ i ].text = objText.substr( start, end - start );
+		start = end;
+	}
+
+	workers.ParallelFor( chunkCount, [ &chunks ]( const std::size_t i ) { parseChunk( chunks[ i ] ); } );
+
+	// prefix sums of the record counts; the serial parser adds a zero texcoord at the first face if no vt came before it
+	bool defaultTexcoord = false;
+	std::size_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+	for ( Chunk& chunk : chunks )
+	{
+		if ( texcoordCount == 0 && chunk.faceBeforeTexcoord ) defaultTexcoord = true;
+
+		chunk.positionOffset = positionCount;
+		chunk.normalOffset   = normalCount;
+		chunk.texcoordOffset = texcoordCount;
+		positionCount += chunk.positions.size();
+		normalCount   += chunk.normals.size();
+		texcoordCount += chunk.texcoords.size();
+	}
+
+	std::vector<glm::vec3> positions( positionCount );
+	std::vector<glm::vec3> normals( normalCount );
+	std::vector<glm::vec2> texcoords( texcoordCount + ( defaultTexcoord ? 1 : 0 ), glm::vec2( 0.0 ) );
+	workers.ParallelFor( chunkCount, [ & ]( const std::size_t i )
+	{
+		Chunk& chunk = chunks[ i ];
+		std::copy( chunk.positions.cbegin(), chunk.positions.cend(), positions.begin() + chunk.positionOffset );
+		std::copy( chunk.normals.cbegin(), chunk.normals.cend(), normals.begin() + chunk.normalOffset );
+		std::copy( chunk.texcoords.cbegin(), chunk.texcoords.cend(), texcoords.begin() + chunk.texcoordOffset + ( defaultTexcoord ? 1 : 0 ) );
+		chunk.positions = {};
+		chunk.normals = {};
+		chunk.texcoords = {};
+	} );
+
+	// the computed normals go to their slots, every chunk writes only its own
+	workers.ParallelFor( chunkCount, [ & ]( const std::size_t i ) { triangulateChunk( chunks[ i ], positions, normals ); } );
+
+	// The vertices are numbered in order of first use, as in the serial parser. A vertex is first used in the
+	// earliest chunk that has it, so every shard of the vertices walks the chunks in order and remembers where
+	// each one was first used. The shards are independent: a vertex always falls into the same one.
+	for ( Chunk& chunk : chunks )
+	{
+		chunk.firstUses.resize( chunk.keys.size() );
+		chunk.vertexIndices.resize( chunk.keys.size() );
+	}
+
+	workers.ParallelFor( MERGE_SHARD_COUNT, [ & ]( const std::size_t shard )
+	{
+		std::size_t keyCount = 0;
+		for ( const Chunk& chunk : chunks )
+			keyCount += chunk.shardKeys[ shard ].size();
+
+		// the distinct vertices of the shard, numbered in the order they are found
+		IndexedVertTable vertexIds( keyCount );
+		std::vector<std::uint64_t> firstUses;
+		firstUses.reserve( keyCount );
+		for ( std::size_t c = 0; c < chunkCount; ++c )
+		{
+			Chunk& chunk = chunks[ c ];
+			for ( const std::uint32_t key : chunk.shardKeys[ shard ] )
+			{
+				const auto [ id, inserted ] = vertexIds.TryEmplace( chunk.keys[ key ], static_cast<std::uint32_t>( firstUses.size() ) );
+				if ( inserted ) firstUses.push_back( static_cast<std::uint64_t>( c ) << 32 | key );
+				chunk.firstUses[ key ] = firstUses[ id ];
+			}
+		}
+	} );
+
+	// the vertices first used in a chunk follow those of the chunks before it
+	auto isFirstUse = []( const std::size_t c, const std::uint32_t key, const std::uint64_t firstUse ) { return firstUse == ( static_cast<std::uint64_t>( c ) << 32 | key ); };
+
+	std::size_t vertexCount = 0, indexCount = 0;
+	for ( std::size_t c = 0; c < chunkCount; ++c )
+	{
+		Chunk& chunk = chunks[ c ];
+		chunk.firstVertex = vertexCount;
+		chunk.firstIndex  = indexCount;
+		for ( std::uint32_t key = 0; key < chunk.keys.size(); ++key )
+			if ( isFirstUse( c, key, chunk.firstUses[ key ] ) ) ++vertexCount;
+		indexCount += chunk.localIndices.size();
+	}
+
+	Mesh resultMesh;
+	resultMesh.vertexArray.resize( vertexCount );
+	resultMesh.indexArray.resize( indexCount );
+
+	workers.ParallelFor( chunkCount, [ & ]( const std::size_t c )
+	{
+		Chunk& chunk = chunks[ c ];
+		std::size_t vertexIndex = chunk.firstVertex;
+		for ( std::uint32_t key = 0; key < chunk.keys.size(); ++key )
+		{
+			if ( !isFirstUse( c, key, chunk.firstUses[ key ] ) ) continue;
+
+			const IndexedVert& vertex = chunk.keys[ key ];
+			Vertex& v = resultMesh.vertexArray[ vertexIndex ];
+			v.position = positions[vertex.v];
+			v.texcoord = texcoords[vertex.vt];
+			v.normal = normals[vertex.vn];
+
+			chunk.vertexIndices[ key ] = static_cast<std::uint32_t>( vertexIndex++ );
+		}
+	} );
+
+	// the rest of the vertices were numbered in an earlier chunk
+	workers.ParallelFor( chunkCount, [ & ]( const std::size_t c )
+	{
+		Chunk& chunk = chunks[ c ];
+		for ( std::uint32_t key = 0; key < chunk.keys.size(); ++key )
+		{
+			const std::uint64_t firstUse = chunk.firstUses[ key ];
+			if ( !isFirstUse( c, key, firstUse ) )
+				chunk.vertexIndices[ key ] = chunks[ firstUse >> 32 ].vertexIndices[ static_cast<std::uint32_t>( firstUse ) ];
+		}
+
+		std::transform( chunk.localIndices.cbegin(), chunk.localIndices.cend(), resultMesh.indexArray.begin() + chunk.firstIndex,
+						[ &chunk ]( const std::uint32_t key ) { return chunk.vertexIndices[ key ]; } );
+	} );
+
+	return resultMesh;
+}
+
+// Streaming
+
+// the computed normals live in the batch, their vn has this bit set to tell them from the vn records
+static constexpr std::uint32_t COMPUTED_NORMAL = 1u << 31;
+
+struct ObjParser::Stream
+{
+	Stream( const BatchCallback& onBatch, const StreamLimits& limits ) : onBatch( onBatch ), limits( limits ), vertexIndices( limits.batchVertexCount ) {}
+
+	const BatchCallback& onBatch;
+	const StreamLimits   limits;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<IndexedVert> face_vertIds;
+
+	// the batch being filled
+	std::vector<glm::vec3> computedNormals;
+	IndexedVertTable       vertexIndices;
+	std::vector<Vertex>    vertices;
+	std::vector<GLuint>    indices;
+	std::size_t firstVertex = 0;
+	std::size_t firstIndex  = 0;
+};
+
+void ObjParser::parseStreamText( Stream& stream, const std::string_view text )
+{
+	InMemoryTokenizer tokenizer;
+
+	tokenizer.SetData( text.data(), text.size() );
+
+	while ( tokenizer )
+	{
+		std::string_view token = tokenizer.NextToken();
+
+		// only whitespace is left
+		if ( token.empty() ) break;
+
+		if ( token[ 0 ] == '#' )
+		{
+			tokenizer.ToNextLine();
+			continue;
+		}
+
+		// the same records as in the serial parser
+		switch ( *reinterpret_cast<const unsigned short*>( token.data() ) )
+		{
+			case From2Char('m','t'):
+			case From2Char('u','s'):
+			case From2Char('o',' '):
+			case From2Char('o','\t'):
+			case From2Char('g',' '):
+			case From2Char('g','\t'):
+			{
+				tokenizer.NextToken();
+			}break;
+			case From2Char('v',' '):
+			case From2Char('v','\t'):
+			{
+				stream.positions.emplace_back(glm::vec3());
+				parsePosition( tokenizer, stream.positions.back() );
+			}break;
+			case From2Char('v','n'):
+			{
+				stream.normals.emplace_back(glm::vec3());
+				parseNormal( tokenizer, stream.normals.back() );
+			}break;
+			case From2Char('v','t'):
+			{
+				stream.texcoords.emplace_back(glm::vec2());
+				parseTexcoord( tokenizer, stream.texcoords.back() );
+			}break;
+			case From2Char('f',' '):
+			case From2Char('f','\t'):
+			{
+				stream.face_vertIds.clear();
+				bool needsNormalComputation = false;
+
+				for ( std::string_view faceVertT = tokenizer.NextToken( true ); !faceVertT.empty(); faceVertT = tokenizer.NextToken( true ) )
+				{
+					stream.face_vertIds.emplace_back( IndexedVert{} );
+					if ( !parseFaceVertex( faceVertT, stream.face_vertIds.back() ) ) needsNormalComputation = true;
+				}
+
+				addStreamFace( stream, needsNormalComputation );
+			}break;
+		}
+
+		tokenizer.ToNextLine();
+	}
+}
+
+void ObjParser::addStreamFace( Stream& stream, const bool needsNormalComputation )
+{
+	std::vector<IndexedVert>& face_vertIds = stream.face_vertIds;
+
+	if ( 3 < face_vertIds.size() ) triangulateFace( face_vertIds, stream.positions );
+
+	if ( stream.texcoords.empty() ) stream.texcoords.emplace_back( glm::vec2( 0.0 ) );
+
+	// faces are not split: the batch is full if this one does not fit any more
+	if ( !stream.indices.empty()
+		 && ( stream.vertices.size() + face_vertIds.size() > stream.limits.batchVertexCount || stream.indices.size() + face_vertIds.size() > stream.limits.batchIndexCount ) )
+		flushStream( stream );
+
+	if ( needsNormalComputation )
+	{
+		const std::size_t firstNormal = stream.computedNormals.size();
+		stream.computedNormals.resize( firstNormal + face_vertIds.size() / 3 );
+		computeFaceNormals( face_vertIds, stream.positions, stream.computedNormals.data() + firstNormal, COMPUTED_NORMAL | static_cast<unsigned int>( firstNormal ) );
+	}
+
+	for ( const IndexedVert& vertex : face_vertIds )
+	{
+		const auto [ vIndex, inserted ] = stream.vertexIndices.TryEmplace( vertex, static_cast<std::uint32_t>( stream.vertices.size() ) );
+		if ( inserted )
+		{
+			Vertex v;
+			v.position = stream.positions[vertex.v];
+			v.texcoord = stream.texcoords[vertex.vt];
+			v.normal = ( vertex.vn & COMPUTED_NORMAL ) ? stream.computedNormals[vertex.vn & ~COMPUTED_NORMAL] : stream.normals[vertex.vn];
+
+			stream.vertices.push_back(v);
+		}
+		stream.indices.push_back( static_cast<GLuint>( stream.firstVertex + vIndex ) );
+	}
+}
+
+void ObjParser::flushStream( Stream& stream )
 {
-	return fasthash64( iv.vt, iv.vn_64 );
+	if ( stream.indices.empty() ) return;
+
+	stream.onBatch( Batch{ stream.vertices.data(), stream.vertices.size(), stream.indices.data(), stream.indices.size(), stream.firstVertex, stream.firstIndex } );
+
+	stream.firstVertex += stream.vertices.size();
+	stream.firstIndex  += stream.indices.size();
+	stream.vertices.clear();
+	stream.indices.clear();
+	stream.computedNormals.clear();
+	stream.vertexIndices.Clear();
+}
+
+void ObjParser::parseStream(const std::filesystem::path& fileName, const BatchCallback& onBatch, const StreamLimits& limits)
+{
+	// a packed file is mapped already, the OS pages it in and drops it again as needed
+	const AssetData packed = FindPackedAsset( fileName );
+	if ( packed.IsValid() )
+	{
+		parseStreamString( packed.GetText(), onBatch, limits );
+		return;
+	}
+
+	std::ifstream file( fileName, std::ios::binary );
+	if ( !file ) throw(EXC_FILENOTFOUND);
+
+	Stream stream( onBatch, limits );
+
+	// The whole lines of the window are parsed, the rest is moved to its front and completed by the next read.
+	// One byte more than the window: the tokenizer may read the byte after the last token.
+	std::vector<char> window( std::max<std::size_t>( limits.windowBytes, 2 ) + 1 );
+	std::size_t filled = 0;
+	for ( bool endOfFile = false; !endOfFile; )
+	{
+		file.read( window.data() + filled, static_cast<std::streamsize>( window.size() - 1 - filled ) );
+		filled += static_cast<std::size_t>( file.gcount() );
+		endOfFile = !file;
+		window[ filled ] = '\0';
+
+		std::size_t linesEnd = filled;
+		if ( !endOfFile )
+		{
+			const std::size_t lastNewLine = std::string_view( window.data(), filled ).rfind( '\n' );
+			// a line longer than the window
+			if ( lastNewLine == std::string_view::npos )
+			{
+				window.resize( ( window.size() - 1 ) * 2 + 1 );
+				continue;
+			}
+			linesEnd = lastNewLine + 1;
+		}
+
+		parseStreamText( stream, std::string_view( window.data(), linesEnd ) );
+
+		std::memmove( window.data(), window.data() + linesEnd, filled - linesEnd );
+		filled -= linesEnd;
+	}
+
+	flushStream( stream );
+}
+
+void ObjParser::parseStreamString(const std::string_view objText, const BatchCallback& onBatch, const StreamLimits& limits)
+{
+	Stream stream( onBatch, limits );
+
+	parseStreamText( stream, objText );
+
+	flushStream( stream );
 }
 
 static std::vector<unsigned int> triangulatePolygon( const std::vector<glm::vec2>& polygon )
@@ -3,11 +3,14 @@
 #include <filesystem>
 #include <fstream>
 #include <vector>
-#include <unordered_map>
+#include <cstdint>
 #include <functional>
+#include <utility>
+#include <string_view>
 
 #include "GLUtils.hpp"
 
+class WorkerPool;
 
 class ObjParser
 {
@@ -16,10 +19,52 @@ public:
 	typedef MeshObject<Vertex> Mesh;
 
 	static Mesh parse(const std::filesystem::path& fileName);
+	// The contents of an .obj file, followed by a readable zero byte ( as AssetData is ). Not an overload of
+	// parse: a string literal would convert to both a path and a string_view.
+	static Mesh parseString(const std::string_view objText);
+
+	// The same mesh as parse, byte for byte, with large files split at line boundaries into chunks parsed on the workers.
+	// The records of every chunk are parsed in parallel, prefix sums of their counts place them in the mesh,
+	// then the faces are triangulated and their vertices deduplicated per chunk and merged in parallel.
+	static Mesh parse(const std::filesystem::path& fileName, WorkerPool& workers);
+	static Mesh parseString(const std::string_view objText, WorkerPool& workers);
+
+	// A part of a streamed mesh. The indices count the vertices of all batches so far, so the batches
+	// appended in the order they come make up one mesh.
+	struct Batch
+	{
+		const Vertex* vertices;
+		std::size_t   vertexCount;
+		const GLuint* indices;
+		std::size_t   indexCount;
+		std::size_t   firstVertex; // the number of vertices and indices in the batches before
+		std::size_t   firstIndex;
+	};
+	// Called on the parsing thread, the arrays are valid until it returns.
+	typedef std::function<void( const Batch& batch )> BatchCallback;
+
+	struct StreamLimits
+	{
+		std::size_t windowBytes;      // text in memory at a time, more only for a longer line
+		std::size_t batchVertexCount; // a batch holds at least one face, even if that is more
+		std::size_t batchIndexCount;
+	};
+	static constexpr StreamLimits DEFAULT_STREAM_LIMITS{ 1u << 20, 1u << 16, 3u << 16 };
+
+	// The mesh of parse in batches, for meshes too large to hold next to their text. A plain file is read
+	// through a window of limits.windowBytes, a file in the AssetPack is parsed from its mapped view. Kept in
+	// memory are the v, vn and vt records ( 12, 12 and 8 bytes each, any face may refer to any of them ), the
+	// window, and one batch with its deduplication table. Triangles are the same as parse's in the same order,
+	// but a vertex used by several batches is emitted by each of them. The computed normals are not numbered
+	// among the vn records, as parse numbers them, so vn records after such a face keep their index in the file.
+	// Throws EXC_FILENOTFOUND before any batch.
+	static void parseStream(const std::filesystem::path& fileName, const BatchCallback& onBatch, const StreamLimits& limits = DEFAULT_STREAM_LIMITS);
+	// The contents of an .obj file, followed by a readable zero byte ( as AssetData is ).
+	static void parseStreamString(const std::string_view objText, const BatchCallback& onBatch, const StreamLimits& limits = DEFAULT_STREAM_LIMITS);
 
 	enum Exception { EXC_FILENOTFOUND };
 
-private:
+	// A face vertex: the indices of its position, texcoord and normal.
 	struct IndexedVert
 	{
 		union
@@ -48,8 +93,56 @@ private:
 
 	};
 
-	struct IndexedVertHash
+	// Face vertex -> its index in the mesh. Open addressing with linear probing in one flat array, hashing
+	// all three indices. Sized up front for the expected number of distinct vertices, doubles past 3/4 full.
+	// Public for ObjParserBenchmark.
+	class IndexedVertTable
 	{
-		std::size_t operator()( const IndexedVert& iv ) const noexcept;
+	public:
+		explicit IndexedVertTable( const std::size_t expectedCount = 0 );
+
+		// Makes room for expectedCount vertices without growing.
+		void Reserve( const std::size_t expectedCount );
+		// Empties the table, keeping its size.
+		void Clear() noexcept;
+		// The index of vertex and false if the table has it, otherwise index is stored and returned with true.
+		std::pair<std::uint32_t, bool> TryEmplace( const IndexedVert& vertex, const std::uint32_t index );
+
+		inline std::size_t GetCount() const noexcept { return m_count; }
+
+	private:
+		struct Slot
+		{
+			std::uint32_t v, vt, vn;
+			std::uint32_t index; // EMPTY_SLOT if unused
+		};
+		static constexpr std::uint32_t EMPTY_SLOT = ~0u;
+
+		void Rehash( const std::size_t slotCount );
+
+		std::vector<Slot> m_slots;
+		std::size_t m_mask  = 0;
+		std::size_t m_count = 0;
 	};
+
+private:
+	struct Chunk;
+
+	static void parseChunk( Chunk& chunk );
+	static void triangulateChunk( Chunk& chunk, const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals );
+
+	struct Stream;
+
+	// whole lines, followed by a readable byte
+	static void parseStreamText( Stream& stream, const std::string_view text );
+	static void addStreamFace( Stream& stream, const bool needsNormalComputation );
+	// hands the batch to the callback and starts the next one
+	static void flushStream( Stream& stream );
+
+	// false if the face vertex has no normal
+	static bool parseFaceVertex( const std::string_view faceVertT, IndexedVert& idxVert );
+	// splits a polygon of more than 3 vertices into triangles
+	static void triangulateFace( std::vector<IndexedVert>& face_vertIds, const std::vector<glm::vec3>& positions );
+	// a flat normal per triangle, written to normals and referenced as firstNormal, firstNormal + 1, ...
+	static void computeFaceNormals( std::vector<IndexedVert>& face_vertIds, const std::vector<glm::vec3>& positions, glm::vec3* normals, const unsigned int firstNormal );
 };
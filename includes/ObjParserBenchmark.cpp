@@ -0,0 +1,333 @@
+#include "ObjParserBenchmark.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "AssetPack.h"
+#include "InMemoryTokenizer.h"
+#include "ObjParser.h"
+
+namespace
+{
+	constexpr int RUNS = 5;
+
+	// the best of RUNS, the first run also warms up the caches
+	template <typename Function>
+	double BestMilliseconds( Function&& function )
+	{
+		double best = std::numeric_limits<double>::max();
+		for ( int run = 0; run < RUNS; ++run )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			best = std::min( best, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+		}
+		return best;
+	}
+
+	void Report( const std::string& label, const char* name, const std::size_t bytes, const double oldMs, const double newMs, const bool same )
+	{
+		const double megabytes = static_cast<double>( bytes ) / ( 1 << 20 );
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %-16s %-8s %8.0f -> %8.0f MB/s ( %5.2fx )%s",
+					 label.c_str(), name, megabytes / oldMs * 1000.0, megabytes / newMs * 1000.0, oldMs / newMs, same ? "" : "  OUTPUT DIFFERS" );
+	}
+
+	// the previous ObjParser.cpp tokenizer
+	class OldTokenizer
+	{
+	public:
+		void SetData( const char* ptr, size_t Length ) noexcept
+		{
+			this->currentPtr = ptr;
+			this->endPtr = ptr + Length;
+		}
+
+		std::string_view NextToken() noexcept
+		{
+			for ( ;currentPtr < endPtr
+					&& std::isspace(static_cast<unsigned char>(*currentPtr) ); ++currentPtr )
+			{
+			}
+			const char* tPtr = currentPtr;
+			std::size_t tLength = 0;
+
+			while ( currentPtr < endPtr
+					&& !std::isspace(static_cast<unsigned char>(*currentPtr) ) )
+			{
+				currentPtr++;
+				tLength++;
+			}
+
+			return std::string_view( tPtr, tLength );
+		}
+
+		void ToNextLine() noexcept
+		{
+			while ( currentPtr < endPtr && *currentPtr != '\n' )
+				currentPtr++;
+			currentPtr++;
+		}
+
+		operator bool() const noexcept
+		{
+			return currentPtr < endPtr;
+		}
+
+	private:
+		const char* currentPtr = nullptr;
+		const char* endPtr = nullptr;
+	};
+
+	// where every token starts and how long it is, folded into one number
+	template <typename Tokenizer>
+	std::uint64_t HashTokens( const std::string_view text )
+	{
+		Tokenizer tokenizer;
+		tokenizer.SetData( text.data(), text.size() );
+
+		std::uint64_t hash = 0;
+		while ( tokenizer )
+		{
+			const std::string_view token = tokenizer.NextToken();
+			hash = hash * 31 + static_cast<std::uint64_t>( token.data() - text.data() ) * 64 + token.size();
+		}
+		return hash;
+	}
+
+	template <typename Tokenizer>
+	std::size_t CountLines( const std::string_view text )
+	{
+		Tokenizer tokenizer;
+		tokenizer.SetData( text.data(), text.size() );
+
+		std::size_t lines = 0;
+		for ( ; tokenizer; tokenizer.ToNextLine() )
+			++lines;
+		return lines;
+	}
+
+	// the coordinates of the v, vn and vt records
+	std::vector<std::string_view> GetCoordinates( const std::string_view text )
+	{
+		std::vector<std::string_view> coordinates;
+
+		InMemoryTokenizer tokenizer;
+		tokenizer.SetData( text.data(), text.size() );
+		while ( tokenizer )
+		{
+			const std::string_view token = tokenizer.NextToken();
+			if ( token == "v" || token == "vn" || token == "vt" )
+			{
+				for ( std::string_view coordinate = tokenizer.NextToken( true ); !coordinate.empty(); coordinate = tokenizer.NextToken( true ) )
+					coordinates.push_back( coordinate );
+			}
+			tokenizer.ToNextLine();
+		}
+		return coordinates;
+	}
+
+	// the previous face vertex deduplication: a node per vertex, the hash leaves the position out
+	constexpr std::uint64_t fasthash64_mix( std::uint64_t h )
+	{
+		h ^= h >> 23;
+		h *= 0x2127599bf4325c37ULL;
+		h ^= h >> 47;
+		return h;
+	}
+
+	constexpr std::uint64_t fasthash64( std::uint64_t v, std::uint64_t seed )
+	{
+		constexpr std::uint64_t m = 0x880355f21e6d1965ULL;
+		std::uint64_t h = seed ^ ( m * sizeof( std::uint64_t ) );
+		h ^= fasthash64_mix( v );
+		h *= m * m;
+		return fasthash64_mix( h );
+	}
+
+	struct OldIndexedVertHash
+	{
+		std::size_t operator()( const ObjParser::IndexedVert& iv ) const noexcept { return fasthash64( iv.vt, iv.vn_64 ); }
+	};
+
+	// The face vertices of a ( rows + 1 ) x ( columns + 1 ) grid of quads split into triangles. Each grid point has its own
+	// texcoord and normal, or every face vertex refers to the same texcoord and normal.
+	std::vector<ObjParser::IndexedVert> MakeFaceVertices( const int rows, const int columns, const bool sharedAttributes )
+	{
+		std::vector<ObjParser::IndexedVert> faceVertices;
+		faceVertices.reserve( static_cast<std::size_t>( rows ) * columns * 6 );
+		auto append = [ & ]( const std::uint32_t v )
+		{
+			ObjParser::IndexedVert vertex;
+			vertex.v  = v;
+			vertex.vt = sharedAttributes ? 0 : v;
+			vertex.vn = sharedAttributes ? 0 : v;
+			faceVertices.push_back( vertex );
+		};
+		for ( int row = 0; row < rows; ++row )
+		{
+			for ( int column = 0; column < columns; ++column )
+			{
+				const std::uint32_t a = row * ( columns + 1 ) + column, b = a + columns + 1;
+				for ( const std::uint32_t v : { a, b, b + 1, a, b + 1, a + 1 } ) append( v );
+			}
+		}
+		return faceVertices;
+	}
+
+	void BenchmarkDeduplication( const int size, const bool sharedAttributes, const bool runOld )
+	{
+		const std::vector<ObjParser::IndexedVert> faceVertices = MakeFaceVertices( size, size, sharedAttributes );
+		const std::size_t gridPoints = static_cast<std::size_t>( size + 1 ) * ( size + 1 );
+
+		std::vector<std::uint32_t> oldIndices( faceVertices.size() ), newIndices( faceVertices.size() );
+		const double oldMs = !runOld ? 0.0 : BestMilliseconds( [&]()
+		{
+			std::unordered_map<ObjParser::IndexedVert, std::uint32_t, OldIndexedVertHash> vertexIndices;
+			for ( std::size_t i = 0; i < faceVertices.size(); ++i )
+				oldIndices[ i ] = vertexIndices.try_emplace( faceVertices[ i ], static_cast<std::uint32_t>( vertexIndices.size() ) ).first->second;
+		} );
+		// sized as ObjParser::parse sizes it: by the largest attribute array
+		const double newMs = BestMilliseconds( [&]()
+		{
+			ObjParser::IndexedVertTable vertexIndices( gridPoints );
+			for ( std::size_t i = 0; i < faceVertices.size(); ++i )
+				newIndices[ i ] = vertexIndices.TryEmplace( faceVertices[ i ], static_cast<std::uint32_t>( vertexIndices.GetCount() ) ).first;
+		} );
+
+		const std::string label = std::to_string( gridPoints ) + ( sharedAttributes ? " shared" : " distinct" );
+		const double megaVertices = static_cast<double>( faceVertices.size() ) / 1e6;
+		if ( runOld )
+			SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %-16s dedup    %8.1f -> %8.1f M face vertices/s ( %6.1fx )%s",
+						 label.c_str(), megaVertices / oldMs * 1000.0, megaVertices / newMs * 1000.0, oldMs / newMs, oldIndices == newIndices ? "" : "  OUTPUT DIFFERS" );
+		else
+			SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %-16s dedup         - -> %8.1f M face vertices/s ( the old map is quadratic here )",
+						 label.c_str(), megaVertices / newMs * 1000.0 );
+	}
+
+	// A sphere of quads the way exporters write it: six decimals, full v/vt/vn face vertices. With
+	// sharedAttributes all face vertices refer to the same texcoord and normal.
+	std::string MakeSyntheticObj( const int rows, const int columns, const bool sharedAttributes = false )
+	{
+		std::mt19937 random( 2023 );
+		std::uniform_real_distribution<float> bumps( 0.95f, 1.05f );
+
+		std::string text = "# synthetic\no sphere\n";
+		char line[ 128 ];
+		for ( int row = 0; row <= rows; ++row )
+		{
+			for ( int column = 0; column <= columns; ++column )
+			{
+				const float u = 6.2831853f * column / columns;
+				const float v = 3.1415926f * row / rows;
+				const float r = bumps( random );
+				const float x = std::sin( v ) * std::cos( u ), y = std::cos( v ), z = std::sin( v ) * std::sin( u );
+				text.append( line, std::snprintf( line, sizeof( line ), "v %.6f %.6f %.6f\n", r * x, r * y, r * z ) );
+				if ( sharedAttributes ) continue;
+				text.append( line, std::snprintf( line, sizeof( line ), "vt %.6f %.6f\n", static_cast<float>( column ) / columns, static_cast<float>( row ) / rows ) );
+				text.append( line, std::snprintf( line, sizeof( line ), "vn %.6f %.6f %.6f\n", x, y, z ) );
+			}
+		}
+		if ( sharedAttributes ) text += "vt 0.500000 0.500000\nvn 0.000000 1.000000 0.000000\n";
+		for ( int row = 0; row < rows; ++row )
+		{
+			for ( int column = 0; column < columns; ++column )
+			{
+				const int a = row * ( columns + 1 ) + column + 1, b = a + columns + 1;
+				if ( sharedAttributes )
+					text.append( line, std::snprintf( line, sizeof( line ), "f %d/1/1 %d/1/1 %d/1/1 %d/1/1\n", a, b, b + 1, a + 1 ) );
+				else
+					text.append( line, std::snprintf( line, sizeof( line ), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1 ) );
+			}
+		}
+		return text;
+	}
+
+	// text is followed by a readable zero byte, as ObjParser::parseString wants it
+	void BenchmarkText( const std::string& label, const std::string_view text )
+	{
+		{
+			std::uint64_t oldHash = 0, newHash = 0;
+			const double oldMs = BestMilliseconds( [&]() { oldHash = HashTokens<OldTokenizer>( text ); } );
+			const double newMs = BestMilliseconds( [&]() { newHash = HashTokens<InMemoryTokenizer>( text ); } );
+			Report( label, "tokens", text.size(), oldMs, newMs, oldHash == newHash );
+		}
+
+		{
+			std::size_t oldLines = 0, newLines = 0;
+			const double oldMs = BestMilliseconds( [&]() { oldLines = CountLines<OldTokenizer>( text ); } );
+			const double newMs = BestMilliseconds( [&]() { newLines = CountLines<InMemoryTokenizer>( text ); } );
+			Report( label, "lines", text.size(), oldMs, newMs, oldLines == newLines );
+		}
+
+		// throughput of the coordinate text only
+		{
+			const std::vector<std::string_view> coordinates = GetCoordinates( text );
+			std::size_t bytes = 0;
+			for ( const std::string_view coordinate : coordinates ) bytes += coordinate.size();
+
+			std::vector<float> oldValues( coordinates.size() ), newValues( coordinates.size() );
+			const double oldMs = BestMilliseconds( [&]()
+			{
+				for ( std::size_t i = 0; i < coordinates.size(); ++i )
+					std::from_chars( coordinates[ i ].data(), coordinates[ i ].data() + coordinates[ i ].size(), oldValues[ i ] );
+			} );
+			const double newMs = BestMilliseconds( [&]()
+			{
+				for ( std::size_t i = 0; i < coordinates.size(); ++i )
+					ParseFloat( coordinates[ i ], newValues[ i ] );
+			} );
+			Report( label, "floats", bytes, oldMs, newMs, std::memcmp( oldValues.data(), newValues.data(), oldValues.size() * sizeof( float ) ) == 0 );
+		}
+
+		ObjParser::Mesh mesh;
+		const double parseMs = BestMilliseconds( [&]() { mesh = ObjParser::parseString( text ); } );
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %-16s parse    %8.0f MB/s, %d vertices, %d indices", label.c_str(),
+					 static_cast<double>( text.size() ) / ( 1 << 20 ) / parseMs * 1000.0, static_cast<int>( mesh.vertexArray.size() ), static_cast<int>( mesh.indexArray.size() ) );
+
+		// the batches are only counted, as an upload would take them
+		std::size_t batches = 0, vertices = 0, indices = 0;
+		const double streamMs = BestMilliseconds( [&]()
+		{
+			batches = vertices = indices = 0;
+			ObjParser::parseStreamString( text, [&]( const ObjParser::Batch& batch ) { ++batches; vertices += batch.vertexCount; indices += batch.indexCount; } );
+		} );
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %-16s stream   %8.0f MB/s, %d vertices, %d indices in %d batches", label.c_str(),
+					 static_cast<double>( text.size() ) / ( 1 << 20 ) / streamMs * 1000.0, static_cast<int>( vertices ), static_cast<int>( indices ), static_cast<int>( batches ) );
+	}
+}
+
+void RunObjParserBenchmark( const std::filesystem::path& fileName )
+{
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[ObjParser] %s tokenizer, best of %d runs, old -> new", GetTokenizerInstructionSet(), RUNS );
+
+	const AssetData file = ReadAsset( fileName );
+	if ( file.IsValid() )
+		BenchmarkText( fileName.filename().string(), file.GetText() );
+
+	const std::string synthetic = MakeSyntheticObj( 512, 512 );
+	BenchmarkText( "synthetic", synthetic );
+
+	const std::string sharedSynthetic = MakeSyntheticObj( 512, 512, true );
+	BenchmarkText( "synthetic shared", sharedSynthetic );
+
+	// the old map probes one chain per texcoord/normal pair, so only small meshes of shared attributes finish
+	for ( const int size : { 64, 128, 512 } )
+	{
+		BenchmarkDeduplication( size, false, true );
+		BenchmarkDeduplication( size, true, size <= 128 );
+	}
+}
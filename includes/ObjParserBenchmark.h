@@ -0,0 +1,11 @@
+#pragma once
+
+#include <filesystem>
+
+// Times the InMemoryTokenizer and ParseFloat against the code they replaced ( std::isspace and a
+// byte-by-byte '\n' search, std::from_chars per coordinate ) on the given .obj file and on a synthetic
+// one, checks that both give the same tokens and bit identical floats and logs throughput in MB/s of
+// text, together with the throughput of ObjParser::parseString and ObjParser::parseStreamString. The
+// face vertex deduplication is timed against the previous std::unordered_map on grids whose vertices
+// have their own texcoords and normals and on grids where all of them share one. Run it on a worker thread.
+void RunObjParserBenchmark( const std::filesystem::path& fileName );
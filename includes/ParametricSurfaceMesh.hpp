@@ -60,4 +60,30 @@ template <typename SurfT>
 	}
     
         return outputMesh;
-}
\ No newline at end of file
+}
+
+// Ugyanaz az NxM rács, de négyszög patch-ekként ( GL_PATCHES, GL_PATCH_VERTICES = 4 ) a tessellation shadereknek.
+// A sarkok sorrendje patch-enként (u,v)-ben: (u_i, v_j), (u_{i+1}, v_j), (u_{i+1}, v_{j+1}), (u_i, v_{j+1}),
+// így a tessellation evaluation shader gl_TessCoord-ja ugyanabba az irányba mutat, mint a (u,v).
+template <typename SurfT>
+[[nodiscard]] MeshObject<Vertex> GetParamSurfPatches( const SurfT& surf, const std::size_t N, const std::size_t M )
+{
+	MeshObject<Vertex> outputMesh = GetParamSurfMesh( surf, N, M );
+
+	// a pontok maradnak, a háromszöglista helyett négyszögenként 4 index
+	outputMesh.indexArray.resize( 4 * N * M );
+
+	for ( std::size_t j = 0; j < M; ++j )
+	{
+		for ( std::size_t i = 0; i < N; ++i )
+		{
+			std::size_t index = i * 4 + j * ( 4 * N );
+			outputMesh.indexArray[ index + 0 ] = static_cast<GLuint>( ( i     ) + ( j     ) * ( N + 1 ) );
+			outputMesh.indexArray[ index + 1 ] = static_cast<GLuint>( ( i + 1 ) + ( j     ) * ( N + 1 ) );
+			outputMesh.indexArray[ index + 2 ] = static_cast<GLuint>( ( i + 1 ) + ( j + 1 ) * ( N + 1 ) );
+			outputMesh.indexArray[ index + 3 ] = static_cast<GLuint>( ( i     ) + ( j + 1 ) * ( N + 1 ) );
+		}
+	}
+
+	return outputMesh;
+}
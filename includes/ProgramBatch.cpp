@@ -0,0 +1,102 @@
+#include "ProgramBatch.h"
+
+#include <algorithm>
+
+#include <SDL2/SDL_log.h>
+
+#include "ProgramBinaryCache.h"
+
+void ProgramBatch::Init()
+{
+	// 0xFFFFFFFF: as many threads as the driver wants
+	if ( GLEW_KHR_parallel_shader_compile )
+	{
+		glMaxShaderCompilerThreadsKHR( 0xFFFFFFFFu );
+		m_parallel = true;
+	}
+	else if ( GLEW_ARB_parallel_shader_compile )
+	{
+		glMaxShaderCompilerThreadsARB( 0xFFFFFFFFu );
+		m_parallel = true;
+	}
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[ProgramBatch] Parallel shader compile: %s", m_parallel ? "on" : "not supported" );
+}
+
+void ProgramBatch::Submit( const GLuint programID, const std::vector<ShaderStageFile>& stages, ProgramBinaryCache* cache )
+{
+	if ( programID == 0 ) return;
+
+	PendingProgram program = { programID, {}, cache, 0 };
+
+	if ( cache != nullptr && cache->TryLoad( programID, stages, program.cacheKey ) )
+		return;
+
+	for ( const ShaderStageFile& stage : stages )
+	{
+		const GLuint shaderID = glCreateShader( stage.type );
+		if ( shaderID == 0 )
+		{
+			SDL_SetError( "Error while initing shaders (glCreateShader)!" );
+			continue;
+		}
+
+		submitShaderSource( shaderID, loadShaderSource( stage.fileName ) );
+		glAttachShader( programID, shaderID );
+		program.shaderIDs.push_back( shaderID );
+	}
+
+	// linking does not wait for the compiles either, a failed compile shows up as a failed link
+	glLinkProgram( programID );
+
+	m_pending.push_back( std::move( program ) );
+}
+
+bool ProgramBatch::Poll()
+{
+	// finished programs are completed and dropped, the rest keep their order
+	auto firstDone = std::stable_partition( m_pending.begin(), m_pending.end(),
+		[ this ]( const PendingProgram& program ) { return !IsComplete( program ); } );
+
+	std::for_each( firstDone, m_pending.end(), [ this ]( const PendingProgram& program ) { Complete( program ); } );
+	m_pending.erase( firstDone, m_pending.end() );
+
+	return m_pending.empty();
+}
+
+void ProgramBatch::Finish()
+{
+	for ( const PendingProgram& program : m_pending )
+		Complete( program );
+	m_pending.clear();
+}
+
+bool ProgramBatch::IsComplete( const PendingProgram& program ) const
+{
+	// without the extension there is no way to ask, the status query in Complete() waits
+	if ( !m_parallel ) return true;
+
+	GLint complete = GL_FALSE;
+	glGetProgramiv( program.programID, GL_COMPLETION_STATUS_KHR, &complete );
+	return complete == GL_TRUE;
+}
+
+void ProgramBatch::Complete( const PendingProgram& program )
+{
+	// the compile logs explain a failed link, so they come first
+	bool succeeded = true;
+	for ( const GLuint shaderID : program.shaderIDs )
+		succeeded = checkShaderCompileStatus( shaderID ) && succeeded;
+	succeeded = checkProgramLinkStatus( program.programID ) && succeeded;
+
+	if ( !succeeded )
+		++m_failedCount;
+	else if ( program.cache != nullptr )
+		program.cache->StoreIfLinked( program.programID, program.cacheKey );
+
+	for ( const GLuint shaderID : program.shaderIDs )
+	{
+		glDetachShader( program.programID, shaderID );
+		glDeleteShader( shaderID );
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLUtils.hpp"
+
+class ProgramBinaryCache;
+
+// Builds several programs at once without waiting for each compile and link in turn.
+//
+// Submit() starts compiling and linking and returns without querying any status. Poll() finishes
+// the programs the driver is done with. With GL_KHR_parallel_shader_compile (or the ARB version)
+// the driver compiles on its own threads and Poll() never blocks, it asks GL_COMPLETION_STATUS_KHR
+// first. Without the extension the first status query of a program waits for it, as before, but
+// the driver still sees every program before the first wait.
+class ProgramBatch
+{
+public:
+	// Needs a current GL context. Lets the driver use its own compiler threads, if it can.
+	void Init();
+
+	// Starts building programID from the stages. A program found in the cache is ready right away.
+	void Submit( const GLuint programID, const std::vector<ShaderStageFile>& stages, ProgramBinaryCache* cache = nullptr );
+
+	// Finishes what is done. Returns true when nothing is pending any more.
+	bool Poll();
+	// Finishes everything, blocking.
+	void Finish();
+
+	inline bool IsPending() const noexcept { return !m_pending.empty(); }
+	inline bool IsParallel() const noexcept { return m_parallel; }
+	// programs that failed to compile or link since the last ResetFailed()
+	inline std::uint32_t GetFailedCount() const noexcept { return m_failedCount; }
+	inline void ResetFailed() noexcept { m_failedCount = 0; }
+
+private:
+	struct PendingProgram
+	{
+		GLuint programID;
+		std::vector<GLuint> shaderIDs;
+		ProgramBinaryCache* cache;
+		std::uint64_t cacheKey;
+	};
+
+	bool IsComplete( const PendingProgram& program ) const;
+	void Complete( const PendingProgram& program );
+
+	std::vector<PendingProgram> m_pending;
+	bool m_parallel = false;
+	std::uint32_t m_failedCount = 0;
+};
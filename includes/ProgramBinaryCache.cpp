@@ -0,0 +1,180 @@
+#include "ProgramBinaryCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <SDL2/SDL_log.h>
+
+#include "AssetPack.h"
+#include "FileUtils.h"
+
+// Bump when the file layout or anything else that affects the binaries changes.
+static constexpr std::uint32_t CACHE_FORMAT_VERSION = 1;
+static constexpr char CACHE_MAGIC[ 4 ] = { 'P', 'B', 'C', '1' };
+
+static std::string GetGLString( const GLenum name )
+{
+	const GLubyte* value = glGetString( name );
+	return value != nullptr ? reinterpret_cast<const char*>( value ) : "";
+}
+
+void ProgramBinaryCache::Init()
+{
+	GLint formatCount = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount );
+
+	m_enabled = formatCount > 0;
+	if ( !m_enabled )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[ProgramBinaryCache] The driver has no program binary formats, the cache is off." );
+		return;
+	}
+
+	// '\n' separated, so "ab" + "c" and "a" + "bc" differ
+	m_driverID = GetGLString( GL_VENDOR ) + '\n' + GetGLString( GL_RENDERER ) + '\n' + GetGLString( GL_VERSION );
+
+	std::error_code error;
+	std::filesystem::create_directories( m_directory, error );
+	if ( error )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[ProgramBinaryCache] Cannot create %s: %s, the cache is off.",
+						m_directory.string().c_str(), error.message().c_str() );
+		m_enabled = false;
+	}
+}
+
+bool ProgramBinaryCache::Assemble( const GLuint programID, const std::vector<ShaderStageFile>& stages )
+{
+	if ( programID == 0 ) return false;
+
+	std::uint64_t key = 0;
+	if ( TryLoad( programID, stages, key ) )
+		return true;
+
+	AssembleProgram( programID, stages );
+	StoreIfLinked( programID, key );
+
+	return false;
+}
+
+bool ProgramBinaryCache::Assemble( const GLuint programID, const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename )
+{
+	return Assemble( programID, { { GL_VERTEX_SHADER, vs_filename }, { GL_FRAGMENT_SHADER, fs_filename } } );
+}
+
+bool ProgramBinaryCache::AssembleCompute( const GLuint programID, const std::filesystem::path& cs_filename )
+{
+	return Assemble( programID, { { GL_COMPUTE_SHADER, cs_filename } } );
+}
+
+bool ProgramBinaryCache::TryLoad( const GLuint programID, const std::vector<ShaderStageFile>& stages, std::uint64_t& key )
+{
+	if ( !m_enabled ) return false;
+
+	key = MakeKey( stages );
+	const std::filesystem::path path = GetPath( key );
+
+	std::error_code error;
+	if ( std::filesystem::exists( path, error ) )
+	{
+		if ( Load( programID, path ) )
+		{
+			++m_stats.hits;
+			return true;
+		}
+
+		++m_stats.rejected;
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[ProgramBinaryCache] %s was rejected, compiling from source.", path.string().c_str() );
+	}
+
+	++m_stats.misses;
+
+	// the binary must be requested before linking
+	glProgramParameteri( programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+	return false;
+}
+
+void ProgramBinaryCache::StoreIfLinked( const GLuint programID, const std::uint64_t key ) const
+{
+	if ( !m_enabled ) return;
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv( programID, GL_LINK_STATUS, &linked );
+	if ( linked == GL_TRUE )
+		Store( programID, GetPath( key ) );
+}
+
+std::uint64_t ProgramBinaryCache::MakeKey( const std::vector<ShaderStageFile>& stages ) const
+{
+	std::uint64_t hash = FNV_OFFSET_BASIS;
+	hash = HashBytes( hash, &CACHE_FORMAT_VERSION, sizeof( CACHE_FORMAT_VERSION ) );
+	hash = HashBytes( hash, m_driverID.data(), m_driverID.size() );
+
+	for ( const ShaderStageFile& stage : stages )
+	{
+		const AssetData source = ReadAsset( stage.fileName );
+
+		// a missing file hashes as empty and fails to compile as usual
+		const std::uint64_t sourceSize = source.GetSize();
+		hash = HashBytes( hash, &stage.type, sizeof( stage.type ) );
+		hash = HashBytes( hash, &sourceSize, sizeof( sourceSize ) );
+		hash = HashBytes( hash, source.GetData(), source.GetSize() );
+	}
+
+	return hash;
+}
+
+std::filesystem::path ProgramBinaryCache::GetPath( const std::uint64_t key ) const
+{
+	char fileName[ 32 ];
+	std::snprintf( fileName, sizeof( fileName ), "%016llx.bin", static_cast<unsigned long long>( key ) );
+	return m_directory / fileName;
+}
+
+// File layout: magic[ 4 ], GLenum format, binary bytes until the end of the file.
+
+bool ProgramBinaryCache::Load( const GLuint programID, const std::filesystem::path& path ) const
+{
+	std::ifstream file( path, std::ios::binary );
+	if ( !file ) return false;
+
+	char magic[ 4 ] = {};
+	GLenum format = 0;
+	file.read( magic, sizeof( magic ) );
+	file.read( reinterpret_cast<char*>( &format ), sizeof( format ) );
+	if ( !file || !std::equal( std::begin( magic ), std::end( magic ), std::begin( CACHE_MAGIC ) ) ) return false;
+
+	const std::vector<char> binary( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+	if ( binary.empty() ) return false;
+
+	glProgramBinary( programID, format, binary.data(), static_cast<GLsizei>( binary.size() ) );
+
+	// a driver update with the same version string, a different GPU, ... : the link status tells
+	GLint linked = GL_FALSE;
+	glGetProgramiv( programID, GL_LINK_STATUS, &linked );
+	return linked == GL_TRUE;
+}
+
+void ProgramBinaryCache::Store( const GLuint programID, const std::filesystem::path& path ) const
+{
+	GLint length = 0;
+	glGetProgramiv( programID, GL_PROGRAM_BINARY_LENGTH, &length );
+	if ( length <= 0 ) return;
+
+	std::vector<char> binary( length );
+	GLenum format = 0;
+	glGetProgramBinary( programID, length, nullptr, &format, binary.data() );
+
+	const std::error_code error = WriteFileAtomically( path, [ & ]( std::ostream& stream )
+	{
+		stream.write( CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+		stream.write( reinterpret_cast<const char*>( &format ), sizeof( format ) );
+		stream.write( binary.data(), binary.size() );
+		return true;
+	} );
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[ProgramBinaryCache] Cannot write %s: %s", path.string().c_str(), error.message().c_str() );
+}
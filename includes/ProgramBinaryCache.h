@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLUtils.hpp"
+
+// On-disk cache of linked program binaries ( glGetProgramBinary / glProgramBinary ).
+//
+// The key is a 64-bit hash of the driver's vendor, renderer and version strings, the cache format
+// and every stage's type and source bytes, so editing a shader or updating the driver simply misses.
+// A binary the driver rejects is recompiled from source and overwritten.
+class ProgramBinaryCache
+{
+public:
+	struct Stats
+	{
+		std::uint32_t hits     = 0;
+		std::uint32_t misses   = 0; // compiled from source, including rejected binaries
+		std::uint32_t rejected = 0; // found on disk but glProgramBinary failed
+	};
+
+	explicit ProgramBinaryCache( std::filesystem::path directory ) : m_directory( std::move( directory ) ) {}
+
+	// Needs a current GL context. Disables the cache if the driver has no binary formats.
+	void Init();
+
+	// Links programID from the stages, through the cache when it is enabled.
+	// Returns true if the program came from the cache.
+	bool Assemble( const GLuint programID, const std::vector<ShaderStageFile>& stages );
+	// The same as AssembleProgram and AssembleComputeProgram in GLUtils.
+	bool Assemble( const GLuint programID, const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename );
+	bool AssembleCompute( const GLuint programID, const std::filesystem::path& cs_filename );
+
+	// The two halves of Assemble, for callers that compile and link on their own ( ProgramBatch ).
+	// TryLoad returns true on a hit. On a miss it prepares programID for a link whose binary can be
+	// retrieved, and StoreIfLinked saves that binary once the link has succeeded.
+	bool TryLoad( const GLuint programID, const std::vector<ShaderStageFile>& stages, std::uint64_t& key );
+	void StoreIfLinked( const GLuint programID, const std::uint64_t key ) const;
+
+	inline bool IsEnabled() const noexcept { return m_enabled; }
+	inline const Stats& GetStats() const noexcept { return m_stats; }
+	inline void ResetStats() noexcept { m_stats = Stats{}; }
+
+private:
+	std::uint64_t MakeKey( const std::vector<ShaderStageFile>& stages ) const;
+	std::filesystem::path GetPath( const std::uint64_t key ) const;
+
+	bool Load( const GLuint programID, const std::filesystem::path& path ) const;
+	void Store( const GLuint programID, const std::filesystem::path& path ) const;
+
+	std::filesystem::path m_directory;
+	std::string m_driverID; // vendor, renderer and version, part of every key
+	bool  m_enabled = false;
+	Stats m_stats;
+};
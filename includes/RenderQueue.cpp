@@ -0,0 +1,89 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+static std::uint64_t Field( const std::uint64_t value, const int bits ) noexcept
+{
+	return value & ( ( std::uint64_t( 1 ) << bits ) - 1 );
+}
+
+std::uint64_t RenderQueue::MakeKey( const RenderPass pass, const DrawState& state, const float depth ) noexcept
+{
+	constexpr int DEPTH_BITS = 24;
+	const std::uint64_t depthMax = ( std::uint64_t( 1 ) << DEPTH_BITS ) - 1;
+	const std::uint64_t quantizedDepth = static_cast<std::uint64_t>( std::clamp( depth, 0.0f, 1.0f ) * depthMax );
+
+	const std::uint64_t stateBits = ( Field( state.program, 12 ) << 26 )
+								  | ( Field( state.vao, 12 ) << 14 )
+								  |   Field( state.textures[ 0 ], 14 );
+
+	std::uint64_t key = Field( static_cast<std::uint64_t>( pass ), 2 ) << 62;
+
+	if ( pass == RenderPass::Transparent )
+		key |= ( ( depthMax - quantizedDepth ) << 38 ) | stateBits;
+	else
+		key |= ( stateBits << DEPTH_BITS ) | quantizedDepth;
+
+	return key;
+}
+
+void RenderQueue::Clear() noexcept
+{
+	m_items.clear();
+	m_order.clear();
+}
+
+void RenderQueue::Push( const RenderPass pass, const float depth, DrawItem item )
+{
+	m_order.emplace_back( MakeKey( pass, item.state, depth ), static_cast<std::uint32_t>( m_items.size() ) );
+	m_items.push_back( std::move( item ) );
+}
+
+void RenderQueue::Sort()
+{
+	// the item index breaks ties, so this is a stable order without std::stable_sort
+	std::sort( m_order.begin(), m_order.end() );
+}
+
+RenderQueue::Stats RenderQueue::Submit( GLStateCache& stateCache ) const
+{
+	const GLStateCache::Stats before = stateCache.GetStats();
+
+	Stats stats;
+
+	for ( const auto& [ key, index ] : m_order )
+	{
+		const DrawItem& item = m_items[ index ];
+		const DrawState& state = item.state;
+
+		stateCache.UseProgram( state.program );
+		stateCache.BindVertexArray( state.vao );
+		for ( std::size_t i = 0; i < state.textures.size(); ++i )
+			if ( state.textures[ i ] != 0 )
+				stateCache.BindTexture( state.textureUnit + static_cast<GLuint>( i ), state.textureTarget, state.textures[ i ] );
+		if ( item.drawCount > 0 )
+			stateCache.BindDrawIndirectBuffer( state.indirectBuffer );
+		stateCache.SetBlend( state.blend );
+		stateCache.SetCullFace( state.cullFace );
+		stateCache.SetDepthFunc( state.depthFunc );
+
+		if ( item.setUniforms )
+			item.setUniforms();
+
+		const void* indices = reinterpret_cast<const void*>( static_cast<std::uintptr_t>( item.firstIndex ) * sizeof( GLuint ) );
+
+		if ( item.drawCount > 0 )
+			glMultiDrawElementsIndirect( item.mode, GL_UNSIGNED_INT, reinterpret_cast<const void*>( item.indirectOffset ), item.drawCount, 0 );
+		else if ( item.instanceCount == 1 && item.baseInstance == 0 && item.baseVertex == 0 )
+			glDrawElements( item.mode, item.count, GL_UNSIGNED_INT, indices );
+		else
+			glDrawElementsInstancedBaseVertexBaseInstance( item.mode, item.count, GL_UNSIGNED_INT, indices, item.instanceCount, item.baseVertex, item.baseInstance );
+
+		++stats.drawCalls;
+	}
+
+	stats.state.issued  = stateCache.GetStats().issued - before.issued;
+	stats.state.skipped = stateCache.GetStats().skipped - before.skipped;
+
+	return stats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLStateCache.h"
+
+// Passes in submission order.
+enum class RenderPass : std::uint8_t
+{
+	Opaque      = 0,
+	Skybox      = 1, // after the opaque pass so it is only shaded where nothing covers it
+	Transparent = 2, // blended, sorted back to front
+};
+
+// The GL state one draw needs. Everything here goes through the GLStateCache.
+struct DrawState
+{
+	static constexpr std::size_t MAX_TEXTURES = 4;
+
+	GLuint program       = 0;
+	GLuint vao           = 0;
+	GLuint textureUnit   = 0; // textures[ i ] is bound to unit textureUnit + i
+	GLenum textureTarget = GL_TEXTURE_2D;
+	std::array<GLuint, MAX_TEXTURES> textures = {}; // 0: nothing bound there, the unit is left alone
+	GLuint indirectBuffer = 0; // GL_DRAW_INDIRECT_BUFFER of a multi-draw item
+	bool   blend         = false;
+	bool   cullFace      = true;
+	GLenum depthFunc     = GL_LESS;
+};
+
+struct DrawItem
+{
+	DrawState state;
+
+	// indexed draw from the bound VAO's element buffer, firstIndex and baseVertex select a mesh of a MeshPool
+	GLenum  mode          = GL_TRIANGLES;
+	GLsizei count         = 0;
+	GLuint  firstIndex    = 0;
+	GLint   baseVertex    = 0;
+	GLsizei instanceCount = 1;
+	GLuint  baseInstance  = 0;
+
+	// drawCount > 0 makes this a glMultiDrawElementsIndirect of that many commands,
+	// read from state.indirectBuffer at indirectOffset, the fields above are then unused
+	GLsizei  drawCount      = 0;
+	GLintptr indirectOffset = 0;
+
+	// Per-draw uniforms, called with the item's program already bound. May be empty.
+	std::function<void()> setUniforms;
+};
+
+// Collects the draws of a frame, orders them by a 64-bit sort key and submits them through a GLStateCache.
+//
+// Key layout, most significant bits first:
+//   opaque and skybox passes: pass:2 | program:12 | vao:12 | texture:14 | depth:24 (front to back)
+//   transparent pass:         pass:2 | depth:24 (back to front) | program:12 | vao:12 | texture:14
+// where texture is the first one of DrawState::textures.
+// GL object names are truncated to their field, a collision only costs a state change, never correctness.
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		std::uint32_t drawCalls = 0;
+		GLStateCache::Stats state;
+	};
+
+	// depth: view distance normalized to [0, 1], values outside are clamped
+	static std::uint64_t MakeKey( const RenderPass pass, const DrawState& state, const float depth ) noexcept;
+
+	void Clear() noexcept;
+	void Push( const RenderPass pass, const float depth, DrawItem item );
+
+	// Orders the items by key, items with equal keys keep their push order.
+	void Sort();
+	// Issues the sorted items. The returned stats cover this submission only.
+	Stats Submit( GLStateCache& stateCache ) const;
+
+	inline std::size_t GetSize() const noexcept { return m_items.size(); }
+
+private:
+	std::vector<DrawItem> m_items;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> m_order; // key, item index
+};
@@ -0,0 +1,326 @@
+#include "TextureArraySet.h"
+#include "GLUtils.hpp"
+#include "Timing.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <utility>
+
+TextureArraySet::Handle TextureArraySet::Add( const std::filesystem::path& fileName )
+{
+	return Add( fileName, m_fileNames.size() );
+}
+
+TextureArraySet::Handle TextureArraySet::Add( const std::filesystem::path& fileName, const Handle sameArrayAs )
+{
+	m_fileNames.push_back( fileName );
+	m_layers.emplace_back();
+	m_sameArrayAs.push_back( sameArrayAs );
+	return m_fileNames.size() - 1;
+}
+
+// Images by size class, the ones without a size ( could not be loaded ) go into the most populated class.
+static std::map<std::pair<int, int>, std::vector<TextureArraySet::Handle>> GroupBySizeClass( const std::vector<glm::ivec2>& sizes )
+{
+	std::map<std::pair<int, int>, std::vector<TextureArraySet::Handle>> classes;
+	std::vector<TextureArraySet::Handle> failed;
+
+	for ( TextureArraySet::Handle handle = 0; handle < sizes.size(); ++handle )
+	{
+		if ( sizes[ handle ].x <= 0 || sizes[ handle ].y <= 0 )
+		{
+			failed.push_back( handle );
+			continue;
+		}
+		classes[ { sizes[ handle ].x, sizes[ handle ].y } ].push_back( handle );
+	}
+
+	// images that could not be loaded get a clear layer in the most populated class
+	if ( !failed.empty() )
+	{
+		auto target = classes.begin();
+		for ( auto it = classes.begin(); it != classes.end(); ++it )
+			if ( it->second.size() > target->second.size() ) target = it;
+
+		if ( target == classes.end() ) target = classes.emplace( std::make_pair( 1, 1 ), std::vector<TextureArraySet::Handle>() ).first;
+		target->second.insert( target->second.end(), failed.begin(), failed.end() );
+	}
+
+	return classes;
+}
+
+static const char* GetFormatName( const GLenum format )
+{
+	return format == GL_RGBA8 ? "RGBA8" : ( format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? "BC1" : "BC3" );
+}
+
+void TextureArraySet::Build( WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer* streamer )
+{
+	Clean();
+
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	// load everything first on the workers, the size classes are known only after that.
+	// The cache resamples to the class size and bakes the mip chain, a hit skips decoding entirely.
+	std::vector<BakedTexture> images( m_fileNames.size() );
+	std::vector<double> loadMs( m_fileNames.size(), 0.0 );
+
+	workers.ParallelFor( m_fileNames.size(), [ & ]( const std::size_t handle )
+	{
+		const auto start = std::chrono::steady_clock::now();
+		images[ handle ] = cache.Load( m_fileNames[ handle ], true, CompressedTextureCache::Resize::NearestPowerOfTwo );
+		loadMs[ handle ] = MillisecondsSince( start );
+	} );
+
+	std::vector<glm::ivec2> sizes( m_fileNames.size(), glm::ivec2( 0 ) );
+	for ( Handle handle = 0; handle < m_fileNames.size(); ++handle )
+		if ( !images[ handle ].IsEmpty() )
+			sizes[ handle ] = images[ handle ].size;
+
+	// a tied image takes the size class of its pair, baked again at that size if its own differs.
+	// The pair was registered earlier, so its size is already final here.
+	for ( Handle handle = 0; handle < m_fileNames.size(); ++handle )
+	{
+		const Handle pair = m_sameArrayAs[ handle ];
+		if ( pair == handle || sizes[ pair ] == glm::ivec2( 0 ) || sizes[ handle ] == sizes[ pair ] ) continue;
+
+		const auto start = std::chrono::steady_clock::now();
+		if ( !images[ handle ].IsEmpty() )
+			images[ handle ] = cache.Load( m_fileNames[ handle ], true, CompressedTextureCache::Resize::Exact, sizes[ pair ] );
+		sizes[ handle ] = sizes[ pair ];
+		loadMs[ handle ] += MillisecondsSince( start );
+	}
+
+	const auto classes = GroupBySizeClass( sizes );
+
+	// only the uploads are left for the GL thread
+	double loadTotalMs = 0.0, uploadTotalMs = 0.0;
+	std::size_t byteSize = 0;
+
+	for ( const auto& [ classSize, handles ] : classes )
+	{
+		const glm::ivec2 size( classSize.first, classSize.second );
+
+		// one translucent image makes the whole array BC3, the opaque ones are promoted from BC1
+		GLenum format = cache.IsCompressing() ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+		for ( const Handle handle : handles )
+			if ( images[ handle ].format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT )
+				format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		const Array& array = AddArray( size, format, handles, 0 );
+
+		for ( GLint layer = 0; layer < array.size.z; ++layer )
+		{
+			const Handle handle = handles[ layer ];
+
+			BakedTexture image = std::move( images[ handle ] );
+			if ( image.IsEmpty() )
+				image = MakeClearTexture( format, size );
+			PromoteTexture( image, format );
+
+			loadTotalMs += loadMs[ handle ];
+			byteSize += image.GetByteSize();
+
+			if ( streamer != nullptr )
+			{
+				SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %s: load %.1f ms, streaming", m_fileNames[ handle ].string().c_str(), loadMs[ handle ] );
+				streamer->EnqueueLayer( array.textureID, layer, std::move( image ) );
+				continue;
+			}
+
+			const auto uploadStart = std::chrono::steady_clock::now();
+			glBindTexture( GL_TEXTURE_2D_ARRAY, array.textureID );
+			UploadTextureLayer( layer, image );
+			const double uploadMs = MillisecondsSince( uploadStart );
+
+			SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %s: load %.1f ms, upload %.1f ms",
+						 m_fileNames[ handle ].string().c_str(), loadMs[ handle ], uploadMs );
+
+			uploadTotalMs += uploadMs;
+		}
+
+		glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %dx%d array with %d layers, %s", size.x, size.y, array.size.z, GetFormatName( format ) );
+	}
+
+	// the load total is CPU time summed over the workers, the wall time shows the overlap
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %d images on %u workers: load %.1f ms, upload %.1f ms, wall %.1f ms, %.1f MB with mipmaps",
+				 static_cast<int>( m_fileNames.size() ), workers.GetThreadCount(), loadTotalMs, uploadTotalMs, MillisecondsSince( buildStart ), byteSize / ( 1024.0 * 1024.0 ) );
+}
+
+void TextureArraySet::Allocate( WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer& streamer, const int topLevelSize )
+{
+	Clean();
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// only the headers: the same classes and formats as Build, without decoding anything
+	std::vector<CompressedTextureCache::ImageInfo> images( m_fileNames.size() );
+	workers.ParallelFor( m_fileNames.size(), [ & ]( const std::size_t handle )
+	{
+		images[ handle ] = cache.Probe( m_fileNames[ handle ], true, CompressedTextureCache::Resize::NearestPowerOfTwo );
+
+		// LoadLayer bakes at the exact class size: once it has, that entry knows whether the image is really translucent
+		if ( images[ handle ].format != 0 )
+		{
+			const CompressedTextureCache::ImageInfo baked = cache.Probe( m_fileNames[ handle ], true, CompressedTextureCache::Resize::Exact, images[ handle ].size );
+			if ( baked.format != 0 ) images[ handle ] = baked;
+		}
+	} );
+
+	std::vector<glm::ivec2> sizes( m_fileNames.size(), glm::ivec2( 0 ) );
+	for ( Handle handle = 0; handle < m_fileNames.size(); ++handle )
+		if ( images[ handle ].format != 0 )
+			sizes[ handle ] = images[ handle ].size;
+
+	// tied images go into the class of their pair, see Build
+	for ( Handle handle = 0; handle < m_fileNames.size(); ++handle )
+	{
+		const Handle pair = m_sameArrayAs[ handle ];
+		if ( pair == handle || sizes[ pair ] == glm::ivec2( 0 ) || sizes[ handle ] == sizes[ pair ] ) continue;
+
+		if ( images[ handle ].format != 0 )
+		{
+			const CompressedTextureCache::ImageInfo baked = cache.Probe( m_fileNames[ handle ], true, CompressedTextureCache::Resize::Exact, sizes[ pair ] );
+			if ( baked.format != 0 ) images[ handle ] = baked;
+		}
+		sizes[ handle ] = sizes[ pair ];
+	}
+
+	std::size_t byteSize = 0;
+
+	for ( const auto& [ classSize, handles ] : GroupBySizeClass( sizes ) )
+	{
+		const glm::ivec2 size( classSize.first, classSize.second );
+
+		GLenum format = cache.IsCompressing() ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+		for ( const Handle handle : handles )
+			if ( images[ handle ].format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT )
+				format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		// the first level that is not larger than topLevelSize
+		const int levelCount = GetMipLevelCount( size );
+		int topLevel = 0;
+		while ( topLevel + 1 < levelCount && std::max( size.x >> topLevel, size.y >> topLevel ) > topLevelSize )
+			++topLevel;
+
+		const Array& array = AddArray( size, format, handles, topLevel );
+
+		// black until the layer is loaded
+		for ( GLint layer = 0; layer < array.size.z; ++layer )
+			streamer.EnqueueLayer( array.textureID, layer, MakeClearTexture( format, GetMipLevelSize( size, topLevel ) ) );
+
+		byteSize += GetByteSize( m_arrays.size() - 1, topLevel );
+
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %dx%d array with %d layers, %s, allocated from level %d",
+					 size.x, size.y, array.size.z, GetFormatName( format ), topLevel );
+	}
+
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureArraySet] %d images probed on %u workers in %.1f ms, %.2f MB allocated",
+				 static_cast<int>( m_fileNames.size() ), workers.GetThreadCount(), MillisecondsSince( start ), byteSize / ( 1024.0 * 1024.0 ) );
+}
+
+TextureArraySet::Array& TextureArraySet::AddArray( const glm::ivec2 size, const GLenum format, const std::vector<Handle>& handles, const int topLevel )
+{
+	Array& array = m_arrays.emplace_back();
+	array.size = glm::ivec3( size, static_cast<int>( handles.size() ) );
+	array.format = format;
+	array.topLevel = topLevel;
+	array.handles = handles;
+
+	const glm::ivec2 topSize = GetMipLevelSize( size, topLevel );
+	glGenTextures( 1, &array.textureID );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, array.textureID );
+	glTexStorage3D( GL_TEXTURE_2D_ARRAY, GetMipLevelCount( size ) - topLevel, format, topSize.x, topSize.y, array.size.z );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+	SetupTextureSampling( GL_TEXTURE_2D_ARRAY, array.textureID, false, true );
+
+	for ( GLint layer = 0; layer < array.size.z; ++layer )
+		m_layers[ handles[ layer ] ] = TextureLayer{ array.textureID, layer, static_cast<GLint>( m_arrays.size() - 1 ) };
+
+	return array;
+}
+
+std::size_t TextureArraySet::GetByteSize( const std::size_t arrayIndex, const int topLevel ) const
+{
+	const Array& array = m_arrays[ arrayIndex ];
+
+	std::size_t byteSize = 0;
+	for ( int level = topLevel; level < GetLevelCount( arrayIndex ); ++level )
+		byteSize += GetLevelByteSize( array.format, GetMipLevelSize( glm::ivec2( array.size.x, array.size.y ), level ) );
+	return byteSize * array.size.z;
+}
+
+void TextureArraySet::SetTopLevel( const std::size_t arrayIndex, const int topLevel )
+{
+	Array& array = m_arrays[ arrayIndex ];
+	if ( topLevel == array.topLevel ) return;
+
+	const glm::ivec2 size( array.size.x, array.size.y );
+	const int levelCount = GetLevelCount( arrayIndex );
+	const glm::ivec2 topSize = GetMipLevelSize( size, topLevel );
+
+	GLuint textureID = 0;
+	glGenTextures( 1, &textureID );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, textureID );
+	glTexStorage3D( GL_TEXTURE_2D_ARRAY, levelCount - topLevel, array.format, topSize.x, topSize.y, array.size.z );
+	// the new finer levels have no data yet
+	if ( topLevel < array.topLevel )
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, array.topLevel - topLevel );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+	SetupTextureSampling( GL_TEXTURE_2D_ARRAY, textureID, false, true );
+
+	// the common levels, whole levels of every layer, so block compressed sizes need no alignment
+	for ( int level = std::max( topLevel, array.topLevel ); level < levelCount; ++level )
+	{
+		const glm::ivec2 levelSize = GetMipLevelSize( size, level );
+		glCopyImageSubData( array.textureID, GL_TEXTURE_2D_ARRAY, level - array.topLevel, 0, 0, 0,
+							textureID, GL_TEXTURE_2D_ARRAY, level - topLevel, 0, 0, 0, levelSize.x, levelSize.y, array.size.z );
+	}
+
+	glDeleteTextures( 1, &array.textureID );
+	array.textureID = textureID;
+	array.topLevel = topLevel;
+
+	for ( const Handle handle : array.handles )
+		m_layers[ handle ].textureID = textureID;
+}
+
+std::optional<TextureArraySet::Handle> TextureArraySet::Find( const std::filesystem::path& fileName ) const
+{
+	const std::filesystem::path normalFileName = fileName.lexically_normal();
+	for ( Handle handle = 0; handle < m_fileNames.size(); ++handle )
+		if ( m_fileNames[ handle ].lexically_normal() == normalFileName )
+			return handle;
+
+	return std::nullopt;
+}
+
+BakedTexture TextureArraySet::LoadLayer( const Handle handle, const CompressedTextureCache& cache ) const
+{
+	const Array& array = m_arrays[ m_layers[ handle ].array ];
+
+	BakedTexture image = cache.Load( m_fileNames[ handle ], true, CompressedTextureCache::Resize::Exact, glm::ivec2( array.size.x, array.size.y ) );
+	if ( !image.IsEmpty() && !PromoteTexture( image, array.format ) )
+	{
+		// a BC1 array cannot take a translucent image
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[TextureArraySet] %s became translucent, its array is opaque. Restart to apply it.",
+						m_fileNames[ handle ].string().c_str() );
+		return {};
+	}
+	return image;
+}
+
+void TextureArraySet::Clean()
+{
+	for ( Array& array : m_arrays )
+		glDeleteTextures( 1, &array.textureID );
+	m_arrays.clear();
+
+	for ( TextureLayer& layer : m_layers )
+		layer = TextureLayer{};
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "CompressedTextureCache.h"
+#include "TextureStreamer.h"
+#include "WorkerPool.h"
+
+// Location of one image inside a TextureArraySet.
+struct TextureLayer
+{
+	GLuint textureID = 0; // GL_TEXTURE_2D_ARRAY object
+	GLint  layer     = 0; // layer index inside it
+	GLint  array     = 0; // index of the array inside the set, see TextureArraySet::GetArrayID
+};
+
+// Loads a set of 2D images into a few GL_TEXTURE_2D_ARRAYs instead of one texture object per image.
+// Images are grouped by size class (both dimensions rounded to the nearest power of two) and every
+// image is resampled to its class size, so a draw only needs a layer index instead of a texture bind
+// as long as the images it uses fall into the same class.
+// The images come baked from a CompressedTextureCache: an array is BC1 if all of its images are
+// opaque, BC3 otherwise, with the mip chain from the cache.
+class TextureArraySet
+{
+public:
+	using Handle = std::size_t;
+
+	// Registers an image to be loaded by Build(). The handle stays valid until Clean().
+	Handle Add( const std::filesystem::path& fileName );
+	// Like Add, but the image always goes into the array of sameArrayAs, resampled to that size class if
+	// its own differs. For images a shader samples from one array with two layer indices.
+	Handle Add( const std::filesystem::path& fileName, const Handle sameArrayAs );
+
+	// Loads every registered image through the cache on the workers, then groups and uploads them on
+	// the calling ( GL ) thread. Logs per-file timings. With a streamer only the storage is allocated
+	// here, the levels are queued into the streamer and arrive over the next frames.
+	void Build( WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer* streamer = nullptr );
+	// The lazy alternative to Build(): the images are only probed ( CompressedTextureCache::Probe ) to group them,
+	// every array is allocated with its levels from topLevelSize down and cleared through the streamer.
+	// The layers are loaded later with LoadLayer, see TextureResidency.
+	void Allocate( WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer& streamer, const int topLevelSize );
+	void Clean();
+
+	inline const TextureLayer& Get( const Handle handle ) const { return m_layers[ handle ]; }
+
+	// Reloading one image after Build(). The array keeps its size class, a resized image is resampled to it.
+	// The handle the file was registered with.
+	std::optional<Handle> Find( const std::filesystem::path& fileName ) const;
+	// Loads the image baked to its layer's size and format. Touches no GL state, so it may run on
+	// another thread as long as Build() and Clean() do not run meanwhile. Empty if it cannot be loaded
+	// or does not fit the array: a translucent image cannot go into a BC1 array.
+	BakedTexture LoadLayer( const Handle handle, const CompressedTextureCache& cache ) const;
+
+	inline std::size_t GetImageCount() const noexcept { return m_fileNames.size(); }
+	inline std::size_t GetArrayCount() const noexcept { return m_arrays.size(); }
+	inline GLuint GetArrayID( const std::size_t arrayIndex ) const { return m_arrays[ arrayIndex ].textureID; }
+	// width, height and layer count of an array, at level 0 even if the array does not have it
+	inline glm::ivec3 GetArraySize( const std::size_t arrayIndex ) const { return m_arrays[ arrayIndex ].size; }
+	inline GLenum GetArrayFormat( const std::size_t arrayIndex ) const { return m_arrays[ arrayIndex ].format; }
+	// the image of every layer
+	inline const std::vector<Handle>& GetArrayHandles( const std::size_t arrayIndex ) const { return m_arrays[ arrayIndex ].handles; }
+
+	// An array may keep only the coarser part of its mip chain: its storage starts at its top level.
+	// Level numbers here are those of the full chain, the storage's level 0 is the top level.
+	inline int GetTopLevel( const std::size_t arrayIndex ) const { return m_arrays[ arrayIndex ].topLevel; }
+	inline int GetLevelCount( const std::size_t arrayIndex ) const { return GetMipLevelCount( glm::ivec2( m_arrays[ arrayIndex ].size.x, m_arrays[ arrayIndex ].size.y ) ); }
+	// Video memory of the array with its levels from topLevel down.
+	std::size_t GetByteSize( const std::size_t arrayIndex, const int topLevel ) const;
+	// Reallocates the array starting at topLevel. The levels both storages have are copied on the GPU, new finer
+	// levels are undefined until the caller uploads them and the base level is the first copied one meanwhile.
+	// The array gets a new texture object, the layers' textureID changes. Not while the streamer uploads into it.
+	void SetTopLevel( const std::size_t arrayIndex, const int topLevel );
+
+private:
+	struct Array
+	{
+		GLuint     textureID = 0;
+		glm::ivec3 size;
+		GLenum     format    = 0;
+		int        topLevel  = 0;
+		std::vector<Handle> handles; // by layer
+	};
+
+	// Creates an array of the class with the layers' handles set, the storage is allocated from topLevel.
+	Array& AddArray( const glm::ivec2 size, const GLenum format, const std::vector<Handle>& handles, const int topLevel );
+
+	std::vector<std::filesystem::path> m_fileNames;
+	std::vector<TextureLayer>          m_layers;
+	std::vector<Handle>                m_sameArrayAs; // the handle itself if the image has its own size class
+	std::vector<Array>                 m_arrays;
+};
@@ -0,0 +1,52 @@
+#include "TextureLoadBatch.h"
+
+#include <chrono>
+
+#include <SDL2/SDL.h>
+
+#include "Timing.h"
+
+void TextureLoadBatch::Add( const std::filesystem::path& fileName, const bool flipVertically, Upload upload )
+{
+	const CompressedTextureCache* cache = &m_cache;
+	std::future<Loaded> loaded = m_workers.Submit( [ cache, fileName, flipVertically ]()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		BakedTexture image = cache->Load( fileName, flipVertically );
+		return Loaded{ std::move( image ), MillisecondsSince( start ) };
+	} );
+
+	m_entries.push_back( { fileName, std::move( loaded ), std::move( upload ) } );
+}
+
+void TextureLoadBatch::Finish()
+{
+	if ( m_entries.empty() ) return;
+
+	const auto batchStart = std::chrono::steady_clock::now();
+	double loadTotalMs = 0.0, uploadTotalMs = 0.0;
+
+	for ( Entry& entry : m_entries )
+	{
+		Loaded loaded = entry.loaded.get();
+		const glm::ivec2 size = loaded.image.size;
+		const bool isEmpty = loaded.image.IsEmpty();
+
+		const auto uploadStart = std::chrono::steady_clock::now();
+		entry.upload( loaded.image );
+		const double uploadMs = MillisecondsSince( uploadStart );
+
+		if ( !isEmpty )
+			SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureLoadBatch] %s: %dx%d, load %.1f ms, upload %.1f ms",
+						 entry.fileName.string().c_str(), size.x, size.y, loaded.loadMs, uploadMs );
+
+		loadTotalMs += loaded.loadMs;
+		uploadTotalMs += uploadMs;
+	}
+
+	// the load total is CPU time summed over the workers, the wall time shows the overlap
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureLoadBatch] %d files on %u workers: load %.1f ms, upload %.1f ms, wall %.1f ms",
+				 static_cast<int>( m_entries.size() ), m_workers.GetThreadCount(), loadTotalMs, uploadTotalMs, MillisecondsSince( batchStart ) );
+
+	m_entries.clear();
+}
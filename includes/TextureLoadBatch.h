@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "CompressedTextureCache.h"
+#include "WorkerPool.h"
+
+// Loads a set of images through a CompressedTextureCache on a WorkerPool, leaving only the GL upload
+// to the GL thread.
+class TextureLoadBatch
+{
+public:
+	// Gets the baked image, empty if it could not be loaded. Runs on the thread calling Finish(),
+	// may move the image away.
+	using Upload = std::function<void( BakedTexture& image )>;
+
+	TextureLoadBatch( WorkerPool& workers, const CompressedTextureCache& cache ) : m_workers( workers ), m_cache( cache ) {}
+	~TextureLoadBatch() { Finish(); }
+
+	// Starts loading right away.
+	void Add( const std::filesystem::path& fileName, const bool flipVertically, Upload upload );
+
+	// Uploads every image in Add() order, each as soon as it is loaded, and logs the load and
+	// upload time of every file.
+	void Finish();
+
+private:
+	struct Loaded
+	{
+		BakedTexture image;
+		double       loadMs;
+	};
+
+	struct Entry
+	{
+		std::filesystem::path fileName;
+		std::future<Loaded>   loaded;
+		Upload                upload;
+	};
+
+	WorkerPool&                   m_workers;
+	const CompressedTextureCache& m_cache;
+	std::vector<Entry> m_entries;
+};
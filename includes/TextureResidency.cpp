@@ -0,0 +1,380 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+#include <SDL2/SDL.h>
+
+static constexpr std::size_t NO_ARRAY = std::numeric_limits<std::size_t>::max();
+
+// The levels [ first, end ) of a full chain as a texture of their own.
+static BakedTexture KeepLevels( BakedTexture image, const int first, const int end )
+{
+	image.levels.erase( image.levels.begin() + end, image.levels.end() );
+	image.levels.erase( image.levels.begin(), image.levels.begin() + first );
+	image.size = GetMipLevelSize( image.size, first );
+	return image;
+}
+
+void TextureResidency::Init( TextureArraySet& set, WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer& streamer )
+{
+	m_set = &set;
+	m_workers = &workers;
+	m_cache = &cache;
+	m_streamer = &streamer;
+
+	m_set->Allocate( workers, cache, streamer, INITIAL_SIZE );
+
+	m_images = std::vector<Image>( m_set->GetImageCount() );
+	m_arrays = std::vector<Array>( m_set->GetArrayCount() );
+	m_frame = 1;
+
+	m_stats.levelsAdded = 0;
+	m_stats.levelsDropped = 0;
+}
+
+void TextureResidency::Clean()
+{
+	// the workers read the set
+	for ( Image& image : m_images )
+		if ( image.loading.valid() )
+			image.loading.wait();
+
+	m_images.clear();
+	m_arrays.clear();
+	m_set = nullptr;
+}
+
+void TextureResidency::Request( const TextureArraySet::Handle handle, const float texelsPerPixel )
+{
+	if ( handle >= m_images.size() ) return;
+
+	// level n has texelsPerPixel / 2^n texels per pixel, the finest one with at least one is enough
+	const int level = texelsPerPixel > 1.0f ? static_cast<int>( std::floor( std::log2( texelsPerPixel ) ) ) : 0;
+
+	Image& image = m_images[ handle ];
+	image.wantedLevel = image.lastRequest == m_frame ? std::min( image.wantedLevel, level ) : level;
+	image.lastRequest = m_frame;
+}
+
+void TextureResidency::Reload( const TextureArraySet::Handle handle )
+{
+	if ( handle >= m_images.size() ) return;
+
+	// not loaded yet: the first load reads the new source anyway
+	Image& image = m_images[ handle ];
+	if ( image.loading.valid() )
+	{
+		image.stale = true;
+	}
+	else if ( image.resident || image.arrived )
+	{
+		image.arrived = false;
+		image.loaded = {};
+		StartLoad( handle );
+	}
+}
+
+void TextureResidency::Update()
+{
+	if ( m_set == nullptr ) return;
+
+	// finished loads
+	for ( TextureArraySet::Handle handle = 0; handle < m_images.size(); ++handle )
+	{
+		Image& image = m_images[ handle ];
+		if ( !image.loading.valid() || image.loading.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) continue;
+
+		image.loaded = image.loading.get();
+		image.arrived = !image.stale;
+		if ( image.stale )
+		{
+			image.stale = false;
+			image.loaded = {};
+			StartLoad( handle );
+		}
+	}
+
+	// first loads of the images visible in the last frame
+	for ( TextureArraySet::Handle handle = 0; handle < m_images.size(); ++handle )
+	{
+		const Image& image = m_images[ handle ];
+		if ( image.lastRequest == m_frame && !image.resident && !image.arrived && !image.loading.valid() )
+			StartLoad( handle );
+	}
+
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+	{
+		if ( m_arrays[ arrayIndex ].targetLevel < 0 )
+			QueueLoaded( arrayIndex );
+		else
+			FinishGrowing( arrayIndex );
+	}
+
+	// over the budget ( it was lowered ): a growth in progress is given up first, then levels go
+	std::size_t committedBytes = m_stats.externalBytes;
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+		committedBytes += GetCommittedBytes( arrayIndex );
+
+	if ( committedBytes > m_stats.budgetBytes )
+	{
+		for ( Array& array : m_arrays )
+			array.targetLevel = -1;
+		DropLevels( 0, 2, NO_ARRAY, true );
+	}
+	else
+	{
+		Grow();
+	}
+
+	m_stats.residentBytes = 0;
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+		m_stats.residentBytes += GetCommittedBytes( arrayIndex );
+
+	m_stats.loadedImages = 0;
+	m_stats.loadingImages = 0;
+	for ( const Image& image : m_images )
+	{
+		m_stats.loadedImages += image.resident ? 1 : 0;
+		m_stats.loadingImages += image.loading.valid() ? 1 : 0;
+	}
+
+	++m_frame;
+}
+
+bool TextureResidency::IsRecent( const Image& image ) const noexcept
+{
+	return image.lastRequest != 0 && m_frame - image.lastRequest < RECENT_FRAMES;
+}
+
+void TextureResidency::StartLoad( const TextureArraySet::Handle handle )
+{
+	// the full chain at the class size, the levels the array has are picked when it arrives
+	const TextureArraySet* set = m_set;
+	const CompressedTextureCache* cache = m_cache;
+	m_images[ handle ].loading = m_workers->Submit( [ set, cache, handle ]() { return set->LoadLayer( handle, *cache ); } );
+}
+
+bool TextureResidency::IsLoading( const std::size_t arrayIndex ) const
+{
+	for ( const TextureArraySet::Handle handle : m_set->GetArrayHandles( arrayIndex ) )
+		if ( m_images[ handle ].loading.valid() )
+			return true;
+	return false;
+}
+
+void TextureResidency::QueueLoaded( const std::size_t arrayIndex )
+{
+	const int topLevel = m_set->GetTopLevel( arrayIndex );
+	const int levelCount = m_set->GetLevelCount( arrayIndex );
+
+	for ( const TextureArraySet::Handle handle : m_set->GetArrayHandles( arrayIndex ) )
+	{
+		Image& image = m_images[ handle ];
+		if ( !image.arrived ) continue;
+
+		// a failed load leaves the layer clear, the cache has logged why
+		if ( !image.loaded.IsEmpty() )
+		{
+			const TextureLayer& layer = m_set->Get( handle );
+			m_streamer->EnqueueLayer( layer.textureID, layer.layer, KeepLevels( std::move( image.loaded ), topLevel, levelCount ) );
+		}
+
+		image.loaded = {};
+		image.arrived = false;
+		image.resident = true;
+	}
+}
+
+void TextureResidency::FinishGrowing( const std::size_t arrayIndex )
+{
+	// the new levels of every layer have to be queued together: the base level of the array goes down
+	// only when all of them are in. The copy needs levels the streamer is done with.
+	if ( IsLoading( arrayIndex ) || m_streamer->IsStreaming( m_set->GetArrayID( arrayIndex ) ) ) return;
+
+	const int oldTopLevel = m_set->GetTopLevel( arrayIndex );
+	const int topLevel = m_arrays[ arrayIndex ].targetLevel;
+	const int levelCount = m_set->GetLevelCount( arrayIndex );
+	const glm::ivec3 size = m_set->GetArraySize( arrayIndex );
+	const GLenum format = m_set->GetArrayFormat( arrayIndex );
+
+	m_set->SetTopLevel( arrayIndex, topLevel );
+	m_arrays[ arrayIndex ].targetLevel = -1;
+	m_stats.levelsAdded += oldTopLevel - topLevel;
+
+	const GLuint textureID = m_set->GetArrayID( arrayIndex );
+	const std::vector<TextureArraySet::Handle>& handles = m_set->GetArrayHandles( arrayIndex );
+
+	for ( GLint layer = 0; layer < static_cast<GLint>( handles.size() ); ++layer )
+	{
+		Image& image = m_images[ handles[ layer ] ];
+
+		if ( !image.arrived || image.loaded.IsEmpty() )
+			// never loaded or failed: the new levels are cleared like the rest of the layer
+			m_streamer->EnqueueFinerLevels( textureID, layer, KeepLevels( MakeClearTexture( format, GetMipLevelSize( glm::ivec2( size.x, size.y ), topLevel ) ), 0, oldTopLevel - topLevel ) );
+		else if ( image.resident )
+			m_streamer->EnqueueFinerLevels( textureID, layer, KeepLevels( std::move( image.loaded ), topLevel, oldTopLevel ) );
+		else
+			m_streamer->EnqueueLayer( textureID, layer, KeepLevels( std::move( image.loaded ), topLevel, levelCount ) );
+
+		if ( image.arrived )
+		{
+			image.loaded = {};
+			image.arrived = false;
+			image.resident = true;
+		}
+	}
+
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureResidency] %dx%d array: levels from %d instead of %d, %.1f MB",
+				 size.x, size.y, topLevel, oldTopLevel, m_set->GetByteSize( arrayIndex, topLevel ) / ( 1024.0 * 1024.0 ) );
+}
+
+int TextureResidency::GetWantedLevel( const std::size_t arrayIndex ) const
+{
+	int wantedLevel = -1;
+	for ( const TextureArraySet::Handle handle : m_set->GetArrayHandles( arrayIndex ) )
+	{
+		const Image& image = m_images[ handle ];
+		if ( IsRecent( image ) )
+			wantedLevel = wantedLevel < 0 ? image.wantedLevel : std::min( wantedLevel, image.wantedLevel );
+	}
+	return wantedLevel < 0 ? -1 : std::min( wantedLevel, m_set->GetLevelCount( arrayIndex ) - 1 );
+}
+
+std::uint64_t TextureResidency::GetLastRequest( const std::size_t arrayIndex ) const
+{
+	std::uint64_t lastRequest = 0;
+	for ( const TextureArraySet::Handle handle : m_set->GetArrayHandles( arrayIndex ) )
+		lastRequest = std::max( lastRequest, m_images[ handle ].lastRequest );
+	return lastRequest;
+}
+
+std::size_t TextureResidency::GetCommittedBytes( const std::size_t arrayIndex ) const
+{
+	const int targetLevel = m_arrays[ arrayIndex ].targetLevel;
+	return m_set->GetByteSize( arrayIndex, targetLevel >= 0 ? targetLevel : m_set->GetTopLevel( arrayIndex ) );
+}
+
+int TextureResidency::GetDropRank( const std::size_t arrayIndex, const int topLevel ) const
+{
+	const int wantedLevel = GetWantedLevel( arrayIndex );
+	if ( wantedLevel < 0 ) return 0;
+	return topLevel < wantedLevel ? 1 : 2;
+}
+
+bool TextureResidency::DropLevels( const std::size_t extraBytes, const int maxRank, const std::size_t keep, const bool partial )
+{
+	std::size_t committedBytes = m_stats.externalBytes + extraBytes;
+	std::vector<int> topLevels( m_arrays.size() );
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+	{
+		committedBytes += GetCommittedBytes( arrayIndex );
+		topLevels[ arrayIndex ] = m_set->GetTopLevel( arrayIndex );
+	}
+
+	// planned one level at a time, every array is reallocated once at the end
+	while ( committedBytes > m_stats.budgetBytes )
+	{
+		// the lowest rank, the least recently visible, the largest
+		std::size_t victim = NO_ARRAY;
+		std::tuple<int, std::uint64_t, std::size_t> victimOrder;
+
+		for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+		{
+			if ( arrayIndex == keep || m_arrays[ arrayIndex ].targetLevel >= 0 || topLevels[ arrayIndex ] + 1 >= m_set->GetLevelCount( arrayIndex )
+				 || m_streamer->IsStreaming( m_set->GetArrayID( arrayIndex ) ) )
+				continue;
+
+			const int rank = GetDropRank( arrayIndex, topLevels[ arrayIndex ] );
+			if ( rank > maxRank ) continue;
+
+			const std::tuple<int, std::uint64_t, std::size_t> order( rank, GetLastRequest( arrayIndex ), NO_ARRAY - m_set->GetByteSize( arrayIndex, topLevels[ arrayIndex ] ) );
+			if ( victim == NO_ARRAY || order < victimOrder )
+			{
+				victim = arrayIndex;
+				victimOrder = order;
+			}
+		}
+
+		if ( victim == NO_ARRAY ) break;
+
+		committedBytes -= m_set->GetByteSize( victim, topLevels[ victim ] ) - m_set->GetByteSize( victim, topLevels[ victim ] + 1 );
+		++topLevels[ victim ];
+	}
+
+	const bool fits = committedBytes <= m_stats.budgetBytes;
+	if ( !fits && !partial ) return false;
+
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+	{
+		const int oldTopLevel = m_set->GetTopLevel( arrayIndex );
+		if ( topLevels[ arrayIndex ] == oldTopLevel ) continue;
+
+		m_set->SetTopLevel( arrayIndex, topLevels[ arrayIndex ] );
+		m_stats.levelsDropped += topLevels[ arrayIndex ] - oldTopLevel;
+
+		const glm::ivec3 size = m_set->GetArraySize( arrayIndex );
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[TextureResidency] %dx%d array: levels from %d instead of %d, %.1f MB",
+					 size.x, size.y, topLevels[ arrayIndex ], oldTopLevel, m_set->GetByteSize( arrayIndex, topLevels[ arrayIndex ] ) / ( 1024.0 * 1024.0 ) );
+	}
+
+	return fits;
+}
+
+void TextureResidency::Grow()
+{
+	// one array at a time, its loads are spread over the next frames
+	for ( const Array& array : m_arrays )
+		if ( array.targetLevel >= 0 ) return;
+
+	// the most recently visible array that needs finer levels, the one missing the most of those
+	std::size_t grown = NO_ARRAY;
+	std::pair<std::uint64_t, int> grownOrder;
+
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+	{
+		const int wantedLevel = GetWantedLevel( arrayIndex );
+		const int topLevel = m_set->GetTopLevel( arrayIndex );
+		if ( wantedLevel < 0 || wantedLevel >= topLevel ) continue;
+
+		const std::pair<std::uint64_t, int> order( GetLastRequest( arrayIndex ), topLevel - wantedLevel );
+		if ( grown == NO_ARRAY || order > grownOrder )
+		{
+			grown = arrayIndex;
+			grownOrder = order;
+		}
+	}
+
+	if ( grown == NO_ARRAY ) return;
+
+	const int topLevel = m_set->GetTopLevel( grown );
+	const int wantedLevel = GetWantedLevel( grown );
+	const std::size_t currentBytes = m_set->GetByteSize( grown, topLevel );
+
+	// room for at least one more level, from the arrays no recently visible image needs at their size
+	const std::size_t extraBytes = m_set->GetByteSize( grown, topLevel - 1 ) - currentBytes;
+	if ( !DropLevels( extraBytes, 1, grown, false ) ) return;
+
+	std::size_t committedBytes = m_stats.externalBytes;
+	for ( std::size_t arrayIndex = 0; arrayIndex < m_arrays.size(); ++arrayIndex )
+		committedBytes += GetCommittedBytes( arrayIndex );
+
+	// then as many levels as the budget allows
+	int targetLevel = topLevel - 1;
+	while ( targetLevel > wantedLevel && committedBytes - currentBytes + m_set->GetByteSize( grown, targetLevel - 1 ) <= m_stats.budgetBytes )
+		--targetLevel;
+
+	m_arrays[ grown ].targetLevel = targetLevel;
+
+	// the loaded images again for their new levels, the ones not loaded yet get cleared levels
+	for ( const TextureArraySet::Handle handle : m_set->GetArrayHandles( grown ) )
+	{
+		const Image& image = m_images[ handle ];
+		if ( image.resident && !image.arrived && !image.loading.valid() )
+			StartLoad( handle );
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "CompressedTextureCache.h"
+#include "TextureArraySet.h"
+#include "TextureStreamer.h"
+#include "WorkerPool.h"
+
+// Keeps the images of a TextureArraySet in video memory only as far as they are needed, within a budget.
+//
+// Nothing is loaded up front: the arrays are allocated small ( TextureArraySet::Allocate ) and an image is
+// loaded through the cache on the workers the first time it is requested, that is when something using it is
+// visible. A request also tells how many level 0 texels fall on a screen pixel, which gives the finest level
+// worth having. Levels can only be added or dropped for a whole array, since its layers share one storage:
+// the array is reallocated down to the finest level any of its recently visible images needs, the levels it
+// already has are copied on the GPU and only the new ones are loaded and streamed in.
+// The budget is a hard cap. An array only grows as far as the budget allows. When it is exceeded ( lowered, or
+// to make room for a visible array ) finest levels are dropped: first from the arrays whose images were visible
+// the longest time ago, then from arrays with more detail than their images need, at last from visible ones.
+class TextureResidency
+{
+public:
+	struct Stats
+	{
+		std::size_t   budgetBytes   = 0;
+		std::size_t   residentBytes = 0; // the arrays as allocated, growing ones at their target size
+		std::size_t   externalBytes = 0; // see SetExternalBytes
+		std::size_t   loadedImages  = 0;
+		std::size_t   loadingImages = 0;
+		std::uint32_t levelsAdded   = 0; // since Init
+		std::uint32_t levelsDropped = 0;
+	};
+
+	// the arrays start with their levels from this size down
+	static constexpr int INITIAL_SIZE = 64;
+	// an image counts as visible for this many frames after its last request
+	static constexpr std::uint64_t RECENT_FRAMES = 120;
+
+	// Allocates the set lazily and starts managing it. The set, workers, cache and streamer must outlive Clean().
+	void Init( TextureArraySet& set, WorkerPool& workers, const CompressedTextureCache& cache, TextureStreamer& streamer );
+	// Waits for the loads still running, before the set is cleaned.
+	void Clean();
+
+	// Bytes of video memory the set may use, together with the external bytes.
+	inline void SetBudget( const std::size_t budgetBytes ) noexcept { m_stats.budgetBytes = budgetBytes; }
+	// Video memory of textures not managed here that count against the budget ( skybox, virtual texture atlas ).
+	inline void SetExternalBytes( const std::size_t externalBytes ) noexcept { m_stats.externalBytes = externalBytes; }
+
+	// Something using the image is visible this frame. texelsPerPixel: how many level 0 texels fall on one
+	// screen pixel at most, level log2( texelsPerPixel ) is the finest one needed.
+	void Request( const TextureArraySet::Handle handle, const float texelsPerPixel );
+	// Loads the image again from its changed source, if it is loaded at all.
+	void Reload( const TextureArraySet::Handle handle );
+
+	// Once per frame on the GL thread, after the requests of the previous frame: queues the finished loads into
+	// the streamer, starts new ones and adds or drops levels. An array may get a new texture object, so the
+	// TextureLayer::textureIDs have to be read after this.
+	void Update();
+
+	inline const Stats& GetStats() const noexcept { return m_stats; }
+
+private:
+	struct Image
+	{
+		std::future<BakedTexture> loading;
+		BakedTexture  loaded;          // a finished load waiting to be queued, empty if it failed
+		bool          arrived  = false; // loaded is set
+		bool          resident = false; // its pixels are in the array, cleared until then
+		bool          stale    = false; // loaded from the old source, load again
+		std::uint64_t lastRequest = 0;  // frame of the last request, 0: never
+		int           wantedLevel = 0;  // the finest level of the last frame with requests
+	};
+
+	struct Array
+	{
+		int targetLevel = -1; // growing to this top level once its images are loaded, -1: not growing
+	};
+
+	bool IsRecent( const Image& image ) const noexcept;
+	void StartLoad( const TextureArraySet::Handle handle );
+	bool IsLoading( const std::size_t arrayIndex ) const;
+
+	void QueueLoaded( const std::size_t arrayIndex );
+	void FinishGrowing( const std::size_t arrayIndex );
+	// the finest level the recently visible images of the array need, -1 if none of them is recent
+	int GetWantedLevel( const std::size_t arrayIndex ) const;
+	std::uint64_t GetLastRequest( const std::size_t arrayIndex ) const;
+	// the array at its current top level, or at its target while growing
+	std::size_t GetCommittedBytes( const std::size_t arrayIndex ) const;
+
+	// Which arrays lose levels first: 0 none of its images is recent, 1 it has finer levels than its recent
+	// images need, 2 the rest.
+	int GetDropRank( const std::size_t arrayIndex, const int topLevel ) const;
+	// Drops finest levels until the committed bytes plus extraBytes fit the budget, from arrays of at most
+	// maxRank except keep. All or nothing unless partial. Returns whether it fits.
+	bool DropLevels( const std::size_t extraBytes, const int maxRank, const std::size_t keep, const bool partial );
+	// Starts growing the most recently visible array that needs finer levels, as far as the budget allows.
+	void Grow();
+
+	TextureArraySet*              m_set = nullptr;
+	WorkerPool*                   m_workers = nullptr;
+	const CompressedTextureCache* m_cache = nullptr;
+	TextureStreamer*              m_streamer = nullptr;
+
+	std::vector<Image> m_images;
+	std::vector<Array> m_arrays;
+	std::uint64_t      m_frame = 1; // counted by Update, the requests until the next Update belong to it
+
+	Stats m_stats;
+};
@@ -0,0 +1,288 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <SDL2/SDL.h>
+
+#include "Timing.h"
+
+// Upper bound of one upload, small enough that the budget is overshot by a fraction of a millisecond at most.
+static constexpr std::size_t MAX_CHUNK_BYTES = 1 << 20;
+
+static bool IsCompressed( const GLenum format ) noexcept { return format != GL_RGBA8; }
+
+// Bytes of the first rowCount rows of a level, rowCount is a multiple of 4 for block compressed formats
+static std::size_t GetRowsByteSize( const GLenum format, const int width, const int rowCount ) noexcept
+{
+	return rowCount > 0 ? GetLevelByteSize( format, glm::ivec2( width, rowCount ) ) : 0;
+}
+
+void TextureStreamer::Init()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers( 1, &m_bufferID );
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_bufferID );
+	if ( GLEW_ARB_buffer_storage )
+	{
+		glBufferStorage( GL_PIXEL_UNPACK_BUFFER, m_ringSize, nullptr, flags );
+		m_mapped = static_cast<std::uint8_t*>( glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, m_ringSize, flags ) );
+	}
+	else
+	{
+		glBufferData( GL_PIXEL_UNPACK_BUFFER, m_ringSize, nullptr, GL_STREAM_DRAW );
+	}
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[TextureStreamer] %d MB ring, %s", static_cast<int>( m_ringSize >> 20 ),
+					m_mapped != nullptr ? "persistently mapped" : "mapped per upload" );
+}
+
+void TextureStreamer::Clean()
+{
+	m_chunks.clear();
+	m_chunkCount = 0;
+	m_progress.clear();
+	m_stats.pendingBytes = 0;
+
+	RetireUploads( true );
+
+	if ( m_bufferID != 0 )
+	{
+		if ( m_mapped != nullptr )
+		{
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_bufferID );
+			glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+			m_mapped = nullptr;
+		}
+		glDeleteBuffers( 1, &m_bufferID );
+		m_bufferID = 0;
+	}
+	m_head = 0;
+}
+
+void TextureStreamer::EnqueueLayer( const GLuint textureID, const GLint layer, BakedTexture image )
+{
+	Enqueue( textureID, GL_TEXTURE_2D_ARRAY, layer, std::move( image ), false );
+}
+
+void TextureStreamer::EnqueueFace( const GLuint textureID, const GLenum face, BakedTexture image )
+{
+	Enqueue( textureID, face, 0, std::move( image ), false );
+}
+
+void TextureStreamer::EnqueueFinerLevels( const GLuint textureID, const GLint layer, BakedTexture image )
+{
+	Enqueue( textureID, GL_TEXTURE_2D_ARRAY, layer, std::move( image ), true );
+}
+
+void TextureStreamer::Enqueue( const GLuint textureID, const GLenum target, const GLint layer, BakedTexture image, const bool hasCoarserLevels )
+{
+	if ( image.IsEmpty() ) return;
+
+	if ( m_chunkCount == 0 )
+	{
+		m_streamStart = std::chrono::steady_clock::now();
+		m_streamFrames = 0;
+		m_streamBytes = 0;
+	}
+
+	const GLenum bindTarget = target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_2D ? target : GL_TEXTURE_CUBE_MAP;
+	const int levelCount = static_cast<int>( image.levels.size() );
+
+	// until the new levels arrive only the smallest one is sampled, previously streamed layers included,
+	// or the first level the texture already has
+	const int keptLevel = hasCoarserLevels ? levelCount : levelCount - 1;
+	Progress& progress = m_progress.try_emplace( textureID, Progress{ bindTarget, std::vector<int>( keptLevel + 1, 0 ), keptLevel } ).first->second;
+	progress.pendingChunks.resize( std::max<std::size_t>( progress.pendingChunks.size(), keptLevel + 1 ), 0 );
+	progress.baseLevel = hasCoarserLevels ? std::max( progress.baseLevel, keptLevel ) : static_cast<int>( progress.pendingChunks.size() ) - 1;
+
+	glBindTexture( bindTarget, textureID );
+	glTexParameteri( bindTarget, GL_TEXTURE_BASE_LEVEL, progress.baseLevel );
+	glBindTexture( bindTarget, 0 );
+
+	auto shared = std::make_shared<const Image>( Image{ std::move( image ), textureID, target, layer } );
+	const BakedTexture& texture = shared->texture;
+
+	// whole block rows per chunk
+	const int rowGranularity = IsCompressed( texture.format ) ? 4 : 1;
+
+	for ( int level = 0; level < levelCount; ++level )
+	{
+		const glm::ivec2 size = GetMipLevelSize( texture.size, level );
+		const std::size_t granuleBytes = GetRowsByteSize( texture.format, size.x, rowGranularity );
+		const int rowsPerChunk = static_cast<int>( std::max<std::size_t>( 1, std::min( MAX_CHUNK_BYTES, m_ringSize / 4 ) / granuleBytes ) ) * rowGranularity;
+
+		for ( int row = 0; row < size.y; row += rowsPerChunk )
+		{
+			m_chunks[ level ].push_back( Chunk{ shared, level, row, std::min( row + rowsPerChunk, size.y ) } );
+			++progress.pendingChunks[ level ];
+			++m_chunkCount;
+		}
+		m_stats.pendingBytes += texture.levels[ level ].size();
+	}
+}
+
+void TextureStreamer::Update( const double budgetMs )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	m_stats.uploadedBytes = 0;
+	m_stats.uploads = 0;
+
+	if ( m_chunkCount > 0 )
+	{
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_bufferID );
+
+		while ( !m_chunks.empty() && MillisecondsSince( start ) < budgetMs )
+		{
+			auto level = m_chunks.begin();
+			const Chunk chunk = level->second.front();
+
+			const BakedTexture& texture = chunk.image->texture;
+			const int width = GetMipLevelSize( texture.size, chunk.level ).x;
+			const std::size_t size = GetRowsByteSize( texture.format, width, chunk.rowEnd - chunk.rowBegin );
+
+			// the ring is full of data the GPU has not read yet: the rest waits for the next frame
+			std::size_t offset = 0;
+			if ( !Allocate( size, IsCompressed( texture.format ) ? 16 : 4, offset ) ) break;
+
+			level->second.pop_front();
+			if ( level->second.empty() ) m_chunks.erase( level );
+			--m_chunkCount;
+
+			Upload( chunk, offset, size );
+			CompleteChunk( chunk );
+		}
+
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+		++m_streamFrames;
+		m_streamBytes += m_stats.uploadedBytes;
+
+		if ( m_chunkCount == 0 )
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[TextureStreamer] Streamed %.1f MB in %u frames, %.0f ms, longest update %.2f ms",
+							m_streamBytes / ( 1024.0 * 1024.0 ), m_streamFrames, MillisecondsSince( m_streamStart ), std::max( m_stats.maxUpdateMs, MillisecondsSince( start ) ) );
+	}
+
+	m_stats.updateMs = MillisecondsSince( start );
+	m_stats.maxUpdateMs = std::max( m_stats.maxUpdateMs, m_stats.updateMs );
+}
+
+bool TextureStreamer::Allocate( const std::size_t size, const std::size_t alignment, std::size_t& offset )
+{
+	RetireUploads( false );
+
+	auto align = [ alignment ]( const std::size_t value ) { return ( value + alignment - 1 ) / alignment * alignment; };
+
+	if ( m_inFlight.empty() )
+		m_head = 0;
+
+	std::size_t begin = align( m_head );
+
+	if ( m_inFlight.empty() || m_head >= m_inFlight.front().begin )
+	{
+		// free space: [ head, end of the ring ), then [ 0, oldest in flight )
+		const std::size_t tail = m_inFlight.empty() ? m_ringSize : m_inFlight.front().begin;
+		if ( begin + size > m_ringSize )
+		{
+			// the head never catches up with the tail, so head == tail always means empty
+			if ( m_inFlight.empty() ? size > m_ringSize : size >= tail ) return false;
+			begin = 0;
+		}
+	}
+	else if ( begin + size >= m_inFlight.front().begin )
+	{
+		return false;
+	}
+
+	offset = begin;
+	m_head = begin + size;
+	return true;
+}
+
+void TextureStreamer::RetireUploads( const bool wait )
+{
+	while ( !m_inFlight.empty() )
+	{
+		const GLenum status = glClientWaitSync( m_inFlight.front().fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0 );
+		if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && !wait ) break;
+
+		glDeleteSync( m_inFlight.front().fence );
+		m_inFlight.pop_front();
+	}
+}
+
+void TextureStreamer::Upload( const Chunk& chunk, const std::size_t offset, const std::size_t size )
+{
+	const Image& image = *chunk.image;
+	const BakedTexture& texture = image.texture;
+	const glm::ivec2 levelSize = GetMipLevelSize( texture.size, chunk.level );
+	const int rowCount = chunk.rowEnd - chunk.rowBegin;
+
+	const std::uint8_t* source = texture.levels[ chunk.level ].data() + GetRowsByteSize( texture.format, levelSize.x, chunk.rowBegin );
+
+	if ( m_mapped != nullptr )
+	{
+		std::memcpy( m_mapped + offset, source, size );
+	}
+	else
+	{
+		// the fences already guarantee the GPU is done with the range
+		void* target = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+		std::memcpy( target, source, size );
+		glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+	}
+
+	const void* pixels = reinterpret_cast<const void*>( offset );
+	const GLenum bindTarget = m_progress.at( image.textureID ).bindTarget;
+
+	glBindTexture( bindTarget, image.textureID );
+	if ( image.target == GL_TEXTURE_2D_ARRAY )
+	{
+		if ( IsCompressed( texture.format ) )
+			glCompressedTexSubImage3D( GL_TEXTURE_2D_ARRAY, chunk.level, 0, chunk.rowBegin, image.layer, levelSize.x, rowCount, 1, texture.format, static_cast<GLsizei>( size ), pixels );
+		else
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, chunk.level, 0, chunk.rowBegin, image.layer, levelSize.x, rowCount, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+	}
+	else
+	{
+		if ( IsCompressed( texture.format ) )
+			glCompressedTexSubImage2D( image.target, chunk.level, 0, chunk.rowBegin, levelSize.x, rowCount, texture.format, static_cast<GLsizei>( size ), pixels );
+		else
+			glTexSubImage2D( image.target, chunk.level, 0, chunk.rowBegin, levelSize.x, rowCount, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+	}
+	glBindTexture( bindTarget, 0 );
+
+	m_inFlight.push_back( InFlight{ offset, offset + size, glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ) } );
+
+	m_stats.pendingBytes -= size;
+	m_stats.uploadedBytes += size;
+	++m_stats.uploads;
+}
+
+void TextureStreamer::CompleteChunk( const Chunk& chunk )
+{
+	auto it = m_progress.find( chunk.image->textureID );
+	Progress& progress = it->second;
+	--progress.pendingChunks[ chunk.level ];
+
+	// levels are served smallest first, so everything above a complete level is complete as well
+	int baseLevel = progress.baseLevel;
+	while ( baseLevel > 0 && progress.pendingChunks[ baseLevel ] == 0 && progress.pendingChunks[ baseLevel - 1 ] == 0 )
+		--baseLevel;
+
+	if ( baseLevel != progress.baseLevel )
+	{
+		progress.baseLevel = baseLevel;
+		glBindTexture( progress.bindTarget, chunk.image->textureID );
+		glTexParameteri( progress.bindTarget, GL_TEXTURE_BASE_LEVEL, baseLevel );
+		glBindTexture( progress.bindTarget, 0 );
+	}
+
+	if ( baseLevel == 0 && progress.pendingChunks[ 0 ] == 0 )
+		m_progress.erase( it );
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "CompressedTextureCache.h"
+
+// Streams baked textures into already allocated immutable storage ( glTexStorage* ) over several frames.
+//
+// The data goes through a ring of pixel unpack buffer memory, persistently mapped when the driver has
+// ARB_buffer_storage and mapped unsynchronized per upload otherwise, with a fence for every upload so
+// the CPU never writes memory the GPU may still read. Levels are uploaded smallest first across every
+// queued texture, in chunks of whole block rows, and every texture's GL_TEXTURE_BASE_LEVEL follows the
+// finest level that is complete, so it shows up blurry right away and sharpens as the rest arrives.
+class TextureStreamer
+{
+public:
+	struct Stats
+	{
+		std::size_t   pendingBytes  = 0; // queued but not uploaded yet
+		std::size_t   uploadedBytes = 0; // during the last Update
+		std::uint32_t uploads       = 0; // chunks during the last Update
+		double        updateMs      = 0.0;
+		double        maxUpdateMs   = 0.0; // since the last ResetStats
+	};
+
+	// ringSize: bytes of the pixel unpack ring. Chunks are at most a quarter of it.
+	explicit TextureStreamer( const std::size_t ringSize = 32 << 20 ) : m_ringSize( ringSize ) {}
+
+	// Needs a current GL context.
+	void Init();
+	// Drops everything still queued and waits for the GPU to finish reading the ring.
+	void Clean();
+
+	// Queue every level of image for one layer of a GL_TEXTURE_2D_ARRAY, or for one face of a cube map
+	// or a GL_TEXTURE_2D ( face = GL_TEXTURE_2D ). The storage must have the image's format, size and levels.
+	void EnqueueLayer( const GLuint textureID, const GLint layer, BakedTexture image );
+	void EnqueueFace( const GLuint textureID, const GLenum face, BakedTexture image );
+	// Like EnqueueLayer, for an image with only the finest levels of the storage: the coarser ones are already
+	// in the texture and stay sampled until the new levels arrive, instead of only the smallest one.
+	void EnqueueFinerLevels( const GLuint textureID, const GLint layer, BakedTexture image );
+
+	// Uploads chunks until budgetMs of CPU time is spent, the queue is empty or the ring is full.
+	// Binds textures and GL_PIXEL_UNPACK_BUFFER directly, the GLStateCache must be invalidated afterwards.
+	void Update( const double budgetMs );
+
+	inline bool IsIdle() const noexcept { return m_chunkCount == 0; }
+	// true while levels are queued for the texture: its base level still changes and its storage must stay
+	inline bool IsStreaming( const GLuint textureID ) const { return m_progress.count( textureID ) != 0; }
+	inline const Stats& GetStats() const noexcept { return m_stats; }
+	inline void ResetStats() noexcept { m_stats.maxUpdateMs = 0.0; }
+
+private:
+	struct Image
+	{
+		BakedTexture texture;
+		GLuint       textureID;
+		GLenum       target; // GL_TEXTURE_2D_ARRAY, a cube map face or GL_TEXTURE_2D
+		GLint        layer;
+	};
+
+	struct Chunk
+	{
+		std::shared_ptr<const Image> image;
+		int level;
+		int rowBegin, rowEnd; // pixel rows of the level, multiples of 4 for block compressed formats
+	};
+
+	// Per texture: chunks still queued for each level, to know which base level is complete.
+	struct Progress
+	{
+		GLenum           bindTarget;
+		std::vector<int> pendingChunks;
+		int              baseLevel;
+	};
+
+	struct InFlight
+	{
+		std::size_t begin, end;
+		GLsync      fence;
+	};
+
+	void Enqueue( const GLuint textureID, const GLenum target, const GLint layer, BakedTexture image, const bool hasCoarserLevels );
+	bool Allocate( const std::size_t size, const std::size_t alignment, std::size_t& offset );
+	void RetireUploads( const bool wait );
+	void Upload( const Chunk& chunk, const std::size_t offset, const std::size_t size );
+	void CompleteChunk( const Chunk& chunk );
+
+	std::size_t m_ringSize;
+	GLuint      m_bufferID = 0;
+	std::uint8_t* m_mapped = nullptr; // the whole ring while persistently mapped, nullptr otherwise
+	std::size_t m_head = 0;
+	std::deque<InFlight> m_inFlight;
+
+	// smallest level first: the key is the level index, the largest key is served first
+	std::map<int, std::deque<Chunk>, std::greater<int>> m_chunks;
+	std::size_t m_chunkCount = 0;
+	std::map<GLuint, Progress> m_progress;
+
+	Stats m_stats;
+
+	// the current stream, from the first Enqueue into an empty queue until it drains
+	std::chrono::steady_clock::time_point m_streamStart;
+	std::uint32_t m_streamFrames = 0;
+	std::size_t   m_streamBytes  = 0;
+};
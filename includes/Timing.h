@@ -0,0 +1,9 @@
+#pragma once
+
+#include <chrono>
+
+// Wall time since start in milliseconds, for the load and upload logs.
+inline double MillisecondsSince( const std::chrono::steady_clock::time_point start )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstring>
+
+#include <GL/glew.h>
+
+// A uniform buffer object holding one std140 block of type BlockT.
+// BlockT must mirror the GLSL block layout byte by byte (explicit padding, no vec3 followed by vec3).
+// The buffer is bound to a fixed binding point once; programs pick it up through
+// layout( std140, binding = N ) without any per-program setup.
+template <typename BlockT>
+class UniformBuffer
+{
+public:
+	void Create( const GLuint bindingPoint )
+	{
+		m_bindingPoint = bindingPoint;
+
+		glGenBuffers( 1, &m_bufferID );
+		glBindBuffer( GL_UNIFORM_BUFFER, m_bufferID );
+		glBufferData( GL_UNIFORM_BUFFER, sizeof( BlockT ), nullptr, GL_DYNAMIC_DRAW );
+		glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+		glBindBufferBase( GL_UNIFORM_BUFFER, m_bindingPoint, m_bufferID );
+
+		m_valid = false;
+	}
+
+	void Clean()
+	{
+		glDeleteBuffers( 1, &m_bufferID );
+		m_bufferID = 0;
+		m_valid = false;
+	}
+
+	// Uploads the block only if it differs from what the buffer already holds.
+	// Returns whether an upload happened.
+	bool Update( const BlockT& data )
+	{
+		if ( m_valid && std::memcmp( &m_shadow, &data, sizeof( BlockT ) ) == 0 )
+			return false;
+
+		m_shadow = data;
+		m_valid = true;
+
+		glBindBuffer( GL_UNIFORM_BUFFER, m_bufferID );
+		glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( BlockT ), &m_shadow );
+		glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+		return true;
+	}
+
+	inline GLuint GetID() const noexcept { return m_bufferID; }
+	inline GLuint GetBindingPoint() const noexcept { return m_bindingPoint; }
+
+private:
+	GLuint m_bufferID = 0;
+	GLuint m_bindingPoint = 0;
+
+	BlockT m_shadow = {};
+	bool   m_valid = false; // m_shadow matches the buffer content
+};
@@ -0,0 +1,93 @@
+#include "UniformTable.h"
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+void UniformTable::Build( const GLuint programID )
+{
+	Clear();
+	m_programID = programID;
+
+	if ( programID == 0 ) return;
+
+	GLint activeUniforms = 0;
+	glGetProgramInterfaceiv( programID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &activeUniforms );
+
+	GLint maxNameLength = 0;
+	glGetProgramInterfaceiv( programID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength );
+
+	std::vector<char> nameBuffer( static_cast<std::size_t>( maxNameLength ) + 1 );
+
+	m_uniforms.reserve( activeUniforms );
+
+	static const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_BLOCK_INDEX };
+	for ( GLint index = 0; index < activeUniforms; ++index )
+	{
+		GLint values[ 3 ] = {};
+		glGetProgramResourceiv( programID, GL_UNIFORM, index, 3, properties, 3, nullptr, values );
+
+		// uniform block members have no location, they are set through buffers
+		if ( values[ 2 ] != -1 || values[ 0 ] == -1 ) continue;
+
+		GLsizei nameLength = 0;
+		glGetProgramResourceName( programID, GL_UNIFORM, index, static_cast<GLsizei>( nameBuffer.size() ), &nameLength, nameBuffer.data() );
+
+		std::string_view name( nameBuffer.data(), nameLength );
+		// arrays are reported as "name[0]", the base name refers to the first element as well
+		if ( name.size() > 3 && name.substr( name.size() - 3 ) == "[0]" )
+			name.remove_suffix( 3 );
+
+		m_uniforms.emplace( std::string( name ), Entry{ values[ 0 ], static_cast<GLenum>( values[ 1 ] ) } );
+	}
+}
+
+void UniformTable::Clear() noexcept
+{
+	m_programID = 0;
+	m_uniforms.clear();
+}
+
+GLint UniformTable::GetLocation( std::string_view name ) const noexcept
+{
+	auto it = m_uniforms.find( std::string( name ) );
+	return it != m_uniforms.end() ? it->second.location : -1;
+}
+
+static bool IsIntegerSetType( const GLenum type ) noexcept
+{
+	// glUniform1i is used for booleans and every sampler/image type as well
+	switch ( type )
+	{
+	case GL_INT:
+	case GL_BOOL:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_3D:
+	case GL_UNSIGNED_INT_SAMPLER_2D:
+	case GL_INT_SAMPLER_2D:
+		return true;
+	default:
+		return false;
+	}
+}
+
+GLint UniformTable::Find( std::string_view name, GLenum expectedType ) const noexcept
+{
+	auto it = m_uniforms.find( std::string( name ) );
+	if ( it == m_uniforms.end() ) return -1;
+
+	const Entry& entry = it->second;
+	const bool typeMatches = entry.type == expectedType
+						  || ( expectedType == GL_INT && IsIntegerSetType( entry.type ) );
+	if ( !typeMatches )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+						SDL_LOG_PRIORITY_WARN,
+						"[UniformTable] Uniform %s in program %u has GL type 0x%04X, requested as 0x%04X",
+						std::string( name ).c_str(), m_programID, entry.type, expectedType );
+	}
+
+	return entry.location;
+}
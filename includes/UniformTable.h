@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// The GL type a C++ type maps to in GLSL. Used to validate handles when they are resolved.
+template <typename T> struct UniformGLType;
+template <> struct UniformGLType<float>     { static constexpr GLenum value = GL_FLOAT; };
+template <> struct UniformGLType<GLint>     { static constexpr GLenum value = GL_INT; };
+template <> struct UniformGLType<GLuint>    { static constexpr GLenum value = GL_UNSIGNED_INT; };
+template <> struct UniformGLType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformGLType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformGLType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformGLType<glm::mat3> { static constexpr GLenum value = GL_FLOAT_MAT3; };
+template <> struct UniformGLType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
+// Typed handle of a uniform location in a linked program.
+// An inactive (optimized out or missing) uniform has location -1, setting it is a no-op just like in GL.
+template <typename T>
+struct Uniform
+{
+	GLint location = -1;
+
+	// Sets the value in the currently used program.
+	void Set( const T& value ) const noexcept;
+	// Sets the value in the given program without binding it (for values that rarely change, e.g. sampler units).
+	void Set( const GLuint programID, const T& value ) const noexcept;
+
+	explicit operator bool() const noexcept { return location != -1; }
+};
+
+template <> inline void Uniform<float>::Set( const float& value ) const noexcept         { glUniform1f( location, value ); }
+template <> inline void Uniform<GLint>::Set( const GLint& value ) const noexcept         { glUniform1i( location, value ); }
+template <> inline void Uniform<GLuint>::Set( const GLuint& value ) const noexcept       { glUniform1ui( location, value ); }
+template <> inline void Uniform<glm::vec2>::Set( const glm::vec2& value ) const noexcept { glUniform2fv( location, 1, &value.x ); }
+template <> inline void Uniform<glm::vec3>::Set( const glm::vec3& value ) const noexcept { glUniform3fv( location, 1, &value.x ); }
+template <> inline void Uniform<glm::vec4>::Set( const glm::vec4& value ) const noexcept { glUniform4fv( location, 1, &value.x ); }
+template <> inline void Uniform<glm::mat3>::Set( const glm::mat3& value ) const noexcept { glUniformMatrix3fv( location, 1, GL_FALSE, &value[ 0 ].x ); }
+template <> inline void Uniform<glm::mat4>::Set( const glm::mat4& value ) const noexcept { glUniformMatrix4fv( location, 1, GL_FALSE, &value[ 0 ].x ); }
+
+template <> inline void Uniform<float>::Set( const GLuint programID, const float& value ) const noexcept         { glProgramUniform1f( programID, location, value ); }
+template <> inline void Uniform<GLint>::Set( const GLuint programID, const GLint& value ) const noexcept         { glProgramUniform1i( programID, location, value ); }
+template <> inline void Uniform<GLuint>::Set( const GLuint programID, const GLuint& value ) const noexcept       { glProgramUniform1ui( programID, location, value ); }
+template <> inline void Uniform<glm::vec2>::Set( const GLuint programID, const glm::vec2& value ) const noexcept { glProgramUniform2fv( programID, location, 1, &value.x ); }
+template <> inline void Uniform<glm::vec3>::Set( const GLuint programID, const glm::vec3& value ) const noexcept { glProgramUniform3fv( programID, location, 1, &value.x ); }
+template <> inline void Uniform<glm::vec4>::Set( const GLuint programID, const glm::vec4& value ) const noexcept { glProgramUniform4fv( programID, location, 1, &value.x ); }
+template <> inline void Uniform<glm::mat3>::Set( const GLuint programID, const glm::mat3& value ) const noexcept { glProgramUniformMatrix3fv( programID, location, 1, GL_FALSE, &value[ 0 ].x ); }
+template <> inline void Uniform<glm::mat4>::Set( const GLuint programID, const glm::mat4& value ) const noexcept { glProgramUniformMatrix4fv( programID, location, 1, GL_FALSE, &value[ 0 ].x ); }
+
+// Reflection table of the active default-block uniforms of one program.
+// Build it once after the program is linked (and again whenever it is relinked),
+// then resolve typed handles from it instead of calling glGetUniformLocation per frame.
+class UniformTable
+{
+public:
+	void Build( const GLuint programID );
+	void Clear() noexcept;
+
+	inline GLuint GetProgram() const noexcept { return m_programID; }
+	inline std::size_t GetCount() const noexcept { return m_uniforms.size(); }
+
+	// Location of the uniform, -1 if it is not active in the program.
+	GLint GetLocation( std::string_view name ) const noexcept;
+
+	// Resolves a typed handle. A type that does not match the GLSL declaration is reported, the handle stays usable.
+	template <typename T>
+	Uniform<T> Get( std::string_view name ) const noexcept
+	{
+		return Uniform<T>{ Find( name, UniformGLType<T>::value ) };
+	}
+
+private:
+	GLint Find( std::string_view name, GLenum expectedType ) const noexcept;
+
+	struct Entry
+	{
+		GLint  location;
+		GLenum type;
+	};
+
+	GLuint m_programID = 0;
+	std::unordered_map<std::string, Entry> m_uniforms;
+};
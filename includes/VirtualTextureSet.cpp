@@ -0,0 +1,733 @@
+#include "VirtualTextureSet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <SDL2/SDL.h>
+
+#include "AssetPack.h"
+#include "BlockCompression.h"
+#include "CompressedTextureCache.h"
+#include "FileUtils.h"
+#include "GLUtils.hpp"
+#include "ImageOps.h"
+
+// Bump when the tile layout or the baking changes, old tile files then simply miss.
+static constexpr std::uint32_t TILE_FILE_VERSION = 1;
+static constexpr char TILE_FILE_MAGIC[ 4 ] = { 'Z', 'H', 'V', 'T' };
+// the tiles start on a page boundary, after the header
+static constexpr std::size_t TILE_DATA_OFFSET = 4096;
+
+// at most this many tiles are copied out of the tile files at once
+static constexpr std::size_t MAX_LOADS_IN_FLIGHT = 64;
+
+struct TileFileHeader
+{
+	char          magic[ 4 ];
+	std::uint32_t version;
+	std::uint32_t format;     // GL format of every tile
+	std::int32_t  tilesX;     // tiles per side at level 0
+	std::int32_t  tilesY;
+	std::int32_t  levelCount;
+	std::int32_t  tileSize;   // without the border
+	std::int32_t  tileBorder;
+	std::uint64_t tileBytes;
+	std::uint64_t tileTotal;  // every level
+};
+
+static_assert( sizeof( TileFileHeader ) == 48, "the tile file header is written as is" );
+
+// the tiles of a dimension at level 0: the nearest power of two, as the texture arrays round
+static int GetTileCountFor( const int texels )
+{
+	const double tiles = std::max( 1.0, static_cast<double>( texels ) / VirtualTextureSet::TILE_SIZE );
+	return std::min( 1 << static_cast<int>( std::lround( std::log2( tiles ) ) ), VirtualTextureSet::MAX_TILES );
+}
+
+// levels until the shorter side is a single tile
+static int GetTileLevelCount( const glm::ivec2 tileCount )
+{
+	int levelCount = 1;
+	for ( int shorter = std::min( tileCount.x, tileCount.y ); shorter > 1; shorter >>= 1 )
+		++levelCount;
+	return levelCount;
+}
+
+static glm::ivec2 GetLevelTileCount( const glm::ivec2 tileCount, const int level )
+{
+	return glm::max( glm::ivec2( tileCount.x >> level, tileCount.y >> level ), glm::ivec2( 1 ) );
+}
+
+VirtualTextureSet::VirtualTextureSet( std::filesystem::path tileDirectory, const GLuint atlasUnit, const int atlasTiles )
+	: m_directory( std::move( tileDirectory ) ), m_atlasUnit( atlasUnit ), m_atlasTiles( std::clamp( atlasTiles, 2, MAX_TILES ) )
+{
+}
+
+VirtualTextureSet::~VirtualTextureSet()
+{
+	// the workers may still read the tile files or this object
+	for ( Texture& texture : m_textures )
+		if ( texture.baking.valid() ) texture.baking.wait();
+	for ( auto& load : m_loads )
+		load.second.wait();
+}
+
+VirtualTextureSet::Handle VirtualTextureSet::Add( const std::filesystem::path& fileName )
+{
+	m_textures.emplace_back();
+	m_textures.back().fileName = fileName.lexically_normal();
+
+	if ( GetPageTableUnit( m_textures.size() - 1 ) >= static_cast<GLint>( GLStateCache::MAX_TEXTURE_UNITS ) )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[VirtualTexture] No texture unit left for %s, it is never ready", fileName.string().c_str() );
+
+	return m_textures.size() - 1;
+}
+
+std::optional<VirtualTextureSet::Handle> VirtualTextureSet::Find( const std::filesystem::path& fileName ) const
+{
+	const std::filesystem::path normal = fileName.lexically_normal();
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+		if ( m_textures[ handle ].fileName == normal ) return handle;
+	return std::nullopt;
+}
+
+void VirtualTextureSet::Init( WorkerPool& workers, const bool compress )
+{
+	m_workers = &workers;
+	m_compress = compress;
+
+	std::error_code error;
+	std::filesystem::create_directories( m_directory, error );
+	m_writable = !error;
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[VirtualTexture] Cannot create %s: %s, virtual textures are disabled",
+						m_directory.string().c_str(), error.message().c_str() );
+
+	// the atlas is a single level, the tiles of every level go into the same slots
+	GLint maxTextureSize = 0;
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxTextureSize );
+	m_atlasTiles = std::min( m_atlasTiles, std::max( 2, maxTextureSize / SLOT_SIZE ) );
+	m_atlasFormat = m_compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+
+	const GLsizei atlasSize = m_atlasTiles * SLOT_SIZE;
+	glGenTextures( 1, &m_atlasID );
+	glBindTexture( GL_TEXTURE_2D, m_atlasID );
+	glTexStorage2D( GL_TEXTURE_2D, 1, m_atlasFormat, atlasSize, atlasSize );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	m_slots.assign( static_cast<std::size_t>( m_atlasTiles ) * m_atlasTiles, Slot{} );
+	m_stats = Stats{};
+	m_stats.slotCount = m_slots.size();
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[VirtualTexture] Atlas: %dx%d tiles of %d texels, %.1f MB %s",
+					m_atlasTiles, m_atlasTiles, TILE_SIZE, GetLevelByteSize( m_atlasFormat, glm::ivec2( atlasSize ) ) / ( 1024.0 * 1024.0 ), m_compress ? "BC1" : "RGBA8" );
+
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+		StartBaking( handle );
+}
+
+void VirtualTextureSet::Clean()
+{
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+	{
+		if ( m_textures[ handle ].baking.valid() ) m_textures[ handle ].baking.wait();
+		ReleaseTexture( handle );
+	}
+	m_textures.clear();
+	m_requests.clear();
+
+	if ( m_feedbackFence != nullptr ) glDeleteSync( m_feedbackFence );
+	m_feedbackFence = nullptr;
+
+	glDeleteFramebuffers( 1, &m_feedbackFramebufferID );
+	glDeleteTextures( 1, &m_feedbackColorID );
+	glDeleteRenderbuffers( 1, &m_feedbackDepthID );
+	glDeleteBuffers( 1, &m_feedbackBufferID );
+	m_feedbackFramebufferID = m_feedbackColorID = m_feedbackDepthID = m_feedbackBufferID = 0;
+	m_feedbackSize = glm::ivec2( 0 );
+
+	glDeleteTextures( 1, &m_atlasID );
+	m_atlasID = 0;
+	m_slots.clear();
+}
+
+std::uint64_t VirtualTextureSet::MakeTileKey( const Handle handle, const int level, const int x, const int y ) noexcept
+{
+	return ( static_cast<std::uint64_t>( handle ) << 40 ) | ( static_cast<std::uint64_t>( level ) << 32 ) | ( static_cast<std::uint64_t>( y ) << 16 ) | static_cast<std::uint64_t>( x );
+}
+
+std::filesystem::path VirtualTextureSet::GetTilePath( const std::uint64_t key ) const
+{
+	char fileName[ 32 ];
+	std::snprintf( fileName, sizeof( fileName ), "%016llx.vtex", static_cast<unsigned long long>( key ) );
+	return m_directory / fileName;
+}
+
+void VirtualTextureSet::StartBaking( const Handle handle )
+{
+	if ( !m_writable || GetPageTableUnit( handle ) >= static_cast<GLint>( GLStateCache::MAX_TEXTURE_UNITS ) ) return;
+
+	const std::filesystem::path fileName = m_textures[ handle ].fileName;
+	m_textures[ handle ].baking = m_workers->Submit( [ this, fileName ]() { return PrepareTileFile( fileName ); } );
+}
+
+std::filesystem::path VirtualTextureSet::PrepareTileFile( const std::filesystem::path& fileName ) const
+{
+	const AssetData source = ReadAsset( fileName );
+	if ( source.GetSize() == 0 )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[VirtualTexture] Cannot read %s", fileName.string().c_str() );
+		return {};
+	}
+
+	const std::uint8_t compress = static_cast<std::uint8_t>( m_compress );
+	const std::uint64_t sourceSize = source.GetSize();
+
+	std::uint64_t key = FNV_OFFSET_BASIS;
+	key = HashBytes( key, &TILE_FILE_VERSION, sizeof( TILE_FILE_VERSION ) );
+	key = HashBytes( key, &compress, sizeof( compress ) );
+	key = HashBytes( key, &sourceSize, sizeof( sourceSize ) );
+	key = HashBytes( key, source.GetData(), source.GetSize() );
+
+	const std::filesystem::path path = GetTilePath( key );
+	std::error_code error;
+	if ( std::filesystem::exists( path, error ) ) return path;
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+
+	// bottom row first, like every other texture of the scene
+	SDL_Surface* image = LoadImageRGBA( fileName, true );
+	if ( image == nullptr ) return {};
+
+	const glm::ivec2 tileCount( GetTileCountFor( image->w ), GetTileCountFor( image->h ) );
+	glm::ivec2 size = tileCount * TILE_SIZE;
+	image = ResampleImageRGBA( image, size.x, size.y );
+	if ( image == nullptr ) return {};
+
+	// tightly packed from here on
+	std::vector<std::uint8_t> pixels( static_cast<std::size_t>( size.x ) * size.y * 4 );
+	for ( int y = 0; y < size.y; ++y )
+		std::memcpy( pixels.data() + static_cast<std::size_t>( y ) * size.x * 4, static_cast<const std::uint8_t*>( image->pixels ) + y * image->pitch, size.x * 4 );
+	SDL_FreeSurface( image );
+
+	TileFileHeader header{};
+	std::memcpy( header.magic, TILE_FILE_MAGIC, sizeof( TILE_FILE_MAGIC ) );
+	header.version    = TILE_FILE_VERSION;
+	header.format     = m_compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+	header.tilesX     = tileCount.x;
+	header.tilesY     = tileCount.y;
+	header.levelCount = GetTileLevelCount( tileCount );
+	header.tileSize   = TILE_SIZE;
+	header.tileBorder = TILE_BORDER;
+	header.tileBytes  = GetLevelByteSize( header.format, glm::ivec2( SLOT_SIZE ) );
+	for ( int level = 0; level < header.levelCount; ++level )
+	{
+		const glm::ivec2 levelTiles = GetLevelTileCount( tileCount, level );
+		header.tileTotal += static_cast<std::uint64_t>( levelTiles.x ) * levelTiles.y;
+	}
+
+	error = WriteFileAtomically( path, [ & ]( std::ostream& stream )
+	{
+		std::vector<char> headerBytes( TILE_DATA_OFFSET, 0 );
+		std::memcpy( headerBytes.data(), &header, sizeof( header ) );
+		stream.write( headerBytes.data(), headerBytes.size() );
+
+		std::vector<std::uint8_t> tile( static_cast<std::size_t>( SLOT_SIZE ) * SLOT_SIZE * 4 );
+		for ( int level = 0; level < header.levelCount; ++level )
+		{
+			const glm::ivec2 levelTiles = GetLevelTileCount( tileCount, level );
+			for ( int ty = 0; ty < levelTiles.y; ++ty )
+				for ( int tx = 0; tx < levelTiles.x; ++tx )
+				{
+					// the border repeats around the seam horizontally and clamps at the poles
+					for ( int j = 0; j < SLOT_SIZE; ++j )
+					{
+						const int sy = std::clamp( ty * TILE_SIZE - TILE_BORDER + j, 0, size.y - 1 );
+						const std::uint8_t* row = pixels.data() + static_cast<std::size_t>( sy ) * size.x * 4;
+						for ( int i = 0; i < SLOT_SIZE; ++i )
+						{
+							const int sx = ( tx * TILE_SIZE - TILE_BORDER + i + size.x ) % size.x;
+							std::memcpy( tile.data() + ( static_cast<std::size_t>( j ) * SLOT_SIZE + i ) * 4, row + static_cast<std::size_t>( sx ) * 4, 4 );
+						}
+					}
+
+					if ( m_compress )
+					{
+						const std::vector<std::uint8_t> blocks = CompressImage( tile.data(), SLOT_SIZE, SLOT_SIZE, SLOT_SIZE * 4, BlockFormat::BC1 );
+						stream.write( reinterpret_cast<const char*>( blocks.data() ), blocks.size() );
+					}
+					else
+						stream.write( reinterpret_cast<const char*>( tile.data() ), tile.size() );
+				}
+
+			if ( level + 1 < header.levelCount )
+			{
+				const glm::ivec2 halfSize = size / 2;
+				std::vector<std::uint8_t> half( static_cast<std::size_t>( halfSize.x ) * halfSize.y * 4 );
+				DownsampleRGBA( pixels.data(), size.x, size.y, static_cast<std::size_t>( size.x ) * 4, half.data() );
+				pixels = std::move( half );
+				size = halfSize;
+			}
+		}
+
+		return true;
+	} );
+
+	if ( error )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[VirtualTexture] Cannot write %s: %s", path.string().c_str(), error.message().c_str() );
+		return {};
+	}
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[VirtualTexture] Baked %s: %dx%d texels, %d levels, %llu tiles in %.1f ms",
+					fileName.string().c_str(), tileCount.x * TILE_SIZE, tileCount.y * TILE_SIZE, header.levelCount, static_cast<unsigned long long>( header.tileTotal ),
+					1000.0 * ( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency() );
+	return path;
+}
+
+bool VirtualTextureSet::OpenTexture( const Handle handle, const std::filesystem::path& tilePath )
+{
+	Texture& texture = m_textures[ handle ];
+
+	TileFileHeader header{};
+	bool valid = texture.tiles.Open( tilePath ) && texture.tiles.GetSize() >= TILE_DATA_OFFSET;
+	if ( valid )
+	{
+		std::memcpy( &header, texture.tiles.GetData(), sizeof( header ) );
+		const glm::ivec2 tileCount( header.tilesX, header.tilesY );
+		valid = std::memcmp( header.magic, TILE_FILE_MAGIC, sizeof( TILE_FILE_MAGIC ) ) == 0 && header.version == TILE_FILE_VERSION && header.format == m_atlasFormat
+			 && header.tileSize == TILE_SIZE && header.tileBorder == TILE_BORDER && header.tileBytes == GetLevelByteSize( m_atlasFormat, glm::ivec2( SLOT_SIZE ) )
+			 && header.tilesX >= 1 && header.tilesX <= MAX_TILES && header.tilesY >= 1 && header.tilesY <= MAX_TILES
+			 && header.levelCount == GetTileLevelCount( tileCount )
+			 && header.tileTotal <= ( texture.tiles.GetSize() - TILE_DATA_OFFSET ) / header.tileBytes;
+	}
+
+	if ( !valid )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[VirtualTexture] %s is not a valid version %u tile file", tilePath.string().c_str(), TILE_FILE_VERSION );
+		texture.tiles.Close();
+		return false;
+	}
+
+	texture.format     = header.format;
+	texture.tileCount  = glm::ivec2( header.tilesX, header.tilesY );
+	texture.levelCount = header.levelCount;
+	texture.tileBytes  = static_cast<std::size_t>( header.tileBytes );
+
+	texture.levelFirstTile.clear();
+	std::size_t tileTotal = 0;
+	for ( int level = 0; level < texture.levelCount; ++level )
+	{
+		texture.levelFirstTile.push_back( tileTotal );
+		const glm::ivec2 levelTiles = GetLevelTileCount( texture.tileCount, level );
+		tileTotal += static_cast<std::size_t>( levelTiles.x ) * levelTiles.y;
+	}
+	texture.tileSlots.assign( tileTotal, -1 );
+
+	// one texel per tile, one level per tile level; integer textures have to be sampled with nearest filtering
+	glGenTextures( 1, &texture.pageTableID );
+	glBindTexture( GL_TEXTURE_2D, texture.pageTableID );
+	glTexStorage2D( GL_TEXTURE_2D, texture.levelCount, GL_RGBA8UI, texture.tileCount.x, texture.tileCount.y );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	// the coarsest level stays resident, every lookup falls back to it
+	const int topLevel = texture.levelCount - 1;
+	for ( std::size_t tile = texture.levelFirstTile[ topLevel ]; tile < tileTotal; ++tile )
+	{
+		const int slot = AllocateSlot();
+		if ( slot < 0 )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "[VirtualTexture] The atlas has no room for the coarsest level of %s", texture.fileName.string().c_str() );
+			ReleaseTexture( handle );
+			return false;
+		}
+
+		UploadTile( slot, handle, static_cast<std::uint32_t>( tile ), texture.tiles.GetData() + TILE_DATA_OFFSET + tile * texture.tileBytes );
+		m_slots[ slot ].pinned = true;
+	}
+
+	texture.ready = true;
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "[VirtualTexture] %s: %dx%d tiles, %d levels", texture.fileName.string().c_str(),
+					texture.tileCount.x, texture.tileCount.y, texture.levelCount );
+	return true;
+}
+
+void VirtualTextureSet::ReleaseTexture( const Handle handle )
+{
+	// the loads read the mapped tile file
+	for ( auto it = m_loads.begin(); it != m_loads.end(); )
+	{
+		if ( ( it->first >> 40 ) != handle )
+		{
+			++it;
+			continue;
+		}
+		it->second.wait();
+		it = m_loads.erase( it );
+	}
+
+	// the requests refer to the old tile grid, a rebaked image may have fewer levels or tiles
+	for ( auto it = m_requests.begin(); it != m_requests.end(); )
+		it = ( it->first >> 40 ) == handle ? m_requests.erase( it ) : std::next( it );
+
+	for ( Slot& slot : m_slots )
+		if ( slot.texture == static_cast<std::int32_t>( handle ) ) slot = Slot{};
+
+	Texture& texture = m_textures[ handle ];
+	glDeleteTextures( 1, &texture.pageTableID );
+	texture.pageTableID = 0;
+	texture.tiles.Close();
+	texture.levelFirstTile.clear();
+	texture.tileSlots.clear();
+	texture.levelCount = 0;
+	texture.tileCount = glm::ivec2( 0 );
+	texture.pageTableDirty = false;
+	texture.ready = false;
+}
+
+void VirtualTextureSet::Reload( const Handle handle )
+{
+	Texture& texture = m_textures[ handle ];
+	if ( texture.baking.valid() ) texture.baking.wait();
+	texture.baking = {};
+
+	ReleaseTexture( handle );
+	StartBaking( handle );
+}
+
+void VirtualTextureSet::Update( const int uploadBudget )
+{
+	auto isReady = []( const auto& future ) { return future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready; };
+
+	m_stats.uploads = 0;
+
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+	{
+		Texture& texture = m_textures[ handle ];
+		if ( !texture.baking.valid() || !isReady( texture.baking ) ) continue;
+
+		const std::filesystem::path tilePath = texture.baking.get();
+		if ( !tilePath.empty() ) OpenTexture( handle, tilePath );
+	}
+
+	// the readback started a frame or more ago, it does not stall once the fence is signalled
+	if ( m_feedbackFence != nullptr )
+	{
+		const GLenum status = glClientWaitSync( m_feedbackFence, 0, 0 );
+		if ( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED ) ReadFeedback();
+	}
+
+	RequestTiles();
+
+	// the loaded tiles, within the budget; the rest waits for the next frame
+	for ( auto it = m_loads.begin(); it != m_loads.end() && static_cast<int>( m_stats.uploads ) < uploadBudget; )
+	{
+		if ( !isReady( it->second ) )
+		{
+			++it;
+			continue;
+		}
+
+		const std::uint64_t key = it->first;
+		const std::vector<std::uint8_t> bytes = it->second.get();
+		it = m_loads.erase( it );
+
+		const Handle handle = static_cast<Handle>( key >> 40 );
+		const int level = static_cast<int>( ( key >> 32 ) & 0xff );
+		const int y = static_cast<int>( ( key >> 16 ) & 0xffff ), x = static_cast<int>( key & 0xffff );
+
+		Texture& texture = m_textures[ handle ];
+		if ( !texture.ready || bytes.size() != texture.tileBytes ) continue;
+
+		const std::size_t tile = texture.levelFirstTile[ level ] + static_cast<std::size_t>( y ) * GetLevelTileCount( texture.tileCount, level ).x + x;
+		if ( texture.tileSlots[ tile ] >= 0 ) continue;
+
+		// every slot holds a tile the last feedback asked for: this one is asked for again next time
+		const int slot = AllocateSlot();
+		if ( slot < 0 ) continue;
+
+		UploadTile( slot, handle, static_cast<std::uint32_t>( tile ), bytes.data() );
+		++m_stats.uploads;
+	}
+
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+		if ( m_textures[ handle ].ready && m_textures[ handle ].pageTableDirty ) UpdatePageTable( handle );
+
+	m_stats.residentTiles = std::count_if( m_slots.begin(), m_slots.end(), []( const Slot& slot ) { return slot.texture >= 0; } );
+}
+
+void VirtualTextureSet::ReadFeedback()
+{
+	glDeleteSync( m_feedbackFence );
+	m_feedbackFence = nullptr;
+
+	// a new feedback: the tiles it does not ask for may be evicted from now on
+	++m_frame;
+	m_requests.clear();
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, m_feedbackBufferID );
+	const std::size_t pixelCount = static_cast<std::size_t>( m_feedbackSize.x ) * m_feedbackSize.y;
+	const std::uint8_t* pixels = static_cast<const std::uint8_t*>( glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, pixelCount * 4, GL_MAP_READ_BIT ) );
+	if ( pixels != nullptr )
+	{
+		std::uint32_t previous = 0;
+		for ( std::size_t i = 0; i < pixelCount; ++i )
+		{
+			std::uint32_t value;
+			std::memcpy( &value, pixels + i * 4, 4 );
+			// neighbouring pixels mostly ask for the same tile, the counts are per run
+			if ( value == previous ) continue;
+			previous = value;
+
+			const std::uint8_t* pixel = pixels + i * 4;
+			if ( pixel[ 3 ] == 0 ) continue;
+
+			const Handle handle = pixel[ 3 ] - 1u;
+			if ( handle >= m_textures.size() || !m_textures[ handle ].ready ) continue;
+
+			const Texture& texture = m_textures[ handle ];
+			int x = pixel[ 0 ], y = pixel[ 1 ];
+
+			// the ancestors as well: trilinear filtering blends with the next level, and they are the fallback
+			for ( int level = pixel[ 2 ]; level < texture.levelCount; ++level, x >>= 1, y >>= 1 )
+			{
+				const glm::ivec2 levelTiles = GetLevelTileCount( texture.tileCount, level );
+				if ( x >= levelTiles.x || y >= levelTiles.y ) break;
+				++m_requests[ MakeTileKey( handle, level, x, y ) ];
+			}
+		}
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+}
+
+void VirtualTextureSet::RequestTiles()
+{
+	struct Missing
+	{
+		std::uint64_t key;
+		int           level;
+		std::uint32_t count;
+	};
+
+	std::vector<Missing> missing;
+	for ( const auto& [ key, count ] : m_requests )
+	{
+		const Handle handle = static_cast<Handle>( key >> 40 );
+		const Texture& texture = m_textures[ handle ];
+		if ( !texture.ready ) continue;
+
+		// as ReadFeedback checks them: the texture may have been rebaked since
+		const int level = static_cast<int>( ( key >> 32 ) & 0xff );
+		const int y = static_cast<int>( ( key >> 16 ) & 0xffff ), x = static_cast<int>( key & 0xffff );
+		if ( level >= texture.levelCount ) continue;
+		const glm::ivec2 levelTiles = GetLevelTileCount( texture.tileCount, level );
+		if ( x >= levelTiles.x || y >= levelTiles.y ) continue;
+		const std::size_t tile = texture.levelFirstTile[ level ] + static_cast<std::size_t>( y ) * levelTiles.x + x;
+
+		const std::int32_t slot = texture.tileSlots[ tile ];
+		if ( slot >= 0 )
+			m_slots[ slot ].lastUsed = m_frame;
+		else if ( m_loads.count( key ) == 0 )
+			missing.push_back( { key, level, count } );
+	}
+
+	m_stats.requestedTiles = m_requests.size();
+	m_stats.pendingTiles = missing.size() + m_loads.size();
+
+	// coarse tiles first: they cover more of the screen and the finer ones fall back to them,
+	// then the ones covering more pixels
+	const std::size_t loadCount = std::min( missing.size(), MAX_LOADS_IN_FLIGHT - std::min( MAX_LOADS_IN_FLIGHT, m_loads.size() ) );
+	std::partial_sort( missing.begin(), missing.begin() + loadCount, missing.end(),
+					   []( const Missing& a, const Missing& b ) { return a.level != b.level ? a.level > b.level : a.count > b.count; } );
+
+	for ( std::size_t i = 0; i < loadCount; ++i )
+	{
+		const std::uint64_t key = missing[ i ].key;
+		const Texture& texture = m_textures[ static_cast<Handle>( key >> 40 ) ];
+		const int y = static_cast<int>( ( key >> 16 ) & 0xffff ), x = static_cast<int>( key & 0xffff );
+		const std::size_t tile = texture.levelFirstTile[ missing[ i ].level ] + static_cast<std::size_t>( y ) * GetLevelTileCount( texture.tileCount, missing[ i ].level ).x + x;
+
+		// the page faults of the mapped file happen on the worker, not on the GL thread
+		const std::uint8_t* data = texture.tiles.GetData() + TILE_DATA_OFFSET + tile * texture.tileBytes;
+		const std::size_t size = texture.tileBytes;
+		m_loads.emplace( key, m_workers->Submit( [ data, size ]() { return std::vector<std::uint8_t>( data, data + size ); } ) );
+	}
+}
+
+int VirtualTextureSet::AllocateSlot()
+{
+	// a free slot, or the least recently used tile that the last feedback did not ask for
+	int victim = -1;
+	for ( int i = 0; i < static_cast<int>( m_slots.size() ); ++i )
+	{
+		const Slot& slot = m_slots[ i ];
+		if ( slot.texture < 0 ) return i;
+		if ( !slot.pinned && slot.lastUsed < m_frame && ( victim < 0 || slot.lastUsed < m_slots[ victim ].lastUsed ) ) victim = i;
+	}
+
+	if ( victim >= 0 )
+	{
+		Texture& texture = m_textures[ m_slots[ victim ].texture ];
+		texture.tileSlots[ m_slots[ victim ].tile ] = -1;
+		texture.pageTableDirty = true;
+		m_slots[ victim ] = Slot{};
+		++m_stats.evictions;
+	}
+	return victim;
+}
+
+void VirtualTextureSet::UploadTile( const int slot, const Handle handle, const std::uint32_t tile, const std::uint8_t* data )
+{
+	Texture& texture = m_textures[ handle ];
+	const GLint x = ( slot % m_atlasTiles ) * SLOT_SIZE, y = ( slot / m_atlasTiles ) * SLOT_SIZE;
+
+	glBindTexture( GL_TEXTURE_2D, m_atlasID );
+	if ( m_atlasFormat == GL_RGBA8 )
+		glTexSubImage2D( GL_TEXTURE_2D, 0, x, y, SLOT_SIZE, SLOT_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, data );
+	else
+		glCompressedTexSubImage2D( GL_TEXTURE_2D, 0, x, y, SLOT_SIZE, SLOT_SIZE, m_atlasFormat, static_cast<GLsizei>( texture.tileBytes ), data );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	m_slots[ slot ] = Slot{ static_cast<std::int32_t>( handle ), tile, m_frame, false };
+	texture.tileSlots[ tile ] = slot;
+	texture.pageTableDirty = true;
+}
+
+void VirtualTextureSet::UpdatePageTable( const Handle handle )
+{
+	Texture& texture = m_textures[ handle ];
+
+	// coarsest level first: a tile that is not resident inherits its parent's entry
+	std::vector<std::uint8_t> parent, entries;
+	glm::ivec2 parentTiles( 0 );
+
+	glBindTexture( GL_TEXTURE_2D, texture.pageTableID );
+	for ( int level = texture.levelCount - 1; level >= 0; --level )
+	{
+		const glm::ivec2 levelTiles = GetLevelTileCount( texture.tileCount, level );
+		entries.resize( static_cast<std::size_t>( levelTiles.x ) * levelTiles.y * 4 );
+
+		for ( int y = 0; y < levelTiles.y; ++y )
+			for ( int x = 0; x < levelTiles.x; ++x )
+			{
+				std::uint8_t* entry = entries.data() + ( static_cast<std::size_t>( y ) * levelTiles.x + x ) * 4;
+				const std::int32_t slot = texture.tileSlots[ texture.levelFirstTile[ level ] + static_cast<std::size_t>( y ) * levelTiles.x + x ];
+
+				if ( slot >= 0 )
+				{
+					entry[ 0 ] = static_cast<std::uint8_t>( slot % m_atlasTiles );
+					entry[ 1 ] = static_cast<std::uint8_t>( slot / m_atlasTiles );
+					entry[ 2 ] = static_cast<std::uint8_t>( level );
+					entry[ 3 ] = 255;
+				}
+				else if ( !parent.empty() )
+					std::memcpy( entry, parent.data() + ( static_cast<std::size_t>( std::min( y >> 1, parentTiles.y - 1 ) ) * parentTiles.x + std::min( x >> 1, parentTiles.x - 1 ) ) * 4, 4 );
+				else
+					std::memset( entry, 0, 4 );
+			}
+
+		glTexSubImage2D( GL_TEXTURE_2D, level, 0, 0, levelTiles.x, levelTiles.y, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries.data() );
+
+		std::swap( parent, entries );
+		parentTiles = levelTiles;
+	}
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	texture.pageTableDirty = false;
+}
+
+void VirtualTextureSet::Bind( GLStateCache& stateCache ) const
+{
+	if ( m_atlasID == 0 ) return;
+
+	stateCache.BindTexture( m_atlasUnit, GL_TEXTURE_2D, m_atlasID );
+	for ( Handle handle = 0; handle < m_textures.size(); ++handle )
+		if ( m_textures[ handle ].ready )
+			stateCache.BindTexture( static_cast<GLuint>( GetPageTableUnit( handle ) ), GL_TEXTURE_2D, m_textures[ handle ].pageTableID );
+}
+
+bool VirtualTextureSet::BeginFeedback( const glm::ivec2 viewportSize )
+{
+	if ( m_feedbackFence != nullptr || m_atlasID == 0 ) return false;
+
+	const glm::ivec2 size = glm::max( viewportSize / FEEDBACK_DOWNSCALE, glm::ivec2( 1 ) );
+	if ( size != m_feedbackSize )
+	{
+		// the color target has immutable storage, a new size needs a new texture
+		glDeleteTextures( 1, &m_feedbackColorID );
+		glGenTextures( 1, &m_feedbackColorID );
+		glBindTexture( GL_TEXTURE_2D, m_feedbackColorID );
+		glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8UI, size.x, size.y );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+
+		if ( m_feedbackDepthID == 0 ) glGenRenderbuffers( 1, &m_feedbackDepthID );
+		glBindRenderbuffer( GL_RENDERBUFFER, m_feedbackDepthID );
+		glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y );
+		glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+		if ( m_feedbackFramebufferID == 0 ) glGenFramebuffers( 1, &m_feedbackFramebufferID );
+		glBindFramebuffer( GL_FRAMEBUFFER, m_feedbackFramebufferID );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_feedbackColorID, 0 );
+		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_feedbackDepthID );
+		const GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+		if ( m_feedbackBufferID == 0 ) glGenBuffers( 1, &m_feedbackBufferID );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, m_feedbackBufferID );
+		glBufferData( GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>( size.x ) * size.y * 4, nullptr, GL_STREAM_READ );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+		if ( status != GL_FRAMEBUFFER_COMPLETE )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_ERROR, "[VirtualTexture] Feedback framebuffer incomplete: 0x%x", status );
+			m_feedbackSize = glm::ivec2( 0 );
+			return false;
+		}
+		m_feedbackSize = size;
+	}
+
+	glBindFramebuffer( GL_FRAMEBUFFER, m_feedbackFramebufferID );
+	glViewport( 0, 0, m_feedbackSize.x, m_feedbackSize.y );
+
+	const GLuint noTile[ 4 ] = { 0, 0, 0, 0 };
+	glClearBufferuiv( GL_COLOR, 0, noTile );
+	glClear( GL_DEPTH_BUFFER_BIT );
+	return true;
+}
+
+void VirtualTextureSet::EndFeedback( const glm::ivec2 viewportSize )
+{
+	// into the PBO: glReadPixels returns at once, the data is mapped in a later Update when the fence is signalled
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, m_feedbackBufferID );
+	glReadPixels( 0, 0, m_feedbackSize.x, m_feedbackSize.y, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	m_feedbackFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	glViewport( 0, 0, viewportSize.x, viewportSize.y );
+}
+
+std::size_t VirtualTextureSet::GetAtlasByteSize() const noexcept
+{
+	return m_atlasID != 0 ? GetLevelByteSize( m_atlasFormat, glm::ivec2( m_atlasTiles * SLOT_SIZE ) ) : 0;
+}
+
+float VirtualTextureSet::GetFeedbackLodBias() noexcept
+{
+	return -std::log2( static_cast<float>( FEEDBACK_DOWNSCALE ) );
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+// Virtual texturing for surface textures too large to keep in video memory as a whole.
+//
+// Every texture is split offline into TILE_SIZE tiles per mip level, each with a TILE_BORDER wide
+// border taken from its neighbours so bilinear filtering never reads across a tile edge. The tiles
+// are baked once into a file in the cache directory ( BC1 when S3TC is available ) and memory mapped.
+// Only the tiles the camera needs are resident, in the slots of one physical atlas texture shared by
+// every texture of the set, so the video memory used is fixed by the atlas size.
+//
+// Which tiles are needed is decided by a feedback pass: the scene is drawn at a fraction of the
+// viewport into an integer target that stores the tile every pixel would sample, read back one frame
+// later through a PBO. Missing tiles are copied out of the mapped file on the workers and uploaded on
+// the GL thread within a per-frame budget; when the atlas is full the least recently used tile goes.
+// A page table texture per virtual texture ( one texel per tile, one mip level per tile level ) tells
+// the shader where a tile is; a tile that is not resident points at its finest resident ancestor, so
+// sampling never fails, it is only blurrier until the tile arrives. The coarsest level is always resident.
+class VirtualTextureSet
+{
+public:
+	using Handle = std::size_t;
+
+	static constexpr int TILE_SIZE   = 128; // texels per side of a tile, without its border
+	static constexpr int TILE_BORDER = 4;   // texels per side copied from the neighbouring tiles
+	static constexpr int SLOT_SIZE   = TILE_SIZE + 2 * TILE_BORDER;
+	// tiles per side at level 0, the page table and the feedback store tile coordinates in 8 bits
+	static constexpr int MAX_TILES = 256;
+	// the feedback target is this many times smaller than the viewport in both dimensions
+	static constexpr int FEEDBACK_DOWNSCALE = 8;
+
+	struct Stats
+	{
+		std::size_t   residentTiles  = 0;
+		std::size_t   slotCount      = 0;
+		std::size_t   requestedTiles = 0; // seen in the last feedback, ancestors included
+		std::size_t   pendingTiles   = 0; // requested but not resident yet
+		std::uint32_t uploads        = 0; // during the last Update
+		std::uint32_t evictions      = 0; // since Init
+	};
+
+	// tileDirectory: where the baked tile files are kept. atlasUnit: the atlas is bound to this texture
+	// unit, the page table of texture i to atlasUnit + 1 + i. atlasTiles: slots per side of the atlas.
+	VirtualTextureSet( std::filesystem::path tileDirectory, const GLuint atlasUnit, const int atlasTiles = 32 );
+	~VirtualTextureSet();
+
+	VirtualTextureSet( const VirtualTextureSet& ) = delete;
+	VirtualTextureSet& operator=( const VirtualTextureSet& ) = delete;
+
+	// Registers a source image before Init(). The handle stays valid until Clean().
+	Handle Add( const std::filesystem::path& fileName );
+
+	// Creates the atlas and starts baking ( or just opening ) the tile files on the workers. A texture
+	// becomes ready in a later Update(), until then IsReady() is false and callers use something else.
+	// compress: BC1 tiles, see CompressedTextureCache::IsCompressing.
+	void Init( WorkerPool& workers, const bool compress );
+	void Clean();
+
+	// The handle the file was registered with.
+	std::optional<Handle> Find( const std::filesystem::path& fileName ) const;
+	// Bakes the texture again from its changed source. The old tiles are dropped, the texture is not
+	// ready until the new file is open.
+	void Reload( const Handle handle );
+
+	// Once per frame on the GL thread: opens finished tile files, processes the feedback that has
+	// arrived, starts loading the missing tiles and uploads at most uploadBudget of the loaded ones.
+	void Update( const int uploadBudget );
+
+	// Binds the atlas and the page tables of the ready textures, before the draws that sample them.
+	void Bind( GLStateCache& stateCache ) const;
+
+	inline bool IsReady( const Handle handle ) const { return m_textures[ handle ].ready; }
+	// tiles per side at level 0
+	inline glm::ivec2 GetTileCount( const Handle handle ) const { return m_textures[ handle ].tileCount; }
+	inline int GetLevelCount( const Handle handle ) const { return m_textures[ handle ].levelCount; }
+	inline GLint GetPageTableUnit( const Handle handle ) const { return static_cast<GLint>( m_atlasUnit + 1 + handle ); }
+	inline GLint GetAtlasUnit() const noexcept { return static_cast<GLint>( m_atlasUnit ); }
+
+	// The feedback pass: draw the scene between the two calls with a shader that writes
+	// ( tile x, tile y, level, handle + 1 ) as RGBA8UI, and a LOD bias of GetFeedbackLodBias().
+	// BeginFeedback returns false while the previous readback is still in flight, then skip the pass.
+	bool BeginFeedback( const glm::ivec2 viewportSize );
+	// Starts the readback and restores the default framebuffer and the viewport.
+	void EndFeedback( const glm::ivec2 viewportSize );
+	// the feedback target is smaller than the viewport, the mip level has to be chosen as if it was not
+	static float GetFeedbackLodBias() noexcept;
+
+	inline const Stats& GetStats() const noexcept { return m_stats; }
+	// video memory of the atlas, 0 before Init()
+	std::size_t GetAtlasByteSize() const noexcept;
+
+private:
+	struct Texture
+	{
+		std::filesystem::path fileName;
+		std::future<std::filesystem::path> baking; // the tile file, empty if the source cannot be loaded
+
+		MappedFile  tiles;
+		GLenum      format     = 0;
+		glm::ivec2  tileCount  = glm::ivec2( 0 );
+		int         levelCount = 0;
+		std::size_t tileBytes  = 0;
+		std::vector<std::size_t>  levelFirstTile; // index of the first tile of every level in the file
+		std::vector<std::int32_t> tileSlots;      // slot of every tile in file order, -1 if not resident
+
+		GLuint pageTableID = 0;
+		bool   pageTableDirty = false;
+		bool   ready = false;
+	};
+
+	struct Slot
+	{
+		std::int32_t  texture = -1; // -1: free
+		std::uint32_t tile    = 0;  // index in the texture's file
+		std::uint64_t lastUsed = 0; // frame of the last feedback that asked for it
+		bool          pinned  = false;
+	};
+
+	// a tile of a texture: handle, level and coordinates packed into one key
+	static std::uint64_t MakeTileKey( const Handle handle, const int level, const int x, const int y ) noexcept;
+
+	std::filesystem::path GetTilePath( const std::uint64_t key ) const;
+	std::filesystem::path PrepareTileFile( const std::filesystem::path& fileName ) const;
+	void StartBaking( const Handle handle );
+	bool OpenTexture( const Handle handle, const std::filesystem::path& tilePath );
+	void ReleaseTexture( const Handle handle );
+
+	void ReadFeedback();
+	void RequestTiles();
+	int  AllocateSlot();
+	void UploadTile( const int slot, const Handle handle, const std::uint32_t tile, const std::uint8_t* data );
+	void UpdatePageTable( const Handle handle );
+
+	std::filesystem::path m_directory;
+	GLuint      m_atlasUnit;
+	int         m_atlasTiles;
+	WorkerPool* m_workers = nullptr;
+	bool        m_compress = false;
+	bool        m_writable = false;
+
+	std::vector<Texture> m_textures;
+
+	GLuint            m_atlasID = 0;
+	GLenum            m_atlasFormat = 0;
+	std::vector<Slot> m_slots;
+	std::uint64_t     m_frame = 0;
+
+	// tile key -> its bytes, copied out of the mapped file on a worker
+	std::unordered_map<std::uint64_t, std::future<std::vector<std::uint8_t>>> m_loads;
+	// tile key -> how many feedback pixels asked for it, from the last readback
+	std::unordered_map<std::uint64_t, std::uint32_t> m_requests;
+
+	GLuint     m_feedbackFramebufferID = 0;
+	GLuint     m_feedbackColorID = 0;
+	GLuint     m_feedbackDepthID = 0;
+	GLuint     m_feedbackBufferID = 0; // GL_PIXEL_PACK_BUFFER the target is read into
+	glm::ivec2 m_feedbackSize = glm::ivec2( 0 );
+	GLsync     m_feedbackFence = nullptr;
+
+	Stats m_stats;
+};
@@ -0,0 +1,96 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkerPool::WorkerPool( unsigned threadCount )
+{
+	if ( threadCount == 0 )
+		threadCount = std::max( 2u, std::thread::hardware_concurrency() ) - 1;
+
+	m_threads.reserve( threadCount );
+	for ( unsigned i = 0; i < threadCount; ++i )
+		m_threads.emplace_back( [ this ]() { Run(); } );
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for ( std::thread& thread : m_threads )
+		thread.join();
+}
+
+void WorkerPool::Enqueue( std::function<void()> job )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_jobs.push_back( std::move( job ) );
+	}
+	m_jobAvailable.notify_one();
+}
+
+void WorkerPool::Run()
+{
+	for ( ;; )
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_jobAvailable.wait( lock, [ this ]() { return m_stopping || !m_jobs.empty(); } );
+
+			// the queue is drained before stopping
+			if ( m_jobs.empty() ) return;
+
+			job = std::move( m_jobs.front() );
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+void WorkerPool::ParallelFor( const std::size_t count, const std::function<void( std::size_t )>& body )
+{
+	if ( count == 0 ) return;
+
+	// every participant takes the next index until none is left, so uneven items balance out
+	std::atomic<std::size_t> next{ 0 };
+	auto work = [ &next, count, &body ]()
+	{
+		for ( std::size_t i = next++; i < count; i = next++ )
+			body( i );
+	};
+
+	const std::size_t helperCount = std::min<std::size_t>( m_threads.size(), count - 1 );
+	std::vector<std::future<void>> helpers;
+	helpers.reserve( helperCount );
+	for ( std::size_t i = 0; i < helperCount; ++i )
+		helpers.push_back( Submit( work ) );
+
+	// the calling thread works too instead of just waiting; the helpers reference this frame,
+	// so they are waited for even if body throws
+	std::exception_ptr error;
+	try
+	{
+		work();
+	}
+	catch ( ... )
+	{
+		error = std::current_exception();
+		next = count;
+	}
+
+	for ( std::future<void>& helper : helpers )
+		helper.wait();
+
+	if ( error )
+		std::rethrow_exception( error );
+	for ( std::future<void>& helper : helpers )
+		helper.get();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed set of worker threads running queued jobs in submission order.
+// Jobs must not touch GL, the context belongs to the main thread.
+class WorkerPool
+{
+public:
+	// 0: one thread per hardware thread, minus the main thread, at least one
+	explicit WorkerPool( unsigned threadCount = 0 );
+	// Runs the jobs already queued, then joins the threads.
+	~WorkerPool();
+
+	WorkerPool( const WorkerPool& ) = delete;
+	WorkerPool& operator=( const WorkerPool& ) = delete;
+
+	// Queues job() and returns the future of its result. Exceptions end up in the future.
+	template <typename Job>
+	std::future<std::invoke_result_t<Job>> Submit( Job&& job );
+
+	// Runs body( i ) for every i in [ 0, count ) on the workers and the calling thread, returns when all are done.
+	void ParallelFor( const std::size_t count, const std::function<void( std::size_t )>& body );
+
+	inline unsigned GetThreadCount() const noexcept { return static_cast<unsigned>( m_threads.size() ); }
+
+private:
+	void Enqueue( std::function<void()> job );
+	void Run();
+
+	std::vector<std::thread>          m_threads;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex                        m_mutex;
+	std::condition_variable           m_jobAvailable;
+	bool                              m_stopping = false;
+};
+
+template <typename Job>
+std::future<std::invoke_result_t<Job>> WorkerPool::Submit( Job&& job )
+{
+	// std::function needs a copyable target, the task is shared instead
+	auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Job>()>>( std::forward<Job>( job ) );
+	std::future<std::invoke_result_t<Job>> result = task->get_future();
+	Enqueue( [ task ]() { ( *task )(); } );
+	return result;
+}
@@ -11,8 +11,10 @@
 #include <imgui_impl_opengl3.h>
 
 // standard
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 
 #include "MyApp.h"
 
@@ -35,6 +37,16 @@ int main( int argc, char* args[] )
 	// Miután az SDL Init lefutott, kilépésnél fusson le az alrendszerek kikapcsolása.
 	// Így akkor is lefut, ha valamilyen hiba folytán lépünk ki.
 	std::atexit(SDL_Quit);
+
+	// csak az asset csomag elkészítése, ablak nélkül: --build-asset-pack [--decode-images]
+	if ( argc > 1 && std::string_view( args[ 1 ] ) == "--build-asset-pack" )
+		return CMyApp::BuildAssetPack( AssetPack::DEFAULT_FILE, argc > 2 && std::string_view( args[ 2 ] ) == "--decode-images" ) ? 0 : 1;
+
+	// a textúrák videomemória-kerete: --texture-budget <MB>, ha egy gépen több példány fut
+	int textureBudgetMB = 0;
+	for ( int i = 1; i + 1 < argc; ++i )
+		if ( std::string_view( args[ i ] ) == "--texture-budget" )
+			textureBudgetMB = std::atoi( args[ i + 1 ] );
 			
 	//
 	// 2. lépés: állítsuk be az OpenGL-es igényeinket, hozzuk létre az ablakunkat, indítsuk el az OpenGL-t
@@ -148,6 +160,8 @@ int main( int argc, char* args[] )
 
 		// alkalmazás példánya
 		CMyApp app;
+		if ( textureBudgetMB > 0 )
+			app.SetTextureBudget( textureBudgetMB );
 		if (!app.Init())
 		{
 			SDL_GL_DeleteContext(context);